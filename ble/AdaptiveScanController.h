@@ -0,0 +1,166 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADAPTIVE_SCAN_CONTROLLER_H__
+#define __ADAPTIVE_SCAN_CONTROLLER_H__
+
+#include <stdint.h>
+
+#include "blecommon.h"
+
+class Gap;
+
+/**
+ * Number of duty-cycle levels of an AdaptiveScanController, from the fast
+ * settings to the slow settings.
+ */
+#ifndef BLE_ADAPTIVE_SCAN_LEVELS
+#define BLE_ADAPTIVE_SCAN_LEVELS 4
+#endif
+
+#if BLE_ADAPTIVE_SCAN_LEVELS < 2
+#error "BLE_ADAPTIVE_SCAN_LEVELS must be at least 2"
+#endif
+
+/**
+ * @brief Adapt the scan duty cycle to the rate of new discoveries.
+ *
+ * The controller moves the scan interval and window of a Gap between fast
+ * settings and slow settings, over BLE_ADAPTIVE_SCAN_LEVELS levels. Time
+ * is divided in evaluation periods; at the end of each period:
+ *
+ * - if at least burstThreshold new devices were discovered, the fast
+ *   settings are applied at once;
+ * - if no new device was discovered, the settings move one level towards
+ *   the slow settings;
+ * - otherwise the settings are kept.
+ *
+ * Settings are applied with Gap::updateScanParams(), which restarts the
+ * radio scan only when the interval or the window actually change.
+ *
+ * The application reports discoveries with recordNewDevice(), for instance
+ * when a ScanResultCache reports a device seen for the first time, and
+ * calls process() from a timer:
+ *
+ * @code
+ * AdaptiveScanController controller(ble.gap(), 100, 100, 1000, 50);
+ *
+ * void onDevice(const ScanResultCache<32>::Device_t *device) {
+ *     if (device->hitCount == 1) {
+ *         controller.recordNewDevice();
+ *     }
+ * }
+ *
+ * controller.start(clock.read_ms());
+ * ble.gap().startScan(&cache, &ScanResultCache<32>::processReport);
+ * @endcode
+ */
+class AdaptiveScanController {
+public:
+    /**
+     * Construct a controller of the scan settings of @p gapIn.
+     *
+     * @param[in] gapIn
+     *              The Gap which scans.
+     * @param[in] fastIntervalIn
+     *              Scan interval applied when new devices appear, in ms.
+     * @param[in] fastWindowIn
+     *              Scan window applied when new devices appear, in ms.
+     * @param[in] slowIntervalIn
+     *              Scan interval applied in a stable environment, in ms.
+     * @param[in] slowWindowIn
+     *              Scan window applied in a stable environment, in ms.
+     * @param[in] evaluationPeriodIn
+     *              Duration of an evaluation period, in ms.
+     * @param[in] burstThresholdIn
+     *              Number of new devices in a period which brings back the
+     *              fast settings.
+     */
+    AdaptiveScanController(Gap      &gapIn,
+                           uint16_t  fastIntervalIn,
+                           uint16_t  fastWindowIn,
+                           uint16_t  slowIntervalIn,
+                           uint16_t  slowWindowIn,
+                           uint32_t  evaluationPeriodIn = 5000,
+                           uint8_t   burstThresholdIn   = 1);
+
+    /**
+     * Apply the fast settings and start the first evaluation period.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The result of Gap::updateScanParams().
+     */
+    ble_error_t start(uint32_t now);
+
+    /**
+     * Record the discovery of a new device in the current period.
+     */
+    void recordNewDevice(void) {
+        if (newDevices < 0xFFFF) {
+            ++newDevices;
+        }
+    }
+
+    /**
+     * End the evaluation period if it is over, and adapt the settings.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again.
+     */
+    uint32_t process(uint32_t now);
+
+    /**
+     * Get the current level, from 0 (fast settings) to
+     * BLE_ADAPTIVE_SCAN_LEVELS - 1 (slow settings).
+     */
+    uint8_t getLevel(void) const {
+        return level;
+    }
+
+    /**
+     * Get the number of times new settings were applied.
+     */
+    uint32_t getUpdateCount(void) const {
+        return updateCount;
+    }
+
+private:
+    /**
+     * Apply the settings of @p newLevel.
+     */
+    ble_error_t applyLevel(uint8_t newLevel);
+
+private:
+    Gap      &gap;
+    uint16_t  fastInterval;
+    uint16_t  fastWindow;
+    uint16_t  slowInterval;
+    uint16_t  slowWindow;
+    uint32_t  evaluationPeriod;
+    uint8_t   burstThreshold;
+
+    uint8_t   level;
+    uint16_t  newDevices;
+    uint32_t  periodEnd;
+    uint32_t  updateCount;
+};
+
+#endif /* ifndef __ADAPTIVE_SCAN_CONTROLLER_H__ */
@@ -0,0 +1,229 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISEMENT_REPORT_BATCHER_H__
+#define __ADVERTISEMENT_REPORT_BATCHER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Gap.h"
+#include "FunctionPointerWithContext.h"
+
+/**
+ * @brief Deliver advertisement reports to the application in batches.
+ *
+ * Reports are copied into the batch as they arrive: their parameters into
+ * an array, their payloads into a byte arena. The batch is passed to the
+ * application in a single callback when it holds MaxReports reports, when
+ * the arena cannot hold the next payload, or when the oldest report of the
+ * batch is older than the maximum latency, whichever comes first.
+ *
+ * @code
+ * AdvertisementReportBatcher<16> batcher(100, us_ticker_read_ms);
+ *
+ * void onBatch(const AdvertisementReportBatcher<16>::Batch_t *batch) {
+ *     for (unsigned i = 0; i < batch->count; ++i) {
+ *         // batch->reports[i].peerAddr, batch->reports[i].advertisingData...
+ *     }
+ * }
+ *
+ * batcher.onBatch(onBatch);
+ * ble.gap().startScan(&batcher, &AdvertisementReportBatcher<16>::processReport);
+ * @endcode
+ *
+ * The latency is checked when a report arrives; to deliver the last batch
+ * of a quiet period, the application also calls process() from a timer,
+ * after the delay it returns.
+ *
+ * @tparam MaxReports Maximum number of reports of a batch.
+ * @tparam ArenaSize  Number of bytes of payload a batch can hold. By default
+ *                    every report can carry a full legacy payload.
+ */
+template <unsigned MaxReports, unsigned ArenaSize = MaxReports * GAP_ADVERTISING_DATA_MAX_PAYLOAD>
+class AdvertisementReportBatcher {
+public:
+    /**
+     * A batch of reports.
+     */
+    struct Batch_t {
+        const Gap::AdvertisementCallbackParams_t *reports; /**< The reports, in reception order. */
+        unsigned                                  count;   /**< Number of reports. */
+    };
+
+    /**
+     * Batch callback.
+     */
+    typedef FunctionPointerWithContext<const Batch_t *> BatchCallback_t;
+
+public:
+    /**
+     * Construct an empty batcher.
+     *
+     * @param[in] maxLatencyIn
+     *              Maximum time, in milliseconds, a report is held before
+     *              its batch is delivered.
+     * @param[in] clockIn
+     *              Function returning the current time in milliseconds,
+     *              used by processReport(). If NULL, batches are only
+     *              delivered when they are full or by process().
+     */
+    AdvertisementReportBatcher(uint32_t maxLatencyIn, uint32_t (*clockIn)(void) = NULL) :
+        maxLatency(maxLatencyIn),
+        clock(clockIn),
+        batchCallback(NULL),
+        count(0),
+        arenaUsed(0),
+        deadline(0),
+        droppedCount(0) {
+        /* empty */
+    }
+
+    /**
+     * Add a report to the batch, delivering the batch first if there is no
+     * room left for the report, and after if it is full or its latency
+     * expired. This can be used as the scan callback.
+     *
+     * @param[in] params
+     *              The report.
+     */
+    void processReport(const Gap::AdvertisementCallbackParams_t *params) {
+        uint32_t now = clock ? clock() : 0;
+        add(params, now);
+        if (clock) {
+            process(now);
+        }
+    }
+
+    /**
+     * Add a report to the batch, delivering the batch first if there is no
+     * room left for the report.
+     *
+     * @param[in] params
+     *              The report.
+     * @param[in] now
+     *              The current time, in milliseconds.
+     */
+    void add(const Gap::AdvertisementCallbackParams_t *params, uint32_t now) {
+        if (params->advertisingDataLen > ArenaSize) {
+            ++droppedCount;
+            return;
+        }
+        if ((count == MaxReports) || ((arenaUsed + params->advertisingDataLen) > ArenaSize)) {
+            flush();
+        }
+        if (count == 0) {
+            deadline = now + maxLatency;
+        }
+
+        Gap::AdvertisementCallbackParams_t &report = reports[count++];
+        report                 = *params;
+        report.advertisingData = &arena[arenaUsed];
+        memcpy(&arena[arenaUsed], params->advertisingData, params->advertisingDataLen);
+        arenaUsed += params->advertisingDataLen;
+
+        if (count == MaxReports) {
+            flush();
+        }
+    }
+
+    /**
+     * Deliver the batch if its latency expired.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again, or 0 if the batch is empty.
+     */
+    uint32_t process(uint32_t now) {
+        if (count == 0) {
+            return 0;
+        }
+        if ((int32_t)(now - deadline) >= 0) {
+            flush();
+            return 0;
+        }
+
+        return deadline - now;
+    }
+
+    /**
+     * Deliver the batch now, if it is not empty.
+     */
+    void flush(void) {
+        if (count == 0) {
+            return;
+        }
+
+        Batch_t batch = { reports, count };
+        count     = 0;
+        arenaUsed = 0;
+        if (batchCallback) {
+            batchCallback.call(&batch);
+        }
+    }
+
+    /**
+     * Get the number of reports waiting in the batch.
+     */
+    unsigned getPendingCount(void) const {
+        return count;
+    }
+
+    /**
+     * Get the number of reports dropped because their payload was larger
+     * than the arena.
+     */
+    uint32_t getDroppedCount(void) const {
+        return droppedCount;
+    }
+
+    /**
+     * Set up the callback receiving the batches. The batch passed to the
+     * callback is only valid until the callback returns.
+     */
+    void onBatch(void (*callback)(const Batch_t *batch)) {
+        batchCallback.attach(callback);
+    }
+
+    /**
+     * Same as onBatch(), with an object and a member function.
+     */
+    template <typename T>
+    void onBatch(T *objPtr, void (T::*memberPtr)(const Batch_t *batch)) {
+        batchCallback.attach(objPtr, memberPtr);
+    }
+
+private:
+    /* Disallow copy and assignment. */
+    AdvertisementReportBatcher(const AdvertisementReportBatcher &);
+    AdvertisementReportBatcher& operator=(const AdvertisementReportBatcher &);
+
+private:
+    uint32_t                            maxLatency;
+    uint32_t                          (*clock)(void);
+    BatchCallback_t                     batchCallback;
+
+    Gap::AdvertisementCallbackParams_t  reports[MaxReports];
+    unsigned                            count;
+    uint8_t                             arena[ArenaSize];
+    unsigned                            arenaUsed;
+    uint32_t                            deadline;
+    uint32_t                            droppedCount;
+};
+
+#endif /* ifndef __ADVERTISEMENT_REPORT_BATCHER_H__ */
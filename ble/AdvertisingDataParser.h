@@ -0,0 +1,331 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISING_DATA_PARSER_H__
+#define __ADVERTISING_DATA_PARSER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "GapAdvertisingData.h"
+#include "UUID.h"
+
+/**
+ * @brief Parse the AD structures of an advertising payload in place.
+ *
+ * The parser holds a pointer to the payload; it neither copies nor
+ * allocates. It can be used on the payload of an advertisement report, as
+ * well as on a payload built locally with GapAdvertisingData:
+ *
+ * @code
+ * void onAdvertisement(const Gap::AdvertisementCallbackParams_t *params) {
+ *     AdvertisingDataParser parser(params->advertisingData, params->advertisingDataLen);
+ *
+ *     AdvertisingDataParser::Field_t field;
+ *     while (parser.getNextField(field)) {
+ *         // field.type, field.value and field.length describe one AD structure.
+ *     }
+ *
+ *     uint16_t       companyID;
+ *     const uint8_t *data;
+ *     uint8_t        dataLen;
+ *     if (parser.getManufacturerSpecificData(companyID, data, dataLen)) {
+ *         // ...
+ *     }
+ * }
+ * @endcode
+ *
+ * The length of every AD structure is checked against the end of the
+ * payload. A structure which overflows the payload ends the parsing, as if
+ * the payload ended before it, and isMalformed() reports it. A structure of
+ * length zero marks the end of the significant part of the payload.
+ */
+class AdvertisingDataParser {
+public:
+    /**
+     * An AD structure of the payload.
+     */
+    struct Field_t {
+        GapAdvertisingData::DataType_t  type;   /**< AD type of the structure. */
+        const uint8_t                  *value;  /**< Value of the structure, inside the parsed payload. */
+        uint8_t                         length; /**< Length of the value, in bytes. */
+    };
+
+public:
+    /**
+     * Parse the payload @p payload of @p length bytes.
+     */
+    AdvertisingDataParser(const uint8_t *payload, uint16_t length) :
+        _payload(payload), _length(length), _position(0) {
+        /* empty */
+    }
+
+    /**
+     * Parse the payload held by @p advertisingData.
+     */
+    template <uint16_t MaxPayloadLen>
+    AdvertisingDataParser(const BasicGapAdvertisingData<MaxPayloadLen> &advertisingData) :
+        _payload(advertisingData.getPayload()), _length(advertisingData.getPayloadLen()), _position(0) {
+        /* empty */
+    }
+
+    /**
+     * Get the next AD structure of the payload.
+     *
+     * @param[out] field
+     *              Set to the next AD structure if there is one.
+     *
+     * @return true if @p field was set, false if the end of the payload was
+     *         reached.
+     */
+    bool getNextField(Field_t &field) {
+        if (!readField(_position, field)) {
+            _position = _length;
+            return false;
+        }
+
+        _position += field.length + 2;
+        return true;
+    }
+
+    /**
+     * Restart the iteration from the first AD structure.
+     */
+    void rewind(void) {
+        _position = 0;
+    }
+
+    /**
+     * Find the first AD structure of type @p type, in a single pass over the
+     * payload. This does not affect getNextField().
+     *
+     * @param[in]  type
+     *              The AD type to look for.
+     * @param[out] field
+     *              Set to the AD structure if it is found.
+     *
+     * @return true if the AD structure was found.
+     */
+    bool findField(GapAdvertisingData::DataType_t type, Field_t &field) const {
+        for (uint16_t position = 0; readField(position, field); position += field.length + 2) {
+            if (field.type == type) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Check whether the payload contains an AD structure which overflows
+     * the payload.
+     */
+    bool isMalformed(void) const {
+        Field_t  field;
+        uint16_t position = 0;
+        while (readField(position, field)) {
+            position += field.length + 2;
+        }
+
+        return (position < _length) && (_payload[position] != 0);
+    }
+
+    /**
+     * Get the value of the FLAGS AD structure.
+     *
+     * @param[out] flags
+     *              Set to the flags, see GapAdvertisingData::Flags_t.
+     *
+     * @return true if the payload contains flags.
+     */
+    bool getFlags(uint8_t &flags) const {
+        Field_t field;
+        if (!findField(GapAdvertisingData::FLAGS, field) || (field.length < 1)) {
+            return false;
+        }
+
+        flags = field.value[0];
+        return true;
+    }
+
+    /**
+     * Get the value of the TX_POWER_LEVEL AD structure.
+     *
+     * @param[out] txPower
+     *              Set to the advertised transmit power, in dBm.
+     *
+     * @return true if the payload contains a transmit power level.
+     */
+    bool getTxPower(int8_t &txPower) const {
+        Field_t field;
+        if (!findField(GapAdvertisingData::TX_POWER_LEVEL, field) || (field.length < 1)) {
+            return false;
+        }
+
+        txPower = (int8_t)field.value[0];
+        return true;
+    }
+
+    /**
+     * Get the service UUIDs listed in the payload, in all the lists of
+     * 16-bit, 32-bit and 128-bit service UUIDs, complete or not.
+     *
+     * @param[out] uuids
+     *              Array filled with the UUIDs found. 32-bit UUIDs are
+     *              converted to 128-bit UUIDs with the Bluetooth base UUID.
+     * @param[in]  maxCount
+     *              Number of elements of @p uuids.
+     *
+     * @return The number of UUIDs listed in the payload; it can be greater
+     *         than @p maxCount, in which case only the first @p maxCount
+     *         UUIDs are returned.
+     */
+    unsigned getServiceUUIDs(UUID uuids[], unsigned maxCount) const {
+        unsigned count = 0;
+        Field_t  field;
+        for (uint16_t position = 0; readField(position, field); position += field.length + 2) {
+            unsigned uuidSize;
+            switch (field.type) {
+                case GapAdvertisingData::INCOMPLETE_LIST_16BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS:
+                    uuidSize = sizeof(UUID::ShortUUIDBytes_t);
+                    break;
+                case GapAdvertisingData::INCOMPLETE_LIST_32BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_32BIT_SERVICE_IDS:
+                    uuidSize = sizeof(uint32_t);
+                    break;
+                case GapAdvertisingData::INCOMPLETE_LIST_128BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_128BIT_SERVICE_IDS:
+                    uuidSize = UUID::LENGTH_OF_LONG_UUID;
+                    break;
+                default:
+                    continue;
+            }
+
+            for (unsigned offset = 0; (offset + uuidSize) <= field.length; offset += uuidSize, ++count) {
+                if (count < maxCount) {
+                    uuids[count] = readUUID(&field.value[offset], uuidSize);
+                }
+            }
+        }
+
+        return count;
+    }
+
+    /**
+     * Get the value of the MANUFACTURER_SPECIFIC_DATA AD structure.
+     *
+     * @param[out] companyID
+     *              Set to the company identifier which starts the value.
+     * @param[out] data
+     *              Set to the data following the company identifier, inside
+     *              the parsed payload.
+     * @param[out] length
+     *              Set to the length of @p data.
+     *
+     * @return true if the payload contains manufacturer specific data.
+     */
+    bool getManufacturerSpecificData(uint16_t &companyID, const uint8_t *&data, uint8_t &length) const {
+        Field_t field;
+        if (!findField(GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA, field) || (field.length < sizeof(uint16_t))) {
+            return false;
+        }
+
+        companyID = field.value[0] | (field.value[1] << 8);
+        data      = &field.value[sizeof(uint16_t)];
+        length    = field.length - sizeof(uint16_t);
+        return true;
+    }
+
+    /**
+     * Get the data of the SERVICE_DATA AD structure of the service @p uuid.
+     *
+     * @param[in]  uuid
+     *              The 16-bit UUID of the service.
+     * @param[out] data
+     *              Set to the data following the service UUID, inside the
+     *              parsed payload.
+     * @param[out] length
+     *              Set to the length of @p data.
+     *
+     * @return true if the payload contains data for the service.
+     */
+    bool getServiceData(UUID::ShortUUIDBytes_t uuid, const uint8_t *&data, uint8_t &length) const {
+        Field_t field;
+        for (uint16_t position = 0; readField(position, field); position += field.length + 2) {
+            if ((field.type != GapAdvertisingData::SERVICE_DATA) || (field.length < sizeof(uuid))) {
+                continue;
+            }
+            if ((field.value[0] | (field.value[1] << 8)) == uuid) {
+                data   = &field.value[sizeof(uuid)];
+                length = field.length - sizeof(uuid);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    /**
+     * Read the AD structure starting at @p position.
+     *
+     * @return false if there is no valid AD structure at @p position.
+     */
+    bool readField(uint16_t position, Field_t &field) const {
+        if ((position + 1) >= _length) {
+            return false;
+        }
+
+        uint8_t fieldLength = _payload[position];
+        if ((fieldLength == 0) || ((position + 1 + fieldLength) > _length)) {
+            return false;
+        }
+
+        field.type   = (GapAdvertisingData::DataType_t)_payload[position + 1];
+        field.value  = &_payload[position + 2];
+        field.length = fieldLength - 1;
+        return true;
+    }
+
+    /**
+     * Build a UUID from its advertised form, in little endian.
+     */
+    static UUID readUUID(const uint8_t *value, unsigned size) {
+        if (size == sizeof(UUID::ShortUUIDBytes_t)) {
+            return UUID((UUID::ShortUUIDBytes_t)(value[0] | (value[1] << 8)));
+        }
+
+        /* Bluetooth base UUID, least significant byte first. */
+        UUID::LongUUIDBytes_t longUUID = {
+            0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80,
+            0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+        if (size == sizeof(uint32_t)) {
+            memcpy(&longUUID[12], value, sizeof(uint32_t));
+        } else {
+            memcpy(longUUID, value, UUID::LENGTH_OF_LONG_UUID);
+        }
+        return UUID(longUUID, UUID::LSB);
+    }
+
+private:
+    const uint8_t *_payload;
+    uint16_t       _length;
+    uint16_t       _position;
+};
+
+#endif /* ifndef __ADVERTISING_DATA_PARSER_H__ */
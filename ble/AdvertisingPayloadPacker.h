@@ -0,0 +1,186 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISING_PAYLOAD_PACKER_H__
+#define __ADVERTISING_PAYLOAD_PACKER_H__
+
+#include <stdint.h>
+
+#include "GapAdvertisingData.h"
+#include "blecommon.h"
+
+/**
+ * @brief Distribute prioritized AD structures between the advertising
+ * payload and the scan response.
+ *
+ * Fields are placed in decreasing order of priority, fields of equal
+ * priority in the order they were added. Each field goes into the
+ * advertising payload if it fits there, otherwise into the scan response.
+ * A COMPLETE_LOCAL_NAME which fits in neither is truncated and placed as a
+ * SHORTENED_LOCAL_NAME. FLAGS are only ever placed in the advertising
+ * payload. A field which cannot be placed is dropped, and the packing
+ * carries on with the following fields, which may be smaller.
+ *
+ * @code
+ * AdvertisingPayloadPacker<4> packer;
+ * packer.addField(GapAdvertisingData::FLAGS, &flags, 1, 255);
+ * packer.addField(GapAdvertisingData::COMPLETE_LIST_128BIT_SERVICE_IDS, uuid, 16, 200);
+ * packer.addField(GapAdvertisingData::COMPLETE_LOCAL_NAME, (const uint8_t *)name, strlen(name), 100);
+ * packer.addField(GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA, data, sizeof(data), 50);
+ *
+ * unsigned dropped;
+ * ble.gap().setAdvertisingPayload(packer, &dropped);
+ * @endcode
+ *
+ * @note The packer keeps pointers to the values of the fields; they must
+ *       remain valid until the payloads are packed.
+ *
+ * @tparam MaxFields Maximum number of fields.
+ */
+template <unsigned MaxFields>
+class AdvertisingPayloadPacker {
+public:
+    /**
+     * Construct an empty packer.
+     *
+     * @param[in] minShortenedNameLenIn
+     *              Minimum number of characters of a shortened local name.
+     *              A name which cannot keep that many characters is dropped.
+     */
+    AdvertisingPayloadPacker(uint8_t minShortenedNameLenIn = 1) :
+        fieldCount(0), minShortenedNameLen(minShortenedNameLenIn) {
+        /* empty */
+    }
+
+    /**
+     * Add a field to pack.
+     *
+     * @param[in] type
+     *              The AD type of the field.
+     * @param[in] value
+     *              The value of the field. It is not copied.
+     * @param[in] len
+     *              The length of @p value.
+     * @param[in] priority
+     *              The priority of the field; fields of higher priority are
+     *              placed first.
+     *
+     * @return BLE_ERROR_NONE if the field was added, or BLE_ERROR_NO_MEM if
+     *         MaxFields fields were already added.
+     */
+    ble_error_t addField(GapAdvertisingData::DataType_t type, const uint8_t *value, uint8_t len, uint8_t priority) {
+        if (fieldCount == MaxFields) {
+            return BLE_ERROR_NO_MEM;
+        }
+
+        /* Keep the fields sorted by decreasing priority, in insertion order. */
+        unsigned index = fieldCount++;
+        for (; (index > 0) && (fields[index - 1].priority < priority); --index) {
+            fields[index] = fields[index - 1];
+        }
+
+        fields[index].type     = type;
+        fields[index].value    = value;
+        fields[index].len      = len;
+        fields[index].priority = priority;
+
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Remove all the fields.
+     */
+    void clear(void) {
+        fieldCount = 0;
+    }
+
+    /**
+     * Get the number of fields added.
+     */
+    unsigned getFieldCount(void) const {
+        return fieldCount;
+    }
+
+    /**
+     * Pack the fields.
+     *
+     * @param[out] advData
+     *              Set to the advertising payload.
+     * @param[out] scanResponse
+     *              Set to the scan response.
+     *
+     * @return The number of fields which could not be placed.
+     */
+    unsigned pack(GapAdvertisingData &advData, GapAdvertisingData &scanResponse) const {
+        unsigned dropped = 0;
+
+        advData.clear();
+        scanResponse.clear();
+        for (unsigned i = 0; i < fieldCount; ++i) {
+            const Field &field = fields[i];
+
+            if (advData.addData(field.type, field.value, field.len) == BLE_ERROR_NONE) {
+                continue;
+            }
+            if ((field.type != GapAdvertisingData::FLAGS) &&
+                (scanResponse.addData(field.type, field.value, field.len) == BLE_ERROR_NONE)) {
+                continue;
+            }
+            if ((field.type == GapAdvertisingData::COMPLETE_LOCAL_NAME) && addShortenedName(field, advData, scanResponse)) {
+                continue;
+            }
+
+            ++dropped;
+        }
+
+        return dropped;
+    }
+
+private:
+    /**
+     * A field to pack.
+     */
+    struct Field {
+        GapAdvertisingData::DataType_t  type;
+        const uint8_t                  *value;
+        uint8_t                         len;
+        uint8_t                         priority;
+    };
+
+    /**
+     * Place a truncated name in the payload which has the most room left.
+     *
+     * @return true if the name was placed.
+     */
+    bool addShortenedName(const Field &field, GapAdvertisingData &advData, GapAdvertisingData &scanResponse) const {
+        GapAdvertisingData &payload = (advData.getPayloadLen() <= scanResponse.getPayloadLen()) ? advData : scanResponse;
+
+        /* The AD structure header takes two bytes. */
+        unsigned room = GAP_ADVERTISING_DATA_MAX_PAYLOAD - payload.getPayloadLen();
+        if ((room < 2) || ((room - 2) < minShortenedNameLen)) {
+            return false;
+        }
+
+        return payload.addData(GapAdvertisingData::SHORTENED_LOCAL_NAME, field.value, room - 2) == BLE_ERROR_NONE;
+    }
+
+private:
+    Field    fields[MaxFields];
+    unsigned fieldCount;
+    uint8_t  minShortenedNameLen;
+};
+
+#endif /* ifndef __ADVERTISING_PAYLOAD_PACKER_H__ */
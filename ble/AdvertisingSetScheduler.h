@@ -0,0 +1,580 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISING_SET_SCHEDULER_H__
+#define __ADVERTISING_SET_SCHEDULER_H__
+
+#include <stdint.h>
+
+#include "Gap.h"
+#include "GapAdvertisingData.h"
+#include "GapAdvertisingParams.h"
+#include "FunctionPointerWithContext.h"
+
+/**
+ * @brief Advertise several payloads, each with its own parameters, period
+ * and weight.
+ *
+ * Legacy advertising carries a single payload at a time. The scheduler
+ * rotates the registered advertising sets through it: time is divided in
+ * slots, and at the start of each slot the set which is the most overdue
+ * is put on air. A set with a weight of N stays on air for N consecutive
+ * slots each time it is due. When no set is due, advertising is stopped
+ * until the next one is.
+ *
+ * The payloads of a set are built once, when the set is added or updated;
+ * switching sets then costs a single call to the stack for both payloads.
+ *
+ * The scheduler has no timer of its own. The application calls process()
+ * from a single timer, which it reschedules with the delay returned:
+ *
+ * @code
+ * AdvertisingSetScheduler<3> scheduler(ble.gap());
+ * Timeout                    schedulerTimeout;
+ *
+ * void onSchedulerTimeout(void) {
+ *     uint32_t delay = scheduler.process(clock.read_ms());
+ *     if (delay) {
+ *         schedulerTimeout.attach_us(onSchedulerTimeout, delay * 1000);
+ *     }
+ * }
+ *
+ * scheduler.addSet(uidParams, uidFrame, GapAdvertisingData(), 1000, 1, &uidSet);
+ * scheduler.addSet(urlParams, urlFrame, GapAdvertisingData(), 1000, 1, &urlSet);
+ * scheduler.addSet(tlmParams, tlmFrame, GapAdvertisingData(), 10000, 1, &tlmSet);
+ * if (scheduler.start(clock.read_ms()) == BLE_ERROR_NONE) {
+ *     onSchedulerTimeout();
+ * }
+ * @endcode
+ *
+ * A set which could not be put on air for a whole period, because other
+ * sets kept the slots, has missed a slot; missed slots are counted per set
+ * and reported through onMissedSlot(). A set the stack refuses to
+ * advertise is skipped until it is due again, and the next set due is put
+ * on air instead; these failures are counted per set too (see
+ * getFailedSlots()).
+ *
+ * If the underlying stack supports at least as many concurrent advertising
+ * sets as were added (see Gap::getMaxAdvertisingSetCount()), start() hands
+ * every set to the stack instead, and process() has nothing left to do.
+ * The controller then advertises each set at the interval of its
+ * parameters; periods and weights are not used.
+ *
+ * @tparam MaxSets Maximum number of advertising sets.
+ */
+template <unsigned MaxSets>
+class AdvertisingSetScheduler {
+public:
+    /**
+     * Type for the handle of an advertising set of the scheduler.
+     */
+    typedef uint8_t SetHandle_t;
+
+    /**
+     * Handle which does not refer to any advertising set.
+     */
+    static const SetHandle_t INVALID_SET_HANDLE = 0xFF;
+
+    /**
+     * Parameters of the missed slot callback.
+     */
+    struct MissedSlotCallbackParams_t {
+        SetHandle_t set;         /**< The advertising set which missed slots. */
+        uint32_t    missedSlots; /**< Number of slots missed since the set was last on air. */
+    };
+
+    /**
+     * Missed slot callback.
+     */
+    typedef FunctionPointerWithContext<const MissedSlotCallbackParams_t *> MissedSlotCallback_t;
+
+public:
+    /**
+     * Construct a scheduler driving the advertising of @p gapIn.
+     *
+     * @param[in] gapIn
+     *              The Gap which advertises the sets.
+     * @param[in] slotDurationIn
+     *              Duration of a slot, in milliseconds. It should cover a
+     *              few advertising intervals of the sets.
+     */
+    AdvertisingSetScheduler(Gap &gapIn, uint16_t slotDurationIn = 100) :
+        gap(gapIn),
+        slotDuration(slotDurationIn),
+        running(false),
+        offloaded(false),
+        onAir(INVALID_SET_HANDLE),
+        slotsLeft(0),
+        slotEnd(0),
+        missedSlotCallback(NULL) {
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            sets[i].used = false;
+        }
+    }
+
+    /**
+     * Add an advertising set. Sets added while the scheduler is running
+     * are scheduled from their first due time, after one period.
+     *
+     * @param[in]  params
+     *              The advertising parameters of the set.
+     * @param[in]  advData
+     *              The advertising payload of the set.
+     * @param[in]  scanResponse
+     *              The scan response of the set.
+     * @param[in]  period
+     *              The set is put on air once every @p period milliseconds.
+     * @param[in]  weight
+     *              Number of consecutive slots the set stays on air.
+     * @param[out] setP
+     *              Set to the handle of the new advertising set.
+     *
+     * @return BLE_ERROR_NONE if the set was added;
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p period or @p weight is 0;
+     *         BLE_ERROR_NO_MEM if there is no room left for another set;
+     *         BLE_ERROR_INVALID_STATE if the sets are offloaded to the stack.
+     */
+    ble_error_t addSet(const GapAdvertisingParams &params,
+                       const GapAdvertisingData   &advData,
+                       const GapAdvertisingData   &scanResponse,
+                       uint32_t                    period,
+                       uint8_t                     weight,
+                       SetHandle_t                *setP) {
+        if ((period == 0) || (weight == 0)) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+        if (offloaded) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            if (sets[i].used) {
+                continue;
+            }
+
+            Set &set           = sets[i];
+            set.used           = true;
+            set.params         = params;
+            set.advData        = advData;
+            set.scanResponse   = scanResponse;
+            set.period         = period;
+            set.weight         = weight;
+            set.missedSlots    = 0;
+            set.failedSlots    = 0;
+            set.due            = running ? (slotEnd + period) : 0;
+            set.nativeHandle   = Gap::INVALID_ADVERTISING_SET_HANDLE;
+
+            *setP = i;
+            return BLE_ERROR_NONE;
+        }
+
+        return BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Replace the payloads of an advertising set. If the set is on air, the
+     * new payloads are passed to the stack immediately.
+     *
+     * @param[in] set
+     *              Handle of the advertising set.
+     * @param[in] advData
+     *              The new advertising payload.
+     * @param[in] scanResponse
+     *              The new scan response.
+     *
+     * @return BLE_ERROR_NONE if the payloads were replaced.
+     */
+    ble_error_t updateSet(SetHandle_t set, const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse) {
+        if (!isValid(set)) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+
+        ble_error_t rc = BLE_ERROR_NONE;
+        if (offloaded) {
+            if ((rc = gap.setAdvertisingSetPayload(sets[set].nativeHandle, advData)) == BLE_ERROR_NONE) {
+                rc = gap.setAdvertisingSetScanResponse(sets[set].nativeHandle, scanResponse);
+            }
+        } else if (set == onAir) {
+            rc = pushPayloads(advData, scanResponse);
+        }
+
+        if (rc == BLE_ERROR_NONE) {
+            sets[set].advData      = advData;
+            sets[set].scanResponse = scanResponse;
+        }
+
+        return rc;
+    }
+
+    /**
+     * Remove an advertising set. If the set is on air, advertising is
+     * stopped until the next set is due.
+     *
+     * @param[in] set
+     *              Handle of the advertising set.
+     *
+     * @return BLE_ERROR_NONE if the set was removed.
+     */
+    ble_error_t removeSet(SetHandle_t set) {
+        if (!isValid(set)) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+
+        if (offloaded) {
+            gap.destroyAdvertisingSet(sets[set].nativeHandle);
+        } else if (set == onAir) {
+            gap.stopAdvertising();
+            onAir     = INVALID_SET_HANDLE;
+            slotsLeft = 0;
+        }
+
+        sets[set].used = false;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Start advertising the sets. Every set is due immediately.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return BLE_ERROR_NONE if the scheduler was started, or
+     *         BLE_ERROR_INVALID_STATE if it is already running.
+     *
+     * @note When the sets are not offloaded to the stack, process() must
+     *       be called right after start() to put the first set on air.
+     */
+    ble_error_t start(uint32_t now) {
+        if (running) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            sets[i].due = now;
+        }
+        onAir     = INVALID_SET_HANDLE;
+        slotsLeft = 0;
+        slotEnd   = now;
+        running   = true;
+
+        offloaded = offload();
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Stop advertising the sets. The sets are kept and can be started
+     * again.
+     *
+     * @return BLE_ERROR_NONE if the scheduler was stopped, or
+     *         BLE_ERROR_INVALID_STATE if it was not running.
+     */
+    ble_error_t stop(void) {
+        if (!running) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+
+        if (offloaded) {
+            for (unsigned i = 0; i < MaxSets; ++i) {
+                if (sets[i].used) {
+                    gap.destroyAdvertisingSet(sets[i].nativeHandle);
+                    sets[i].nativeHandle = Gap::INVALID_ADVERTISING_SET_HANDLE;
+                }
+            }
+            offloaded = false;
+        } else if (onAir != INVALID_SET_HANDLE) {
+            gap.stopAdvertising();
+        }
+
+        onAir     = INVALID_SET_HANDLE;
+        slotsLeft = 0;
+        running   = false;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Run the scheduler: end the current slot if it is over and put on air
+     * the next set due. A set the stack refuses is skipped until it is due
+     * again, in favour of the following set due.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again, or 0 if the scheduler does not need to be
+     *         called (it is stopped, the sets are offloaded to the stack,
+     *         or there is no set).
+     */
+    uint32_t process(uint32_t now) {
+        if (!running || offloaded) {
+            return 0;
+        }
+
+        if ((onAir != INVALID_SET_HANDLE) && isBefore(now, slotEnd)) {
+            return slotEnd - now;
+        }
+
+        if ((onAir != INVALID_SET_HANDLE) && (--slotsLeft > 0)) {
+            slotEnd = now + slotDuration;
+            return slotDuration;
+        }
+
+        for (SetHandle_t next = selectDue(now); next != INVALID_SET_HANDLE; next = selectDue(now)) {
+            Set      &set    = sets[next];
+            uint32_t  missed = (now - set.due) / set.period;
+            set.due += (missed + 1) * set.period;
+            if (missed) {
+                set.missedSlots += missed;
+                if (missedSlotCallback) {
+                    MissedSlotCallbackParams_t params = { next, missed };
+                    missedSlotCallback.call(&params);
+                }
+            }
+
+            if ((next == onAir) || (putOnAir(next) == BLE_ERROR_NONE)) {
+                slotsLeft = set.weight;
+                slotEnd   = now + slotDuration;
+                return slotDuration;
+            }
+
+            /* The stack refused the set; it is skipped until it is due again. */
+            ++set.failedSlots;
+        }
+
+        if (onAir != INVALID_SET_HANDLE) {
+            gap.stopAdvertising();
+            onAir = INVALID_SET_HANDLE;
+        }
+        return getDelayToNextDue(now);
+    }
+
+    /**
+     * Get the number of slots an advertising set has missed since it was
+     * added.
+     *
+     * @param[in] set
+     *              Handle of the advertising set.
+     */
+    uint32_t getMissedSlots(SetHandle_t set) const {
+        return isValid(set) ? sets[set].missedSlots : 0;
+    }
+
+    /**
+     * Get the number of slots an advertising set has lost since it was
+     * added, because the stack refused its parameters or payloads, or to
+     * start advertising.
+     *
+     * @param[in] set
+     *              Handle of the advertising set.
+     */
+    uint32_t getFailedSlots(SetHandle_t set) const {
+        return isValid(set) ? sets[set].failedSlots : 0;
+    }
+
+    /**
+     * Get the advertising set currently on air.
+     *
+     * @return The handle of the set, or INVALID_SET_HANDLE if none is on air.
+     */
+    SetHandle_t getSetOnAir(void) const {
+        return onAir;
+    }
+
+    /**
+     * Check whether the scheduler is running.
+     */
+    bool isRunning(void) const {
+        return running;
+    }
+
+    /**
+     * Check whether the advertising sets were handed to the stack by
+     * start().
+     */
+    bool isOffloaded(void) const {
+        return offloaded;
+    }
+
+    /**
+     * Set up a callback invoked when an advertising set missed slots.
+     *
+     * @param[in] callback
+     *              The callback, or NULL to remove the current one.
+     */
+    void onMissedSlot(void (*callback)(const MissedSlotCallbackParams_t *)) {
+        missedSlotCallback.attach(callback);
+    }
+
+    /**
+     * Same as onMissedSlot(), with an object and a member function.
+     */
+    template <typename T>
+    void onMissedSlot(T *objPtr, void (T::*memberPtr)(const MissedSlotCallbackParams_t *)) {
+        missedSlotCallback.attach(objPtr, memberPtr);
+    }
+
+private:
+    /**
+     * An advertising set and its precomputed payloads.
+     */
+    struct Set {
+        bool                        used;
+        GapAdvertisingParams        params;
+        GapAdvertisingData          advData;
+        GapAdvertisingData          scanResponse;
+        uint32_t                    period;
+        uint32_t                    due;
+        uint32_t                    missedSlots;
+        uint32_t                    failedSlots;
+        uint8_t                     weight;
+        Gap::AdvertisingSetHandle_t nativeHandle;
+    };
+
+    /* Disallow copy and assignment. */
+    AdvertisingSetScheduler(const AdvertisingSetScheduler &);
+    AdvertisingSetScheduler& operator=(const AdvertisingSetScheduler &);
+
+    bool isValid(SetHandle_t set) const {
+        return (set < MaxSets) && sets[set].used;
+    }
+
+    /**
+     * Compare two times, allowing for the wrap-around of the clock.
+     */
+    static bool isBefore(uint32_t lhs, uint32_t rhs) {
+        return (int32_t)(lhs - rhs) < 0;
+    }
+
+    /**
+     * Select the set due which is the most overdue, the heaviest first on
+     * ties.
+     *
+     * @return The handle of the set, or INVALID_SET_HANDLE if none is due.
+     */
+    SetHandle_t selectDue(uint32_t now) const {
+        SetHandle_t next = INVALID_SET_HANDLE;
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            if (!sets[i].used || isBefore(now, sets[i].due)) {
+                continue;
+            }
+            if ((next == INVALID_SET_HANDLE) ||
+                isBefore(sets[i].due, sets[next].due) ||
+                ((sets[i].due == sets[next].due) && (sets[i].weight > sets[next].weight))) {
+                next = i;
+            }
+        }
+
+        return next;
+    }
+
+    uint32_t getDelayToNextDue(uint32_t now) const {
+        uint32_t delay = 0;
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            if (sets[i].used && ((delay == 0) || ((sets[i].due - now) < delay))) {
+                delay = sets[i].due - now;
+            }
+        }
+
+        return delay;
+    }
+
+    /**
+     * Pass both payloads to the stack in a single call.
+     */
+    ble_error_t pushPayloads(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse) {
+        Gap::AdvertisingPayloadTransaction transaction(gap);
+        gap.setAdvertisingPayload(advData);
+        gap.setScanResponse(scanResponse);
+        return transaction.commit();
+    }
+
+    /**
+     * Replace the set on air by @p set.
+     *
+     * @return BLE_ERROR_NONE if @p set is on air; otherwise the first error
+     *         of the stack, and no set is on air.
+     */
+    ble_error_t putOnAir(SetHandle_t set) {
+        if (onAir != INVALID_SET_HANDLE) {
+            gap.stopAdvertising();
+            onAir = INVALID_SET_HANDLE;
+        }
+
+        gap.setAdvertisingParams(sets[set].params);
+        ble_error_t rc = pushPayloads(sets[set].advData, sets[set].scanResponse);
+        if (rc == BLE_ERROR_NONE) {
+            rc = gap.startAdvertising();
+        }
+        if (rc == BLE_ERROR_NONE) {
+            onAir = set;
+        }
+
+        return rc;
+    }
+
+    /**
+     * Hand every set to the stack if it can advertise them concurrently.
+     *
+     * @return true if the sets were offloaded.
+     */
+    bool offload(void) {
+        unsigned count = 0;
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            count += sets[i].used;
+        }
+        if ((count == 0) || (gap.getMaxAdvertisingSetCount() < count)) {
+            return false;
+        }
+
+        for (unsigned i = 0; i < MaxSets; ++i) {
+            if (!sets[i].used) {
+                continue;
+            }
+
+            Set &set = sets[i];
+            if ((gap.createAdvertisingSet(&set.nativeHandle, set.params) != BLE_ERROR_NONE) ||
+                (gap.setAdvertisingSetPayload(set.nativeHandle, set.advData) != BLE_ERROR_NONE) ||
+                (gap.setAdvertisingSetScanResponse(set.nativeHandle, set.scanResponse) != BLE_ERROR_NONE) ||
+                (gap.startAdvertisingSet(set.nativeHandle) != BLE_ERROR_NONE)) {
+                /* Fall back to the host-side rotation. */
+                for (unsigned j = 0; j <= i; ++j) {
+                    if (sets[j].used && (sets[j].nativeHandle != Gap::INVALID_ADVERTISING_SET_HANDLE)) {
+                        gap.destroyAdvertisingSet(sets[j].nativeHandle);
+                        sets[j].nativeHandle = Gap::INVALID_ADVERTISING_SET_HANDLE;
+                    }
+                }
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    Gap                  &gap;
+    uint16_t              slotDuration;
+    bool                  running;
+    bool                  offloaded;
+    SetHandle_t           onAir;
+    uint8_t               slotsLeft;
+    uint32_t              slotEnd;
+    MissedSlotCallback_t  missedSlotCallback;
+    Set                   sets[MaxSets];
+};
+
+template <unsigned MaxSets>
+const typename AdvertisingSetScheduler<MaxSets>::SetHandle_t AdvertisingSetScheduler<MaxSets>::INVALID_SET_HANDLE;
+
+#endif /* ifndef __ADVERTISING_SET_SCHEDULER_H__ */
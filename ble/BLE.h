@@ -24,8 +24,10 @@
 
 #include "ble/FunctionPointerWithContext.h"
 
-#ifdef YOTTA_CFG_MBED_OS
+#if defined(YOTTA_CFG_MBED_OS)
 #include "mbed-drivers/mbed_error.h"
+#elif defined(BLE_SIMULATOR)
+#include "ble/simulator/SimulatedPlatform.h"
 #else
 #include "mbed_error.h"
 #endif
@@ -1532,6 +1534,37 @@ public:
      */
     void onEventsToProcess(const OnEventsToProcessCallback_t& callback);
 
+    /**
+     * Defer the events reported by the stack to Gap, GattServer and
+     * GattClient: instead of invoking the application callbacks from the
+     * context of the stack (possibly an interrupt), they are copied into
+     * @p queue and dispatched by processEvents().
+     *
+     * The hook registered with onEventsToProcess() is only signalled when the
+     * queue goes from empty to non-empty, or when processEvents() returns
+     * with events left in the queue.
+     *
+     * @param[in] queue
+     *              The queue holding the deferred events. It must outlive its
+     *              use by this instance.
+     * @param[in] budget
+     *              Maximum number of deferred events dispatched by each call
+     *              to processEvents(); 0 means no limit.
+     *
+     * @return BLE_ERROR_NONE on success, BLE_ERROR_INVALID_PARAM if the
+     *         capacity of @p queue is not a power of two.
+     *
+     * @note Events dropped because the queue was full are counted by
+     *       DeferredEventQueue::getDroppedCount().
+     */
+    ble_error_t enableDeferredEventDispatch(DeferredEventQueue &queue, unsigned budget = 0);
+
+    /**
+     * Dispatch the events still held in the deferred event queue then go
+     * back to dispatching events from the context of the stack.
+     */
+    void disableDeferredEventDispatch(void);
+
 private:
 
     friend class BLEInstanceBase;
@@ -1544,6 +1577,19 @@ private:
      */
     void signalEventsToProcess();
 
+    /**
+     * Callback of the deferred event queue, invoked when the queue goes from
+     * empty to non-empty.
+     */
+    void signalDeferredEvents(DeferredEventQueue *queue);
+
+    /**
+     * Dispatch at most @p budget deferred events; 0 means no limit.
+     *
+     * @return true if events are left in the queue.
+     */
+    bool dispatchDeferredEvents(unsigned budget);
+
     /**
      * Implementation of init() [internal to BLE_API].
      *
@@ -1560,6 +1606,8 @@ private:
     InstanceID_t     instanceID;
     BLEInstanceBase *transport; /* The device-specific backend */
     OnEventsToProcessCallback_t whenEventsToProcess;
+    DeferredEventQueue         *deferredEventQueue;
+    unsigned                    deferredEventBudget;
 };
 
 typedef BLE BLEDevice; /**< @deprecated This type alias is retained for the
@@ -0,0 +1,161 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_CALLCHAIN_NODE_ALLOCATOR_H
+#define MBED_CALLCHAIN_NODE_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+/**
+ * Build option: when BLE_CALLCHAIN_USE_NODE_POOL is defined, the callchains
+ * owned by Gap, GattServer, GattClient and SecurityManager take their nodes
+ * from statically sized pools instead of the heap. Every callchain of a
+ * component has its own pool, shared by the instances of the component when
+ * there are several BLE instances. The capacity of the pools of each
+ * component can be tuned with BLE_GAP_CALLCHAIN_POOL_CAPACITY,
+ * BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY,
+ * BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY and
+ * BLE_SECURITY_MANAGER_CALLCHAIN_POOL_CAPACITY; they all default to
+ * BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY.
+ */
+#ifndef BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY
+#define BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY 4
+#endif
+
+#ifdef BLE_CALLCHAIN_USE_NODE_POOL
+#define BLE_CALLCHAIN_ALLOCATOR(CAPACITY, OWNER) CallChainPoolAllocator<CAPACITY, OWNER>
+#else
+#define BLE_CALLCHAIN_ALLOCATOR(CAPACITY, OWNER) CallChainHeapAllocator
+#endif
+
+/**
+ * A statically allocated pool of objects of type T.
+ *
+ * Storage for Capacity objects is reserved at link time; construct() and
+ * destroy() run in constant time and never touch the heap. The pool relies
+ * solely on zero-initialized static data, so it can be used safely from the
+ * constructors of other static objects.
+ *
+ * @note There is a single pool per (T, Capacity, Owner) triple; every user
+ *       of that triple shares it. Owner is only a tag, which keeps apart the
+ *       pools of users storing objects of the same type.
+ */
+template <typename T, unsigned Capacity, typename Owner = void>
+class StaticObjectPool {
+public:
+    /**
+     * Construct a copy of @p value in a free slot of the pool.
+     *
+     * @return A pointer to the new object or NULL if the pool is exhausted.
+     */
+    static T *construct(const T &value) {
+        Slot *slot = freeList;
+        if (slot != NULL) {
+            freeList = slot->nextFree;
+        } else if (highWaterMark < Capacity) {
+            slot = &slots[highWaterMark++];
+        } else {
+            return NULL;
+        }
+
+        return new (slot->storage) T(value);
+    }
+
+    /**
+     * Destroy an object previously returned by construct() and give its slot
+     * back to the pool.
+     */
+    static void destroy(T *object) {
+        object->~T();
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        slot->nextFree = freeList;
+        freeList = slot;
+    }
+
+    /**
+     * @return The number of objects which can still be constructed.
+     */
+    static unsigned available(void) {
+        unsigned count = Capacity - highWaterMark;
+        for (const Slot *slot = freeList; slot != NULL; slot = slot->nextFree) {
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    union Slot {
+        char      storage[sizeof(T)];
+        Slot     *nextFree;
+        /* Members below are only there to align the storage. */
+        void     *alignPointer;
+        uint64_t  alignInteger;
+        double    alignDouble;
+    };
+
+    static Slot     slots[Capacity];
+    static Slot    *freeList;
+    static unsigned highWaterMark;
+};
+
+template <typename T, unsigned Capacity, typename Owner>
+typename StaticObjectPool<T, Capacity, Owner>::Slot StaticObjectPool<T, Capacity, Owner>::slots[Capacity];
+
+template <typename T, unsigned Capacity, typename Owner>
+typename StaticObjectPool<T, Capacity, Owner>::Slot *StaticObjectPool<T, Capacity, Owner>::freeList;
+
+template <typename T, unsigned Capacity, typename Owner>
+unsigned StaticObjectPool<T, Capacity, Owner>::highWaterMark;
+
+/**
+ * Node allocator of CallChainOfFunctionPointersWithContext using the heap.
+ * This is the default.
+ */
+struct CallChainHeapAllocator {
+    template <typename T>
+    static T *construct(const T &value) {
+        return new T(value);
+    }
+
+    template <typename T>
+    static void destroy(T *object) {
+        delete object;
+    }
+};
+
+/**
+ * Node allocator of CallChainOfFunctionPointersWithContext drawing nodes from
+ * a StaticObjectPool of @p Capacity nodes. Callchains with the same context
+ * type share a pool unless they are given different @p Owner tags; the
+ * components of BLE API pass their own class, so that each of their
+ * callchains gets its own pool.
+ */
+template <unsigned Capacity, typename Owner = void>
+struct CallChainPoolAllocator {
+    template <typename T>
+    static T *construct(const T &value) {
+        return StaticObjectPool<T, Capacity, Owner>::construct(value);
+    }
+
+    template <typename T>
+    static void destroy(T *object) {
+        StaticObjectPool<T, Capacity, Owner>::destroy(object);
+    }
+};
+
+#endif /* ifndef MBED_CALLCHAIN_NODE_ALLOCATOR_H */
@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include "FunctionPointerWithContext.h"
+#include "CallChainNodeAllocator.h"
 #include "SafeBool.h"
 
 
@@ -54,9 +55,19 @@
  *     chain.call();
  * }
  * @endcode
+ *
+ * Nodes of the chain are obtained from NodeAllocator. By default they are
+ * allocated on the heap; a chain which must not use the heap can draw them
+ * from a fixed size pool instead:
+ * @code
+ *
+ * // At most 4 callbacks can be registered in chains of this type.
+ * CallChainOfFunctionPointersWithContext<void *, CallChainPoolAllocator<4> > pooledChain;
+ *
+ * @endcode
  */
-template <typename ContextType>
-class CallChainOfFunctionPointersWithContext : public SafeBool<CallChainOfFunctionPointersWithContext<ContextType> > {
+template <typename ContextType, typename NodeAllocator = CallChainHeapAllocator>
+class CallChainOfFunctionPointersWithContext : public SafeBool<CallChainOfFunctionPointersWithContext<ContextType, NodeAllocator> > {
 public:
     /**
      * The type of each callback in the callchain.
@@ -67,7 +78,7 @@ public:
     /**
      * Create an empty chain.
      */
-    CallChainOfFunctionPointersWithContext() : chainHead(NULL) {
+    CallChainOfFunctionPointersWithContext() : chainHead(NULL), currentCalled(NULL) {
         /* empty */
     }
 
@@ -81,10 +92,13 @@ public:
      * @param[in]  function
      *              A pointer to a void function.
      *
-     * @return  The function object created for @p function.
+     * @return  The function object created for @p function or NULL if the
+     *          node allocator is exhausted. It can be passed back to
+     *          detach(pFunctionPointerWithContext_t) to remove the function
+     *          from the chain in constant time.
      */
     pFunctionPointerWithContext_t add(void (*function)(ContextType context)) {
-        return common_add(new FunctionPointerWithContext<ContextType>(function));
+        return common_add(FunctionPointerWithContext<ContextType>(function));
     }
 
     /**
@@ -95,11 +109,14 @@ public:
      * @param[in] mptr
      *              Pointer to the member function to be called.
      *
-     * @return  The function object created for @p tptr and @p mptr.
+     * @return  The function object created for @p tptr and @p mptr or NULL
+     *          if the node allocator is exhausted. It can be passed back to
+     *          detach(pFunctionPointerWithContext_t) to remove the function
+     *          from the chain in constant time.
      */
     template<typename T>
     pFunctionPointerWithContext_t add(T *tptr, void (T::*mptr)(ContextType context)) {
-        return common_add(new FunctionPointerWithContext<ContextType>(tptr, mptr));
+        return common_add(FunctionPointerWithContext<ContextType>(tptr, mptr));
     }
 
     /**
@@ -108,10 +125,13 @@ public:
      * @param[in] func
      *              The FunctionPointerWithContext to add.
      *
-     * @return  The function object created for @p func.
+     * @return  The function object created for @p func or NULL if the node
+     *          allocator is exhausted. It can be passed back to
+     *          detach(pFunctionPointerWithContext_t) to remove the function
+     *          from the chain in constant time.
      */
     pFunctionPointerWithContext_t add(const FunctionPointerWithContext<ContextType>& func) {
-        return common_add(new FunctionPointerWithContext<ContextType>(func));
+        return common_add(func);
     }
 
     /**
@@ -124,49 +144,80 @@ public:
      *
      * @note It is safe to remove a function pointer while the chain is
      *       traversed by call(ContextType).
+     *
+     * @note This walks the chain; prefer detach(pFunctionPointerWithContext_t)
+     *       when the value returned by add() is at hand.
      */
     bool detach(const FunctionPointerWithContext<ContextType>& toDetach) {
         pFunctionPointerWithContext_t current = chainHead;
-        pFunctionPointerWithContext_t previous = NULL;
 
         while (current) {
             if(*current == toDetach) {
-                if(previous == NULL) {
-                    if(currentCalled == current) {
-                        currentCalled = NULL;
-                    }
-                    chainHead = current->getNext();
-                } else {
-                    if(currentCalled == current) {
-                        currentCalled = previous;
-                    }
-                    previous->chainAsNext(current->getNext());
-                }
-                delete current;
-                return true;
+                return detach(current);
             }
 
-            previous = current;
             current = current->getNext();
         }
 
         return false;
     }
 
+    /**
+     * Detach a function pointer from a callchain in constant time.
+     *
+     * @param[in] registration
+     *              The function object returned by add() when the function
+     *              was added to this callchain.
+     *
+     * @return true if a function pointer has been detached and false if
+     *         @p registration is NULL.
+     *
+     * @note It is safe to remove a function pointer while the chain is
+     *       traversed by call(ContextType).
+     *
+     * @note @p registration must have been returned by add() on this
+     *       callchain and must not have been detached already.
+     */
+    bool detach(pFunctionPointerWithContext_t registration) {
+        if (registration == NULL) {
+            return false;
+        }
+
+        Node *node = static_cast<Node *>(registration);
+        Node *next = static_cast<Node *>(node->getNext());
+
+        if (node->previous == NULL) {
+            chainHead = next;
+        } else {
+            node->previous->chainAsNext(next);
+        }
+        if (next != NULL) {
+            next->previous = node->previous;
+        }
+
+        /* If the node is being called, resume the traversal from its
+         * predecessor; NULL makes call() restart from the head. */
+        if (currentCalled == node) {
+            currentCalled = node->previous;
+        }
+
+        NodeAllocator::destroy(node);
+        return true;
+    }
+
     /**
      * Clear the call chain (remove all functions in the chain).
      */
     void clear(void) {
         pFunctionPointerWithContext_t fptr = chainHead;
         while (fptr) {
-            pFunctionPointerWithContext_t deadPtr = fptr;
+            Node *deadPtr = static_cast<Node *>(fptr);
             fptr = deadPtr->getNext();
-            delete deadPtr;
+            NodeAllocator::destroy(deadPtr);
         }
 
         chainHead = NULL;
     }
-
     /**
      * Check whether the callchain contains any callbacks.
      *
@@ -231,18 +282,35 @@ public:
     }
 
 private:
+    /**
+     * Node of the callchain. The link to the previous node makes detaching a
+     * registration a constant time operation.
+     */
+    struct Node : public FunctionPointerWithContext<ContextType> {
+        Node(const FunctionPointerWithContext<ContextType> &func) :
+            FunctionPointerWithContext<ContextType>(func), previous(NULL) {
+        }
+
+        Node *previous;
+    };
+
     /**
      * Add a callback to the head of the callchain.
      *
-     * @return A pointer to the head of the callchain.
+     * @return A pointer to the head of the callchain or NULL if no node could
+     *         be allocated.
      */
-    pFunctionPointerWithContext_t common_add(pFunctionPointerWithContext_t pf) {
-        if (chainHead == NULL) {
-            chainHead = pf;
-        } else {
-            pf->chainAsNext(chainHead);
-            chainHead = pf;
+    pFunctionPointerWithContext_t common_add(const FunctionPointerWithContext<ContextType> &func) {
+        Node *node = NodeAllocator::construct(Node(func));
+        if (node == NULL) {
+            return NULL;
+        }
+
+        if (chainHead != NULL) {
+            node->chainAsNext(chainHead);
+            static_cast<Node *>(chainHead)->previous = node;
         }
+        chainHead = node;
 
         return chainHead;
     }
@@ -0,0 +1,271 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONNECTION_PARAMS_POLICY_H__
+#define __CONNECTION_PARAMS_POLICY_H__
+
+#include <stdint.h>
+
+#include "Gap.h"
+
+/**
+ * Number of connections a ConnectionParamsPolicy manages.
+ */
+#ifndef BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS
+#define BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS BLE_GAP_MAX_CONNECTIONS
+#endif
+
+/**
+ * Number of times a rejected request is retried with relaxed parameters.
+ */
+#ifndef BLE_CONNECTION_PARAMS_POLICY_MAX_RETRIES
+#define BLE_CONNECTION_PARAMS_POLICY_MAX_RETRIES 2
+#endif
+
+/**
+ * @brief Named connection parameter profiles, and a policy requesting them
+ * according to the traffic of each connection.
+ *
+ * The policy keeps a connection in the idle profile, and moves it to the
+ * active profile when a burst of traffic is reported with recordTraffic():
+ * at least burstThreshold packets within burstWindow milliseconds. The
+ * connection returns to the idle profile after idleTimeout milliseconds
+ * without traffic. While a bulk transfer is flagged with setBulkTransfer(),
+ * the connection is kept in PROFILE_MAX_THROUGHPUT.
+ *
+ * Requests are only made when the wanted profile changes. When the peer
+ * rejects a request, it is retried up to
+ * BLE_CONNECTION_PARAMS_POLICY_MAX_RETRIES times; every retry doubles the
+ * connection intervals of the profile and extends the supervision timeout
+ * accordingly.
+ *
+ * @code
+ * ConnectionParamsPolicy policy(ble.gap());
+ *
+ * void onDataWritten(const GattWriteCallbackParams *params) {
+ *     policy.recordTraffic(params->connHandle, clock.read_ms());
+ * }
+ *
+ * ble.gap().setPreferredConnectionParams(&policy.getProfileParams(ConnectionParamsPolicy::PROFILE_BALANCED));
+ * // ...and from a timer:
+ * uint32_t delay = policy.process(clock.read_ms());
+ * @endcode
+ *
+ * @note The policy registers for the connection, disconnection and
+ *       connection parameter update events of the Gap, and unregisters when
+ *       it is destroyed; it must be constructed after BLE::init(), and
+ *       reconstructed after Gap::reset(). Check getRegistrationStatus()
+ *       after construction.
+ */
+class ConnectionParamsPolicy {
+public:
+    /**
+     * Named connection parameter profiles.
+     */
+    enum Profile_t {
+        PROFILE_LOW_LATENCY,    /**< Shortest interval, no slave latency. */
+        PROFILE_MAX_THROUGHPUT, /**< Short interval, long enough for several packets per connection event. */
+        PROFILE_BALANCED,       /**< Moderate interval, no slave latency. */
+        PROFILE_LOW_POWER,      /**< Long interval and slave latency. */
+        NUM_PROFILES,
+        PROFILE_NONE = NUM_PROFILES /**< Parameters not set by the policy. */
+    };
+
+public:
+    /**
+     * Construct a policy for the connections of @p gapIn.
+     *
+     * @param[in] gapIn
+     *              The Gap which connections are managed.
+     * @param[in] activeProfileIn
+     *              Profile requested during bursts of traffic.
+     * @param[in] idleProfileIn
+     *              Profile requested without traffic.
+     * @param[in] idleTimeoutIn
+     *              Time without traffic, in milliseconds, after which the
+     *              idle profile is requested.
+     * @param[in] burstThresholdIn
+     *              Number of packets within @p burstWindowIn which starts a
+     *              burst.
+     * @param[in] burstWindowIn
+     *              Duration of the window in which packets are counted, in
+     *              milliseconds.
+     */
+    ConnectionParamsPolicy(Gap       &gapIn,
+                           Profile_t  activeProfileIn  = PROFILE_LOW_LATENCY,
+                           Profile_t  idleProfileIn    = PROFILE_LOW_POWER,
+                           uint32_t   idleTimeoutIn    = 2000,
+                           uint16_t   burstThresholdIn = 3,
+                           uint32_t   burstWindowIn    = 1000);
+
+    /**
+     * Unregister from the events of the Gap.
+     */
+    ~ConnectionParamsPolicy();
+
+    /**
+     * Check whether the policy could register for the events of the Gap.
+     *
+     * @return BLE_ERROR_NONE if it did; BLE_ERROR_NO_MEM if a callchain of
+     *         the Gap had no node left (see BLE_GAP_CALLCHAIN_POOL_CAPACITY),
+     *         in which case the policy does not track the connections.
+     */
+    ble_error_t getRegistrationStatus(void) const {
+        return registrationStatus;
+    }
+
+    /**
+     * Get the parameters of a profile.
+     */
+    const Gap::ConnectionParams_t &getProfileParams(Profile_t profile) const {
+        return profiles[(profile < NUM_PROFILES) ? profile : PROFILE_BALANCED];
+    }
+
+    /**
+     * Replace the parameters of a profile.
+     *
+     * @return BLE_ERROR_NONE if the parameters were replaced;
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p profile is invalid;
+     *         BLE_ERROR_INVALID_PARAM if @p params are not consistent.
+     */
+    ble_error_t setProfileParams(Profile_t profile, const Gap::ConnectionParams_t &params);
+
+    /**
+     * Report traffic on a connection, and request the active profile if it
+     * starts a burst.
+     *
+     * @param[in] handle
+     *              The connection handle.
+     * @param[in] now
+     *              The current time, in milliseconds.
+     * @param[in] packets
+     *              Number of packets exchanged.
+     */
+    void recordTraffic(Gap::Handle_t handle, uint32_t now, uint16_t packets = 1);
+
+    /**
+     * Flag a bulk transfer in progress on a connection; the connection is
+     * kept in PROFILE_MAX_THROUGHPUT until the flag is cleared.
+     *
+     * @param[in] handle
+     *              The connection handle.
+     * @param[in] now
+     *              The current time, in milliseconds.
+     * @param[in] active
+     *              Whether a bulk transfer is in progress.
+     */
+    void setBulkTransfer(Gap::Handle_t handle, uint32_t now, bool active);
+
+    /**
+     * Request the idle profile on idle connections, and time out requests
+     * left unanswered by the peer.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again, or 0 if there is nothing to wait for.
+     */
+    uint32_t process(uint32_t now);
+
+    /**
+     * Get the profile in use on a connection.
+     *
+     * @return The profile, or PROFILE_NONE if the parameters in use were not
+     *         requested by the policy.
+     */
+    Profile_t getProfile(Gap::Handle_t handle) const;
+
+    /**
+     * Get the number of requests made.
+     */
+    uint32_t getRequestCount(void) const {
+        return requestCount;
+    }
+
+    /**
+     * Get the number of requests rejected or left unanswered.
+     */
+    uint32_t getRejectCount(void) const {
+        return rejectCount;
+    }
+
+    /**
+     * Time after which a request left unanswered is considered rejected, in
+     * milliseconds. This is the L2CAP response timeout.
+     */
+    static const uint32_t REQUEST_TIMEOUT = 30000;
+
+private:
+    struct Link_t {
+        Gap::Handle_t handle;
+        bool          used;
+        bool          pending;     /**< A request is in progress. */
+        bool          bulk;        /**< A bulk transfer is in progress. */
+        bool          active;      /**< A burst of traffic is in progress. */
+        uint8_t       profile;     /**< Profile in use. */
+        uint8_t       wanted;      /**< Profile the policy wants. */
+        uint8_t       requested;   /**< Profile of the request in progress. */
+        uint8_t       retries;     /**< Retries of the wanted profile. */
+        uint16_t      packets;     /**< Packets in the current window. */
+        uint32_t      windowStart;
+        uint32_t      lastActivity;
+        uint32_t      requestTime;
+    };
+
+    void onConnection(const Gap::ConnectionCallbackParams_t *params);
+    void onDisconnection(const Gap::DisconnectionCallbackParams_t *params);
+    void onConnectionParamsUpdate(const Gap::ConnectionParamsUpdateCallbackParams_t *params);
+
+    Link_t *findLink(Gap::Handle_t handle);
+
+    /**
+     * Request the wanted profile of @p link if it changed.
+     */
+    void update(Link_t &link, uint32_t now);
+
+    /**
+     * Make the request for the wanted profile of @p link.
+     */
+    void request(Link_t &link, uint32_t now);
+
+    /**
+     * Handle the failure of the request in progress on @p link.
+     */
+    void handleRejection(Link_t &link, uint32_t now);
+
+private:
+    /* Disallow copy and assignment. */
+    ConnectionParamsPolicy(const ConnectionParamsPolicy &);
+    ConnectionParamsPolicy& operator=(const ConnectionParamsPolicy &);
+
+private:
+    Gap                     &gap;
+    Profile_t                activeProfile;
+    Profile_t                idleProfile;
+    uint32_t                 idleTimeout;
+    uint16_t                 burstThreshold;
+    uint32_t                 burstWindow;
+    Gap::ConnectionParams_t  profiles[NUM_PROFILES];
+
+    Link_t                   links[BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS];
+    uint32_t                 lastNow; /**< Last time reported to the policy, used by the event handlers. */
+    uint32_t                 requestCount;
+    uint32_t                 rejectCount;
+    ble_error_t              registrationStatus;
+};
+
+#endif /* ifndef __CONNECTION_PARAMS_POLICY_H__ */
@@ -0,0 +1,773 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONNECTION_SCHEDULER_H__
+#define __CONNECTION_SCHEDULER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Gap.h"
+#include "GapScanningParams.h"
+#include "FunctionPointerWithContext.h"
+
+/**
+ * @brief Establish connections to a list of peers, as a central.
+ *
+ * Targets are queued with a priority. The scheduler runs as many
+ * connection initiations in parallel as the stack allows (see
+ * Gap::getMaxConcurrentConnectionInitiations()), starting with the targets
+ * of highest priority, and targets of equal priority in turn. An
+ * initiation which does not complete within the attempt timeout is
+ * cancelled, and its target is retried after an exponential backoff.
+ *
+ * With auto-connect enabled, and if the stack supports a whitelist of more
+ * than one address, the scheduler instead fills the whitelist with the
+ * targets of highest priority and starts a single initiation filtered by
+ * the whitelist: the controller then connects to whichever of them is seen
+ * first. The whitelist is refilled after every connection and every
+ * attempt timeout. The scheduler claims the whitelist (see
+ * Gap::claimWhitelist()) while the initiator policy filters on it; if
+ * another owner holds it, the targets are initiated one by one.
+ *
+ * A target leaves the queue when it is connected, or when it used all its
+ * attempts; the outcome is reported through onResult(), with the time from
+ * the first attempt.
+ *
+ * @code
+ * ConnectionScheduler<32> scheduler(ble.gap(), 5000, 1000, 60000, 0, us_ticker_read_ms);
+ *
+ * void onResult(const ConnectionScheduler<32>::Result_t *result) {
+ *     // result->handle, result->latency...
+ * }
+ *
+ * scheduler.onResult(onResult);
+ * scheduler.addTarget(BLEProtocol::AddressType::RANDOM_STATIC, sensorAddress, 1);
+ * scheduler.start(clock.read_ms());
+ * // ...and from a timer:
+ * uint32_t delay = scheduler.process(clock.read_ms());
+ * @endcode
+ *
+ * @note The scheduler registers for the connection and timeout events of the
+ *       Gap, and unregisters when it is destroyed; it must be constructed
+ *       after BLE::init(), and reconstructed after Gap::reset(). If the Gap
+ *       has no room for the registrations, start() fails.
+ *
+ * @tparam MaxTargets Maximum number of queued targets.
+ */
+template <unsigned MaxTargets>
+class ConnectionScheduler {
+public:
+    /**
+     * Outcome of the connection to a target.
+     */
+    struct Result_t {
+        BLEProtocol::AddressType_t  peerAddrType; /**< The target's address type. */
+        BLEProtocol::AddressBytes_t peerAddr;     /**< The target's address. */
+        ble_error_t                 status;       /**< BLE_ERROR_NONE if connected, or the error of the last attempt. */
+        Gap::Handle_t               handle;       /**< The connection handle, if connected. */
+        uint32_t                    latency;      /**< Time from the first attempt, in milliseconds. */
+        uint8_t                     attempts;     /**< Number of attempts made. */
+    };
+
+    /**
+     * Result callback.
+     */
+    typedef FunctionPointerWithContext<const Result_t *> ResultCallback_t;
+
+public:
+    /**
+     * Construct an empty scheduler.
+     *
+     * @param[in] gapIn
+     *              The Gap which connects.
+     * @param[in] attemptTimeoutIn
+     *              Duration of an attempt, in milliseconds.
+     * @param[in] minBackoffIn
+     *              Delay before the first retry of a target, in milliseconds;
+     *              it doubles with every failed attempt.
+     * @param[in] maxBackoffIn
+     *              Maximum delay between two attempts, in milliseconds.
+     * @param[in] maxAttemptsIn
+     *              Number of attempts after which a target is given up, 0 to
+     *              retry forever.
+     * @param[in] clockIn
+     *              Function returning the current time in milliseconds, used
+     *              to timestamp connections. If NULL, the time passed to the
+     *              last call to process() is used.
+     */
+    ConnectionScheduler(Gap        &gapIn,
+                        uint32_t    attemptTimeoutIn = 5000,
+                        uint32_t    minBackoffIn     = 1000,
+                        uint32_t    maxBackoffIn     = 30000,
+                        uint8_t     maxAttemptsIn    = 0,
+                        uint32_t  (*clockIn)(void)   = NULL) :
+        gap(gapIn),
+        attemptTimeout(attemptTimeoutIn ? attemptTimeoutIn : 1),
+        minBackoff(minBackoffIn ? minBackoffIn : 1),
+        maxBackoff(maxBackoffIn),
+        maxAttempts(maxAttemptsIn),
+        clock(clockIn),
+        scanParams(100, 100, (attemptTimeoutIn + 999) / 1000),
+        hasConnectionParams(false),
+        autoConnect(false),
+        running(false),
+        whitelistActive(false),
+        initiatorPolicyFiltered(false),
+        maxInitiations(1),
+        initiations(0),
+        pendingControllerTimeouts(0),
+        nextSequence(0),
+        lastNow(0),
+        registrationStatus(BLE_ERROR_NONE),
+        resultCallback(NULL) {
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            targets[i].used = false;
+        }
+
+        if ((gap.onConnection(this, &ConnectionScheduler::onConnection) != BLE_ERROR_NONE) ||
+            (gap.onTimeout(Gap::TimeoutEventCallback_t(this, &ConnectionScheduler::onTimeout)) != BLE_ERROR_NONE)) {
+            registrationStatus = BLE_ERROR_NO_MEM;
+        }
+    }
+
+    /**
+     * Stop connecting, and unregister from the events of the Gap.
+     */
+    ~ConnectionScheduler() {
+        stop();
+        gap.onConnection().detach(Gap::ConnectionEventCallback_t(this, &ConnectionScheduler::onConnection));
+        gap.onTimeout().detach(Gap::TimeoutEventCallback_t(this, &ConnectionScheduler::onTimeout));
+    }
+
+    /**
+     * Check whether the scheduler could register for the events of the Gap.
+     *
+     * @return BLE_ERROR_NONE if it did; BLE_ERROR_NO_MEM if a callchain of
+     *         the Gap had no node left (see BLE_GAP_CALLCHAIN_POOL_CAPACITY).
+     */
+    ble_error_t getRegistrationStatus(void) const {
+        return registrationStatus;
+    }
+
+    /**
+     * Set the connection parameters requested for new connections.
+     *
+     * @param[in] params
+     *              The parameters, or NULL to use the defaults of the stack.
+     */
+    void setConnectionParams(const Gap::ConnectionParams_t *params) {
+        hasConnectionParams = (params != NULL);
+        if (params) {
+            connectionParams = *params;
+        }
+    }
+
+    /**
+     * Enable the use of the whitelist to connect to several targets with a
+     * single initiation. It is disabled again if the stack doesn't support
+     * it.
+     */
+    void setAutoConnect(bool enable) {
+        autoConnect = enable;
+    }
+
+    /**
+     * Queue a target, or change its priority if it is already queued.
+     *
+     * @param[in] type
+     *              The target's address type.
+     * @param[in] address
+     *              The target's address.
+     * @param[in] priority
+     *              Targets of higher priority are attempted first.
+     *
+     * @return BLE_ERROR_NONE if the target was queued;
+     *         BLE_ERROR_NO_MEM if the queue is full.
+     */
+    ble_error_t addTarget(BLEProtocol::AddressType_t type, const BLEProtocol::AddressBytes_t address, uint8_t priority = 0) {
+        int index = findTarget(address);
+        if (index >= 0) {
+            targets[index].priority = priority;
+            return BLE_ERROR_NONE;
+        }
+
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            Target_t &target = targets[i];
+            if (target.used) {
+                continue;
+            }
+
+            target.used         = true;
+            target.state        = QUEUED;
+            target.type         = type;
+            memcpy(target.address, address, BLEProtocol::ADDR_LEN);
+            target.priority     = priority;
+            target.attempts     = 0;
+            target.started      = false;
+            target.sequence     = nextSequence++;
+            target.firstAttempt = 0;
+            target.attemptStart = 0;
+            target.nextAttempt  = lastNow;
+            return BLE_ERROR_NONE;
+        }
+
+        return BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Remove a target from the queue, cancelling its initiation if needed.
+     *
+     * @return BLE_ERROR_NONE if the target was removed;
+     *         BLE_ERROR_INVALID_PARAM if it is not queued.
+     */
+    ble_error_t removeTarget(const BLEProtocol::AddressBytes_t address) {
+        int index = findTarget(address);
+        if (index < 0) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+
+        if (targets[index].state == INITIATING) {
+            cancelInitiations(lastNow);
+        }
+        targets[index].used = false;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Start connecting to the queued targets.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return BLE_ERROR_NONE if the scheduler started, or the error of
+     *         getRegistrationStatus().
+     */
+    ble_error_t start(uint32_t now) {
+        if (registrationStatus != BLE_ERROR_NONE) {
+            return registrationStatus;
+        }
+
+        lastNow        = now;
+        running        = true;
+        maxInitiations = gap.getMaxConcurrentConnectionInitiations();
+        if (maxInitiations == 0) {
+            maxInitiations = 1;
+        }
+
+        launch(now);
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Stop connecting; initiations in progress are cancelled, and their
+     * targets remain queued.
+     */
+    void stop(void) {
+        running = false;
+        cancelInitiations(lastNow);
+        resetInitiatorPolicy();
+    }
+
+    /**
+     * Time out attempts and start new ones.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again, or 0 if there is nothing to wait for.
+     */
+    uint32_t process(uint32_t now) {
+        lastNow = now;
+        if (!running) {
+            return 0;
+        }
+
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            if (targets[i].used && (targets[i].state == INITIATING) && ((now - targets[i].attemptStart) >= attemptTimeout)) {
+                expireInitiations(now);
+                break;
+            }
+        }
+        launch(now);
+
+        uint32_t delay = 0;
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            const Target_t &target = targets[i];
+            if (!target.used) {
+                continue;
+            }
+
+            uint32_t targetDelay;
+            if (target.state == INITIATING) {
+                targetDelay = attemptTimeout - (now - target.attemptStart);
+            } else if ((int32_t)(target.nextAttempt - now) > 0) {
+                targetDelay = target.nextAttempt - now;
+            } else if (initiations < maxInitiations) {
+                /* Due, but the stack refused the initiation: try again later. */
+                targetDelay = minBackoff;
+            } else {
+                continue;
+            }
+            if ((delay == 0) || (targetDelay < delay)) {
+                delay = targetDelay;
+            }
+        }
+
+        return delay;
+    }
+
+    /**
+     * Get the number of queued targets, including those being initiated.
+     */
+    unsigned getTargetCount(void) const {
+        unsigned count = 0;
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            if (targets[i].used) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Get the number of initiations in progress.
+     */
+    uint8_t getInitiationCount(void) const {
+        return initiations;
+    }
+
+    /**
+     * Check whether the initiation in progress is filtered by the whitelist.
+     */
+    bool isUsingWhitelist(void) const {
+        return whitelistActive;
+    }
+
+    /**
+     * Set up the callback receiving the outcome of the connection to each
+     * target.
+     */
+    void onResult(void (*callback)(const Result_t *result)) {
+        resultCallback.attach(callback);
+    }
+
+    /**
+     * Same as onResult(), with an object and a member function.
+     */
+    template <typename T>
+    void onResult(T *objPtr, void (T::*memberPtr)(const Result_t *result)) {
+        resultCallback.attach(objPtr, memberPtr);
+    }
+
+private:
+    enum State_t {
+        QUEUED,
+        INITIATING
+    };
+
+    struct Target_t {
+        bool                        used;
+        uint8_t                     state;
+        BLEProtocol::AddressType_t  type;
+        BLEProtocol::AddressBytes_t address;
+        uint8_t                     priority;
+        uint8_t                     attempts;     /**< Attempts made, including the one in progress. */
+        bool                        started;      /**< firstAttempt is set. */
+        uint32_t                    sequence;     /**< Order among targets of equal priority. */
+        uint32_t                    firstAttempt;
+        uint32_t                    attemptStart;
+        uint32_t                    nextAttempt;
+    };
+
+    uint32_t getTime(void) const {
+        return clock ? clock() : lastNow;
+    }
+
+    int findTarget(const BLEProtocol::AddressBytes_t address) const {
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            if (targets[i].used && (memcmp(targets[i].address, address, BLEProtocol::ADDR_LEN) == 0)) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /**
+     * Select the queued target to attempt next.
+     *
+     * @return Its index, or -1 if no target is due.
+     */
+    int selectNext(uint32_t now) const {
+        int best = -1;
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            const Target_t &target = targets[i];
+            if (!target.used || (target.state != QUEUED) || ((int32_t)(now - target.nextAttempt) < 0)) {
+                continue;
+            }
+            if ((best < 0) ||
+                (target.priority > targets[best].priority) ||
+                ((target.priority == targets[best].priority) && ((int32_t)(target.sequence - targets[best].sequence) < 0))) {
+                best = i;
+            }
+        }
+
+        return best;
+    }
+
+    void beginAttempt(Target_t &target, uint32_t now) {
+        if (!target.started) {
+            target.started      = true;
+            target.firstAttempt = now;
+        }
+        if (target.attempts < 0xFF) {
+            ++target.attempts;
+        }
+        target.state        = INITIATING;
+        target.attemptStart = now;
+    }
+
+    /**
+     * Start initiations for the due targets, as many as allowed.
+     */
+    void launch(uint32_t now) {
+        if (!running || whitelistActive) {
+            return;
+        }
+        if (autoConnect && (initiations == 0) && launchWhitelist(now)) {
+            return;
+        }
+
+        while (initiations < maxInitiations) {
+            /* The application's own initiations must not be filtered
+             * either: give the whitelist back even if no target is due. */
+            resetInitiatorPolicy();
+
+            int index = selectNext(now);
+            if (index < 0) {
+                return;
+            }
+
+            Target_t &target = targets[index];
+            beginAttempt(target, now);
+            ble_error_t rc = gap.connect(target.address, target.type, hasConnectionParams ? &connectionParams : NULL, &scanParams);
+            if (rc == BLE_ERROR_NONE) {
+                ++initiations;
+                continue;
+            }
+
+            if ((rc == BLE_ERROR_INVALID_STATE) || (rc == BLE_STACK_BUSY)) {
+                /* The stack can't start another initiation now; this attempt doesn't count. */
+                target.state = QUEUED;
+                --target.attempts;
+                return;
+            }
+            failAttempt(target, now, rc);
+        }
+    }
+
+    /**
+     * Start a single initiation filtered by a whitelist of the due targets.
+     *
+     * @return true if the initiation was started, or if the stack can't
+     *         start one now.
+     */
+    bool launchWhitelist(uint32_t now) {
+        unsigned capacity = gap.getMaxWhitelistSize();
+        if (capacity > MaxTargets) {
+            capacity = MaxTargets;
+        }
+        if ((capacity < 2) || (gap.claimWhitelist(this) != BLE_ERROR_NONE)) {
+            return false;
+        }
+
+        /* Pick the due targets of highest priority; they are marked as initiating while picked. */
+        uint8_t  picked[MaxTargets];
+        unsigned count = 0;
+        while (count < capacity) {
+            int index = selectNext(now);
+            if (index < 0) {
+                break;
+            }
+            targets[index].state = INITIATING;
+            whitelistAddresses[count] = BLEProtocol::Address_t(targets[index].type, targets[index].address);
+            picked[count++] = index;
+        }
+
+        ble_error_t rc = BLE_ERROR_INVALID_PARAM;
+        if (count >= 2) {
+            Gap::Whitelist_t whitelist = { whitelistAddresses, (uint8_t)count, (uint8_t)capacity };
+            rc = gap.setWhitelist(whitelist);
+            if (rc == BLE_ERROR_NONE) {
+                rc = gap.setInitiatorPolicyMode(Gap::INIT_POLICY_FILTER_ALL_ADV);
+            }
+            if (rc == BLE_ERROR_NONE) {
+                initiatorPolicyFiltered = true;
+                rc = gap.connect(whitelistAddresses[0].address, whitelistAddresses[0].type,
+                                 hasConnectionParams ? &connectionParams : NULL, &scanParams);
+            } else if (rc == BLE_ERROR_NOT_IMPLEMENTED) {
+                autoConnect = false;
+            }
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+            targets[picked[i]].state = QUEUED;
+            if (rc == BLE_ERROR_NONE) {
+                beginAttempt(targets[picked[i]], now);
+            }
+        }
+        if (rc == BLE_ERROR_NONE) {
+            whitelistActive = true;
+            initiations     = 1;
+            return true;
+        }
+        if (!initiatorPolicyFiltered) {
+            gap.releaseWhitelist(this);
+        }
+
+        return (rc == BLE_ERROR_INVALID_STATE) || (rc == BLE_STACK_BUSY);
+    }
+
+    /**
+     * Stop filtering initiations with the whitelist, and release it.
+     */
+    void resetInitiatorPolicy(void) {
+        if (initiatorPolicyFiltered) {
+            gap.setInitiatorPolicyMode(Gap::INIT_POLICY_IGNORE_WHITELIST);
+            initiatorPolicyFiltered = false;
+            gap.releaseWhitelist(this);
+        }
+    }
+
+    /**
+     * Record the failure of the attempt in progress on @p target.
+     */
+    void failAttempt(Target_t &target, uint32_t now, ble_error_t status) {
+        if (maxAttempts && (target.attempts >= maxAttempts)) {
+            report(target, status, 0, now);
+            return;
+        }
+
+        uint32_t backoff = minBackoff;
+        for (unsigned i = 1; (i < target.attempts) && (backoff < maxBackoff); ++i) {
+            backoff *= 2;
+        }
+        if (backoff > maxBackoff) {
+            backoff = maxBackoff;
+        }
+
+        target.state       = QUEUED;
+        target.sequence    = nextSequence++;
+        target.nextAttempt = now + backoff;
+    }
+
+    /**
+     * Remove @p target from the queue and report its outcome.
+     */
+    void report(Target_t &target, ble_error_t status, Gap::Handle_t handle, uint32_t now) {
+        Result_t result;
+        result.peerAddrType = target.type;
+        memcpy(result.peerAddr, target.address, BLEProtocol::ADDR_LEN);
+        result.status       = status;
+        result.handle       = handle;
+        result.latency      = target.started ? (now - target.firstAttempt) : 0;
+        result.attempts     = target.attempts;
+
+        target.used = false;
+        if (resultCallback) {
+            resultCallback.call(&result);
+        }
+    }
+
+    /**
+     * End the initiations in progress whose attempt timed out. The stack
+     * cancels the other ones with them; these are restarted without penalty.
+     */
+    void expireInitiations(uint32_t now) {
+        bool cancelled = (gap.cancelConnect() == BLE_ERROR_NONE);
+
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            Target_t &target = targets[i];
+            if (!target.used || (target.state != INITIATING)) {
+                continue;
+            }
+
+            bool expired = ((now - target.attemptStart) >= attemptTimeout);
+            if (!expired && !cancelled) {
+                continue;
+            }
+            if (!cancelled && (!whitelistActive || (initiations > 0))) {
+                /* The controller reports the end of the initiation with a timeout event. */
+                ++pendingControllerTimeouts;
+            }
+            if (initiations > 0) {
+                --initiations;
+            }
+            if (expired) {
+                failAttempt(target, now, BLE_ERROR_UNSPECIFIED);
+            } else {
+                restart(target, now);
+            }
+        }
+
+        if (initiations == 0) {
+            whitelistActive = false;
+        }
+    }
+
+    /**
+     * Cancel the initiations in progress, and queue their targets again
+     * without penalty.
+     */
+    void cancelInitiations(uint32_t now) {
+        if (initiations == 0) {
+            return;
+        }
+        if (gap.cancelConnect() != BLE_ERROR_NONE) {
+            /* The controller reports the end of each initiation with a timeout event. */
+            pendingControllerTimeouts += initiations;
+        }
+
+        initiations     = 0;
+        whitelistActive = false;
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            if (targets[i].used && (targets[i].state == INITIATING)) {
+                restart(targets[i], now);
+            }
+        }
+    }
+
+    /**
+     * Queue @p target again, without counting the attempt in progress.
+     */
+    void restart(Target_t &target, uint32_t now) {
+        if (target.attempts > 0) {
+            --target.attempts;
+        }
+        target.state       = QUEUED;
+        target.nextAttempt = now;
+    }
+
+    void onConnection(const Gap::ConnectionCallbackParams_t *params) {
+        if (params->role != Gap::CENTRAL) {
+            return;
+        }
+
+        uint32_t now = getTime();
+        if (whitelistActive) {
+            /* The connection ends the initiation filtered by the whitelist. */
+            whitelistActive = false;
+            initiations     = 0;
+            for (unsigned i = 0; i < MaxTargets; ++i) {
+                if (targets[i].used && (targets[i].state == INITIATING) &&
+                    (memcmp(targets[i].address, params->peerAddr, BLEProtocol::ADDR_LEN) != 0)) {
+                    restart(targets[i], now);
+                }
+            }
+        }
+
+        int index = findTarget(params->peerAddr);
+        if (index >= 0) {
+            Target_t &target = targets[index];
+            if ((target.state == INITIATING) && (initiations > 0)) {
+                --initiations;
+            }
+            report(target, BLE_ERROR_NONE, params->handle, now);
+        } else if (pendingControllerTimeouts > 0) {
+            /* An initiation which could not be cancelled completed after all. */
+            --pendingControllerTimeouts;
+        }
+
+        launch(now);
+    }
+
+    void onTimeout(Gap::TimeoutSource_t source) {
+        if (source != Gap::TIMEOUT_SRC_CONN) {
+            return;
+        }
+
+        uint32_t now = getTime();
+        if (pendingControllerTimeouts > 0) {
+            /* End of an initiation which was already timed out. */
+            --pendingControllerTimeouts;
+        } else if (whitelistActive) {
+            expireAll(now);
+        } else {
+            /* All attempts have the same duration: the oldest one ended. */
+            int oldest = -1;
+            for (unsigned i = 0; i < MaxTargets; ++i) {
+                if (targets[i].used && (targets[i].state == INITIATING) &&
+                    ((oldest < 0) || ((int32_t)(targets[i].attemptStart - targets[oldest].attemptStart) < 0))) {
+                    oldest = i;
+                }
+            }
+            if (oldest >= 0) {
+                --initiations;
+                failAttempt(targets[oldest], now, BLE_ERROR_UNSPECIFIED);
+            }
+        }
+
+        launch(now);
+    }
+
+    /**
+     * Fail the attempts of all the targets being initiated.
+     */
+    void expireAll(uint32_t now) {
+        initiations     = 0;
+        whitelistActive = false;
+        for (unsigned i = 0; i < MaxTargets; ++i) {
+            if (targets[i].used && (targets[i].state == INITIATING)) {
+                failAttempt(targets[i], now, BLE_ERROR_UNSPECIFIED);
+            }
+        }
+    }
+
+private:
+    /* Disallow copy and assignment. */
+    ConnectionScheduler(const ConnectionScheduler &);
+    ConnectionScheduler& operator=(const ConnectionScheduler &);
+
+private:
+    Gap                     &gap;
+    uint32_t                 attemptTimeout;
+    uint32_t                 minBackoff;
+    uint32_t                 maxBackoff;
+    uint8_t                  maxAttempts;
+    uint32_t               (*clock)(void);
+    GapScanningParams        scanParams;
+    Gap::ConnectionParams_t  connectionParams;
+    bool                     hasConnectionParams;
+    bool                     autoConnect;
+
+    bool                     running;
+    bool                     whitelistActive;
+    bool                     initiatorPolicyFiltered;
+    uint8_t                  maxInitiations;
+    uint8_t                  initiations;
+    uint8_t                  pendingControllerTimeouts;
+    uint32_t                 nextSequence;
+    uint32_t                 lastNow;
+    ble_error_t              registrationStatus;
+
+    Target_t                 targets[MaxTargets];
+    BLEProtocol::Address_t   whitelistAddresses[MaxTargets];
+    ResultCallback_t         resultCallback;
+};
+
+#endif /* ifndef __CONNECTION_SCHEDULER_H__ */
@@ -0,0 +1,325 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEFERRED_EVENT_QUEUE_H__
+#define __DEFERRED_EVENT_QUEUE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "FunctionPointerWithContext.h"
+
+/**
+ * Maximum number of payload bytes (advertising data, attribute value) copied
+ * into a deferred event. Events carrying a larger payload are dropped. The
+ * default is the largest attribute value carried by a single link layer
+ * PDU: 251 bytes of payload, less the L2CAP and ATT headers. It can be
+ * reduced to save memory if the ATT_MTU is never raised above
+ * BLE_DEFERRED_EVENT_MAX_DATA_LEN + 3.
+ */
+#ifndef BLE_DEFERRED_EVENT_MAX_DATA_LEN
+#define BLE_DEFERRED_EVENT_MAX_DATA_LEN 244
+#endif
+
+#if (BLE_DEFERRED_EVENT_MAX_DATA_LEN < 31) || (BLE_DEFERRED_EVENT_MAX_DATA_LEN > 0xFFFF)
+#error "BLE_DEFERRED_EVENT_MAX_DATA_LEN must be between 31 and 65535"
+#endif
+
+/*
+ * Memory barrier ordering accesses to the queue slots and indices between the
+ * producer (the stack, possibly in interrupt context) and the consumer.
+ */
+#if defined(__CC_ARM)
+#define BLE_DEFERRED_EVENT_QUEUE_BARRIER() __dmb(0xF)
+#elif defined(__GNUC__)
+#define BLE_DEFERRED_EVENT_QUEUE_BARRIER() __sync_synchronize()
+#else
+#define BLE_DEFERRED_EVENT_QUEUE_BARRIER()
+#endif
+
+/**
+ * Copy of an event reported by the stack, held in a DeferredEventQueue until
+ * BLE::processEvents() dispatches it to the application.
+ */
+struct DeferredEvent_t {
+    enum Type_t {
+        GAP_CONNECTION,
+        GAP_DISCONNECTION,
+        GAP_ADVERTISEMENT_REPORT,
+        GAP_TIMEOUT,
+        GAP_CONNECTION_PARAMS_UPDATE,
+        GAP_DATA_LENGTH_UPDATE,
+        GAP_PHY_UPDATE,
+        GATT_SERVER_DATA_WRITTEN,
+        GATT_SERVER_DATA_READ,
+        GATT_SERVER_EVENT,
+        GATT_SERVER_DATA_SENT,
+        GATT_SERVER_ATT_MTU_CHANGE,
+        GATT_CLIENT_READ_RESPONSE,
+        GATT_CLIENT_WRITE_RESPONSE,
+        GATT_CLIENT_HVX,
+        GATT_CLIENT_ATT_MTU_CHANGE
+    };
+
+    uint8_t type; /**< One of Type_t. */
+
+    union {
+        struct {
+            uint16_t handle;
+            uint8_t  role;
+            uint8_t  peerAddrType;
+            uint8_t  peerAddr[6];
+            uint8_t  ownAddrType;
+            uint8_t  ownAddr[6];
+            bool     hasConnectionParams;
+            uint16_t minConnectionInterval;
+            uint16_t maxConnectionInterval;
+            uint16_t slaveLatency;
+            uint16_t connectionSupervisionTimeout;
+        } connection;
+
+        struct {
+            uint16_t handle;
+            uint8_t  reason;
+        } disconnection;
+
+        struct {
+            uint8_t  peerAddr[6];
+            int8_t   rssi;
+            bool     isScanResponse;
+            uint8_t  type;
+        } advertisementReport;
+
+        struct {
+            uint8_t  source;
+        } timeout;
+
+        struct {
+            uint16_t handle;
+            uint8_t  status;
+            bool     hasConnectionParams;
+            uint16_t minConnectionInterval;
+            uint16_t maxConnectionInterval;
+            uint16_t slaveLatency;
+            uint16_t connectionSupervisionTimeout;
+        } connectionParamsUpdate;
+
+        struct {
+            uint16_t handle;
+            uint16_t maxTxOctets;
+            uint16_t maxRxOctets;
+        } dataLengthUpdate;
+
+        struct {
+            uint16_t handle;
+            uint8_t  status;
+            uint8_t  txPhy;
+            uint8_t  rxPhy;
+        } phyUpdate;
+
+        /* Data written, data read, read response, write response and HVX. */
+        struct {
+            uint16_t connHandle;
+            uint16_t handle;
+            uint16_t offset;
+            uint8_t  op; /**< Write operation or HVX type. */
+        } attribute;
+
+        struct {
+            uint8_t  type;
+            uint16_t handle;
+        } serverEvent;
+
+        struct {
+            unsigned count;
+        } dataSent;
+
+        struct {
+            uint16_t connHandle;
+            uint16_t attMtu;
+        } attMtuChange;
+    };
+
+    uint16_t dataLength;
+    uint8_t  data[BLE_DEFERRED_EVENT_MAX_DATA_LEN];
+
+    /**
+     * Copy @p length bytes of payload into the event.
+     *
+     * @return false if the payload doesn't fit.
+     */
+    bool setData(const uint8_t *payload, uint16_t length) {
+        if (length > sizeof(data)) {
+            return false;
+        }
+        if (length) {
+            memcpy(data, payload, length);
+        }
+        dataLength = length;
+        return true;
+    }
+};
+
+/**
+ * Lock-free single producer, single consumer ring of DeferredEvent_t.
+ *
+ * The stack is the producer: when a queue is installed through
+ * BLE::enableDeferredEventDispatch(), Gap, GattServer and GattClient copy
+ * the events reported to their process and handle entry points into the
+ * queue instead of invoking the application callbacks. BLE::processEvents()
+ * is the consumer and dispatches them from the thread of the application.
+ *
+ * All events must be pushed from a single execution context, and all of them
+ * consumed from a single (possibly different) one.
+ *
+ * @code
+ * static DeferredEvent_t eventStorage[16];
+ * static DeferredEventQueue eventQueue(eventStorage, 16);
+ *
+ * ble.enableDeferredEventDispatch(eventQueue, 4); // at most 4 events per processEvents()
+ * @endcode
+ */
+class DeferredEventQueue {
+public:
+    /**
+     * Type of the callback invoked when the queue goes from empty to
+     * non-empty.
+     */
+    typedef FunctionPointerWithContext<DeferredEventQueue *> EventsPendingCallback_t;
+
+    /**
+     * Construct a queue.
+     *
+     * @param[in] buffer
+     *              Storage for the events.
+     * @param[in] capacity
+     *              Number of events in @p buffer. Must be a power of two;
+     *              BLE::enableDeferredEventDispatch() refuses the queue
+     *              otherwise.
+     */
+    DeferredEventQueue(DeferredEvent_t *buffer, unsigned capacity) :
+        events(buffer),
+        mask(capacity - 1),
+        valid((capacity != 0) && ((capacity & (capacity - 1)) == 0)),
+        head(0),
+        tail(0),
+        droppedCount(0),
+        onEventsPending() {
+        /* empty */
+    }
+
+    /**
+     * Check whether the capacity of the queue is a power of two.
+     */
+    bool isValid(void) const {
+        return valid;
+    }
+
+    /**
+     * Append a copy of @p event to the queue. Producer side.
+     *
+     * @return false and count the event as dropped if the queue is full.
+     */
+    bool push(const DeferredEvent_t &event) {
+        unsigned currentTail = tail;
+        if ((currentTail - head) > mask) {
+            ++droppedCount;
+            return false;
+        }
+
+        events[currentTail & mask] = event;
+        BLE_DEFERRED_EVENT_QUEUE_BARRIER();
+        tail = currentTail + 1;
+        BLE_DEFERRED_EVENT_QUEUE_BARRIER();
+
+        /* Signal only if the consumer had drained everything before this
+         * event; otherwise it is still busy with the previous ones. */
+        if ((head == currentTail) && onEventsPending) {
+            onEventsPending(this);
+        }
+        return true;
+    }
+
+    /**
+     * Count an event which couldn't be copied into the queue as dropped.
+     * Producer side.
+     */
+    void drop(void) {
+        ++droppedCount;
+    }
+
+    /**
+     * Get the oldest event of the queue. Consumer side. The event remains
+     * valid until pop() is called.
+     *
+     * @return NULL if the queue is empty.
+     */
+    const DeferredEvent_t *front(void) const {
+        if (head == tail) {
+            return NULL;
+        }
+        BLE_DEFERRED_EVENT_QUEUE_BARRIER();
+        return &events[head & mask];
+    }
+
+    /**
+     * Remove the oldest event of the queue. Consumer side.
+     */
+    void pop(void) {
+        if (head != tail) {
+            BLE_DEFERRED_EVENT_QUEUE_BARRIER();
+            head = head + 1;
+        }
+    }
+
+    /**
+     * Check whether the queue holds any event.
+     */
+    bool empty(void) const {
+        return head == tail;
+    }
+
+    /**
+     * Get the number of events dropped because the queue was full or their
+     * payload exceeded BLE_DEFERRED_EVENT_MAX_DATA_LEN.
+     */
+    uint32_t getDroppedCount(void) const {
+        return droppedCount;
+    }
+
+    /**
+     * Set the callback invoked by the producer when the queue goes from empty
+     * to non-empty.
+     */
+    void setEventsPendingCallback(const EventsPendingCallback_t &callback) {
+        onEventsPending = callback;
+    }
+
+private:
+    DeferredEvent_t         *events;
+    const unsigned           mask;
+    const bool               valid;
+    volatile unsigned        head;         /**< Written by the consumer only. */
+    volatile unsigned        tail;         /**< Written by the producer only. */
+    volatile uint32_t        droppedCount; /**< Written by the producer only. */
+    EventsPendingCallback_t  onEventsPending;
+
+private:
+    /* Disallow copy and assignment. */
+    DeferredEventQueue(const DeferredEventQueue &);
+    DeferredEventQueue& operator=(const DeferredEventQueue &);
+};
+
+#endif /* ifndef __DEFERRED_EVENT_QUEUE_H__ */
@@ -187,6 +187,9 @@ public:
      *              the read operation begin.
      * @param[in] onRead
      *              Continuation of the read operation
+     *
+     * @return BLE_ERROR_NO_MEM if @p onRead cannot be registered, otherwise
+     *         the result of #read(uint16_t) const.
      */
     ble_error_t read(uint16_t offset, const GattClient::ReadCallback_t& onRead) const;
 
@@ -18,10 +18,24 @@
 #define MBED_FUNCTIONPOINTER_WITH_CONTEXT_H
 
 #include <string.h>
+#include <stdint.h>
 #include "SafeBool.h"
 
+/**
+ * Size in bytes of the inline storage available to functors attached to a
+ * FunctionPointerWithContext. By default, functors as large as two pointers
+ * fit without growing the object.
+ */
+#ifndef BLE_FUNCTION_POINTER_FUNCTOR_STORAGE_SIZE
+#define BLE_FUNCTION_POINTER_FUNCTOR_STORAGE_SIZE (2 * sizeof(void *))
+#endif
+
+/* Only the true specialization is complete; used to reject oversized functors at compile time. */
+template <bool> struct FunctionPointerWithContextFunctorFits;
+template <> struct FunctionPointerWithContextFunctorFits<true> { };
+
 /** A class for storing and calling a pointer to a static or member void function
- *  that takes a context.
+ *  that takes a context, or a small functor stored inline.
  */
 template <typename ContextType>
 class FunctionPointerWithContext : public SafeBool<FunctionPointerWithContext<ContextType> > {
@@ -35,7 +49,7 @@ public:
      *  @param function The void static function to attach (default is none).
      */
     FunctionPointerWithContext(void (*function)(ContextType context) = NULL) :
-        _memberFunctionAndPointer(), _caller(NULL), _next(NULL) {
+        _caller(NULL), _next(NULL) {
         attach(function);
     }
 
@@ -46,16 +60,17 @@ public:
      */
     template<typename T>
     FunctionPointerWithContext(T *object, void (T::*member)(ContextType context)) :
-        _memberFunctionAndPointer(), _caller(NULL), _next(NULL) {
+        _caller(NULL), _next(NULL) {
         attach(object, member);
     }
 
     FunctionPointerWithContext(const FunctionPointerWithContext& that) : 
-        _memberFunctionAndPointer(that._memberFunctionAndPointer), _caller(that._caller), _next(NULL) {
+        _caller(that._caller), _next(NULL) {
+        memcpy(&_storage, &that._storage, sizeof(_storage));
     }
 
     FunctionPointerWithContext& operator=(const FunctionPointerWithContext& that) {
-        _memberFunctionAndPointer = that._memberFunctionAndPointer;
+        memcpy(&_storage, &that._storage, sizeof(_storage));
         _caller = that._caller; 
         _next = NULL;
         return *this;
@@ -66,7 +81,8 @@ public:
      *  @param function The void static function to attach (default is none).
      */
     void attach(void (*function)(ContextType context) = NULL) {
-        _function = function;
+        memset(&_storage, 0, sizeof(_storage));
+        _storage._function = function;
         _caller = functioncaller;
     }
 
@@ -77,11 +93,34 @@ public:
      */
     template<typename T>
     void attach(T *object, void (T::*member)(ContextType context)) {
-        _memberFunctionAndPointer._object = static_cast<void *>(object);
-        memcpy(_memberFunctionAndPointer._memberFunction, (char*) &member, sizeof(member));
+        memset(&_storage, 0, sizeof(_storage));
+        _storage._memberFunctionAndPointer._object = static_cast<void *>(object);
+        memcpy(_storage._memberFunctionAndPointer._memberFunction, (char*) &member, sizeof(member));
         _caller = &FunctionPointerWithContext::membercaller<T>;
     }
 
+    /** Attach a functor; a copy of it is kept inside this object, no memory
+     *  is allocated.
+     *
+     *  @param functor The functor to attach. Its type must be trivially
+     *         copyable and destructible, at most
+     *         BLE_FUNCTION_POINTER_FUNCTOR_STORAGE_SIZE bytes large, and
+     *         provide void operator()(ContextType).
+     *
+     *  @note Functors are compared bytewise by operator==.
+     */
+    template<typename F>
+    void attachFunctor(const F &functor) {
+        (void) sizeof(FunctionPointerWithContextFunctorFits<(sizeof(F) <= sizeof(_storage._functor._bytes))>);
+#if defined(__GNUC__) && !defined(__CC_ARM)
+        (void) sizeof(FunctionPointerWithContextFunctorFits<__has_trivial_copy(F) && __has_trivial_destructor(F)>);
+#endif
+        memset(&_storage, 0, sizeof(_storage));
+        _storage._functor._invoke = &FunctionPointerWithContext::functorinvoker<F>;
+        memcpy(_storage._functor._bytes, (const char *) &functor, sizeof(F));
+        _caller = &FunctionPointerWithContext::functorcaller;
+    }
+
     /** Call the attached static or member function; if there are chained
      *  FunctionPointers their callbacks are invoked as well.
      *  @Note: All chained callbacks stack up, so hopefully there won't be too
@@ -108,7 +147,8 @@ public:
      * implementation of safe bool operator
      */
     bool toBool() const {
-        return (_function || _memberFunctionAndPointer._object);
+        return (_caller == &FunctionPointerWithContext::functorcaller) ||
+               _storage._function || _storage._memberFunctionAndPointer._object;
     }
 
     /**
@@ -127,35 +167,44 @@ public:
     }
 
     pvoidfcontext_t get_function() const {
-        return (pvoidfcontext_t)_function;
+        return (pvoidfcontext_t)_storage._function;
     }
 
     friend bool operator==(const FunctionPointerWithContext& lhs, const FunctionPointerWithContext& rhs) {
         return rhs._caller == lhs._caller &&
                memcmp(
-                   &rhs._memberFunctionAndPointer, 
-                   &lhs._memberFunctionAndPointer, 
-                   sizeof(rhs._memberFunctionAndPointer)
+                   &rhs._storage, 
+                   &lhs._storage, 
+                   sizeof(rhs._storage)
                ) == 0;
     }
 
 private:
     template<typename T>
     static void membercaller(cpFunctionPointerWithContext_t self, ContextType context) {
-        if (self->_memberFunctionAndPointer._object) {
-            T *o = static_cast<T *>(self->_memberFunctionAndPointer._object);
+        if (self->_storage._memberFunctionAndPointer._object) {
+            T *o = static_cast<T *>(self->_storage._memberFunctionAndPointer._object);
             void (T::*m)(ContextType);
-            memcpy((char*) &m, self->_memberFunctionAndPointer._memberFunction, sizeof(m));
+            memcpy((char*) &m, self->_storage._memberFunctionAndPointer._memberFunction, sizeof(m));
             (o->*m)(context);
         }
     }
 
     static void functioncaller(cpFunctionPointerWithContext_t self, ContextType context) {
-        if (self->_function) {
-            self->_function(context);
+        if (self->_storage._function) {
+            self->_storage._function(context);
         }
     }
 
+    static void functorcaller(cpFunctionPointerWithContext_t self, ContextType context) {
+        self->_storage._functor._invoke(self->_storage._functor._bytes, context);
+    }
+
+    template<typename F>
+    static void functorinvoker(void *functor, ContextType context) {
+        (*static_cast<F *>(functor))(context);
+    }
+
     struct MemberFunctionAndPtr {
         /*
          * Forward declaration of a class and a member function to this class.
@@ -173,15 +222,29 @@ private:
         };
     };
 
-    union {
+    struct FunctorStorage {
+        void (*_invoke)(void *functor, ContextType context);
+        union {
+            char _bytes[BLE_FUNCTION_POINTER_FUNCTOR_STORAGE_SIZE];
+            /* Members below are only there to align the storage. */
+            void *_alignPointer;
+            uint64_t _alignInteger;
+            double _alignDouble;
+        };
+    };
+
+    union Storage {
         pvoidfcontext_t _function;                      /**< Static function pointer - NULL if none attached */
         /**
          * object this pointer and pointer to member -
          * _memberFunctionAndPointer._object will be NULL if none attached
          */
-        mutable MemberFunctionAndPtr _memberFunctionAndPointer;
+        MemberFunctionAndPtr _memberFunctionAndPointer;
+        FunctorStorage _functor;                        /**< Inline copy of an attached functor */
     };
 
+    mutable Storage _storage;
+
     void (*_caller)(const FunctionPointerWithContext*, ContextType);
 
     pFunctionPointerWithContext_t _next;                /**< Optional link to make a chain out of functionPointers. This
@@ -209,4 +272,29 @@ FunctionPointerWithContext<ContextType> makeFunctionPointer(T *object, void (T::
     return FunctionPointerWithContext<ContextType>(object, member);
 }
 
+/**
+ * @brief Create a new FunctionPointerWithContext holding a copy of a functor.
+ * @details The context type cannot be deduced from the functor and has to be
+ * given explicitly:
+ * @code
+ * struct Counter {
+ *     unsigned *count;
+ *     void operator()(const GattHVXCallbackParams *) { ++(*count); }
+ * };
+ *
+ * Counter counter = { &notifications };
+ * gattClient.onHVX(makeFunctionPointer<const GattHVXCallbackParams *>(counter));
+ * @endcode
+ *
+ * @param functor The functor to copy, see FunctionPointerWithContext::attachFunctor().
+ * @return a new FunctionPointerWithContext
+ */
+template<typename ContextType, typename F>
+FunctionPointerWithContext<ContextType> makeFunctionPointer(const F &functor)
+{
+    FunctionPointerWithContext<ContextType> result;
+    result.attachFunctor(functor);
+    return result;
+}
+
 #endif // ifndef MBED_FUNCTIONPOINTER_WITH_CONTEXT_H
@@ -19,13 +19,47 @@
 
 #include "ble/BLEProtocol.h"
 #include "GapAdvertisingData.h"
+#include "AdvertisingDataParser.h"
+#include "AdvertisingPayloadPacker.h"
 #include "GapAdvertisingParams.h"
 #include "GapScanningParams.h"
+#include "GapScanFilter.h"
+#include "VirtualWhitelist.h"
 #include "GapEvents.h"
 #include "CallChainOfFunctionPointersWithContext.h"
 #include "FunctionPointerWithContext.h"
+#include "DeferredEventQueue.h"
 #include "deprecate.h"
 
+/**
+ * Capacity of the node pools backing the callchains of Gap when
+ * BLE_CALLCHAIN_USE_NODE_POOL is defined.
+ */
+#ifndef BLE_GAP_CALLCHAIN_POOL_CAPACITY
+#define BLE_GAP_CALLCHAIN_POOL_CAPACITY BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY
+#endif
+
+/**
+ * Number of connections recorded in the connection table of Gap, see
+ * Gap::getConnection(). Connections beyond this number are counted but not
+ * recorded.
+ */
+#ifndef BLE_GAP_MAX_CONNECTIONS
+#define BLE_GAP_MAX_CONNECTIONS 4
+#endif
+
+#if BLE_GAP_MAX_CONNECTIONS > 32
+#error "BLE_GAP_MAX_CONNECTIONS must not exceed 32"
+#endif
+
+/**
+ * Number of application pointers attached to each entry of the connection
+ * table of Gap, see Gap::setConnectionUserData().
+ */
+#ifndef BLE_GAP_CONNECTION_USER_SLOTS
+#define BLE_GAP_CONNECTION_USER_SLOTS 1
+#endif
+
 /* Forward declarations for classes that will only be used for pointers or references in the following. */
 class GapAdvertisingParams;
 class GapScanningParams;
@@ -173,6 +207,16 @@ public:
      */
     typedef uint16_t Handle_t;
 
+    /**
+     * Type for the handle of an advertising set, see createAdvertisingSet().
+     */
+    typedef uint8_t AdvertisingSetHandle_t;
+
+    /**
+     * Value of an invalid advertising set handle.
+     */
+    static const AdvertisingSetHandle_t INVALID_ADVERTISING_SET_HANDLE = 0xFF;
+
     /**
      * Structure containing GAP connection parameters. When in peripheral role
      * the connection parameters are suggestions. The choice of the connection
@@ -193,6 +237,19 @@ public:
         CENTRAL     = 0x2, /**< Central Role.    */
     };
 
+    /**
+     * Enumeration for the PHYs of the LE radio. Sets of PHYs are expressed
+     * as a bitwise OR of these values.
+     */
+    enum Phy_t {
+        PHY_1M    = 0x01, /**< 1 Mbps, used by every connection until a PHY update. */
+        PHY_2M    = 0x02, /**< 2 Mbps. */
+        PHY_CODED = 0x04, /**< Coded PHY, 125 or 500 kbps with an extended range. */
+    };
+
+    static const uint16_t DATA_LENGTH_DEFAULT = 27;  /**< Link layer payload size, in octets, until a data length update. */
+    static const uint16_t DATA_LENGTH_MAX     = 251; /**< Largest link layer payload size, in octets. */
+
     /**
      * Structure containing data and metadata of a scanned advertising packet.
      */
@@ -202,7 +259,7 @@ public:
         bool                                     isScanResponse;     /**< Whether this packet is the response to a scan request. */
         GapAdvertisingParams::AdvertisingType_t  type;               /**< The type of advertisement. */
         uint8_t                                  advertisingDataLen; /**< Length of the advertisement data. */
-        const uint8_t                           *advertisingData;    /**< Pointer to the advertisement packet's data. */
+        const uint8_t                           *advertisingData;    /**< Pointer to the advertisement packet's data; see AdvertisingDataParser. */
     };
 
     /**
@@ -261,6 +318,25 @@ public:
         }
     };
 
+    /**
+     * Entry of the connection table, describing an open connection. Refer to
+     * Gap::getConnection().
+     */
+    struct ConnectionEntry_t {
+        Handle_t                    handle;                                   /**< The ID for this connection. */
+        Role_t                      role;                                     /**< This device's role in the connection. */
+        BLEProtocol::AddressType_t  peerAddrType;                             /**< The peer's BLE address type. */
+        BLEProtocol::AddressBytes_t peerAddr;                                 /**< The peer's BLE address. */
+        bool                        hasConnectionParams;                      /**< Whether connectionParams is known. */
+        ConnectionParams_t          connectionParams;                         /**< The connection parameters reported by the stack. */
+        uint32_t                    connectedAt;                              /**< Time of the connection, see Gap::setTimeSource(). */
+        uint16_t                    maxTxOctets;                              /**< Link layer payload size sent, see Gap::updateDataLength(). */
+        uint16_t                    maxRxOctets;                              /**< Link layer payload size received. */
+        uint8_t                     txPhy;                                    /**< PHY used to send, one of Phy_t, see Gap::updatePhy(). */
+        uint8_t                     rxPhy;                                    /**< PHY used to receive, one of Phy_t. */
+        void                       *userData[BLE_GAP_CONNECTION_USER_SLOTS];  /**< Application data, see Gap::setConnectionUserData(). */
+    };
+
     /**
      * Structure that encapsulates information about a disconnection event.
      * Refer to Gap::onDisconnection().
@@ -284,6 +360,95 @@ public:
         {}
     };
 
+    /**
+     * Structure that encapsulates information about the outcome of a
+     * connection parameter update. Refer to Gap::onConnectionParamsUpdate().
+     */
+    struct ConnectionParamsUpdateCallbackParams_t {
+        Handle_t                  handle;           /**< The ID of the connection. */
+        ble_error_t               status;           /**< BLE_ERROR_NONE if new parameters are in use, or the reason of the failure, e.g. BLE_ERROR_OPERATION_NOT_PERMITTED if the peer rejected the request. */
+        const ConnectionParams_t *connectionParams; /**< The parameters in use after the procedure, NULL if unknown. */
+
+        /**
+         * Constructor for ConnectionParamsUpdateCallbackParams_t.
+         *
+         * @param[in] handleIn
+         *              Value for ConnectionParamsUpdateCallbackParams_t::handle.
+         * @param[in] statusIn
+         *              Value for ConnectionParamsUpdateCallbackParams_t::status.
+         * @param[in] connectionParamsIn
+         *              Value for ConnectionParamsUpdateCallbackParams_t::connectionParams.
+         */
+        ConnectionParamsUpdateCallbackParams_t(Handle_t                  handleIn,
+                                               ble_error_t               statusIn,
+                                               const ConnectionParams_t *connectionParamsIn) :
+            handle(handleIn),
+            status(statusIn),
+            connectionParams(connectionParamsIn)
+        {}
+    };
+
+    /**
+     * Structure that encapsulates the link layer payload sizes of a
+     * connection, reported when they change. Refer to Gap::onDataLengthUpdate().
+     */
+    struct DataLengthUpdateCallbackParams_t {
+        Handle_t handle;      /**< The ID of the connection. */
+        uint16_t maxTxOctets; /**< Largest link layer payload sent, in octets. */
+        uint16_t maxRxOctets; /**< Largest link layer payload received, in octets. */
+
+        /**
+         * Constructor for DataLengthUpdateCallbackParams_t.
+         *
+         * @param[in] handleIn
+         *              Value for DataLengthUpdateCallbackParams_t::handle.
+         * @param[in] maxTxOctetsIn
+         *              Value for DataLengthUpdateCallbackParams_t::maxTxOctets.
+         * @param[in] maxRxOctetsIn
+         *              Value for DataLengthUpdateCallbackParams_t::maxRxOctets.
+         */
+        DataLengthUpdateCallbackParams_t(Handle_t handleIn,
+                                         uint16_t maxTxOctetsIn,
+                                         uint16_t maxRxOctetsIn) :
+            handle(handleIn),
+            maxTxOctets(maxTxOctetsIn),
+            maxRxOctets(maxRxOctetsIn)
+        {}
+    };
+
+    /**
+     * Structure that encapsulates information about the outcome of a PHY
+     * update. Refer to Gap::onPhyUpdate().
+     */
+    struct PhyUpdateCallbackParams_t {
+        Handle_t    handle; /**< The ID of the connection. */
+        ble_error_t status; /**< BLE_ERROR_NONE if the procedure completed, or the reason of the failure. */
+        Phy_t       txPhy;  /**< The PHY used to send after the procedure. */
+        Phy_t       rxPhy;  /**< The PHY used to receive after the procedure. */
+
+        /**
+         * Constructor for PhyUpdateCallbackParams_t.
+         *
+         * @param[in] handleIn
+         *              Value for PhyUpdateCallbackParams_t::handle.
+         * @param[in] statusIn
+         *              Value for PhyUpdateCallbackParams_t::status.
+         * @param[in] txPhyIn
+         *              Value for PhyUpdateCallbackParams_t::txPhy.
+         * @param[in] rxPhyIn
+         *              Value for PhyUpdateCallbackParams_t::rxPhy.
+         */
+        PhyUpdateCallbackParams_t(Handle_t    handleIn,
+                                  ble_error_t statusIn,
+                                  Phy_t       txPhyIn,
+                                  Phy_t       rxPhyIn) :
+            handle(handleIn),
+            status(statusIn),
+            txPhy(txPhyIn),
+            rxPhy(rxPhyIn)
+        {}
+    };
+
     static const uint16_t UNIT_1_25_MS  = 1250; /**< Number of microseconds in 1.25 milliseconds. */
     /**
      * Helper function to convert from units of milliseconds to GAP duration
@@ -306,7 +471,7 @@ public:
     /**
      * Type for the timeout event callchain. Refer to Gap::onTimeout().
      */
-    typedef CallChainOfFunctionPointersWithContext<TimeoutSource_t> TimeoutEventCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<TimeoutSource_t, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> TimeoutEventCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the connection event
@@ -316,7 +481,7 @@ public:
     /**
      * Type for the connection event callchain. Refer to Gap::onConnection().
      */
-    typedef CallChainOfFunctionPointersWithContext<const ConnectionCallbackParams_t *> ConnectionEventCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const ConnectionCallbackParams_t *, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> ConnectionEventCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the disconnection event
@@ -326,7 +491,39 @@ public:
     /**
      * Type for the disconnection event callchain. Refer to Gap::onDisconnection().
      */
-    typedef CallChainOfFunctionPointersWithContext<const DisconnectionCallbackParams_t*> DisconnectionEventCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const DisconnectionCallbackParams_t*, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> DisconnectionEventCallbackChain_t;
+
+    /**
+     * Type for the registered callbacks added to the connection parameter
+     * update event callchain. Refer to Gap::onConnectionParamsUpdate().
+     */
+    typedef FunctionPointerWithContext<const ConnectionParamsUpdateCallbackParams_t *> ConnectionParamsUpdateEventCallback_t;
+    /**
+     * Type for the connection parameter update event callchain. Refer to
+     * Gap::onConnectionParamsUpdate().
+     */
+    typedef CallChainOfFunctionPointersWithContext<const ConnectionParamsUpdateCallbackParams_t *, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> ConnectionParamsUpdateEventCallbackChain_t;
+
+    /**
+     * Type for the registered callbacks added to the data length update
+     * event callchain. Refer to Gap::onDataLengthUpdate().
+     */
+    typedef FunctionPointerWithContext<const DataLengthUpdateCallbackParams_t *> DataLengthUpdateEventCallback_t;
+    /**
+     * Type for the data length update event callchain. Refer to
+     * Gap::onDataLengthUpdate().
+     */
+    typedef CallChainOfFunctionPointersWithContext<const DataLengthUpdateCallbackParams_t *, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> DataLengthUpdateEventCallbackChain_t;
+
+    /**
+     * Type for the registered callbacks added to the PHY update event
+     * callchain. Refer to Gap::onPhyUpdate().
+     */
+    typedef FunctionPointerWithContext<const PhyUpdateCallbackParams_t *> PhyUpdateEventCallback_t;
+    /**
+     * Type for the PHY update event callchain. Refer to Gap::onPhyUpdate().
+     */
+    typedef CallChainOfFunctionPointersWithContext<const PhyUpdateCallbackParams_t *, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> PhyUpdateEventCallbackChain_t;
 
     /**
      * Type for the handlers of radio notification callback events. Refer to
@@ -342,7 +539,7 @@ public:
     /**
      * Type for the shutdown event callchain. Refer to Gap::onShutdown().
      */
-    typedef CallChainOfFunctionPointersWithContext<const Gap *> GapShutdownCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const Gap *, BLE_CALLCHAIN_ALLOCATOR(BLE_GAP_CALLCHAIN_POOL_CAPACITY, Gap)> GapShutdownCallbackChain_t;
 
     /*
      * The following functions are meant to be overridden in the platform-specific sub-class.
@@ -428,6 +625,183 @@ public:
         return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
     }
 
+    /**
+     * Get the maximum length of the advertising data of an advertising set.
+     * With extended advertising, the data is chained over auxiliary packets
+     * and can be longer than a legacy advertising payload.
+     *
+     * @return Maximum length of the advertising data in bytes.
+     */
+    virtual uint16_t getMaxAdvertisingDataLength(void) const {
+        return GAP_ADVERTISING_DATA_MAX_PAYLOAD; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Get the number of advertising sets the underlying BLE stack can run
+     * concurrently.
+     *
+     * @return Number of advertising sets, 0 if advertising sets are not
+     *         supported.
+     */
+    virtual uint8_t getMaxAdvertisingSetCount(void) const {
+        return 0; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Create an advertising set, advertised independently of the legacy
+     * advertising started with startAdvertising().
+     *
+     * @param[out] handleP
+     *              Set to the handle of the new advertising set.
+     * @param[in]  params
+     *              The advertising parameters of the set.
+     *
+     * @return BLE_ERROR_NONE if the advertising set was created.
+     */
+    virtual ble_error_t createAdvertisingSet(AdvertisingSetHandle_t *handleP, const GapAdvertisingParams &params) {
+        /* avoid compiler warnings about unused variables */
+        (void)handleP;
+        (void)params;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Destroy an advertising set, stopping it first if needed.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     *
+     * @return BLE_ERROR_NONE if the advertising set was destroyed.
+     */
+    virtual ble_error_t destroyAdvertisingSet(AdvertisingSetHandle_t handle) {
+        /* avoid compiler warnings about unused variables */
+        (void)handle;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Change the advertising parameters of an advertising set.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     * @param[in] params
+     *              The new advertising parameters.
+     *
+     * @return BLE_ERROR_NONE if the parameters were set.
+     */
+    virtual ble_error_t setAdvertisingSetParams(AdvertisingSetHandle_t handle, const GapAdvertisingParams &params) {
+        /* avoid compiler warnings about unused variables */
+        (void)handle;
+        (void)params;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Set the advertising data or the scan response of an advertising set.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     * @param[in] payload
+     *              The formatted AD structures.
+     * @param[in] length
+     *              Length of @p payload, up to getMaxAdvertisingDataLength().
+     * @param[in] scanResponse
+     *              true to set the scan response, false to set the advertising
+     *              data.
+     *
+     * @return BLE_ERROR_NONE if the data was set.
+     *
+     * @note Applications should use setAdvertisingSetPayload() or
+     *       setAdvertisingSetScanResponse().
+     */
+    virtual ble_error_t setAdvertisingSetData(AdvertisingSetHandle_t handle, const uint8_t *payload, uint16_t length, bool scanResponse) {
+        /* avoid compiler warnings about unused variables */
+        (void)handle;
+        (void)payload;
+        (void)length;
+        (void)scanResponse;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Start advertising an advertising set.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     *
+     * @return BLE_ERROR_NONE if the advertising set was started.
+     */
+    virtual ble_error_t startAdvertisingSet(AdvertisingSetHandle_t handle) {
+        /* avoid compiler warnings about unused variables */
+        (void)handle;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Stop advertising an advertising set. Its parameters and data remain in
+     * effect.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     *
+     * @return BLE_ERROR_NONE if the advertising set was stopped.
+     */
+    virtual ble_error_t stopAdvertisingSet(AdvertisingSetHandle_t handle) {
+        /* avoid compiler warnings about unused variables */
+        (void)handle;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Set the advertising data of an advertising set. The payload can be a
+     * GapAdvertisingData, or an ExtendedAdvertisingData when the stack
+     * supports extended advertising.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     * @param[in] payload
+     *              The advertising data.
+     *
+     * @return BLE_ERROR_BUFFER_OVERFLOW if the payload is longer than
+     *         getMaxAdvertisingDataLength(), otherwise the result of
+     *         setAdvertisingSetData().
+     */
+    template <uint16_t MaxPayloadLen>
+    ble_error_t setAdvertisingSetPayload(AdvertisingSetHandle_t handle, const BasicGapAdvertisingData<MaxPayloadLen> &payload) {
+        if (payload.getPayloadLen() > getMaxAdvertisingDataLength()) {
+            return BLE_ERROR_BUFFER_OVERFLOW;
+        }
+
+        return setAdvertisingSetData(handle, payload.getPayload(), payload.getPayloadLen(), false);
+    }
+
+    /**
+     * Set the scan response of an advertising set.
+     *
+     * @param[in] handle
+     *              Handle of the advertising set.
+     * @param[in] payload
+     *              The scan response.
+     *
+     * @return BLE_ERROR_BUFFER_OVERFLOW if the payload is longer than
+     *         getMaxAdvertisingDataLength(), otherwise the result of
+     *         setAdvertisingSetData().
+     */
+    template <uint16_t MaxPayloadLen>
+    ble_error_t setAdvertisingSetScanResponse(AdvertisingSetHandle_t handle, const BasicGapAdvertisingData<MaxPayloadLen> &payload) {
+        if (payload.getPayloadLen() > getMaxAdvertisingDataLength()) {
+            return BLE_ERROR_BUFFER_OVERFLOW;
+        }
+
+        return setAdvertisingSetData(handle, payload.getPayload(), payload.getPayloadLen(), true);
+    }
+
     /**
      * Stop scanning. The current scanning parameters remain in effect.
      *
@@ -484,6 +858,27 @@ public:
         return connect(peerAddr, (BLEProtocol::AddressType_t) peerAddrType, connectionParams, scanParams);
     }
 
+    /**
+     * Cancel the connection establishment procedures started with connect()
+     * which have not completed yet.
+     *
+     * @return BLE_ERROR_NONE if the procedures were cancelled; no connection
+     *         or timeout event is reported for them.
+     */
+    virtual ble_error_t cancelConnect(void) {
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Get the number of connection establishment procedures that can run
+     * at the same time, each started with its own call to connect().
+     *
+     * @return The number of procedures, 1 by default.
+     */
+    virtual uint8_t getMaxConcurrentConnectionInitiations(void) const {
+        return 1; /* Requesting action from porter(s): override this API if more concurrent initiations are supported. */
+    }
+
     /**
      * This call initiates the disconnection procedure, and its completion will
      * be communicated to the application with an invocation of the
@@ -585,6 +980,89 @@ public:
         return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
     }
 
+    /**
+     * Set the link layer payload size the controller suggests for new
+     * connections. Connections start with DATA_LENGTH_DEFAULT octets; a larger
+     * value makes the controller run the data length update procedure once
+     * connected.
+     *
+     * @param[in] maxTxOctets
+     *              Payload size to send, between DATA_LENGTH_DEFAULT and
+     *              DATA_LENGTH_MAX octets.
+     *
+     * @return BLE_ERROR_NONE if the suggested payload size was set.
+     */
+    virtual ble_error_t setPreferredDataLength(uint16_t maxTxOctets = DATA_LENGTH_MAX) {
+        /* Avoid compiler warnings about unused variables. */
+        (void)maxTxOctets;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Request a new link layer payload size on a connection. Larger payloads
+     * carry a full ATT PDU in a single packet, cutting the per-packet
+     * overhead of bulk transfers. The payload sizes in use are reported to
+     * onDataLengthUpdate() once the procedure completes.
+     *
+     * @param[in] handle
+     *              Connection Handle.
+     * @param[in] maxTxOctets
+     *              Payload size to send, between DATA_LENGTH_DEFAULT and
+     *              DATA_LENGTH_MAX octets.
+     *
+     * @return BLE_ERROR_NONE if the procedure was started.
+     */
+    virtual ble_error_t updateDataLength(Handle_t handle, uint16_t maxTxOctets = DATA_LENGTH_MAX) {
+        /* Avoid compiler warnings about unused variables. */
+        (void)handle;
+        (void)maxTxOctets;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Set the PHYs this device prefers, for the PHY updates requested by the
+     * peers as well as for new connections.
+     *
+     * @param[in] txPhys
+     *              Set of PHYs to send with, a bitwise OR of Phy_t.
+     * @param[in] rxPhys
+     *              Set of PHYs to receive with, a bitwise OR of Phy_t.
+     *
+     * @return BLE_ERROR_NONE if the preferences were set.
+     */
+    virtual ble_error_t setPreferredPhys(uint8_t txPhys = PHY_1M | PHY_2M, uint8_t rxPhys = PHY_1M | PHY_2M) {
+        /* Avoid compiler warnings about unused variables. */
+        (void)txPhys;
+        (void)rxPhys;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
+    /**
+     * Request a PHY update on a connection. The controllers pick PHYs within
+     * the sets preferred by both devices; the outcome is reported to
+     * onPhyUpdate(), even if the PHYs don't change.
+     *
+     * @param[in] handle
+     *              Connection Handle.
+     * @param[in] txPhys
+     *              Set of PHYs to send with, a bitwise OR of Phy_t.
+     * @param[in] rxPhys
+     *              Set of PHYs to receive with, a bitwise OR of Phy_t.
+     *
+     * @return BLE_ERROR_NONE if the procedure was started.
+     */
+    virtual ble_error_t updatePhy(Handle_t handle, uint8_t txPhys = PHY_2M, uint8_t rxPhys = PHY_2M) {
+        /* Avoid compiler warnings about unused variables. */
+        (void)handle;
+        (void)txPhys;
+        (void)rxPhys;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
     /**
      * Set the device name characteristic in the GAP service.
      *
@@ -757,6 +1235,46 @@ public:
         return BLE_ERROR_NOT_IMPLEMENTED;
     }
 
+    /**
+     * Claim the whitelist of the controller. The controller has a single
+     * whitelist, which its users would otherwise overwrite: ReconnectManager,
+     * ConnectionScheduler and VirtualWhitelist claim it before loading it,
+     * and work without it if another owner holds it. An application which
+     * loads the whitelist itself should claim it first, and release it once
+     * its filter policies no longer use it.
+     *
+     * @param[in] owner
+     *              The claimant, usually the object loading the whitelist.
+     *
+     * @return BLE_ERROR_NONE if @p owner holds the whitelist;
+     *         BLE_ERROR_INVALID_STATE if another owner holds it.
+     */
+    ble_error_t claimWhitelist(const void *owner) {
+        if ((whitelistOwner != NULL) && (whitelistOwner != owner)) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+
+        whitelistOwner = owner;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Release the whitelist of the controller, if @p owner holds it. The
+     * content of the whitelist is left for the next owner to replace.
+     */
+    void releaseWhitelist(const void *owner) {
+        if (whitelistOwner == owner) {
+            whitelistOwner = NULL;
+        }
+    }
+
+    /**
+     * Get the owner of the whitelist of the controller, NULL if it is free.
+     */
+    const void *getWhitelistOwner(void) const {
+        return whitelistOwner;
+    }
+
     /**
      * Set the advertising policy filter mode to be used in the next call
      * to startAdvertising().
@@ -864,6 +1382,28 @@ protected:
         return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
     }
 
+    /**
+     * Push the rules of a scan filter down to the controller, so that the
+     * reports which do not pass it are not sent to the host at all.
+     *
+     * The filter is still evaluated on every report passed to
+     * processAdvertisementReport(), so an implementation may offload only
+     * the rules the controller supports; it must not drop a report which
+     * passes the filter.
+     *
+     * @param[in] filter
+     *              The filter to offload, or NULL to remove the filter
+     *              previously offloaded.
+     *
+     * @return BLE_ERROR_NONE if the controller applies the filter.
+     */
+    virtual ble_error_t setControllerScanFilter(const GapScanFilter *filter) {
+        /* avoid compiler warnings about unused variables */
+        (void)filter;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porter(s): override this API if this capability is supported. */
+    }
+
     /*
      * APIs with non-virtual implementations.
      */
@@ -879,22 +1419,123 @@ public:
     }
 
     /**
-     * Set the GAP advertising mode to use for this device.
-     *
-     * @param[in] advType
-     *              The new type of the advertising packets.
+     * Get the number of open connections.
      */
-    void setAdvertisingType(GapAdvertisingParams::AdvertisingType_t advType) {
-        _advParams.setAdvertisingType(advType);
+    uint8_t getConnectionCount(void) const {
+        return connectionCount;
     }
 
     /**
-     * Set the advertising interval.
+     * Get the entry of the connection table for the connection @p handle.
      *
-     * @param[in] interval
-     *              Advertising interval in units of milliseconds. Advertising
-     *              is disabled if interval is 0. If interval is smaller than
-     *              the minimum supported value, then the minimum supported
+     * The entry is created before the connection callbacks are invoked, and
+     * removed after the disconnection callbacks return.
+     *
+     * @param[in] handle
+     *              The connection handle.
+     *
+     * @return The entry, or NULL if there is no open connection @p handle or
+     *         if it did not fit in the table (see BLE_GAP_MAX_CONNECTIONS).
+     */
+    const ConnectionEntry_t *getConnection(Handle_t handle) const {
+        int index = findConnection(handle);
+        return (index < 0) ? NULL : &connectionTable[index];
+    }
+
+    /**
+     * Iterate over the entries of the connection table.
+     *
+     * @code
+     * for (const Gap::ConnectionEntry_t *entry = gap.getNextConnection(NULL);
+     *      entry != NULL;
+     *      entry = gap.getNextConnection(entry)) {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @param[in] entry
+     *              The previous entry, or NULL to get the first one.
+     *
+     * @return The next entry, or NULL if there are no more entries.
+     */
+    const ConnectionEntry_t *getNextConnection(const ConnectionEntry_t *entry) const {
+        for (unsigned i = (entry == NULL) ? 0 : (entry - connectionTable) + 1; i < BLE_GAP_MAX_CONNECTIONS; ++i) {
+            if (connectionTableUsed & (1UL << i)) {
+                return &connectionTable[i];
+            }
+        }
+
+        return NULL;
+    }
+
+    /**
+     * Attach an application pointer to a connection; it is available until
+     * the disconnection callbacks return.
+     *
+     * @param[in] handle
+     *              The connection handle.
+     * @param[in] slot
+     *              The slot of the pointer, below BLE_GAP_CONNECTION_USER_SLOTS.
+     * @param[in] data
+     *              The pointer.
+     *
+     * @return BLE_ERROR_NONE if the pointer was set;
+     *         BLE_ERROR_INVALID_PARAM if there is no entry for @p handle;
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p slot is invalid.
+     */
+    ble_error_t setConnectionUserData(Handle_t handle, unsigned slot, void *data) {
+        if (slot >= BLE_GAP_CONNECTION_USER_SLOTS) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+
+        int index = findConnection(handle);
+        if (index < 0) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+
+        connectionTable[index].userData[slot] = data;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Get an application pointer attached to a connection.
+     *
+     * @return The pointer, or NULL if none was set.
+     */
+    void *getConnectionUserData(Handle_t handle, unsigned slot) const {
+        const ConnectionEntry_t *entry = getConnection(handle);
+        return ((entry == NULL) || (slot >= BLE_GAP_CONNECTION_USER_SLOTS)) ? NULL : entry->userData[slot];
+    }
+
+    /**
+     * Set the function used to timestamp the entries of the connection
+     * table.
+     *
+     * @param[in] timeSource
+     *              Function returning the current time, in milliseconds, or
+     *              NULL to record a time of 0.
+     */
+    void setTimeSource(uint32_t (*timeSource)(void)) {
+        timeSourceFunction = timeSource;
+    }
+
+    /**
+     * Set the GAP advertising mode to use for this device.
+     *
+     * @param[in] advType
+     *              The new type of the advertising packets.
+     */
+    void setAdvertisingType(GapAdvertisingParams::AdvertisingType_t advType) {
+        _advParams.setAdvertisingType(advType);
+    }
+
+    /**
+     * Set the advertising interval.
+     *
+     * @param[in] interval
+     *              Advertising interval in units of milliseconds. Advertising
+     *              is disabled if interval is 0. If interval is smaller than
+     *              the minimum supported value, then the minimum supported
      *              value is used instead. This minimum value can be discovered
      *              using getMinAdvertisingInterval().
      *
@@ -951,8 +1592,14 @@ public:
      * initialized advertising payload to the underlying stack.
      */
     void clearAdvertisingPayload(void) {
+        if (_payloadTransactionActive) {
+            _stagedAdvPayload.clear();
+            return;
+        }
+
+        GapAdvertisingData emptyPayload;
+        pushAdvertisingData(emptyPayload, _scanResponse);
         _advPayload.clear();
-        setAdvertisingData(_advPayload, _scanResponse);
     }
 
     /**
@@ -970,13 +1617,17 @@ public:
      *         advertising payload.
      */
     ble_error_t accumulateAdvertisingPayload(uint8_t flags) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedAdvPayload.addFlags(flags));
+        }
+
         GapAdvertisingData advPayloadCopy = _advPayload;
         ble_error_t rc;
         if ((rc = advPayloadCopy.addFlags(flags)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(advPayloadCopy, _scanResponse);
+        rc = pushAdvertisingData(advPayloadCopy, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = advPayloadCopy;
         }
@@ -997,13 +1648,17 @@ public:
      *         advertising payload.
      */
     ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::Appearance app) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedAdvPayload.addAppearance(app));
+        }
+
         GapAdvertisingData advPayloadCopy = _advPayload;
         ble_error_t rc;
         if ((rc = advPayloadCopy.addAppearance(app)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(advPayloadCopy, _scanResponse);
+        rc = pushAdvertisingData(advPayloadCopy, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = advPayloadCopy;
         }
@@ -1024,13 +1679,17 @@ public:
      *         advertising payload.
      */
     ble_error_t accumulateAdvertisingPayloadTxPower(int8_t power) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedAdvPayload.addTxPower(power));
+        }
+
         GapAdvertisingData advPayloadCopy = _advPayload;
         ble_error_t rc;
         if ((rc = advPayloadCopy.addTxPower(power)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(advPayloadCopy, _scanResponse);
+        rc = pushAdvertisingData(advPayloadCopy, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = advPayloadCopy;
         }
@@ -1062,13 +1721,17 @@ public:
      *       payload.
      */
     ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::DataType type, const uint8_t *data, uint8_t len) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedAdvPayload.addData(type, data, len));
+        }
+
         GapAdvertisingData advPayloadCopy = _advPayload;
         ble_error_t rc;
         if ((rc = advPayloadCopy.addData(type, data, len)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(advPayloadCopy, _scanResponse);
+        rc = pushAdvertisingData(advPayloadCopy, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = advPayloadCopy;
         }
@@ -1093,13 +1756,17 @@ public:
      *         matching AD type; otherwise, an appropriate error.
      */
     ble_error_t updateAdvertisingPayload(GapAdvertisingData::DataType type, const uint8_t *data, uint8_t len) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedAdvPayload.updateData(type, data, len));
+        }
+
         GapAdvertisingData advPayloadCopy = _advPayload;
         ble_error_t rc;
         if ((rc = advPayloadCopy.updateData(type, data, len)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(advPayloadCopy, _scanResponse);
+        rc = pushAdvertisingData(advPayloadCopy, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = advPayloadCopy;
         }
@@ -1121,7 +1788,12 @@ public:
      *         set.
      */
     ble_error_t setAdvertisingPayload(const GapAdvertisingData &payload) {
-        ble_error_t rc = setAdvertisingData(payload, _scanResponse);
+        if (_payloadTransactionActive) {
+            _stagedAdvPayload = payload;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t rc = pushAdvertisingData(payload, _scanResponse);
         if (rc == BLE_ERROR_NONE) {
             _advPayload = payload;
         }
@@ -1129,6 +1801,63 @@ public:
         return rc;
     }
 
+    /**
+     * Set up an advertising payload encoded at compile time, typically with
+     * BLE_ADVERTISING_PAYLOAD(). The AD structures are copied as they are; a
+     * payload longer than GAP_ADVERTISING_DATA_MAX_PAYLOAD fails to compile.
+     *
+     * @param[in]   payload
+     *                  The encoded AD structures.
+     *
+     * @return BLE_ERROR_NONE if the advertisement payload was successfully
+     *         set.
+     */
+    template <size_t N>
+    ble_error_t setAdvertisingPayload(const uint8_t (&payload)[N]) {
+        (void) sizeof(GapAdvertisingPayloadFits<(N <= GAP_ADVERTISING_DATA_MAX_PAYLOAD)>);
+
+        GapAdvertisingData advPayload;
+        advPayload.setPayload(payload, N);
+        return setAdvertisingPayload(advPayload);
+    }
+
+    /**
+     * Set up both the advertising payload and the scan response from the
+     * prioritized fields of @p packer, in a single call to the underlying
+     * stack. See AdvertisingPayloadPacker for the packing rules.
+     *
+     * @param[in]  packer
+     *              The fields to advertise.
+     * @param[out] droppedCountP
+     *              If not NULL, set to the number of fields which fit in
+     *              neither payload.
+     *
+     * @return BLE_ERROR_NONE if the payloads were successfully set.
+     */
+    template <unsigned MaxFields>
+    ble_error_t setAdvertisingPayload(const AdvertisingPayloadPacker<MaxFields> &packer, unsigned *droppedCountP = NULL) {
+        GapAdvertisingData advPayload;
+        GapAdvertisingData scanResponse;
+        unsigned dropped = packer.pack(advPayload, scanResponse);
+        if (droppedCountP != NULL) {
+            *droppedCountP = dropped;
+        }
+
+        if (_payloadTransactionActive) {
+            _stagedAdvPayload   = advPayload;
+            _stagedScanResponse = scanResponse;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t rc = pushAdvertisingData(advPayload, scanResponse);
+        if (rc == BLE_ERROR_NONE) {
+            _advPayload   = advPayload;
+            _scanResponse = scanResponse;
+        }
+
+        return rc;
+    }
+
     /**
      * Get a reference to the advertising payload.
      *
@@ -1155,13 +1884,17 @@ public:
      *         response payload.
      */
     ble_error_t accumulateScanResponse(GapAdvertisingData::DataType type, const uint8_t *data, uint8_t len) {
+        if (_payloadTransactionActive) {
+            return stagePayloadUpdate(_stagedScanResponse.addData(type, data, len));
+        }
+
         GapAdvertisingData scanResponseCopy = _scanResponse;
         ble_error_t rc;
         if ((rc = scanResponseCopy.addData(type, data, len)) != BLE_ERROR_NONE) {
             return rc;
         }
 
-        rc = setAdvertisingData(_advPayload, scanResponseCopy);
+        rc = pushAdvertisingData(_advPayload, scanResponseCopy);
         if (rc == BLE_ERROR_NONE) {
             _scanResponse = scanResponseCopy;
         }
@@ -1177,10 +1910,211 @@ public:
      *       Gap::startAdvertising() before the update takes effect.
      */
     void clearScanResponse(void) {
+        if (_payloadTransactionActive) {
+            _stagedScanResponse.clear();
+            return;
+        }
+
+        GapAdvertisingData emptyPayload;
+        pushAdvertisingData(_advPayload, emptyPayload);
         _scanResponse.clear();
-        setAdvertisingData(_advPayload, _scanResponse);
     }
 
+    /**
+     * Set up a particular, user-constructed scan response payload for the
+     * underlying stack.
+     *
+     * @param[in]   payload
+     *                  A reference to a user constructed scan response
+     *                  payload.
+     *
+     * @return BLE_ERROR_NONE if the scan response payload was successfully
+     *         set.
+     */
+    ble_error_t setScanResponse(const GapAdvertisingData &payload) {
+        if (_payloadTransactionActive) {
+            _stagedScanResponse = payload;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t rc = pushAdvertisingData(_advPayload, payload);
+        if (rc == BLE_ERROR_NONE) {
+            _scanResponse = payload;
+        }
+
+        return rc;
+    }
+
+    /**
+     * Get a reference to the scan response payload.
+     *
+     * @return  Read back scan response data.
+     */
+    const GapAdvertisingData &getScanResponse(void) const {
+        return _scanResponse;
+    }
+
+    /**
+     * Start a transaction on the advertising payload and the scan response.
+     *
+     * Until the transaction is committed or aborted, the functions which
+     * modify the payloads (accumulateAdvertisingPayload(),
+     * updateAdvertisingPayload(), setAdvertisingPayload(),
+     * accumulateScanResponse(), setScanResponse() and their clear
+     * counterparts) only update a staged copy of the payloads; nothing is
+     * passed to the underlying stack.
+     * commitAdvertisingPayloadTransaction() then sets the staged payloads in
+     * a single call to the stack. This avoids a stack round-trip per field
+     * when a payload is rebuilt.
+     *
+     * @return BLE_ERROR_NONE if the transaction was started, or
+     *         BLE_ERROR_INVALID_STATE if a transaction is already in progress.
+     *
+     * @note getAdvertisingPayload() keeps returning the committed payload
+     *       while a transaction is in progress.
+     */
+    ble_error_t beginAdvertisingPayloadTransaction(void) {
+        if (_payloadTransactionActive) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+
+        _stagedAdvPayload         = _advPayload;
+        _stagedScanResponse       = _scanResponse;
+        _payloadTransactionError  = BLE_ERROR_NONE;
+        _payloadTransactionActive = true;
+
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Pass the payloads staged since beginAdvertisingPayloadTransaction() to
+     * the underlying stack and end the transaction.
+     *
+     * The payloads are applied as a whole: if a field could not be added
+     * during the transaction, or if the stack rejects the new payloads, the
+     * previous payloads remain in use.
+     *
+     * @return BLE_ERROR_NONE if the new payloads were set;
+     *         BLE_ERROR_INVALID_STATE if no transaction is in progress;
+     *         otherwise the first error met during the transaction or the
+     *         error returned by the stack.
+     */
+    ble_error_t commitAdvertisingPayloadTransaction(void) {
+        if (!_payloadTransactionActive) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+        _payloadTransactionActive = false;
+
+        if (_payloadTransactionError != BLE_ERROR_NONE) {
+            return _payloadTransactionError;
+        }
+
+        ble_error_t rc = pushAdvertisingData(_stagedAdvPayload, _stagedScanResponse);
+        if (rc == BLE_ERROR_NONE) {
+            _advPayload   = _stagedAdvPayload;
+            _scanResponse = _stagedScanResponse;
+        }
+
+        return rc;
+    }
+
+    /**
+     * Discard the payloads staged since beginAdvertisingPayloadTransaction()
+     * and end the transaction. The stack is not called.
+     */
+    void abortAdvertisingPayloadTransaction(void) {
+        _payloadTransactionActive = false;
+    }
+
+    /**
+     * Check whether a transaction on the advertising payload is in progress.
+     *
+     * @return true if beginAdvertisingPayloadTransaction() was called and the
+     *         transaction was neither committed nor aborted yet.
+     */
+    bool isAdvertisingPayloadTransactionActive(void) const {
+        return _payloadTransactionActive;
+    }
+
+    /**
+     * Get the number of times the advertising payload and the scan response
+     * were passed to the underlying stack.
+     *
+     * @note An update which leaves both payloads unchanged is not passed to
+     *       the stack; see getAdvertisingPayloadSuppressedCount().
+     */
+    uint32_t getAdvertisingPayloadPushCount(void) const {
+        return _advertisingDataPushCount;
+    }
+
+    /**
+     * Get the number of updates of the advertising payload or the scan
+     * response which were not passed to the underlying stack, because the
+     * stack already held the same payloads.
+     */
+    uint32_t getAdvertisingPayloadSuppressedCount(void) const {
+        return _advertisingDataSuppressedCount;
+    }
+
+    /**
+     * Scoped transaction on the advertising payload and the scan response.
+     *
+     * The transaction starts with the object and is aborted when the object
+     * goes out of scope, unless it was committed:
+     *
+     * @code
+     * Gap::AdvertisingPayloadTransaction transaction(ble.gap());
+     * ble.gap().clearAdvertisingPayload();
+     * ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+     * ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::SERVICE_DATA, serviceData, serviceDataLen);
+     * ble_error_t rc = transaction.commit();
+     * @endcode
+     */
+    class AdvertisingPayloadTransaction {
+    public:
+        /**
+         * Start a transaction on the payloads of @p gapIn.
+         */
+        AdvertisingPayloadTransaction(Gap &gapIn) :
+            gap(gapIn),
+            owner(gapIn.beginAdvertisingPayloadTransaction() == BLE_ERROR_NONE) {
+            /* empty */
+        }
+
+        /**
+         * Abort the transaction if it was not committed.
+         */
+        ~AdvertisingPayloadTransaction() {
+            if (owner) {
+                gap.abortAdvertisingPayloadTransaction();
+            }
+        }
+
+        /**
+         * Commit the transaction.
+         *
+         * @return The result of Gap::commitAdvertisingPayloadTransaction(),
+         *         or BLE_ERROR_INVALID_STATE if another transaction was
+         *         already in progress when this object was created.
+         */
+        ble_error_t commit(void) {
+            if (!owner) {
+                return BLE_ERROR_INVALID_STATE;
+            }
+            owner = false;
+            return gap.commitAdvertisingPayloadTransaction();
+        }
+
+    private:
+        /* Disallow copy and assignment. */
+        AdvertisingPayloadTransaction(const AdvertisingPayloadTransaction &);
+        AdvertisingPayloadTransaction& operator=(const AdvertisingPayloadTransaction &);
+
+    private:
+        Gap  &gap;
+        bool  owner;
+    };
+
     /**
      * Set up parameters for GAP scanning (observer mode).
      *
@@ -1280,6 +2214,43 @@ public:
         return BLE_ERROR_NONE;
     }
 
+    /**
+     * Change the scan interval and the scan window together.
+     *
+     * If scanning is active, the new settings are propagated to the
+     * underlying stack with a single restart of the scan, and only if they
+     * differ from the settings in effect once converted to 0.625ms units.
+     *
+     * @param[in] interval
+     *              Scan interval (in milliseconds) [valid values lie between 2.5ms and 10.24s].
+     * @param[in] window
+     *              Scan Window (in milliseconds) [valid values lie between 2.5ms and 10.24s],
+     *              no longer than @p interval.
+     *
+     * @return BLE_ERROR_NONE if the scan interval and window were set; the
+     *         current settings are left unchanged otherwise.
+     */
+    ble_error_t updateScanParams(uint16_t interval, uint16_t window) {
+        uint16_t newInterval = GapScanningParams::MSEC_TO_SCAN_DURATION_UNITS(interval);
+        uint16_t newWindow   = GapScanningParams::MSEC_TO_SCAN_DURATION_UNITS(window);
+        if ((newInterval < GapScanningParams::SCAN_INTERVAL_MIN) || (newInterval >= GapScanningParams::SCAN_INTERVAL_MAX) ||
+            (newWindow   < GapScanningParams::SCAN_WINDOW_MIN)   || (newWindow   > newInterval)) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+
+        if ((newInterval == _scanningParams.getInterval()) && (newWindow == _scanningParams.getWindow())) {
+            return BLE_ERROR_NONE;
+        }
+
+        _scanningParams.setInterval(interval);
+        _scanningParams.setWindow(window);
+        if (scanningActive) {
+            return startRadioScan(_scanningParams);
+        }
+
+        return BLE_ERROR_NONE;
+    }
+
     /**
      * Set up parameters for GAP scanning (observer mode).
      *
@@ -1386,6 +2357,78 @@ public:
         return err;
     }
 
+    /**
+     * Set the filter applied to advertisement reports before they are
+     * passed to the callback registered with startScan(). The reports which
+     * do not pass the filter are discarded, before they are queued if event
+     * dispatch is deferred; the criteria which need the resolver of the
+     * filter (see GapScanFilter::setResolver()) are evaluated when the
+     * reports are dispatched.
+     *
+     * The underlying stack is given the filter too, and may apply all or
+     * part of it in the controller.
+     *
+     * @param[in] filter
+     *              The filter, or NULL to pass every report. It is not
+     *              copied and must outlive its use by Gap.
+     *
+     * @note The filter counters are reset.
+     */
+    void setScanFilter(const GapScanFilter *filter) {
+        scanFilter                    = filter;
+        scanFilterMatchCount          = 0;
+        scanFilterRejectCount         = 0;
+        scanFilterIdentityRejectCount = 0;
+        setControllerScanFilter(filter);
+    }
+
+    /**
+     * Get the number of advertisement reports which passed the scan filter
+     * since it was set.
+     */
+    uint32_t getScanFilterMatchCount(void) const {
+        return scanFilterMatchCount;
+    }
+
+    /**
+     * Get the number of advertisement reports discarded by the scan filter
+     * since it was set.
+     */
+    uint32_t getScanFilterRejectCount(void) const {
+        return scanFilterRejectCount + scanFilterIdentityRejectCount;
+    }
+
+    /**
+     * Set the host-maintained whitelist applied to advertisement reports and
+     * incoming connections. The reports of peers not in the whitelist are
+     * discarded after the scan filter is applied; the peers not in the
+     * whitelist which connect to this device as a peripheral are
+     * disconnected without their connection or disconnection being
+     * reported, and the advertising they interrupted is restarted with the
+     * current advertising parameters once they are disconnected.
+     *
+     * The whitelist is applied where the events are dispatched: in the
+     * context of BLE::dispatchDeferredEvents() if deferred event dispatch is
+     * enabled, so that it is only accessed from the application context.
+     *
+     * @param[in] whitelist
+     *              The whitelist, or NULL to accept every peer. It is not
+     *              copied and must outlive its use by Gap.
+     *
+     * @note Use VirtualWhitelist::syncHardwareWhitelist() to have the
+     *       controller filter the most recently active entries too.
+     */
+    void setVirtualWhitelist(VirtualWhitelist *whitelist) {
+        virtualWhitelist = whitelist;
+    }
+
+    /**
+     * Get the host-maintained whitelist, NULL if none is set.
+     */
+    VirtualWhitelist *getVirtualWhitelist(void) const {
+        return virtualWhitelist;
+    }
+
     /**
      * Initialize radio-notification events to be generated from the stack.
      * This API doesn't need to be called directly.
@@ -1477,9 +2520,12 @@ public:
      *              Event handler being registered.
      *
      * @note It is possible to unregister callbacks using onTimeout().detach(callback).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onTimeout(TimeoutEventCallback_t callback) {
-        timeoutCallbackChain.add(callback);
+    ble_error_t onTimeout(TimeoutEventCallback_t callback) {
+        return timeoutCallbackChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1502,9 +2548,12 @@ public:
      *              Event handler being registered.
      *
      * @note It is possible to unregister callbacks using onConnection().detach(callback)
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onConnection(ConnectionEventCallback_t callback) {
-        connectionCallChain.add(callback);
+    ble_error_t onConnection(ConnectionEventCallback_t callback) {
+        return connectionCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1518,10 +2567,13 @@ public:
      * @param[in] mptr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template<typename T>
-    void onConnection(T *tptr, void (T::*mptr)(const ConnectionCallbackParams_t*)) {
-        connectionCallChain.add(tptr, mptr);
+    ble_error_t onConnection(T *tptr, void (T::*mptr)(const ConnectionCallbackParams_t*)) {
+        return connectionCallChain.add(tptr, mptr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1544,9 +2596,12 @@ public:
                     Event handler being registered.
      *
      * @note It is possible to unregister callbacks using onDisconnection().detach(callback).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onDisconnection(DisconnectionEventCallback_t callback) {
-        disconnectionCallChain.add(callback);
+    ble_error_t onDisconnection(DisconnectionEventCallback_t callback) {
+        return disconnectionCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1560,10 +2615,13 @@ public:
      * @param[in] mptr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template<typename T>
-    void onDisconnection(T *tptr, void (T::*mptr)(const DisconnectionCallbackParams_t*)) {
-        disconnectionCallChain.add(tptr, mptr);
+    ble_error_t onDisconnection(T *tptr, void (T::*mptr)(const DisconnectionCallbackParams_t*)) {
+        return disconnectionCallChain.add(tptr, mptr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1580,38 +2638,179 @@ public:
     }
 
     /**
-     * Set the application callback for radio-notification events.
+     * Append to a chain of callbacks to be invoked when a connection
+     * parameter update procedure completes, whether it was requested with
+     * updateConnectionParams() or started by the peer.
      *
-     * Radio Notification is a feature that enables ACTIVE and INACTIVE
-     * (nACTIVE) signals from the stack that notify the application when the
-     * radio is in use.
+     * @param[in] callback
+     *              Event handler being registered.
      *
-     * The ACTIVE signal is sent before the radio event starts. The nACTIVE
-     * signal is sent at the end of the radio event. These signals can be used
-     * by the application programmer to synchronize application logic with radio
-     * activity. For example, the ACTIVE signal can be used to shut off external
-     * devices, to manage peak current drawn during periods when the radio is on,
-     * or to trigger sensor data collection for transmission in the Radio Event.
+     * @note It is possible to unregister callbacks using onConnectionParamsUpdate().detach(callback).
      *
-     * @param[in] callback
-     *              The application handler to be invoked in response to a radio
-     *              ACTIVE/INACTIVE event.
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onRadioNotification(void (*callback)(bool param)) {
-        radioNotificationCallback.attach(callback);
+    ble_error_t onConnectionParamsUpdate(ConnectionParamsUpdateEventCallback_t callback) {
+        return connectionParamsUpdateCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
-     * Same as Gap::onRadioNotification(), but allows the posibility to
-     * register an object reference and member function as handler for radio
-     * notification events.
+     * Same as Gap::onConnectionParamsUpdate(), but allows the possibility to
+     * add an object reference and member function as handler for connection
+     * parameter update event callbacks.
      *
      * @param[in] tptr
      *              Pointer to the object of a class defining the member callback
      *              function (@p mptr).
      * @param[in] mptr
      *              The member callback (within the context of an object) to be
-     *              invoked in response to a radio ACTIVE/INACTIVE event.
+     *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    template<typename T>
+    ble_error_t onConnectionParamsUpdate(T *tptr, void (T::*mptr)(const ConnectionParamsUpdateCallbackParams_t*)) {
+        return connectionParamsUpdateCallChain.add(tptr, mptr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * @brief Provide access to the callchain of connection parameter update
+     * event callbacks.
+     *
+     * @return A reference to the connection parameter update event callback
+     *         chain.
+     */
+    ConnectionParamsUpdateEventCallbackChain_t& onConnectionParamsUpdate() {
+        return connectionParamsUpdateCallChain;
+    }
+
+    /**
+     * Append to a chain of callbacks to be invoked when the link layer
+     * payload sizes of a connection change, whether the data length update
+     * procedure was requested with updateDataLength() or by the peer.
+     *
+     * @param[in] callback
+     *              Event handler being registered.
+     *
+     * @note It is possible to unregister callbacks using onDataLengthUpdate().detach(callback).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    ble_error_t onDataLengthUpdate(DataLengthUpdateEventCallback_t callback) {
+        return dataLengthUpdateCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Same as Gap::onDataLengthUpdate(), but allows the possibility to add an
+     * object reference and member function as handler for data length update
+     * event callbacks.
+     *
+     * @param[in] tptr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p mptr).
+     * @param[in] mptr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    template<typename T>
+    ble_error_t onDataLengthUpdate(T *tptr, void (T::*mptr)(const DataLengthUpdateCallbackParams_t*)) {
+        return dataLengthUpdateCallChain.add(tptr, mptr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * @brief Provide access to the callchain of data length update event
+     * callbacks.
+     *
+     * @return A reference to the data length update event callback chain.
+     */
+    DataLengthUpdateEventCallbackChain_t& onDataLengthUpdate() {
+        return dataLengthUpdateCallChain;
+    }
+
+    /**
+     * Append to a chain of callbacks to be invoked when a PHY update
+     * procedure completes, whether it was requested with updatePhy() or by
+     * the peer.
+     *
+     * @param[in] callback
+     *              Event handler being registered.
+     *
+     * @note It is possible to unregister callbacks using onPhyUpdate().detach(callback).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    ble_error_t onPhyUpdate(PhyUpdateEventCallback_t callback) {
+        return phyUpdateCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Same as Gap::onPhyUpdate(), but allows the possibility to add an object
+     * reference and member function as handler for PHY update event
+     * callbacks.
+     *
+     * @param[in] tptr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p mptr).
+     * @param[in] mptr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    template<typename T>
+    ble_error_t onPhyUpdate(T *tptr, void (T::*mptr)(const PhyUpdateCallbackParams_t*)) {
+        return phyUpdateCallChain.add(tptr, mptr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * @brief Provide access to the callchain of PHY update event callbacks.
+     *
+     * @return A reference to the PHY update event callback chain.
+     */
+    PhyUpdateEventCallbackChain_t& onPhyUpdate() {
+        return phyUpdateCallChain;
+    }
+
+    /**
+     * Set the application callback for radio-notification events.
+     *
+     * Radio Notification is a feature that enables ACTIVE and INACTIVE
+     * (nACTIVE) signals from the stack that notify the application when the
+     * radio is in use.
+     *
+     * The ACTIVE signal is sent before the radio event starts. The nACTIVE
+     * signal is sent at the end of the radio event. These signals can be used
+     * by the application programmer to synchronize application logic with radio
+     * activity. For example, the ACTIVE signal can be used to shut off external
+     * devices, to manage peak current drawn during periods when the radio is on,
+     * or to trigger sensor data collection for transmission in the Radio Event.
+     *
+     * @param[in] callback
+     *              The application handler to be invoked in response to a radio
+     *              ACTIVE/INACTIVE event.
+     */
+    void onRadioNotification(void (*callback)(bool param)) {
+        radioNotificationCallback.attach(callback);
+    }
+
+    /**
+     * Same as Gap::onRadioNotification(), but allows the posibility to
+     * register an object reference and member function as handler for radio
+     * notification events.
+     *
+     * @param[in] tptr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p mptr).
+     * @param[in] mptr
+     *              The member callback (within the context of an object) to be
+     *              invoked in response to a radio ACTIVE/INACTIVE event.
      */
     template <typename T>
     void onRadioNotification(T *tptr, void (T::*mptr)(bool)) {
@@ -1635,9 +2834,12 @@ public:
      * some object.
      *
      * @note It is possible to unregister a callback using onShutdown().detach(callback)
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onShutdown(const GapShutdownCallback_t& callback) {
-        shutdownCallChain.add(callback);
+    ble_error_t onShutdown(const GapShutdownCallback_t& callback) {
+        return shutdownCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1651,10 +2853,13 @@ public:
      * @param[in] memberPtr
      *              The member callback (within the context of an object) to be
      *              invoked in response to a shutdown event.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template <typename T>
-    void onShutdown(T *objPtr, void (T::*memberPtr)(const Gap *)) {
-        shutdownCallChain.add(objPtr, memberPtr);
+    ble_error_t onShutdown(T *objPtr, void (T::*memberPtr)(const Gap *)) {
+        return shutdownCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -1693,20 +2898,35 @@ public:
 
         /* Clear Gap state */
         state.advertising = 0;
-        state.connected   = 0;
-        connectionCount   = 0;
+        state.connected     = 0;
+        connectionCount     = 0;
+        connectionTableUsed = 0;
 
         /* Clear scanning state */
-        scanningActive = false;
+        scanningActive                = false;
+        scanFilter                    = NULL;
+        scanFilterMatchCount          = 0;
+        scanFilterRejectCount         = 0;
+        scanFilterIdentityRejectCount = 0;
+        virtualWhitelist              = NULL;
+        rejectedConnections           = 0;
+        whitelistOwner                = NULL;
 
         /* Clear advertising and scanning data */
         _advPayload.clear();
         _scanResponse.clear();
+        _payloadTransactionActive       = false;
+        _advertisingDataPushed          = false;
+        _advertisingDataPushCount       = 0;
+        _advertisingDataSuppressedCount = 0;
 
         /* Clear callbacks */
         timeoutCallbackChain.clear();
         connectionCallChain.clear();
         disconnectionCallChain.clear();
+        connectionParamsUpdateCallChain.clear();
+        dataLengthUpdateCallChain.clear();
+        phyUpdateCallChain.clear();
         radioNotificationCallback = NULL;
         onAdvertisementReport     = NULL;
 
@@ -1722,20 +2942,124 @@ protected:
         _advPayload(),
         _scanningParams(),
         _scanResponse(),
+        _stagedAdvPayload(),
+        _stagedScanResponse(),
+        _payloadTransactionActive(false),
+        _payloadTransactionError(BLE_ERROR_NONE),
+        _advertisingDataPushed(false),
+        _advertisingDataPushCount(0),
+        _advertisingDataSuppressedCount(0),
         connectionCount(0),
+        connectionTable(),
+        connectionTableUsed(0),
+        timeSourceFunction(NULL),
         state(),
         scanningActive(false),
+        scanFilter(NULL),
+        scanFilterMatchCount(0),
+        scanFilterRejectCount(0),
+        scanFilterIdentityRejectCount(0),
+        virtualWhitelist(NULL),
+        rejectedConnections(0),
+        rejectedConnectionHandles(),
+        whitelistOwner(NULL),
         timeoutCallbackChain(),
         radioNotificationCallback(),
         onAdvertisementReport(),
         connectionCallChain(),
-        disconnectionCallChain() {
+        disconnectionCallChain(),
+        connectionParamsUpdateCallChain(),
+        dataLengthUpdateCallChain(),
+        phyUpdateCallChain(),
+        deferredEventQueue(NULL) {
         _advPayload.clear();
         _scanResponse.clear();
     }
 
     /* Entry points for the underlying stack to report events back to the user. */
 public:
+    /**
+     * Set the queue in which the events reported to the entry points below
+     * are copied instead of being dispatched immediately.
+     *
+     * @param[in] queue
+     *              The queue to use, NULL to dispatch events immediately.
+     *
+     * @note This is meant to be called by BLE::enableDeferredEventDispatch().
+     */
+    void setDeferredEventQueue(DeferredEventQueue *queue) {
+        deferredEventQueue = queue;
+    }
+
+    /**
+     * Dispatch an event previously deferred by one of the entry points below.
+     *
+     * @param[in] event
+     *              The event to dispatch.
+     *
+     * @note This is meant to be called by BLE::processEvents().
+     */
+    void dispatchDeferredEvent(const DeferredEvent_t &event) {
+        switch (event.type) {
+            case DeferredEvent_t::GAP_CONNECTION: {
+                ConnectionParams_t connectionParams = {
+                    event.connection.minConnectionInterval,
+                    event.connection.maxConnectionInterval,
+                    event.connection.slaveLatency,
+                    event.connection.connectionSupervisionTimeout
+                };
+                dispatchConnectionEvent(event.connection.handle,
+                                        static_cast<Role_t>(event.connection.role),
+                                        static_cast<BLEProtocol::AddressType_t>(event.connection.peerAddrType),
+                                        event.connection.peerAddr,
+                                        static_cast<BLEProtocol::AddressType_t>(event.connection.ownAddrType),
+                                        event.connection.ownAddr,
+                                        event.connection.hasConnectionParams ? &connectionParams : NULL);
+                break;
+            }
+            case DeferredEvent_t::GAP_DISCONNECTION:
+                dispatchDisconnectionEvent(event.disconnection.handle,
+                                           static_cast<DisconnectionReason_t>(event.disconnection.reason));
+                break;
+            case DeferredEvent_t::GAP_ADVERTISEMENT_REPORT:
+                dispatchAdvertisementReport(event.advertisementReport.peerAddr,
+                                            event.advertisementReport.rssi,
+                                            event.advertisementReport.isScanResponse,
+                                            static_cast<GapAdvertisingParams::AdvertisingType_t>(event.advertisementReport.type),
+                                            event.dataLength,
+                                            event.data);
+                break;
+            case DeferredEvent_t::GAP_TIMEOUT:
+                dispatchTimeoutEvent(static_cast<TimeoutSource_t>(event.timeout.source));
+                break;
+            case DeferredEvent_t::GAP_CONNECTION_PARAMS_UPDATE: {
+                ConnectionParams_t connectionParams = {
+                    event.connectionParamsUpdate.minConnectionInterval,
+                    event.connectionParamsUpdate.maxConnectionInterval,
+                    event.connectionParamsUpdate.slaveLatency,
+                    event.connectionParamsUpdate.connectionSupervisionTimeout
+                };
+                dispatchConnectionParamsUpdateEvent(event.connectionParamsUpdate.handle,
+                                                    static_cast<ble_error_t>(event.connectionParamsUpdate.status),
+                                                    event.connectionParamsUpdate.hasConnectionParams ? &connectionParams : NULL);
+                break;
+            }
+            case DeferredEvent_t::GAP_DATA_LENGTH_UPDATE:
+                dispatchDataLengthUpdateEvent(event.dataLengthUpdate.handle,
+                                              event.dataLengthUpdate.maxTxOctets,
+                                              event.dataLengthUpdate.maxRxOctets);
+                break;
+            case DeferredEvent_t::GAP_PHY_UPDATE:
+                dispatchPhyUpdateEvent(event.phyUpdate.handle,
+                                       static_cast<ble_error_t>(event.phyUpdate.status),
+                                       static_cast<Phy_t>(event.phyUpdate.txPhy),
+                                       static_cast<Phy_t>(event.phyUpdate.rxPhy));
+                break;
+            default:
+                break;
+        }
+    }
+
     /**
      * Helper function that notifies all registered handlers of an occurrence
      * of a connection event. This function is meant to be called from the
@@ -1763,13 +3087,28 @@ public:
                                 BLEProtocol::AddressType_t         ownAddrType,
                                 const BLEProtocol::AddressBytes_t  ownAddr,
                                 const ConnectionParams_t          *connectionParams) {
-        /* Update Gap state */
-        state.advertising = 0;
-        state.connected   = 1;
-        ++connectionCount;
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                               = DeferredEvent_t::GAP_CONNECTION;
+            event.connection.handle                  = handle;
+            event.connection.role                    = role;
+            event.connection.peerAddrType            = peerAddrType;
+            event.connection.ownAddrType             = ownAddrType;
+            memcpy(event.connection.peerAddr, peerAddr, ADDR_LEN);
+            memcpy(event.connection.ownAddr, ownAddr, ADDR_LEN);
+            event.connection.hasConnectionParams     = (connectionParams != NULL);
+            if (connectionParams) {
+                event.connection.minConnectionInterval        = connectionParams->minConnectionInterval;
+                event.connection.maxConnectionInterval        = connectionParams->maxConnectionInterval;
+                event.connection.slaveLatency                 = connectionParams->slaveLatency;
+                event.connection.connectionSupervisionTimeout = connectionParams->connectionSupervisionTimeout;
+            }
+            event.dataLength = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
 
-        ConnectionCallbackParams_t callbackParams(handle, role, peerAddrType, peerAddr, ownAddrType, ownAddr, connectionParams);
-        connectionCallChain.call(&callbackParams);
+        dispatchConnectionEvent(handle, role, peerAddrType, peerAddr, ownAddrType, ownAddr, connectionParams);
     }
 
     /**
@@ -1783,14 +3122,17 @@ public:
      *              The reason for disconnection.
      */
     void processDisconnectionEvent(Handle_t handle, DisconnectionReason_t reason) {
-        /* Update Gap state */
-        --connectionCount;
-        if (!connectionCount) {
-            state.connected = 0;
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                 = DeferredEvent_t::GAP_DISCONNECTION;
+            event.disconnection.handle = handle;
+            event.disconnection.reason = reason;
+            event.dataLength           = 0;
+            deferredEventQueue->push(event);
+            return;
         }
 
-        DisconnectionCallbackParams_t callbackParams(handle, reason);
-        disconnectionCallChain.call(&callbackParams);
+        dispatchDisconnectionEvent(handle, reason);
     }
 
     /**
@@ -1817,14 +3159,28 @@ public:
                                     GapAdvertisingParams::AdvertisingType_t  type,
                                     uint8_t                                  advertisingDataLen,
                                     const uint8_t                           *advertisingData) {
-        AdvertisementCallbackParams_t params;
-        memcpy(params.peerAddr, peerAddr, ADDR_LEN);
-        params.rssi               = rssi;
-        params.isScanResponse     = isScanResponse;
-        params.type               = type;
-        params.advertisingDataLen = advertisingDataLen;
-        params.advertisingData    = advertisingData;
-        onAdvertisementReport.call(&params);
+        /* The criteria which need the resolver are left to dispatchAdvertisementReport(). */
+        if (scanFilter && !scanFilter->matches(peerAddr, rssi, type, advertisingDataLen, advertisingData, false)) {
+            ++scanFilterRejectCount;
+            return;
+        }
+
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GAP_ADVERTISEMENT_REPORT;
+            if (!event.setData(advertisingData, advertisingDataLen)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            memcpy(event.advertisementReport.peerAddr, peerAddr, ADDR_LEN);
+            event.advertisementReport.rssi           = rssi;
+            event.advertisementReport.isScanResponse = isScanResponse;
+            event.advertisementReport.type           = type;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchAdvertisementReport(peerAddr, rssi, isScanResponse, type, advertisingDataLen, advertisingData);
     }
 
     /**
@@ -1836,6 +3192,324 @@ public:
      *              The source of the timout event.
      */
     void processTimeoutEvent(TimeoutSource_t source) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type           = DeferredEvent_t::GAP_TIMEOUT;
+            event.timeout.source = source;
+            event.dataLength     = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchTimeoutEvent(source);
+    }
+
+    /**
+     * Helper function that notifies all registered handlers of the outcome
+     * of a connection parameter update procedure. This function is meant to
+     * be called from the BLE stack specific implementation when the procedure
+     * completes or is rejected.
+     *
+     * @param[in] handle
+     *              The ID of the connection.
+     * @param[in] status
+     *              BLE_ERROR_NONE if new parameters are in use, or the reason
+     *              of the failure.
+     * @param[in] connectionParams
+     *              The parameters in use after the procedure, NULL if
+     *              unknown.
+     */
+    void processConnectionParamsUpdateEvent(Handle_t                  handle,
+                                            ble_error_t               status,
+                                            const ConnectionParams_t *connectionParams) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                                      = DeferredEvent_t::GAP_CONNECTION_PARAMS_UPDATE;
+            event.connectionParamsUpdate.handle              = handle;
+            event.connectionParamsUpdate.status              = status;
+            event.connectionParamsUpdate.hasConnectionParams = (connectionParams != NULL);
+            if (connectionParams) {
+                event.connectionParamsUpdate.minConnectionInterval        = connectionParams->minConnectionInterval;
+                event.connectionParamsUpdate.maxConnectionInterval        = connectionParams->maxConnectionInterval;
+                event.connectionParamsUpdate.slaveLatency                 = connectionParams->slaveLatency;
+                event.connectionParamsUpdate.connectionSupervisionTimeout = connectionParams->connectionSupervisionTimeout;
+            }
+            event.dataLength                                = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchConnectionParamsUpdateEvent(handle, status, connectionParams);
+    }
+
+    /**
+     * Helper function that notifies all registered handlers of a change of
+     * the link layer payload sizes of a connection. This function is meant to
+     * be called from the BLE stack specific implementation when a data length
+     * update procedure completes.
+     *
+     * @param[in] handle
+     *              The ID of the connection.
+     * @param[in] maxTxOctets
+     *              Largest link layer payload sent, in octets.
+     * @param[in] maxRxOctets
+     *              Largest link layer payload received, in octets.
+     */
+    void processDataLengthUpdateEvent(Handle_t handle, uint16_t maxTxOctets, uint16_t maxRxOctets) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                         = DeferredEvent_t::GAP_DATA_LENGTH_UPDATE;
+            event.dataLengthUpdate.handle      = handle;
+            event.dataLengthUpdate.maxTxOctets = maxTxOctets;
+            event.dataLengthUpdate.maxRxOctets = maxRxOctets;
+            event.dataLength                   = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchDataLengthUpdateEvent(handle, maxTxOctets, maxRxOctets);
+    }
+
+    /**
+     * Helper function that notifies all registered handlers of the outcome
+     * of a PHY update procedure. This function is meant to be called from the
+     * BLE stack specific implementation when the procedure completes or
+     * fails.
+     *
+     * @param[in] handle
+     *              The ID of the connection.
+     * @param[in] status
+     *              BLE_ERROR_NONE if the procedure completed, or the reason of
+     *              the failure.
+     * @param[in] txPhy
+     *              The PHY used to send after the procedure.
+     * @param[in] rxPhy
+     *              The PHY used to receive after the procedure.
+     */
+    void processPhyUpdateEvent(Handle_t handle, ble_error_t status, Phy_t txPhy, Phy_t rxPhy) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type             = DeferredEvent_t::GAP_PHY_UPDATE;
+            event.phyUpdate.handle = handle;
+            event.phyUpdate.status = status;
+            event.phyUpdate.txPhy  = txPhy;
+            event.phyUpdate.rxPhy  = rxPhy;
+            event.dataLength       = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchPhyUpdateEvent(handle, status, txPhy, rxPhy);
+    }
+
+private:
+    /* Update the Gap state and invoke the application callbacks for the events above. */
+    void dispatchConnectionEvent(Handle_t                           handle,
+                                 Role_t                             role,
+                                 BLEProtocol::AddressType_t         peerAddrType,
+                                 const BLEProtocol::AddressBytes_t  peerAddr,
+                                 BLEProtocol::AddressType_t         ownAddrType,
+                                 const BLEProtocol::AddressBytes_t  ownAddr,
+                                 const ConnectionParams_t          *connectionParams) {
+        /* Update Gap state */
+        state.advertising = 0;
+        if (virtualWhitelist && (role == PERIPHERAL) && !virtualWhitelist->acceptConnection(peerAddr) && rejectConnection(handle)) {
+            return;
+        }
+
+        state.connected   = 1;
+        ++connectionCount;
+        addConnection(handle, role, peerAddrType, peerAddr, connectionParams);
+
+        ConnectionCallbackParams_t callbackParams(handle, role, peerAddrType, peerAddr, ownAddrType, ownAddr, connectionParams);
+        connectionCallChain.call(&callbackParams);
+    }
+
+    void dispatchDisconnectionEvent(Handle_t handle, DisconnectionReason_t reason) {
+        if (rejectedConnections && forgetRejectedConnection(handle)) {
+            /* Resume the advertising the rejected peer interrupted. */
+            if (!state.advertising) {
+                startAdvertising();
+            }
+            return;
+        }
+
+        /* Update Gap state */
+        --connectionCount;
+        if (!connectionCount) {
+            state.connected = 0;
+        }
+
+        DisconnectionCallbackParams_t callbackParams(handle, reason);
+        disconnectionCallChain.call(&callbackParams);
+
+        /* The entry remains available to the disconnection callbacks. */
+        int index = findConnection(handle);
+        if (index >= 0) {
+            connectionTableUsed &= ~(1UL << index);
+        }
+    }
+
+    /**
+     * Record a new connection in the connection table. The search for a free
+     * entry starts at the entry the handle hashes to, so that lookups usually
+     * succeed on the first entry probed.
+     */
+    void addConnection(Handle_t                           handle,
+                       Role_t                             role,
+                       BLEProtocol::AddressType_t         peerAddrType,
+                       const BLEProtocol::AddressBytes_t  peerAddr,
+                       const ConnectionParams_t          *connectionParams) {
+        for (unsigned probe = 0; probe < BLE_GAP_MAX_CONNECTIONS; ++probe) {
+            unsigned index = (handle + probe) % BLE_GAP_MAX_CONNECTIONS;
+            if (connectionTableUsed & (1UL << index)) {
+                continue;
+            }
+
+            ConnectionEntry_t &entry = connectionTable[index];
+            entry.handle              = handle;
+            entry.role                = role;
+            entry.peerAddrType        = peerAddrType;
+            memcpy(entry.peerAddr, peerAddr, ADDR_LEN);
+            entry.hasConnectionParams = (connectionParams != NULL);
+            if (connectionParams != NULL) {
+                entry.connectionParams = *connectionParams;
+            }
+            entry.connectedAt         = timeSourceFunction ? timeSourceFunction() : 0;
+            entry.maxTxOctets         = DATA_LENGTH_DEFAULT;
+            entry.maxRxOctets         = DATA_LENGTH_DEFAULT;
+            entry.txPhy               = PHY_1M;
+            entry.rxPhy               = PHY_1M;
+            memset(entry.userData, 0, sizeof(entry.userData));
+
+            connectionTableUsed |= (1UL << index);
+            return;
+        }
+    }
+
+    /**
+     * Find the entry of the connection @p handle.
+     *
+     * @return The index of the entry, or -1 if there is none.
+     */
+    int findConnection(Handle_t handle) const {
+        for (unsigned probe = 0; probe < BLE_GAP_MAX_CONNECTIONS; ++probe) {
+            unsigned index = (handle + probe) % BLE_GAP_MAX_CONNECTIONS;
+            if ((connectionTableUsed & (1UL << index)) && (connectionTable[index].handle == handle)) {
+                return index;
+            }
+        }
+
+        return -1;
+    }
+
+    /**
+     * Disconnect a connection rejected by the virtual whitelist, and
+     * remember its handle so that its disconnection is not reported.
+     *
+     * @return false if the handle could not be remembered or the
+     *         disconnection could not be requested, in which case the
+     *         connection is reported like any other.
+     */
+    bool rejectConnection(Handle_t handle) {
+        unsigned index = 0;
+        while ((index < BLE_GAP_MAX_CONNECTIONS) && (rejectedConnections & (1UL << index))) {
+            ++index;
+        }
+        if (index == BLE_GAP_MAX_CONNECTIONS) {
+            return false;
+        }
+
+        rejectedConnectionHandles[index] = handle;
+        rejectedConnections |= (1UL << index);
+        if (disconnect(handle, REMOTE_USER_TERMINATED_CONNECTION) != BLE_ERROR_NONE) {
+            forgetRejectedConnection(handle);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Forget the handle of a connection rejected by the virtual whitelist.
+     *
+     * @return false if @p handle is not the handle of a rejected connection.
+     */
+    bool forgetRejectedConnection(Handle_t handle) {
+        for (unsigned index = 0; index < BLE_GAP_MAX_CONNECTIONS; ++index) {
+            if ((rejectedConnections & (1UL << index)) && (rejectedConnectionHandles[index] == handle)) {
+                rejectedConnections &= ~(1UL << index);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void dispatchAdvertisementReport(const BLEProtocol::AddressBytes_t        peerAddr,
+                                     int8_t                                   rssi,
+                                     bool                                     isScanResponse,
+                                     GapAdvertisingParams::AdvertisingType_t  type,
+                                     uint8_t                                  advertisingDataLen,
+                                     const uint8_t                           *advertisingData) {
+        if (scanFilter) {
+            if (!scanFilter->matchesIdentity(peerAddr)) {
+                ++scanFilterIdentityRejectCount;
+                return;
+            }
+            ++scanFilterMatchCount;
+        }
+
+        if (virtualWhitelist && !virtualWhitelist->acceptAdvertisement(peerAddr)) {
+            return;
+        }
+
+        AdvertisementCallbackParams_t params;
+        memcpy(params.peerAddr, peerAddr, ADDR_LEN);
+        params.rssi               = rssi;
+        params.isScanResponse     = isScanResponse;
+        params.type               = type;
+        params.advertisingDataLen = advertisingDataLen;
+        params.advertisingData    = advertisingData;
+        onAdvertisementReport.call(&params);
+    }
+
+    void dispatchConnectionParamsUpdateEvent(Handle_t                  handle,
+                                             ble_error_t               status,
+                                             const ConnectionParams_t *connectionParams) {
+        int index = findConnection(handle);
+        if ((index >= 0) && (connectionParams != NULL)) {
+            connectionTable[index].hasConnectionParams = true;
+            connectionTable[index].connectionParams    = *connectionParams;
+        }
+
+        ConnectionParamsUpdateCallbackParams_t callbackParams(handle, status, connectionParams);
+        connectionParamsUpdateCallChain.call(&callbackParams);
+    }
+
+    void dispatchDataLengthUpdateEvent(Handle_t handle, uint16_t maxTxOctets, uint16_t maxRxOctets) {
+        int index = findConnection(handle);
+        if (index >= 0) {
+            connectionTable[index].maxTxOctets = maxTxOctets;
+            connectionTable[index].maxRxOctets = maxRxOctets;
+        }
+
+        DataLengthUpdateCallbackParams_t callbackParams(handle, maxTxOctets, maxRxOctets);
+        dataLengthUpdateCallChain.call(&callbackParams);
+    }
+
+    void dispatchPhyUpdateEvent(Handle_t handle, ble_error_t status, Phy_t txPhy, Phy_t rxPhy) {
+        int index = findConnection(handle);
+        if ((index >= 0) && (status == BLE_ERROR_NONE)) {
+            connectionTable[index].txPhy = txPhy;
+            connectionTable[index].rxPhy = rxPhy;
+        }
+
+        PhyUpdateCallbackParams_t callbackParams(handle, status, txPhy, rxPhy);
+        phyUpdateCallChain.call(&callbackParams);
+    }
+
+    void dispatchTimeoutEvent(TimeoutSource_t source) {
         if (source == TIMEOUT_SRC_ADVERTISING) {
             /* Update gap state if the source is an advertising timeout */
             state.advertising = 0;
@@ -1845,6 +3519,36 @@ public:
         }
     }
 
+private:
+    /**
+     * Record the result of an update of the payloads staged by a transaction.
+     * The first error is returned by the commit.
+     */
+    ble_error_t stagePayloadUpdate(ble_error_t rc) {
+        if ((rc != BLE_ERROR_NONE) && (_payloadTransactionError == BLE_ERROR_NONE)) {
+            _payloadTransactionError = rc;
+        }
+        return rc;
+    }
+
+    /**
+     * Pass new payloads to the underlying stack, unless they are identical
+     * to the payloads it already holds.
+     */
+    ble_error_t pushAdvertisingData(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse) {
+        if (_advertisingDataPushed && (advData == _advPayload) && (scanResponse == _scanResponse)) {
+            ++_advertisingDataSuppressedCount;
+            return BLE_ERROR_NONE;
+        }
+
+        ++_advertisingDataPushCount;
+        ble_error_t rc = setAdvertisingData(advData, scanResponse);
+        /* After a failure, the payloads held by the stack are unknown. */
+        _advertisingDataPushed = (rc == BLE_ERROR_NONE);
+
+        return rc;
+    }
+
 protected:
     /**
      * Currently set advertising parameters.
@@ -1862,11 +3566,52 @@ protected:
      * Currently set scan response data.
      */
     GapAdvertisingData               _scanResponse;
+    /**
+     * Advertising data staged by the transaction in progress.
+     */
+    GapAdvertisingData               _stagedAdvPayload;
+    /**
+     * Scan response staged by the transaction in progress.
+     */
+    GapAdvertisingData               _stagedScanResponse;
+    /**
+     * Whether a transaction on the payloads is in progress.
+     */
+    bool                             _payloadTransactionActive;
+    /**
+     * First error met by the transaction in progress.
+     */
+    ble_error_t                      _payloadTransactionError;
+    /**
+     * Whether the stack holds _advPayload and _scanResponse.
+     */
+    bool                             _advertisingDataPushed;
+    /**
+     * Number of payload updates passed to the stack.
+     */
+    uint32_t                         _advertisingDataPushCount;
+    /**
+     * Number of payload updates skipped because the stack already held the
+     * same payloads.
+     */
+    uint32_t                         _advertisingDataSuppressedCount;
 
     /**
      * Total number of open connections.
      */
     uint8_t                          connectionCount;
+    /**
+     * Entries of the connection table.
+     */
+    ConnectionEntry_t                connectionTable[BLE_GAP_MAX_CONNECTIONS];
+    /**
+     * Bit mask of the entries of the connection table in use.
+     */
+    uint32_t                         connectionTableUsed;
+    /**
+     * Function timestamping the entries of the connection table.
+     */
+    uint32_t                       (*timeSourceFunction)(void);
     /**
      * The current GAP state.
      */
@@ -1876,6 +3621,42 @@ protected:
      * from a peer if possible.
      */
     bool                             scanningActive;
+    /**
+     * Filter applied to advertisement reports, NULL if none.
+     */
+    const GapScanFilter             *scanFilter;
+    /**
+     * Number of advertisement reports which passed the scan filter.
+     */
+    uint32_t                         scanFilterMatchCount;
+    /**
+     * Number of advertisement reports discarded by the scan filter as they
+     * are reported.
+     */
+    uint32_t                         scanFilterRejectCount;
+    /**
+     * Number of advertisement reports discarded by the criteria of the scan
+     * filter which need the resolver, as they are dispatched. Kept apart
+     * from scanFilterRejectCount, which is written from the stack context.
+     */
+    uint32_t                         scanFilterIdentityRejectCount;
+    /**
+     * Host-maintained whitelist, NULL if none.
+     */
+    VirtualWhitelist                *virtualWhitelist;
+    /**
+     * Bit mask of the entries of rejectedConnectionHandles in use.
+     */
+    uint32_t                         rejectedConnections;
+    /**
+     * Connections rejected by the virtual whitelist, which disconnection
+     * is not reported.
+     */
+    Handle_t                         rejectedConnectionHandles[BLE_GAP_MAX_CONNECTIONS];
+    /**
+     * Holder of the whitelist of the controller, NULL if none.
+     */
+    const void                      *whitelistOwner;
 
 protected:
     /**
@@ -1902,6 +3683,21 @@ protected:
      * events.
      */
     DisconnectionEventCallbackChain_t disconnectionCallChain;
+    /**
+     * Callchain containing all registered callback handlers for connection
+     * parameter update events.
+     */
+    ConnectionParamsUpdateEventCallbackChain_t connectionParamsUpdateCallChain;
+    /**
+     * Callchain containing all registered callback handlers for data length
+     * update events.
+     */
+    DataLengthUpdateEventCallbackChain_t dataLengthUpdateCallChain;
+    /**
+     * Callchain containing all registered callback handlers for PHY update
+     * events.
+     */
+    PhyUpdateEventCallbackChain_t     phyUpdateCallChain;
 
 private:
     /**
@@ -1909,6 +3705,11 @@ private:
      * events.
      */
     GapShutdownCallbackChain_t shutdownCallChain;
+    /**
+     * Queue in which events are deferred, NULL if they are dispatched
+     * immediately.
+     */
+    DeferredEventQueue        *deferredEventQueue;
 
 private:
     /* Disallow copy and assignment. */
@@ -25,50 +25,10 @@
 #define GAP_ADVERTISING_DATA_MAX_PAYLOAD        (31)
 
 /**
- * @brief This class provides several helper functions to generate properly
- *        formatted GAP Advertising and Scan Response data payloads.
- *
- * @note See Bluetooth Specification 4.0 (Vol. 3), Part C, Sections 11 and 18
- *       for further information on Advertising and Scan Response data.
- *
- * @par Advertising and Scan Response Payloads
- *      Advertising data and Scan Response data are organized around a set of
- *      data types called 'AD types' in Bluetooth 4.0 (see the Bluetooth Core
- *      Specification v4.0, Vol. 3, Part C, Sections 11 and 18).
- *
- * @par
- *      Each AD type has its own standardized assigned number, as defined
- *      by the Bluetooth SIG:
- *      https://www.bluetooth.org/en-us/specification/assigned-numbers/generic-access-profile.
- *
- * @par
- *      For convenience, all appropriate AD types are encapsulated
- *      in GapAdvertisingData::DataType.
- *
- * @par
- *      Before the AD Types and their payload (if any) can be inserted into
- *      the Advertising or Scan Response frames, they need to be formatted as
- *      follows:
- *
- * @li @c Record length (1 byte).
- * @li @c AD Type (1 byte).
- * @li @c AD payload (optional; only present if record length > 1).
- *
- * @par
- *      This class takes care of properly formatting the payload, performs
- *      some basic checks on the payload length, and tries to avoid common
- *      errors like adding an exclusive AD field twice in the Advertising
- *      or Scan Response payload.
- *
- * @par EXAMPLE
- *
- * @code
- *
- * // ToDo
- *
- * @endcode
+ * @brief AD types, flags and appearance values used in advertising and scan
+ *        response payloads; see GapAdvertisingData.
  */
-class GapAdvertisingData
+class GapAdvertisingDataTypes
 {
 public:
     /*!
@@ -200,11 +160,41 @@ public:
      * @deprecated  This type alias will be dropped in future releases.
      */
     typedef enum Appearance_t Appearance;
+};
+
+/* Type of the payload length of BasicGapAdvertisingData; one byte for
+ * payloads of legacy advertising. */
+template <bool Wide> struct GapAdvertisingDataLength { typedef uint8_t type; };
+template <> struct GapAdvertisingDataLength<true> { typedef uint16_t type; };
+
+/**
+ * @brief Advertising or scan response payload of up to @p MaxPayloadLen
+ *        bytes.
+ *
+ * GapAdvertisingData is the payload of legacy advertising, limited to
+ * GAP_ADVERTISING_DATA_MAX_PAYLOAD bytes. Larger capacities are meant for
+ * the extended advertising of Bluetooth 5, which chains a payload of up to
+ * 1650 bytes over auxiliary packets; see ExtendedAdvertisingData and
+ * Gap::setAdvertisingSetPayload().
+ */
+template <uint16_t MaxPayloadLen>
+class BasicGapAdvertisingData : public GapAdvertisingDataTypes
+{
+public:
+    /**
+     * Type of the length of the payload.
+     */
+    typedef typename GapAdvertisingDataLength<(MaxPayloadLen > 0xFF)>::type Length_t;
+
+    /**
+     * Maximum length of the payload.
+     */
+    static const uint16_t MAX_PAYLOAD_LEN = MaxPayloadLen;
 
     /**
      * Empty constructor.
      */
-    GapAdvertisingData(void) : _payload(), _payloadLen(0), _appearance(GENERIC_TAG) {
+    BasicGapAdvertisingData(void) : _payload(), _payloadLen(0), _appearance(GENERIC_TAG) {
         /* empty */
     }
 
@@ -280,7 +270,7 @@ public:
      */
     ble_error_t addAppearance(Appearance appearance = GENERIC_TAG) {
         _appearance = appearance;
-        return addData(GapAdvertisingData::APPEARANCE, (uint8_t *)&appearance, 2);
+        return addData(APPEARANCE, (uint8_t *)&appearance, 2);
     }
 
     /**
@@ -298,7 +288,7 @@ public:
      *         advertising buffer to overflow, else BLE_ERROR_NONE.
      */
     ble_error_t addFlags(uint8_t flags = LE_GENERAL_DISCOVERABLE) {
-        return addData(GapAdvertisingData::FLAGS, &flags, 1);
+        return addData(FLAGS, &flags, 1);
     }
 
     /**
@@ -309,17 +299,44 @@ public:
      */
     ble_error_t addTxPower(int8_t txPower) {
         /* To Do: Basic error checking to make sure txPower is in range. */
-        return addData(GapAdvertisingData::TX_POWER_LEVEL, (uint8_t *)&txPower, 1);
+        return addData(TX_POWER_LEVEL, (uint8_t *)&txPower, 1);
     }
 
     /**
      * Clears the payload and resets the payload length counter.
      */
     void        clear(void) {
-        memset(&_payload, 0, GAP_ADVERTISING_DATA_MAX_PAYLOAD);
+        memset(&_payload, 0, MaxPayloadLen);
         _payloadLen = 0;
     }
 
+    /**
+     * Replace the payload with @p len bytes of already encoded AD structures,
+     * for instance a payload built at compile time with BLE_AD_FIELD().
+     *
+     * @param[in] payload  Pointer to the encoded payload.
+     * @param[in] len      Length of the encoded payload.
+     *
+     * @return BLE_ERROR_BUFFER_OVERFLOW if the payload does not fit, else
+     *         BLE_ERROR_NONE.
+     */
+    ble_error_t setPayload(const uint8_t *payload, Length_t len) {
+        if (len > MaxPayloadLen) {
+            return BLE_ERROR_BUFFER_OVERFLOW;
+        }
+
+        clear();
+        memcpy(_payload, payload, len);
+        _payloadLen = len;
+
+        const uint8_t *field = findField(APPEARANCE);
+        if ((field != NULL) && (field[0] >= 3) && ((field - _payload) + 3 < _payloadLen)) {
+            _appearance = field[2] | (field[3] << 8);
+        }
+
+        return BLE_ERROR_NONE;
+    }
+
     /**
      * Access the current payload.
      *
@@ -332,9 +349,9 @@ public:
     /**
      * Get the current payload length.
      *
-     * @return The current payload length (0..31 bytes).
+     * @return The current payload length (0..MaxPayloadLen bytes).
      */
-    uint8_t     getPayloadLen(void) const {
+    Length_t    getPayloadLen(void) const {
         return _payloadLen;
     }
 
@@ -347,6 +364,30 @@ public:
         return (uint16_t)_appearance;
     }
 
+    /**
+     * Compare the AD structures of two payloads.
+     *
+     * @param[in] other
+     *              The payload to compare to.
+     *
+     * @return true if both payloads hold the same bytes.
+     */
+    bool operator== (const BasicGapAdvertisingData &other) const {
+        return (_payloadLen == other._payloadLen) && (memcmp(_payload, other._payload, _payloadLen) == 0);
+    }
+
+    /**
+     * Compare the AD structures of two payloads.
+     *
+     * @param[in] other
+     *              The payload to compare to.
+     *
+     * @return true if the payloads differ.
+     */
+    bool operator!= (const BasicGapAdvertisingData &other) const {
+        return !(*this == other);
+    }
+
     /**
      * Search advertisement data for a specific field.
      *
@@ -357,7 +398,20 @@ public:
      *         Where the first element is the length of the field.
      */
     const uint8_t* findField(DataType_t type) const {
-        return findField(type);
+        /* Scan through advertisement data */
+        for (unsigned idx = 0; (idx + 1) < _payloadLen; ) {
+            uint8_t fieldType = _payload[idx + 1];
+
+            if (fieldType == type) {
+                return &_payload[idx];
+            }
+
+            /* Advance to next field */
+            idx += _payload[idx] + 1;
+        }
+
+        /* Field not found */
+        return NULL;
     }
 
 private:
@@ -378,8 +432,8 @@ private:
      */
     ble_error_t appendField(DataType advDataType, const uint8_t *payload, uint8_t len)
     {
-        /* Make sure we don't exceed the 31 byte payload limit */
-        if (_payloadLen + len + 2 > GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+        /* Make sure we don't exceed the payload limit, nor the limit of the length byte */
+        if ((_payloadLen + len + 2 > MaxPayloadLen) || (len > 0xFE)) {
             return BLE_ERROR_BUFFER_OVERFLOW;
         }
 
@@ -408,20 +462,7 @@ private:
      *         otherwise. Where the first element is the length of the field.
      */
     uint8_t* findField(DataType_t type) {
-        /* Scan through advertisement data */
-        for (uint8_t idx = 0; idx < _payloadLen; ) {
-            uint8_t fieldType = _payload[idx + 1];
-
-            if (fieldType == type) {
-                return &_payload[idx];
-            }
-
-            /* Advance to next field */
-            idx += _payload[idx] + 1;
-        }
-
-        /* Field not found */
-        return NULL;
+        return const_cast<uint8_t *>(static_cast<const BasicGapAdvertisingData *>(this)->findField(type));
     }
 
     /**
@@ -462,7 +503,7 @@ private:
             case COMPLETE_LIST_128BIT_SERVICE_IDS:
             case LIST_128BIT_SOLICITATION_IDS: {
                 /* Check if data fits */
-                if ((_payloadLen + len) <= GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+                if (((_payloadLen + len) <= MaxPayloadLen) && ((field[0] + len) <= 0xFF)) {
                     /*
                      * Make room for new field by moving the remainder of the
                      * advertisement payload "to the right" starting after the
@@ -530,8 +571,9 @@ private:
 
             result = BLE_ERROR_NONE;
         } else {
-            /* Check if data fits */
-            if ((_payloadLen - dataLength + len) <= GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+            /* Check if data fits, and the limit of the length byte, before
+             * the old field is removed */
+            if (((_payloadLen - dataLength + len) <= MaxPayloadLen) && (len <= 0xFE)) {
 
                 /* Remove old field */
                 while ((field + dataLength + 2) < &_payload[_payloadLen]) {
@@ -553,15 +595,158 @@ private:
     /**
      * The advertising data buffer
      */
-    uint8_t  _payload[GAP_ADVERTISING_DATA_MAX_PAYLOAD];
+    uint8_t  _payload[MaxPayloadLen];
     /**
      * The length of the data added to the advertising buffer.
      */
-    uint8_t  _payloadLen;
+    Length_t _payloadLen;
     /**
      * Appearance value.
      */
     uint16_t _appearance;
 };
 
+template <uint16_t MaxPayloadLen>
+const uint16_t BasicGapAdvertisingData<MaxPayloadLen>::MAX_PAYLOAD_LEN;
+
+/**
+ * @brief This class provides several helper functions to generate properly
+ *        formatted GAP Advertising and Scan Response data payloads.
+ *
+ * @note See Bluetooth Specification 4.0 (Vol. 3), Part C, Sections 11 and 18
+ *       for further information on Advertising and Scan Response data.
+ *
+ * @par Advertising and Scan Response Payloads
+ *      Advertising data and Scan Response data are organized around a set of
+ *      data types called 'AD types' in Bluetooth 4.0 (see the Bluetooth Core
+ *      Specification v4.0, Vol. 3, Part C, Sections 11 and 18).
+ *
+ * @par
+ *      Each AD type has its own standardized assigned number, as defined
+ *      by the Bluetooth SIG:
+ *      https://www.bluetooth.org/en-us/specification/assigned-numbers/generic-access-profile.
+ *
+ * @par
+ *      For convenience, all appropriate AD types are encapsulated
+ *      in GapAdvertisingData::DataType.
+ *
+ * @par
+ *      Before the AD Types and their payload (if any) can be inserted into
+ *      the Advertising or Scan Response frames, they need to be formatted as
+ *      follows:
+ *
+ * @li @c Record length (1 byte).
+ * @li @c AD Type (1 byte).
+ * @li @c AD payload (optional; only present if record length > 1).
+ *
+ * @par
+ *      This class takes care of properly formatting the payload, performs
+ *      some basic checks on the payload length, and tries to avoid common
+ *      errors like adding an exclusive AD field twice in the Advertising
+ *      or Scan Response payload.
+ *
+ * @par EXAMPLE
+ *
+ * @code
+ *
+ * // ToDo
+ *
+ * @endcode
+ */
+class GapAdvertisingData : public BasicGapAdvertisingData<GAP_ADVERTISING_DATA_MAX_PAYLOAD>
+{
+public:
+    /**
+     * Empty constructor.
+     */
+    GapAdvertisingData(void) : BasicGapAdvertisingData<GAP_ADVERTISING_DATA_MAX_PAYLOAD>() {
+        /* empty */
+    }
+};
+
+/**
+ * Capacity of ExtendedAdvertisingData, in bytes. The default is the largest
+ * payload of an extended advertising set.
+ */
+#ifndef BLE_GAP_EXTENDED_ADVERTISING_DATA_MAX_PAYLOAD
+#define BLE_GAP_EXTENDED_ADVERTISING_DATA_MAX_PAYLOAD (1650)
+#endif
+
+/**
+ * Payload of an extended advertising set.
+ */
+typedef BasicGapAdvertisingData<BLE_GAP_EXTENDED_ADVERTISING_DATA_MAX_PAYLOAD> ExtendedAdvertisingData;
+
+/* Only the true specialization is complete; used to reject oversized payloads at compile time. */
+template <bool> struct GapAdvertisingPayloadFits;
+template <> struct GapAdvertisingPayloadFits<true> { };
+
+/**
+ * @name Compile time advertising payloads
+ *
+ * These macros expand to the bytes of AD structures, so that a fixed
+ * payload can be written as a constant array placed in flash and set with
+ * Gap::setAdvertisingPayload() without being encoded at runtime:
+ *
+ * @code
+ * BLE_ADVERTISING_PAYLOAD(beaconPayload,
+ *     BLE_AD_FLAGS(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE),
+ *     BLE_AD_FIELD(GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS, BLE_AD_UINT16(0x180F), BLE_AD_UINT16(0x180A)),
+ *     BLE_AD_FIELD(GapAdvertisingData::COMPLETE_LOCAL_NAME, 'm', 'b', 'e', 'd'),
+ *     BLE_AD_FIELD(GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA, BLE_AD_UINT16(0x0059), 0x01, 0x02)
+ * );
+ *
+ * ble.gap().setAdvertisingPayload(beaconPayload);
+ * @endcode
+ *
+ * BLE_ADVERTISING_PAYLOAD() fails to compile if the payload is longer than
+ * GAP_ADVERTISING_DATA_MAX_PAYLOAD.
+ *
+ * @{
+ */
+
+/**
+ * Expand to the two bytes of a 16-bit value, least significant first, as
+ * used for 16-bit UUIDs, company identifiers and appearances.
+ */
+#define BLE_AD_UINT16(value) (uint8_t)((value) & 0xFF), (uint8_t)(((value) >> 8) & 0xFF)
+
+/**
+ * Expand to the 1 to 29 bytes of the value of an AD structure, preceded by
+ * its length and its type @p type.
+ */
+#define BLE_AD_FIELD(type, ...) (uint8_t)(1 + BLE_AD_COUNT_BYTES(__VA_ARGS__)), (uint8_t)(type), __VA_ARGS__
+
+/**
+ * Expand to the FLAGS AD structure.
+ */
+#define BLE_AD_FLAGS(flags) BLE_AD_FIELD(GapAdvertisingData::FLAGS, (uint8_t)(flags))
+
+/**
+ * Expand to the TX_POWER_LEVEL AD structure.
+ */
+#define BLE_AD_TX_POWER(power) BLE_AD_FIELD(GapAdvertisingData::TX_POWER_LEVEL, (uint8_t)(power))
+
+/**
+ * Expand to the APPEARANCE AD structure.
+ */
+#define BLE_AD_APPEARANCE(appearance) BLE_AD_FIELD(GapAdvertisingData::APPEARANCE, BLE_AD_UINT16(appearance))
+
+/**
+ * Define the constant array @p name holding the AD structures passed as the
+ * remaining arguments, and check at compile time that they fit in a legacy
+ * advertising payload.
+ */
+#define BLE_ADVERTISING_PAYLOAD(name, ...)                                                                      \
+    static const uint8_t name[] = { __VA_ARGS__ };                                                              \
+    enum { name##_fits = sizeof(GapAdvertisingPayloadFits<(sizeof(name) <= GAP_ADVERTISING_DATA_MAX_PAYLOAD)>) }
+
+/** @} */
+
+/* Count the bytes of the value of an AD structure, up to 29. */
+#define BLE_AD_COUNT_BYTES(...) BLE_AD_COUNT_BYTES_N(__VA_ARGS__,                                          \
+    29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define BLE_AD_COUNT_BYTES_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18,  \
+                             _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, N, ...) N
+
 #endif /* ifndef __GAP_ADVERTISING_DATA_H__ */
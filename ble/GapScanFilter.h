@@ -0,0 +1,496 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GAP_SCAN_FILTER_H__
+#define __GAP_SCAN_FILTER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "blecommon.h"
+#include "BLEProtocol.h"
+#include "UUID.h"
+#include "GapAdvertisingData.h"
+#include "GapAdvertisingParams.h"
+#include "AdvertisingDataParser.h"
+
+class PrivateAddressResolver;
+
+/**
+ * Maximum number of service UUIDs of a GapScanFilter.
+ */
+#ifndef BLE_GAP_SCAN_FILTER_MAX_SERVICE_UUIDS
+#define BLE_GAP_SCAN_FILTER_MAX_SERVICE_UUIDS 4
+#endif
+
+/**
+ * Maximum number of company identifiers of a GapScanFilter.
+ */
+#ifndef BLE_GAP_SCAN_FILTER_MAX_COMPANY_IDS
+#define BLE_GAP_SCAN_FILTER_MAX_COMPANY_IDS 4
+#endif
+
+/**
+ * Maximum number of addresses and address prefixes of a GapScanFilter.
+ */
+#ifndef BLE_GAP_SCAN_FILTER_MAX_ADDRESSES
+#define BLE_GAP_SCAN_FILTER_MAX_ADDRESSES 8
+#endif
+
+/**
+ * @brief Rules selecting the advertisement reports passed to the application.
+ *
+ * A filter is made of criteria; a report passes the filter if it meets every
+ * criterion set. A criterion listing several values (service UUIDs, company
+ * identifiers, addresses or advertising types) is met if any of them
+ * matches. A filter without criteria passes every report.
+ *
+ * The criteria on the report itself (RSSI, advertising type and address) are
+ * checked first; the AD structures are then walked once, and the walk stops
+ * as soon as the remaining criteria are met.
+ *
+ * @code
+ * GapScanFilter filter;
+ * filter.setMinRssi(-70);
+ * filter.addServiceUUID(GattService::UUID_HEART_RATE_SERVICE);
+ * filter.addCompanyID(0x004C);
+ * ble.gap().setScanFilter(&filter);
+ * @endcode
+ *
+ * With a PrivateAddressResolver set, the identity addresses of bonded peers
+ * can be listed instead of the private addresses they advertise with.
+ *
+ * @note Each report is evaluated on its own: the AD structures of a scan
+ *       response are not combined with those of the advertising packet it
+ *       answers.
+ */
+class GapScanFilter {
+public:
+    /**
+     * Construct a filter without criteria.
+     */
+    GapScanFilter(void) {
+        clear();
+    }
+
+    /**
+     * Remove all the criteria.
+     */
+    void clear(void) {
+        criteria         = 0;
+        minRssi          = -128;
+        advertisingTypes = 0;
+        serviceUUIDCount = 0;
+        companyIDCount   = 0;
+        addressCount     = 0;
+        resolver         = NULL;
+    }
+
+    /**
+     * Only pass reports received with an RSSI of at least @p rssi dBm.
+     */
+    void setMinRssi(int8_t rssi) {
+        minRssi   = rssi;
+        criteria |= CRITERION_RSSI;
+    }
+
+    /**
+     * Pass reports of the advertising type @p type.
+     */
+    void addAdvertisingType(GapAdvertisingParams::AdvertisingType_t type) {
+        advertisingTypes |= (1 << type);
+        criteria         |= CRITERION_ADVERTISING_TYPE;
+    }
+
+    /**
+     * Pass reports listing the service @p uuid, in any list of 16-bit,
+     * 32-bit or 128-bit service UUIDs.
+     *
+     * @return BLE_ERROR_NONE if the UUID was added, or BLE_ERROR_NO_MEM if
+     *         BLE_GAP_SCAN_FILTER_MAX_SERVICE_UUIDS UUIDs were already
+     *         added.
+     */
+    ble_error_t addServiceUUID(const UUID &uuid) {
+        if (serviceUUIDCount == BLE_GAP_SCAN_FILTER_MAX_SERVICE_UUIDS) {
+            return BLE_ERROR_NO_MEM;
+        }
+
+        serviceUUIDs[serviceUUIDCount++] = uuid;
+        criteria |= CRITERION_SERVICE_UUID;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Pass reports carrying manufacturer specific data of the company
+     * @p companyID.
+     *
+     * @return BLE_ERROR_NONE if the company identifier was added, or
+     *         BLE_ERROR_NO_MEM if BLE_GAP_SCAN_FILTER_MAX_COMPANY_IDS
+     *         identifiers were already added.
+     */
+    ble_error_t addCompanyID(uint16_t companyID) {
+        if (companyIDCount == BLE_GAP_SCAN_FILTER_MAX_COMPANY_IDS) {
+            return BLE_ERROR_NO_MEM;
+        }
+
+        companyIDs[companyIDCount++] = companyID;
+        criteria |= CRITERION_COMPANY_ID;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Pass reports from the peer @p address, or from the peers whose address
+     * starts with the @p prefixLen most significant bytes of @p address.
+     *
+     * @param[in] address
+     *              The address, in LSB format.
+     * @param[in] prefixLen
+     *              Number of most significant bytes to compare, from 1 to
+     *              BLEProtocol::ADDR_LEN.
+     *
+     * @return BLE_ERROR_NONE if the address was added;
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p prefixLen is invalid;
+     *         BLE_ERROR_NO_MEM if BLE_GAP_SCAN_FILTER_MAX_ADDRESSES addresses
+     *         were already added.
+     */
+    ble_error_t addAddress(const BLEProtocol::AddressBytes_t address, uint8_t prefixLen = BLEProtocol::ADDR_LEN) {
+        if ((prefixLen == 0) || (prefixLen > BLEProtocol::ADDR_LEN)) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+        if (addressCount == BLE_GAP_SCAN_FILTER_MAX_ADDRESSES) {
+            return BLE_ERROR_NO_MEM;
+        }
+
+        memcpy(addresses[addressCount].address, address, BLEProtocol::ADDR_LEN);
+        addresses[addressCount].prefixLen = prefixLen;
+        ++addressCount;
+        criteria |= CRITERION_ADDRESS;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Resolve the addresses of the reports to the identities of bonded
+     * peers: an address passes the address criterion if the identity
+     * address of the peer does.
+     *
+     * @param[in] resolverIn
+     *              The resolver, or NULL to compare the addresses as
+     *              reported. It is not copied and must outlive its use by
+     *              the filter.
+     * @param[in] bondedOnly
+     *              If true, only pass reports of peers which identity is
+     *              known to @p resolverIn.
+     *
+     * @note Gap evaluates the criteria which need the resolver where it
+     *       dispatches the reports: in the context of
+     *       BLE::dispatchDeferredEvents() if deferred event dispatch is
+     *       enabled, from which the resolver can be updated safely.
+     */
+    void setResolver(PrivateAddressResolver *resolverIn, bool bondedOnly = false) {
+        resolver = resolverIn;
+        if (resolver && bondedOnly) {
+            criteria |= CRITERION_BONDED;
+        } else {
+            criteria &= ~CRITERION_BONDED;
+        }
+    }
+
+    /**
+     * Evaluate the filter on an advertisement report.
+     *
+     * @param[in] resolveIdentity
+     *              If false, the criteria which need the resolver are left
+     *              out, to be evaluated later with matchesIdentity().
+     *
+     * @return true if the report passes the filter.
+     */
+    bool matches(const BLEProtocol::AddressBytes_t        peerAddr,
+                 int8_t                                   rssi,
+                 GapAdvertisingParams::AdvertisingType_t  type,
+                 uint8_t                                  advertisingDataLen,
+                 const uint8_t                           *advertisingData,
+                 bool                                     resolveIdentity = true) const {
+        if ((criteria & CRITERION_RSSI) && (rssi < minRssi)) {
+            return false;
+        }
+        if ((criteria & CRITERION_ADVERTISING_TYPE) && !(advertisingTypes & (1 << type))) {
+            return false;
+        }
+        if (resolver) {
+            if (resolveIdentity && !matchesIdentity(peerAddr)) {
+                return false;
+            }
+        } else if ((criteria & CRITERION_ADDRESS) && !matchAddress(peerAddr)) {
+            return false;
+        }
+
+        uint8_t pending = criteria & (CRITERION_SERVICE_UUID | CRITERION_COMPANY_ID);
+
+        AdvertisingDataParser           parser(advertisingData, advertisingDataLen);
+        AdvertisingDataParser::Field_t  field;
+        while (pending && parser.getNextField(field)) {
+            switch (field.type) {
+                case GapAdvertisingData::INCOMPLETE_LIST_16BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS:
+                case GapAdvertisingData::INCOMPLETE_LIST_32BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_32BIT_SERVICE_IDS:
+                case GapAdvertisingData::INCOMPLETE_LIST_128BIT_SERVICE_IDS:
+                case GapAdvertisingData::COMPLETE_LIST_128BIT_SERVICE_IDS:
+                    if ((pending & CRITERION_SERVICE_UUID) && matchServiceUUIDs(field)) {
+                        pending &= ~CRITERION_SERVICE_UUID;
+                    }
+                    break;
+                case GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA:
+                    if ((pending & CRITERION_COMPANY_ID) && matchCompanyID(field)) {
+                        pending &= ~CRITERION_COMPANY_ID;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return pending == 0;
+    }
+
+    /**
+     * Evaluate the criteria which need the resolver, the address and bonded
+     * criteria while a resolver is set, on the address of a report. This
+     * updates the cache of the resolver, and costs an AES-128 evaluation
+     * per identity if the address is not in the cache.
+     *
+     * @return true if the address passes these criteria, or if there are
+     *         none.
+     */
+    bool matchesIdentity(const BLEProtocol::AddressBytes_t peerAddr) const {
+        if (!resolver || !(criteria & (CRITERION_ADDRESS | CRITERION_BONDED))) {
+            return true;
+        }
+
+        return matchIdentity(peerAddr);
+    }
+
+    /* Accessors, meant for ports which push the filter down to the controller. */
+
+    /**
+     * Get the minimum RSSI.
+     *
+     * @return true if a minimum RSSI is set.
+     */
+    bool getMinRssi(int8_t &rssi) const {
+        rssi = minRssi;
+        return (criteria & CRITERION_RSSI) != 0;
+    }
+
+    /**
+     * Get the accepted advertising types, as a bit mask indexed by
+     * GapAdvertisingParams::AdvertisingType_t; 0 if every type is accepted.
+     */
+    uint8_t getAdvertisingTypeMask(void) const {
+        return advertisingTypes;
+    }
+
+    /**
+     * Get the number of service UUIDs.
+     */
+    unsigned getServiceUUIDCount(void) const {
+        return serviceUUIDCount;
+    }
+
+    /**
+     * Get the service UUID @p index.
+     */
+    const UUID &getServiceUUID(unsigned index) const {
+        return serviceUUIDs[index];
+    }
+
+    /**
+     * Get the number of company identifiers.
+     */
+    unsigned getCompanyIDCount(void) const {
+        return companyIDCount;
+    }
+
+    /**
+     * Get the company identifier @p index.
+     */
+    uint16_t getCompanyID(unsigned index) const {
+        return companyIDs[index];
+    }
+
+    /**
+     * Get the number of addresses and address prefixes.
+     */
+    unsigned getAddressCount(void) const {
+        return addressCount;
+    }
+
+    /**
+     * Get the address @p index.
+     *
+     * @param[in]  index
+     *              Index of the address.
+     * @param[out] prefixLen
+     *              Set to the number of most significant bytes compared;
+     *              BLEProtocol::ADDR_LEN for a full address.
+     */
+    const uint8_t *getAddress(unsigned index, uint8_t &prefixLen) const {
+        prefixLen = addresses[index].prefixLen;
+        return addresses[index].address;
+    }
+
+    /**
+     * Get the resolver, NULL if none. The address criterion cannot be
+     * applied by the controller while a resolver is set.
+     */
+    PrivateAddressResolver *getResolver(void) const {
+        return resolver;
+    }
+
+private:
+    /**
+     * The criteria which can be set on a filter.
+     */
+    enum Criterion_t {
+        CRITERION_RSSI             = 0x01,
+        CRITERION_ADVERTISING_TYPE = 0x02,
+        CRITERION_ADDRESS          = 0x04,
+        CRITERION_SERVICE_UUID     = 0x08,
+        CRITERION_COMPANY_ID       = 0x10,
+        CRITERION_BONDED           = 0x20
+    };
+
+    /**
+     * An address or an address prefix.
+     */
+    struct AddressPrefix_t {
+        BLEProtocol::AddressBytes_t address;
+        uint8_t                     prefixLen;
+    };
+
+    bool matchAddress(const BLEProtocol::AddressBytes_t peerAddr) const {
+        for (unsigned i = 0; i < addressCount; ++i) {
+            /* The most significant bytes are last. */
+            unsigned offset = BLEProtocol::ADDR_LEN - addresses[i].prefixLen;
+            if (memcmp(&peerAddr[offset], &addresses[i].address[offset], addresses[i].prefixLen) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Resolve the identity of the peer, and apply the address and bonded
+     * criteria to it.
+     */
+    bool matchIdentity(const BLEProtocol::AddressBytes_t peerAddr) const;
+
+    bool matchCompanyID(const AdvertisingDataParser::Field_t &field) const {
+        if (field.length < sizeof(uint16_t)) {
+            return false;
+        }
+
+        uint16_t companyID = field.value[0] | (field.value[1] << 8);
+        for (unsigned i = 0; i < companyIDCount; ++i) {
+            if (companyIDs[i] == companyID) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool matchServiceUUIDs(const AdvertisingDataParser::Field_t &field) const {
+        unsigned uuidSize;
+        switch (field.type) {
+            case GapAdvertisingData::INCOMPLETE_LIST_16BIT_SERVICE_IDS:
+            case GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS:
+                uuidSize = sizeof(UUID::ShortUUIDBytes_t);
+                break;
+            case GapAdvertisingData::INCOMPLETE_LIST_32BIT_SERVICE_IDS:
+            case GapAdvertisingData::COMPLETE_LIST_32BIT_SERVICE_IDS:
+                uuidSize = sizeof(uint32_t);
+                break;
+            default:
+                uuidSize = UUID::LENGTH_OF_LONG_UUID;
+                break;
+        }
+
+        for (unsigned offset = 0; (offset + uuidSize) <= field.length; offset += uuidSize) {
+            for (unsigned i = 0; i < serviceUUIDCount; ++i) {
+                if (matchServiceUUID(serviceUUIDs[i], &field.value[offset], uuidSize)) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Compare a UUID to an advertised UUID of @p size bytes, in little
+     * endian. 16-bit and 32-bit UUIDs stand for 128-bit UUIDs built on the
+     * Bluetooth base UUID.
+     */
+    static bool matchServiceUUID(const UUID &uuid, const uint8_t *value, unsigned size) {
+        /* Bluetooth base UUID, least significant byte first. */
+        static const uint8_t baseUUID[12] = {
+            0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00
+        };
+
+        if (uuid.shortOrLong() == UUID::UUID_TYPE_SHORT) {
+            if (size == UUID::LENGTH_OF_LONG_UUID) {
+                if (memcmp(value, baseUUID, sizeof(baseUUID)) != 0) {
+                    return false;
+                }
+                value += sizeof(baseUUID);
+                size   = sizeof(uint32_t);
+            }
+            if ((size == sizeof(uint32_t)) && ((value[2] != 0) || (value[3] != 0))) {
+                return false;
+            }
+            return (value[0] | (value[1] << 8)) == uuid.getShortUUID();
+        }
+
+        const uint8_t *longUUID = uuid.getBaseUUID();
+        if (size == UUID::LENGTH_OF_LONG_UUID) {
+            return memcmp(longUUID, value, UUID::LENGTH_OF_LONG_UUID) == 0;
+        }
+        if ((memcmp(longUUID, baseUUID, sizeof(baseUUID)) != 0) || (memcmp(&longUUID[sizeof(baseUUID)], value, size) != 0)) {
+            return false;
+        }
+        return (size == sizeof(uint32_t)) || ((longUUID[14] == 0) && (longUUID[15] == 0));
+    }
+
+private:
+    uint8_t         criteria;
+    int8_t          minRssi;
+    uint8_t         advertisingTypes;
+
+    UUID            serviceUUIDs[BLE_GAP_SCAN_FILTER_MAX_SERVICE_UUIDS];
+    uint8_t         serviceUUIDCount;
+
+    uint16_t        companyIDs[BLE_GAP_SCAN_FILTER_MAX_COMPANY_IDS];
+    uint8_t         companyIDCount;
+
+    AddressPrefix_t addresses[BLE_GAP_SCAN_FILTER_MAX_ADDRESSES];
+    uint8_t         addressCount;
+
+    PrivateAddressResolver *resolver;
+};
+
+#endif /* ifndef __GAP_SCAN_FILTER_H__ */
@@ -112,4 +112,13 @@ struct GattHVXCallbackParams {
   const uint8_t           *data;       /**< Attribute data, variable length. */
 };
 
+/**
+ * For encapsulating the ATT_MTU of a connection, reported once the MTU
+ * exchange procedure completes.
+ */
+struct GattAttMtuChangeCallbackParams {
+  Gap::Handle_t            connHandle; /**< The handle of the connection that triggered the event */
+  uint16_t                 attMtu;     /**< The ATT_MTU in use on the connection, in bytes. */
+};
+
 #endif /*__GATT_CALLBACK_PARAM_TYPES_H__*/
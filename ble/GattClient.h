@@ -26,6 +26,14 @@
 
 #include "CallChainOfFunctionPointersWithContext.h"
 
+/**
+ * Capacity of the node pools backing the callchains of GattClient when
+ * BLE_CALLCHAIN_USE_NODE_POOL is defined.
+ */
+#ifndef BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY
+#define BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY
+#endif
+
 class GattClient {
 public:
     /**
@@ -36,7 +44,7 @@ public:
     /**
      * Type for the data read event callchain. Refer to GattClient::onDataRead().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattReadCallbackParams*> ReadCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattReadCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY, GattClient)> ReadCallbackChain_t;
 
     /**
      * Enumerator for write operations.
@@ -54,7 +62,7 @@ public:
     /**
      * Type for the data write event callchain. Refer to GattClient::onDataWrite().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattWriteCallbackParams*> WriteCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattWriteCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY, GattClient)> WriteCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the update event callchain.
@@ -64,7 +72,17 @@ public:
     /**
      * Type for the update event callchain. Refer to GattClient::onHVX().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattHVXCallbackParams*> HVXCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattHVXCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY, GattClient)> HVXCallbackChain_t;
+
+    /**
+     * Type for the registered callbacks added to the ATT_MTU change callchain.
+     * Refer to GattClient::onAttMtuChange().
+     */
+    typedef FunctionPointerWithContext<const GattAttMtuChangeCallbackParams*> AttMtuChangeCallback_t;
+    /**
+     * Type for the ATT_MTU change event callchain. Refer to GattClient::onAttMtuChange().
+     */
+    typedef CallChainOfFunctionPointersWithContext<const GattAttMtuChangeCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY, GattClient)> AttMtuChangeCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the shutdown callchain.
@@ -74,7 +92,7 @@ public:
     /**
      * Type for the shutdown event callchain. Refer to GattClient::onShutown().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattClient *> GattClientShutdownCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattClient *, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_CLIENT_CALLCHAIN_POOL_CAPACITY, GattClient)> GattClientShutdownCallbackChain_t;
 
     /*
      * The following functions are meant to be overridden in the platform-specific sub-class.
@@ -297,6 +315,49 @@ public:
         return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porters: override this API if this capability is supported. */
     }
 
+    /**
+     * Initiate the ATT MTU exchange procedure, proposing the largest ATT_MTU
+     * supported by the stack to the peer. Once the procedure completes, the
+     * ATT_MTU in use on the connection is reported to the onAttMtuChange()
+     * callbacks of both the GattClient and the GattServer.
+     *
+     * @param[in] connHandle
+     *              Handle for the connection with the peer.
+     *
+     * @return
+     *          BLE_ERROR_NONE if the procedure was successfully started.
+     *
+     * @note The procedure can only be run once per connection, by the client.
+     * @note With deferred event dispatch (see
+     *       BLE::enableDeferredEventDispatch()), writes and notifications
+     *       longer than BLE_DEFERRED_EVENT_MAX_DATA_LEN bytes are dropped; an
+     *       ATT_MTU above BLE_DEFERRED_EVENT_MAX_DATA_LEN + 3 should not be
+     *       used then.
+     */
+    virtual ble_error_t negotiateAttMtu(Gap::Handle_t connHandle) {
+        /* Avoid compiler warnings about unused variables. */
+        (void)connHandle;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porters: override this API if this capability is supported. */
+    }
+
+    /**
+     * Get the ATT_MTU in use on a connection.
+     *
+     * @param[in] connHandle
+     *              Handle for the connection with the peer.
+     *
+     * @return The ATT_MTU in bytes; BLE_GATT_MTU_SIZE_DEFAULT until an MTU
+     *         exchange completes on the connection. The largest attribute
+     *         value which fits in a single write or notification is
+     *         3 bytes shorter.
+     */
+    virtual uint16_t getEffectiveMtu(Gap::Handle_t connHandle) const {
+        (void)connHandle; /* Avoid compiler warnings about unused variables. */
+
+        return BLE_GATT_MTU_SIZE_DEFAULT; /* Requesting action from porters: override this API if this capability is supported. */
+    }
+
     /* Event callback handlers. */
 public:
     /**
@@ -310,9 +371,12 @@ public:
      *
      * @note It is possible to unregister a callback using
      * onDataRead().detach(callbackToRemove).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onDataRead(ReadCallback_t callback) {
-        onDataReadCallbackChain.add(callback);
+    ble_error_t onDataRead(ReadCallback_t callback) {
+        return onDataReadCallbackChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -338,9 +402,12 @@ public:
      * onDataWritten().detach(callbackToRemove).
      *
      * @note  Write commands (issued using writeWoResponse) don't generate a response.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onDataWritten(WriteCallback_t callback) {
-        onDataWriteCallbackChain.add(callback);
+    ble_error_t onDataWritten(WriteCallback_t callback) {
+        return onDataWriteCallbackChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -452,9 +519,62 @@ public:
      *
      * @note It is possible to unregister callbacks using
      *       onHVX().detach(callbackToRemove).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    ble_error_t onHVX(HVXCallback_t callback) {
+        return onHVXCallbackChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Set up a callback for when the ATT_MTU of a connection changes as the
+     * result of an MTU exchange.
+     *
+     * @param[in] callback
+     *              Event handler being registered.
+     *
+     * @note It is possible to unregister callbacks using
+     *       onAttMtuChange().detach(callbackToRemove).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    ble_error_t onAttMtuChange(const AttMtuChangeCallback_t& callback) {
+        return attMtuChangeCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Same as GattClient::onAttMtuChange(), but allows the possibility to add
+     * an object reference and member function as handler for ATT_MTU change
+     * event callbacks.
+     *
+     * @param[in] objPtr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p memberPtr).
+     * @param[in] memberPtr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    template <typename T>
+    ble_error_t onAttMtuChange(T *objPtr, void (T::*memberPtr)(const GattAttMtuChangeCallbackParams *)) {
+        return attMtuChangeCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * @brief Provide access to the callchain of ATT_MTU change event callbacks.
+     *
+     * @return A reference to the ATT_MTU change event callbacks chain.
+     *
+     * @note It is possible to register callbacks using onAttMtuChange().add(callback).
+     *
+     * @note It is possible to unregister callbacks using onAttMtuChange().detach(callback).
      */
-    void onHVX(HVXCallback_t callback) {
-        onHVXCallbackChain.add(callback);
+    AttMtuChangeCallbackChain_t& onAttMtuChange() {
+        return attMtuChangeCallChain;
     }
 
     /**
@@ -473,9 +593,12 @@ public:
      *        some object.
      *
      * @note It is possible to unregister a callback using onShutdown().detach(callback).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onShutdown(const GattClientShutdownCallback_t& callback) {
-        shutdownCallChain.add(callback);
+    ble_error_t onShutdown(const GattClientShutdownCallback_t& callback) {
+        return shutdownCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -489,10 +612,13 @@ public:
      * @param[in] memberPtr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template <typename T>
-    void onShutdown(T *objPtr, void (T::*memberPtr)(const GattClient *)) {
-        shutdownCallChain.add(objPtr, memberPtr);
+    ble_error_t onShutdown(T *objPtr, void (T::*memberPtr)(const GattClient *)) {
+        return shutdownCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -543,12 +669,13 @@ public:
         onDataReadCallbackChain.clear();
         onDataWriteCallbackChain.clear();
         onHVXCallbackChain.clear();
+        attMtuChangeCallChain.clear();
 
         return BLE_ERROR_NONE;
     }
 
 protected:
-    GattClient() {
+    GattClient() : deferredEventQueue(NULL) {
         /* Empty */
     }
 
@@ -564,6 +691,20 @@ public:
      *              handlers.
      */
     void processReadResponse(const GattReadCallbackParams *params) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GATT_CLIENT_READ_RESPONSE;
+            if (!event.setData(params->data, params->len)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            event.attribute.connHandle = params->connHandle;
+            event.attribute.handle     = params->handle;
+            event.attribute.offset     = params->offset;
+            deferredEventQueue->push(event);
+            return;
+        }
+
         onDataReadCallbackChain(params);
     }
 
@@ -577,6 +718,21 @@ public:
      *              handlers.
      */
     void processWriteResponse(const GattWriteCallbackParams *params) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GATT_CLIENT_WRITE_RESPONSE;
+            if (!event.setData(params->data, params->len)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            event.attribute.connHandle = params->connHandle;
+            event.attribute.handle     = params->handle;
+            event.attribute.offset     = params->offset;
+            event.attribute.op         = params->writeOp;
+            deferredEventQueue->push(event);
+            return;
+        }
+
         onDataWriteCallbackChain(params);
     }
 
@@ -590,11 +746,116 @@ public:
      *              handlers.
      */
     void processHVXEvent(const GattHVXCallbackParams *params) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GATT_CLIENT_HVX;
+            if (!event.setData(params->data, params->len)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            event.attribute.connHandle = params->connHandle;
+            event.attribute.handle     = params->handle;
+            event.attribute.op         = params->type;
+            deferredEventQueue->push(event);
+            return;
+        }
+
         if (onHVXCallbackChain) {
             onHVXCallbackChain(params);
         }
     }
 
+    /**
+     * Helper function that notifies all registered handlers of a change of
+     * the ATT_MTU of a connection. This function is meant to be called from
+     * the BLE stack specific implementation when an MTU exchange completes.
+     *
+     * @param[in] params
+     *              The ATT_MTU change parameters passed to the registered
+     *              handlers.
+     */
+    void processAttMtuChangeEvent(const GattAttMtuChangeCallbackParams *params) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                    = DeferredEvent_t::GATT_CLIENT_ATT_MTU_CHANGE;
+            event.attMtuChange.connHandle = params->connHandle;
+            event.attMtuChange.attMtu     = params->attMtu;
+            event.dataLength              = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        attMtuChangeCallChain(params);
+    }
+
+    /**
+     * Set the queue in which the events reported to the process entry points
+     * are copied instead of being dispatched immediately.
+     *
+     * @param[in] queue
+     *              The queue to use, NULL to dispatch events immediately.
+     *
+     * @note This is meant to be called by BLE::enableDeferredEventDispatch().
+     */
+    void setDeferredEventQueue(DeferredEventQueue *queue) {
+        deferredEventQueue = queue;
+    }
+
+    /**
+     * Dispatch an event previously deferred by one of the process entry points.
+     *
+     * @param[in] event
+     *              The event to dispatch.
+     *
+     * @note This is meant to be called by BLE::processEvents().
+     */
+    void dispatchDeferredEvent(const DeferredEvent_t &event) {
+        switch (event.type) {
+            case DeferredEvent_t::GATT_CLIENT_READ_RESPONSE: {
+                GattReadCallbackParams params;
+                params.connHandle = event.attribute.connHandle;
+                params.handle     = event.attribute.handle;
+                params.offset     = event.attribute.offset;
+                params.len        = event.dataLength;
+                params.data       = event.data;
+                onDataReadCallbackChain(&params);
+                break;
+            }
+            case DeferredEvent_t::GATT_CLIENT_WRITE_RESPONSE: {
+                GattWriteCallbackParams params;
+                params.connHandle = event.attribute.connHandle;
+                params.handle     = event.attribute.handle;
+                params.writeOp    = static_cast<GattWriteCallbackParams::WriteOp_t>(event.attribute.op);
+                params.offset     = event.attribute.offset;
+                params.len        = event.dataLength;
+                params.data       = event.data;
+                onDataWriteCallbackChain(&params);
+                break;
+            }
+            case DeferredEvent_t::GATT_CLIENT_HVX: {
+                GattHVXCallbackParams params;
+                params.connHandle = event.attribute.connHandle;
+                params.handle     = event.attribute.handle;
+                params.type       = static_cast<HVXType_t>(event.attribute.op);
+                params.len        = event.dataLength;
+                params.data       = event.data;
+                if (onHVXCallbackChain) {
+                    onHVXCallbackChain(&params);
+                }
+                break;
+            }
+            case DeferredEvent_t::GATT_CLIENT_ATT_MTU_CHANGE: {
+                GattAttMtuChangeCallbackParams params;
+                params.connHandle = event.attMtuChange.connHandle;
+                params.attMtu     = event.attMtuChange.attMtu;
+                attMtuChangeCallChain(&params);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
 protected:
     /**
      * Callchain containing all registered callback handlers for data read
@@ -611,12 +872,24 @@ protected:
      * events.
      */
     HVXCallbackChain_t                onHVXCallbackChain;
+    /**
+     * Callchain containing all registered callback handlers for ATT_MTU
+     * change events.
+     */
+    AttMtuChangeCallbackChain_t       attMtuChangeCallChain;
     /**
      * Callchain containing all registered callback handlers for shutdown
      * events.
      */
     GattClientShutdownCallbackChain_t shutdownCallChain;
 
+private:
+    /**
+     * Queue in which events are deferred, NULL if they are dispatched
+     * immediately.
+     */
+    DeferredEventQueue               *deferredEventQueue;
+
 private:
     /* Disallow copy and assignment. */
     GattClient(const GattClient &);
@@ -24,6 +24,41 @@
 #include "GattCallbackParamTypes.h"
 #include "CallChainOfFunctionPointersWithContext.h"
 
+/**
+ * Capacity of the node pools backing the callchains of GattServer when
+ * BLE_CALLCHAIN_USE_NODE_POOL is defined.
+ */
+#ifndef BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY
+#define BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY
+#endif
+
+/**
+ * Maximum number of dedicated handlers registered at a time for each of the
+ * data written and data read events; see
+ * GattServer::onDataWritten(GattAttribute::Handle_t, const DataWrittenCallback_t&).
+ * Each handler costs a function pointer per event in every GattServer. The
+ * default, 0, disables the dedicated handlers: registering one fails, and
+ * services fall back to the data written and data read callchains. A build
+ * with many services watching their own attributes can set it to, say, 16.
+ */
+#ifndef BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS
+#define BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS 0
+#endif
+
+#if (BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS < 0) || (BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS > 255)
+#error "BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS must be between 0 and 255"
+#endif
+
+/**
+ * Attribute handles below this bound can have a dedicated handler, when
+ * BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS is not 0. 128 handles cover about 15
+ * services of a few characteristics each, on top of the GAP and GATT
+ * services; the table costs one byte per handle and per event.
+ */
+#ifndef BLE_GATT_SERVER_MAX_DISPATCH_HANDLES
+#define BLE_GATT_SERVER_MAX_DISPATCH_HANDLES 128
+#endif
+
 class GattServer {
 public:
     /**
@@ -34,7 +69,7 @@ public:
     /**
      * Type for the data sent event callchain. Refer to GattServer::onDataSent().
      */
-    typedef CallChainOfFunctionPointersWithContext<unsigned> DataSentCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<unsigned, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY, GattServer)> DataSentCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the data written callchain.
@@ -44,7 +79,7 @@ public:
     /**
      * Type for the data written event callchain. Refer to GattServer::onDataWritten().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattWriteCallbackParams*> DataWrittenCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattWriteCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY, GattServer)> DataWrittenCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the data read callchain.
@@ -54,7 +89,7 @@ public:
     /**
      * Type for the data read event callchain. Refer to GattServer::onDataRead().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattReadCallbackParams *> DataReadCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattReadCallbackParams *, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY, GattServer)> DataReadCallbackChain_t;
 
     /**
      * Type for the registered callbacks added to the shutdown callchain.
@@ -64,7 +99,17 @@ public:
     /**
      * Type for the shutdown event callchain. Refer to GattServer::onShutdown().
      */
-    typedef CallChainOfFunctionPointersWithContext<const GattServer *> GattServerShutdownCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const GattServer *, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY, GattServer)> GattServerShutdownCallbackChain_t;
+
+    /**
+     * Type for the registered callbacks added to the ATT_MTU change callchain.
+     * Refer to GattServer::onAttMtuChange().
+     */
+    typedef FunctionPointerWithContext<const GattAttMtuChangeCallbackParams*> AttMtuChangeCallback_t;
+    /**
+     * Type for the ATT_MTU change event callchain. Refer to GattServer::onAttMtuChange().
+     */
+    typedef CallChainOfFunctionPointersWithContext<const GattAttMtuChangeCallbackParams*, BLE_CALLCHAIN_ALLOCATOR(BLE_GATT_SERVER_CALLCHAIN_POOL_CAPACITY, GattServer)> AttMtuChangeCallbackChain_t;
 
     /**
      * Type for the registered callback for various events. Refer to
@@ -83,9 +128,13 @@ protected:
         dataSentCallChain(),
         dataWrittenCallChain(),
         dataReadCallChain(),
+        dataWrittenHandleTable(),
+        dataReadHandleTable(),
+        attMtuChangeCallChain(),
         updatesEnabledCallback(NULL),
         updatesDisabledCallback(NULL),
-        confirmationReceivedCallback(NULL) {
+        confirmationReceivedCallback(NULL),
+        deferredEventQueue(NULL) {
         /* empty */
     }
 
@@ -277,6 +326,23 @@ public:
         return false; /* Requesting action from porters: override this API if this capability is supported. */
     }
 
+    /**
+     * Get the ATT_MTU in use on a connection.
+     *
+     * @param[in] connectionHandle
+     *              Connection handle.
+     *
+     * @return The ATT_MTU in bytes; BLE_GATT_MTU_SIZE_DEFAULT until the
+     *         client runs an MTU exchange on the connection. The largest
+     *         attribute value which fits in a single notification is 3 bytes
+     *         shorter.
+     */
+    virtual uint16_t getEffectiveMtu(Gap::Handle_t connectionHandle) const {
+        (void)connectionHandle; /* Avoid compiler warnings about unused variables. */
+
+        return BLE_GATT_MTU_SIZE_DEFAULT; /* Requesting action from porters: override this API if this capability is supported. */
+    }
+
     /*
      * APIs with non-virtual implementations.
      */
@@ -294,9 +360,12 @@ public:
      *
      * @note It is also possible to set up a callback into a member function of
      *       some object.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onDataSent(const DataSentCallback_t& callback) {
-        dataSentCallChain.add(callback);
+    ble_error_t onDataSent(const DataSentCallback_t& callback) {
+        return dataSentCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -310,10 +379,13 @@ public:
      * @param[in] memberPtr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template <typename T>
-    void onDataSent(T *objPtr, void (T::*memberPtr)(unsigned count)) {
-        dataSentCallChain.add(objPtr, memberPtr);
+    ble_error_t onDataSent(T *objPtr, void (T::*memberPtr)(unsigned count)) {
+        return dataSentCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -344,9 +416,12 @@ public:
      * some object.
      *
      * @note It is possible to unregister a callback using onDataWritten().detach(callback)
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onDataWritten(const DataWrittenCallback_t& callback) {
-        dataWrittenCallChain.add(callback);
+    ble_error_t onDataWritten(const DataWrittenCallback_t& callback) {
+        return dataWrittenCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -360,10 +435,13 @@ public:
      * @param[in] memberPtr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template <typename T>
-    void onDataWritten(T *objPtr, void (T::*memberPtr)(const GattWriteCallbackParams *context)) {
-        dataWrittenCallChain.add(objPtr, memberPtr);
+    ble_error_t onDataWritten(T *objPtr, void (T::*memberPtr)(const GattWriteCallbackParams *context)) {
+        return dataWrittenCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -379,6 +457,51 @@ public:
         return dataWrittenCallChain;
     }
 
+    /**
+     * Set up a dedicated callback for when the value of a given attribute is
+     * updated by the connected peer. Unlike handlers registered in the data
+     * written callchain, this callback is only invoked for writes to
+     * @p attributeHandle, and finding it does not depend on the number of
+     * registered handlers. It is called before the data written callchain.
+     *
+     * @param[in] attributeHandle
+     *              Handle of the attribute to watch.
+     * @param[in] callback
+     *              Event handler being registered. It replaces the handler
+     *              previously registered for @p attributeHandle, if any; an
+     *              empty callback removes it.
+     *
+     * @return BLE_ERROR_NONE on success, BLE_ERROR_NOT_IMPLEMENTED if
+     *         BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS is 0,
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p attributeHandle is not below
+     *         BLE_GATT_SERVER_MAX_DISPATCH_HANDLES or BLE_ERROR_NO_MEM if
+     *         BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS handlers are already
+     *         registered. In these cases,
+     *         onDataWritten(const DataWrittenCallback_t&) can be used instead.
+     */
+    ble_error_t onDataWritten(GattAttribute::Handle_t attributeHandle, const DataWrittenCallback_t& callback) {
+        return dataWrittenHandleTable.set(attributeHandle, callback);
+    }
+
+    /**
+     * Same as GattServer::onDataWritten(GattAttribute::Handle_t, const DataWrittenCallback_t&),
+     * but allows the possibility to add an object reference and member
+     * function as handler.
+     *
+     * @param[in] attributeHandle
+     *              Handle of the attribute to watch.
+     * @param[in] objPtr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p memberPtr).
+     * @param[in] memberPtr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     */
+    template <typename T>
+    ble_error_t onDataWritten(GattAttribute::Handle_t attributeHandle, T *objPtr, void (T::*memberPtr)(const GattWriteCallbackParams *context)) {
+        return dataWrittenHandleTable.set(attributeHandle, DataWrittenCallback_t(objPtr, memberPtr));
+    }
+
     /**
      * Setup a callback to be invoked on the peripheral when an attribute is
      * being read by a remote client.
@@ -387,6 +510,7 @@ public:
      *              Event handler being registered.
      *
      * @return BLE_ERROR_NOT_IMPLEMENTED if this functionality isn't available;
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted;
      *         else BLE_ERROR_NONE.
      *
      * @note  This functionality may not be available on all underlying stacks.
@@ -408,8 +532,7 @@ public:
             return BLE_ERROR_NOT_IMPLEMENTED;
         }
 
-        dataReadCallChain.add(callback);
-        return BLE_ERROR_NONE;
+        return dataReadCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -430,8 +553,7 @@ public:
             return BLE_ERROR_NOT_IMPLEMENTED;
         }
 
-        dataReadCallChain.add(objPtr, memberPtr);
-        return BLE_ERROR_NONE;
+        return dataReadCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -447,6 +569,102 @@ public:
         return dataReadCallChain;
     }
 
+    /**
+     * Set up a dedicated callback to be invoked on the peripheral when a given
+     * attribute is being read by a remote client. It is called before the
+     * data read callchain.
+     *
+     * @param[in] attributeHandle
+     *              Handle of the attribute to watch.
+     * @param[in] callback
+     *              Event handler being registered. It replaces the handler
+     *              previously registered for @p attributeHandle, if any; an
+     *              empty callback removes it.
+     *
+     * @return BLE_ERROR_NOT_IMPLEMENTED if this functionality isn't available
+     *         or BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS is 0,
+     *         BLE_ERROR_PARAM_OUT_OF_RANGE if @p attributeHandle is not below
+     *         BLE_GATT_SERVER_MAX_DISPATCH_HANDLES, BLE_ERROR_NO_MEM if
+     *         BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS handlers are already
+     *         registered; else BLE_ERROR_NONE.
+     */
+    ble_error_t onDataRead(GattAttribute::Handle_t attributeHandle, const DataReadCallback_t& callback) {
+        if (!isOnDataReadAvailable()) {
+            return BLE_ERROR_NOT_IMPLEMENTED;
+        }
+
+        return dataReadHandleTable.set(attributeHandle, callback);
+    }
+
+    /**
+     * Same as GattServer::onDataRead(GattAttribute::Handle_t, const DataReadCallback_t&),
+     * but allows the possibility to add an object reference and member
+     * function as handler.
+     *
+     * @param[in] attributeHandle
+     *              Handle of the attribute to watch.
+     * @param[in] objPtr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p memberPtr).
+     * @param[in] memberPtr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     */
+    template <typename T>
+    ble_error_t onDataRead(GattAttribute::Handle_t attributeHandle, T *objPtr, void (T::*memberPtr)(const GattReadCallbackParams *context)) {
+        return onDataRead(attributeHandle, DataReadCallback_t(objPtr, memberPtr));
+    }
+
+    /**
+     * Set up a callback for when the ATT_MTU of a connection changes as the
+     * result of an MTU exchange run by the client.
+     *
+     * @param[in] callback
+     *              Event handler being registered.
+     *
+     * @note It is possible to unregister callbacks using
+     *       onAttMtuChange().detach(callbackToRemove).
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    ble_error_t onAttMtuChange(const AttMtuChangeCallback_t& callback) {
+        return attMtuChangeCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Same as GattServer::onAttMtuChange(), but allows the possibility to add
+     * an object reference and member function as handler for ATT_MTU change
+     * event callbacks.
+     *
+     * @param[in] objPtr
+     *              Pointer to the object of a class defining the member callback
+     *              function (@p memberPtr).
+     * @param[in] memberPtr
+     *              The member callback (within the context of an object) to be
+     *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
+     */
+    template <typename T>
+    ble_error_t onAttMtuChange(T *objPtr, void (T::*memberPtr)(const GattAttMtuChangeCallbackParams *)) {
+        return attMtuChangeCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * @brief Provide access to the callchain of ATT_MTU change event callbacks.
+     *
+     * @return A reference to the ATT_MTU change event callbacks chain.
+     *
+     * @note It is possible to register callbacks using onAttMtuChange().add(callback).
+     *
+     * @note It is possible to unregister callbacks using onAttMtuChange().detach(callback).
+     */
+    AttMtuChangeCallbackChain_t& onAttMtuChange() {
+        return attMtuChangeCallChain;
+    }
+
     /**
      * Setup a callback to be invoked to notify the user application that the
      * GattServer instance is about to shutdown (possibly as a result of a call
@@ -463,9 +681,12 @@ public:
      * some object.
      *
      * @note It is possible to unregister a callback using onShutdown().detach(callback)
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onShutdown(const GattServerShutdownCallback_t& callback) {
-        shutdownCallChain.add(callback);
+    ble_error_t onShutdown(const GattServerShutdownCallback_t& callback) {
+        return shutdownCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -479,10 +700,13 @@ public:
      * @param[in] memberPtr
      *              The member callback (within the context of an object) to be
      *              invoked.
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
     template <typename T>
-    void onShutdown(T *objPtr, void (T::*memberPtr)(const GattServer *)) {
-        shutdownCallChain.add(objPtr, memberPtr);
+    ble_error_t onShutdown(T *objPtr, void (T::*memberPtr)(const GattServer *)) {
+        return shutdownCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
@@ -543,7 +767,22 @@ protected:
      *              handlers.
      */
     void handleDataWrittenEvent(const GattWriteCallbackParams *params) {
-        dataWrittenCallChain.call(params);
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GATT_SERVER_DATA_WRITTEN;
+            if (!event.setData(params->data, params->len)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            event.attribute.connHandle = params->connHandle;
+            event.attribute.handle     = params->handle;
+            event.attribute.offset     = params->offset;
+            event.attribute.op         = params->writeOp;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchDataWrittenEvent(params);
     }
 
     /**
@@ -556,7 +795,21 @@ protected:
      *              handlers.
      */
     void handleDataReadEvent(const GattReadCallbackParams *params) {
-        dataReadCallChain.call(params);
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type = DeferredEvent_t::GATT_SERVER_DATA_READ;
+            if (!event.setData(params->data, params->len)) {
+                deferredEventQueue->drop();
+                return;
+            }
+            event.attribute.connHandle = params->connHandle;
+            event.attribute.handle     = params->handle;
+            event.attribute.offset     = params->offset;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchDataReadEvent(params);
     }
 
     /**
@@ -571,6 +824,139 @@ protected:
      *              The handle of the attribute that was modified.
      */
     void handleEvent(GattServerEvents::gattEvent_e type, GattAttribute::Handle_t attributeHandle) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type               = DeferredEvent_t::GATT_SERVER_EVENT;
+            event.serverEvent.type   = type;
+            event.serverEvent.handle = attributeHandle;
+            event.dataLength         = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dispatchEvent(type, attributeHandle);
+    }
+
+    /**
+     * Helper function that notifies all registered handlers of an occurrence
+     * of a data sent event. This function is meant to be called from the
+     * BLE stack specific implementation when a data sent event occurs.
+     *
+     * @param[in] count
+     *              Number of packets sent.
+     */
+    void handleDataSentEvent(unsigned count) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type           = DeferredEvent_t::GATT_SERVER_DATA_SENT;
+            event.dataSent.count = count;
+            event.dataLength     = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        dataSentCallChain.call(count);
+    }
+
+    /**
+     * Helper function that notifies all registered handlers of a change of
+     * the ATT_MTU of a connection. This function is meant to be called from
+     * the BLE stack specific implementation when an MTU exchange completes.
+     *
+     * @param[in] params
+     *              The ATT_MTU change parameters passed to the registered
+     *              handlers.
+     */
+    void handleAttMtuChangeEvent(const GattAttMtuChangeCallbackParams *params) {
+        if (deferredEventQueue) {
+            DeferredEvent_t event;
+            event.type                    = DeferredEvent_t::GATT_SERVER_ATT_MTU_CHANGE;
+            event.attMtuChange.connHandle = params->connHandle;
+            event.attMtuChange.attMtu     = params->attMtu;
+            event.dataLength              = 0;
+            deferredEventQueue->push(event);
+            return;
+        }
+
+        attMtuChangeCallChain.call(params);
+    }
+
+public:
+    /**
+     * Set the queue in which the events reported to the handle entry points
+     * are copied instead of being dispatched immediately.
+     *
+     * @param[in] queue
+     *              The queue to use, NULL to dispatch events immediately.
+     *
+     * @note This is meant to be called by BLE::enableDeferredEventDispatch().
+     */
+    void setDeferredEventQueue(DeferredEventQueue *queue) {
+        deferredEventQueue = queue;
+    }
+
+    /**
+     * Dispatch an event previously deferred by one of the handle entry points.
+     *
+     * @param[in] event
+     *              The event to dispatch.
+     *
+     * @note This is meant to be called by BLE::processEvents().
+     */
+    void dispatchDeferredEvent(const DeferredEvent_t &event) {
+        switch (event.type) {
+            case DeferredEvent_t::GATT_SERVER_DATA_WRITTEN: {
+                GattWriteCallbackParams params;
+                params.connHandle = event.attribute.connHandle;
+                params.handle     = event.attribute.handle;
+                params.writeOp    = static_cast<GattWriteCallbackParams::WriteOp_t>(event.attribute.op);
+                params.offset     = event.attribute.offset;
+                params.len        = event.dataLength;
+                params.data       = event.data;
+                dispatchDataWrittenEvent(&params);
+                break;
+            }
+            case DeferredEvent_t::GATT_SERVER_DATA_READ: {
+                GattReadCallbackParams params;
+                params.connHandle = event.attribute.connHandle;
+                params.handle     = event.attribute.handle;
+                params.offset     = event.attribute.offset;
+                params.len        = event.dataLength;
+                params.data       = event.data;
+                dispatchDataReadEvent(&params);
+                break;
+            }
+            case DeferredEvent_t::GATT_SERVER_EVENT:
+                dispatchEvent(static_cast<GattServerEvents::gattEvent_e>(event.serverEvent.type), event.serverEvent.handle);
+                break;
+            case DeferredEvent_t::GATT_SERVER_DATA_SENT:
+                dataSentCallChain.call(event.dataSent.count);
+                break;
+            case DeferredEvent_t::GATT_SERVER_ATT_MTU_CHANGE: {
+                GattAttMtuChangeCallbackParams params;
+                params.connHandle = event.attMtuChange.connHandle;
+                params.attMtu     = event.attMtuChange.attMtu;
+                attMtuChangeCallChain.call(&params);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+private:
+    /* Invoke the application callbacks for the events above. */
+    void dispatchDataWrittenEvent(const GattWriteCallbackParams *params) {
+        dataWrittenHandleTable.call(params->handle, params);
+        dataWrittenCallChain.call(params);
+    }
+
+    void dispatchDataReadEvent(const GattReadCallbackParams *params) {
+        dataReadHandleTable.call(params->handle, params);
+        dataReadCallChain.call(params);
+    }
+
+    void dispatchEvent(GattServerEvents::gattEvent_e type, GattAttribute::Handle_t attributeHandle) {
         switch (type) {
             case GattServerEvents::GATT_EVENT_UPDATES_ENABLED:
                 if (updatesEnabledCallback) {
@@ -592,18 +978,6 @@ protected:
         }
     }
 
-    /**
-     * Helper function that notifies all registered handlers of an occurrence
-     * of a data sent event. This function is meant to be called from the
-     * BLE stack specific implementation when a data sent event occurs.
-     *
-     * @param[in] count
-     *              Number of packets sent.
-     */
-    void handleDataSentEvent(unsigned count) {
-        dataSentCallChain.call(count);
-    }
-
 public:
     /**
      * Notify all registered onShutdown callbacks that the GattServer is
@@ -629,6 +1003,9 @@ public:
         dataSentCallChain.clear();
         dataWrittenCallChain.clear();
         dataReadCallChain.clear();
+        dataWrittenHandleTable.clear();
+        dataReadHandleTable.clear();
+        attMtuChangeCallChain.clear();
         updatesEnabledCallback       = NULL;
         updatesDisabledCallback      = NULL;
         confirmationReceivedCallback = NULL;
@@ -646,6 +1023,84 @@ protected:
      */
     uint8_t characteristicCount;
 
+private:
+    /**
+     * Dedicated event handlers indexed by attribute handle. The dense table
+     * maps a handle to the slot of its handler, so that dispatching an event
+     * is a constant time operation. It is empty when
+     * BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS is 0.
+     */
+    template <typename ContextType>
+    class HandleDispatchTable {
+    public:
+#if BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS > 0
+        HandleDispatchTable() : slotByHandle(), callbacks() {
+            /* empty */
+        }
+
+        ble_error_t set(GattAttribute::Handle_t handle, const FunctionPointerWithContext<ContextType> &callback) {
+            if (handle >= BLE_GATT_SERVER_MAX_DISPATCH_HANDLES) {
+                return BLE_ERROR_PARAM_OUT_OF_RANGE;
+            }
+
+            uint8_t slot = slotByHandle[handle];
+            if (!callback) {
+                if (slot) {
+                    callbacks[slot - 1] = NULL;
+                    slotByHandle[handle] = 0;
+                }
+                return BLE_ERROR_NONE;
+            }
+
+            if (slot == 0) {
+                while ((slot < BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS) && callbacks[slot]) {
+                    ++slot;
+                }
+                if (slot == BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS) {
+                    return BLE_ERROR_NO_MEM;
+                }
+                slotByHandle[handle] = ++slot;
+            }
+
+            callbacks[slot - 1] = callback;
+            return BLE_ERROR_NONE;
+        }
+
+        void call(GattAttribute::Handle_t handle, ContextType context) const {
+            if (handle >= BLE_GATT_SERVER_MAX_DISPATCH_HANDLES || slotByHandle[handle] == 0) {
+                return;
+            }
+
+            /* Call a copy, the handler may replace itself. */
+            FunctionPointerWithContext<ContextType> callback(callbacks[slotByHandle[handle] - 1]);
+            callback.call(context);
+        }
+
+        void clear(void) {
+            memset(slotByHandle, 0, sizeof(slotByHandle));
+            for (unsigned i = 0; i < BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS; ++i) {
+                callbacks[i] = NULL;
+            }
+        }
+
+    private:
+        uint8_t                                 slotByHandle[BLE_GATT_SERVER_MAX_DISPATCH_HANDLES]; /**< Slot index plus one, 0 if none. */
+        FunctionPointerWithContext<ContextType> callbacks[BLE_GATT_SERVER_MAX_HANDLE_CALLBACKS];
+#else
+        ble_error_t set(GattAttribute::Handle_t, const FunctionPointerWithContext<ContextType> &) {
+            return BLE_ERROR_NOT_IMPLEMENTED;
+        }
+
+        void call(GattAttribute::Handle_t, ContextType) const {
+            /* empty */
+        }
+
+        void clear(void) {
+            /* empty */
+        }
+#endif
+    };
+
 private:
     /**
      * Callchain containing all registered callback handlers for data sent
@@ -662,6 +1117,19 @@ private:
      * events.
      */
     DataReadCallbackChain_t           dataReadCallChain;
+    /**
+     * Dedicated data written event handlers, indexed by attribute handle.
+     */
+    HandleDispatchTable<const GattWriteCallbackParams *> dataWrittenHandleTable;
+    /**
+     * Dedicated data read event handlers, indexed by attribute handle.
+     */
+    HandleDispatchTable<const GattReadCallbackParams *>  dataReadHandleTable;
+    /**
+     * Callchain containing all registered callback handlers for ATT_MTU
+     * change events.
+     */
+    AttMtuChangeCallbackChain_t       attMtuChangeCallChain;
     /**
      * Callchain containing all registered callback handlers for shutdown
      * events.
@@ -679,6 +1147,11 @@ private:
      * The registered callback handler for confirmation received events.
      */
     EventCallback_t                   confirmationReceivedCallback;
+    /**
+     * Queue in which events are deferred, NULL if they are dispatched
+     * immediately.
+     */
+    DeferredEventQueue               *deferredEventQueue;
 
 private:
     /* Disallow copy and assignment. */
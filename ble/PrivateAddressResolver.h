@@ -0,0 +1,236 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PRIVATE_ADDRESS_RESOLVER_H__
+#define __PRIVATE_ADDRESS_RESOLVER_H__
+
+#include <stdint.h>
+
+#include "BLEProtocol.h"
+#include "SecurityManager.h"
+
+/**
+ * Time after which a cached resolution expires, in milliseconds. The
+ * default is the 15 minutes period recommended by the Core Specification
+ * for the renewal of private addresses.
+ */
+#ifndef BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_TTL
+#define BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_TTL (15UL * 60 * 1000)
+#endif
+
+/**
+ * Number of entries of the cache an address may be stored in. A larger value
+ * makes collisions less likely, and lookups longer.
+ */
+#ifndef BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_WAYS
+#define BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_WAYS 4
+#endif
+
+/**
+ * @brief Host-side resolution of resolvable private addresses.
+ *
+ * Resolving a private address takes one AES-128 evaluation per IRK known, and
+ * a peer keeps advertising with the same address until it renews it. The
+ * resolver evaluates the hash of an address against every IRK in a single
+ * pass sharing the plaintext, and caches the outcome, whether an identity
+ * or none, until BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_TTL elapses; in a crowd
+ * of peers an address costs the pass over the IRKs once per period.
+ *
+ * @code
+ * static SecurityManager::Identity_t             identities[200];
+ * static PrivateAddressResolver::CacheEntry_t    cache[256];
+ * PrivateAddressResolver resolver(identities, 200, cache, 256, us_ticker_read_ms);
+ *
+ * resolver.loadBondTable(ble.securityManager());
+ *
+ * BLEProtocol::Address_t identity;
+ * if (resolver.resolve(params->peerAddr, &identity)) {
+ *     // A bonded peer.
+ * }
+ * @endcode
+ *
+ * The resolver can also be given to GapScanFilter::setResolver(), to filter
+ * advertisement reports on the identity of the peers.
+ *
+ * @note The identities and the cache are flushed when the bond table is
+ *       reloaded; reload it when a bond is added or removed.
+ */
+class PrivateAddressResolver {
+public:
+    /**
+     * An entry of the cache.
+     */
+    struct CacheEntry_t {
+        BLEProtocol::AddressBytes_t address;  /**< The address resolved. */
+        uint16_t                    identity; /**< Index of the identity, NO_IDENTITY if none, or EMPTY_ENTRY. */
+        uint32_t                    storedAt; /**< Time the entry was stored, in milliseconds. */
+    };
+
+    /**
+     * Value of CacheEntry_t::identity for an address which does not resolve.
+     */
+    static const uint16_t NO_IDENTITY = 0xFFFF;
+
+    /**
+     * Value of CacheEntry_t::identity for an entry not in use.
+     */
+    static const uint16_t EMPTY_ENTRY = 0xFFFE;
+
+public:
+    /**
+     * Construct a resolver without identities.
+     *
+     * @param[in] identityStorage
+     *              Storage for the identities.
+     * @param[in] identityCapacityIn
+     *              Number of identities in @p identityStorage, less than
+     *              EMPTY_ENTRY.
+     * @param[in] cacheStorage
+     *              Storage for the cache.
+     * @param[in] cacheCapacityIn
+     *              Number of entries in @p cacheStorage.
+     * @param[in] clockIn
+     *              Function returning the current time in milliseconds. If
+     *              NULL, cached resolutions do not expire.
+     */
+    PrivateAddressResolver(SecurityManager::Identity_t  *identityStorage,
+                           uint16_t                      identityCapacityIn,
+                           CacheEntry_t                 *cacheStorage,
+                           uint16_t                      cacheCapacityIn,
+                           uint32_t                    (*clockIn)(void) = NULL);
+
+    /**
+     * Replace the identities by those of the bond table of @p securityManager.
+     *
+     * @return BLE_ERROR_NONE if the identities were loaded, otherwise the
+     *         error of SecurityManager::getIdentitiesFromBondTable(); the
+     *         resolver is left without identities on error.
+     */
+    ble_error_t loadBondTable(const SecurityManager &securityManager);
+
+    /**
+     * Add an identity.
+     *
+     * @return BLE_ERROR_NONE if the identity was added;
+     *         BLE_ERROR_NO_MEM if the storage of the identities is full.
+     */
+    ble_error_t addIdentity(const BLEProtocol::Address_t &address, const SecurityManager::Irk_t irk);
+
+    /**
+     * Remove every identity, and flush the cache.
+     */
+    void clear(void);
+
+    /**
+     * Flush the cache.
+     */
+    void flushCache(void);
+
+    /**
+     * Find the identity of a peer from the address it uses: a resolvable
+     * private address generated with one of the IRKs, or an identity address.
+     *
+     * @param[in]  address
+     *              The address, in LSB format.
+     * @param[out] identityP
+     *              If not NULL, set to the identity address of the peer.
+     *
+     * @return true if the identity of the peer is known.
+     *
+     * @note The type of @p address is not compared to those of the identity
+     *       addresses, since advertisement reports do not carry it; @p address
+     *       is compared to the identity addresses before it is tried against
+     *       the IRKs, even if it has the top bits of a resolvable private
+     *       address.
+     */
+    bool resolve(const BLEProtocol::AddressBytes_t address, BLEProtocol::Address_t *identityP = NULL);
+
+    /**
+     * Check whether an address of a random type is a resolvable private
+     * address.
+     */
+    static bool isResolvable(const BLEProtocol::AddressBytes_t address) {
+        return (address[BLEProtocol::ADDR_LEN - 1] & 0xC0) == 0x40;
+    }
+
+    /**
+     * Check whether a resolvable private address was generated with @p irk.
+     * This costs an AES-128 evaluation.
+     */
+    static bool matchesIrk(const SecurityManager::Irk_t irk, const BLEProtocol::AddressBytes_t address);
+
+    /**
+     * Get the number of identities.
+     */
+    uint16_t getIdentityCount(void) const {
+        return identityCount;
+    }
+
+    /**
+     * Get the identity at @p index.
+     */
+    const SecurityManager::Identity_t &getIdentity(uint16_t index) const {
+        return identities[index];
+    }
+
+    /**
+     * Get the number of resolutions answered from the cache.
+     */
+    uint32_t getCacheHitCount(void) const {
+        return cacheHitCount;
+    }
+
+    /**
+     * Get the number of resolutions not found in the cache.
+     */
+    uint32_t getCacheMissCount(void) const {
+        return cacheMissCount;
+    }
+
+    /**
+     * Get the number of AES-128 evaluations made.
+     */
+    uint32_t getCipherCount(void) const {
+        return cipherCount;
+    }
+
+private:
+    /**
+     * Find the identity of @p address without the cache.
+     *
+     * @return The index of the identity, or NO_IDENTITY.
+     */
+    uint16_t lookup(const BLEProtocol::AddressBytes_t address);
+
+private:
+    /* Disallow copy and assignment. */
+    PrivateAddressResolver(const PrivateAddressResolver &);
+    PrivateAddressResolver& operator=(const PrivateAddressResolver &);
+
+private:
+    SecurityManager::Identity_t  *identities;
+    uint16_t                      identityCapacity;
+    uint16_t                      identityCount;
+    CacheEntry_t                 *cache;
+    uint16_t                      cacheCapacity;
+    uint32_t                    (*clock)(void);
+
+    uint32_t                      cacheHitCount;
+    uint32_t                      cacheMissCount;
+    uint32_t                      cipherCount;
+};
+
+#endif /* ifndef __PRIVATE_ADDRESS_RESOLVER_H__ */
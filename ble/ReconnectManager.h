@@ -0,0 +1,789 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RECONNECT_MANAGER_H__
+#define __RECONNECT_MANAGER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Gap.h"
+#include "GapScanningParams.h"
+#include "SecurityManager.h"
+#include "FunctionPointerWithContext.h"
+
+/**
+ * @brief Reconnect to peers after a connection is lost.
+ *
+ * The manager knows a set of peers: those added with addPeer() or
+ * addPeersFromBondTable(), and, unless disabled with setLearnPeers(), every
+ * peer this device connects to. When the connection to a known peer is
+ * lost, the manager reacts to the disconnection reason:
+ *
+ * - after a connection timeout or an unacceptable connection interval,
+ *   which are typical of RF dropouts, it tries to reconnect immediately;
+ * - after the peer terminated the connection for low resources or power
+ *   off, it tries to reconnect after a longer delay, giving the peer time
+ *   to recover;
+ * - after the connection was terminated on purpose, by the peer's user or
+ *   by this device, it does not reconnect.
+ *
+ * Reconnection is attempted in the role this device had in the lost
+ * connection. As a peripheral, it advertises; as a central, it initiates a
+ * connection. During attempts, the whitelist holds the peers being
+ * reconnected, and the advertising and initiator policies filter on it, so
+ * that only these peers can reconnect. The manager claims the whitelist
+ * (see Gap::claimWhitelist()) while its policies filter on it, and
+ * releases it when the attempts end. If the stack has no whitelist
+ * support, or if another owner holds the whitelist, the attempts are not
+ * filtered, and a central attempts the peers in turn.
+ *
+ * An attempt lasts for the attempt duration. After a failed attempt, the
+ * next one is delayed by an exponential backoff, of which a random part is
+ * drawn so that devices which lost their connections at the same time do
+ * not retry in lockstep.
+ *
+ * The time from the disconnection to the reconnection is recorded per peer
+ * and reported through onReconnect().
+ *
+ * @code
+ * ReconnectManager<8> reconnectManager(ble.gap(), 10000, 500, 60000, us_ticker_read_ms);
+ *
+ * reconnectManager.setLearnPeers(false);
+ * reconnectManager.addPeersFromBondTable(ble.securityManager());
+ * reconnectManager.start(clock.read_ms());
+ * // ...and from a timer:
+ * uint32_t delay = reconnectManager.process(clock.read_ms());
+ * @endcode
+ *
+ * @note While reconnecting as a peripheral, the manager starts and stops
+ *       advertising with the current advertising parameters and payloads.
+ *
+ * @note The manager registers for the connection, disconnection and timeout
+ *       events of the Gap, and unregisters when it is destroyed; it must be
+ *       constructed after BLE::init(), and reconstructed after Gap::reset().
+ *       If the Gap has no room for the registrations, start() fails.
+ *
+ * @tparam MaxPeers Maximum number of known peers.
+ */
+template <unsigned MaxPeers>
+class ReconnectManager {
+public:
+    /**
+     * Parameters of the reconnection callback.
+     */
+    struct ReconnectCallbackParams_t {
+        BLEProtocol::AddressType_t  peerAddrType;    /**< The peer's address type. */
+        BLEProtocol::AddressBytes_t peerAddr;        /**< The peer's address. */
+        Gap::Handle_t               handle;          /**< The new connection handle. */
+        Gap::Role_t                 role;            /**< This device's role in the new connection. */
+        Gap::DisconnectionReason_t  reason;          /**< The reason of the disconnection. */
+        uint32_t                    timeToReconnect; /**< Time from the disconnection, in milliseconds. */
+    };
+
+    /**
+     * Reconnection callback.
+     */
+    typedef FunctionPointerWithContext<const ReconnectCallbackParams_t *> ReconnectCallback_t;
+
+public:
+    /**
+     * Construct a manager with no known peers.
+     *
+     * @param[in] gapIn
+     *              The Gap which reconnects.
+     * @param[in] attemptDurationIn
+     *              Duration of an attempt, in milliseconds.
+     * @param[in] minBackoffIn
+     *              Delay after the first failed attempt, in milliseconds; it
+     *              doubles with every failed attempt.
+     * @param[in] maxBackoffIn
+     *              Maximum delay between two attempts, in milliseconds.
+     * @param[in] clockIn
+     *              Function returning the current time in milliseconds, used
+     *              to timestamp events. If NULL, the time passed to the last
+     *              call to process() is used.
+     * @param[in] seedIn
+     *              Seed of the random backoff; devices should use different
+     *              seeds, for instance derived from their address.
+     */
+    ReconnectManager(Gap        &gapIn,
+                     uint32_t    attemptDurationIn = 10000,
+                     uint32_t    minBackoffIn      = 500,
+                     uint32_t    maxBackoffIn      = 60000,
+                     uint32_t  (*clockIn)(void)    = NULL,
+                     uint32_t    seedIn            = 0) :
+        gap(gapIn),
+        attemptDuration(attemptDurationIn ? attemptDurationIn : 1),
+        minBackoff(minBackoffIn ? minBackoffIn : 1),
+        maxBackoff(maxBackoffIn),
+        clock(clockIn),
+        scanParams(100, 100, (attemptDurationIn + 999) / 1000),
+        learnPeers(true),
+        running(false),
+        advertisingPolicyFiltered(false),
+        initiatorPolicyFiltered(false),
+        randomState(seedIn ? seedIn : 0x9E3779B9UL),
+        nextCentralPeer(0),
+        lastNow(0),
+        useCount(0),
+        registrationStatus(BLE_ERROR_NONE),
+        reconnectCallback(NULL) {
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            peers[i].used = false;
+        }
+        for (unsigned i = 0; i < NUM_ROLES; ++i) {
+            attempts[i].active          = false;
+            attempts[i].awaitingTimeout = false;
+            attempts[i].count           = 0;
+            attempts[i].start           = 0;
+            attempts[i].next            = 0;
+        }
+
+        if ((gap.onConnection(this, &ReconnectManager::onConnection) != BLE_ERROR_NONE) ||
+            (gap.onDisconnection(this, &ReconnectManager::onDisconnection) != BLE_ERROR_NONE) ||
+            (gap.onTimeout(Gap::TimeoutEventCallback_t(this, &ReconnectManager::onTimeout)) != BLE_ERROR_NONE)) {
+            registrationStatus = BLE_ERROR_NO_MEM;
+        }
+    }
+
+    /**
+     * Stop reconnecting, and unregister from the events of the Gap.
+     */
+    ~ReconnectManager() {
+        stop();
+        gap.onConnection().detach(Gap::ConnectionEventCallback_t(this, &ReconnectManager::onConnection));
+        gap.onDisconnection().detach(Gap::DisconnectionEventCallback_t(this, &ReconnectManager::onDisconnection));
+        gap.onTimeout().detach(Gap::TimeoutEventCallback_t(this, &ReconnectManager::onTimeout));
+    }
+
+    /**
+     * Check whether the manager could register for the events of the Gap.
+     *
+     * @return BLE_ERROR_NONE if it did; BLE_ERROR_NO_MEM if a callchain of
+     *         the Gap had no node left (see BLE_GAP_CALLCHAIN_POOL_CAPACITY).
+     */
+    ble_error_t getRegistrationStatus(void) const {
+        return registrationStatus;
+    }
+
+    /**
+     * Choose whether peers are added to the known peers when they connect.
+     * If not, only the peers added with addPeer() and
+     * addPeersFromBondTable() are reconnected.
+     */
+    void setLearnPeers(bool enable) {
+        learnPeers = enable;
+    }
+
+    /**
+     * Add a known peer.
+     *
+     * @return BLE_ERROR_NONE if the peer was added or is already known;
+     *         BLE_ERROR_NO_MEM if there is no room left for another peer.
+     */
+    ble_error_t addPeer(BLEProtocol::AddressType_t type, const BLEProtocol::AddressBytes_t address) {
+        return (findPeer(address) >= 0 || allocatePeer(type, address) >= 0) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
+    }
+
+    /**
+     * Add the peers of the bond table to the known peers.
+     *
+     * @return The result of SecurityManager::getAddressesFromBondTable(), or
+     *         BLE_ERROR_NO_MEM if some peers could not be added.
+     */
+    ble_error_t addPeersFromBondTable(const SecurityManager &securityManager) {
+        BLEProtocol::Address_t addresses[MaxPeers];
+        Gap::Whitelist_t       bondTable = { addresses, 0, MaxPeers };
+
+        ble_error_t rc = securityManager.getAddressesFromBondTable(bondTable);
+        for (unsigned i = 0; (rc == BLE_ERROR_NONE) && (i < bondTable.size); ++i) {
+            rc = addPeer(addresses[i].type, addresses[i].address);
+        }
+
+        return rc;
+    }
+
+    /**
+     * Forget a peer, stopping its reconnection.
+     *
+     * @return BLE_ERROR_NONE if the peer was removed;
+     *         BLE_ERROR_INVALID_PARAM if it is not known.
+     */
+    ble_error_t removePeer(const BLEProtocol::AddressBytes_t address) {
+        int index = findPeer(address);
+        if (index < 0) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+
+        Peer_t &peer = peers[index];
+        peer.used = false;
+        if (peer.pending) {
+            peer.pending = false;
+            if (countPending(peer.role) == 0) {
+                finish(peer.role, lastNow);
+            }
+        }
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Start reconnecting peers when their connection is lost.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return BLE_ERROR_NONE if the manager started, or the error of
+     *         getRegistrationStatus().
+     */
+    ble_error_t start(uint32_t now) {
+        if (registrationStatus != BLE_ERROR_NONE) {
+            return registrationStatus;
+        }
+
+        lastNow = now;
+        running = true;
+        return BLE_ERROR_NONE;
+    }
+
+    /**
+     * Stop reconnecting; attempts in progress are stopped, and no more
+     * disconnections are tracked.
+     */
+    void stop(void) {
+        running = false;
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            peers[i].pending = false;
+        }
+        finish(Gap::PERIPHERAL, lastNow);
+        finish(Gap::CENTRAL, lastNow);
+    }
+
+    /**
+     * End attempts which lasted for the attempt duration, and start the
+     * attempts which are due.
+     *
+     * @param[in] now
+     *              The current time, in milliseconds.
+     *
+     * @return The delay, in milliseconds, after which process() should be
+     *         called again, or 0 if there is nothing to wait for.
+     */
+    uint32_t process(uint32_t now) {
+        lastNow = now;
+        if (!running) {
+            return 0;
+        }
+
+        uint32_t delay = 0;
+        for (unsigned i = 0; i < NUM_ROLES; ++i) {
+            Gap::Role_t role    = (i == PERIPHERAL_INDEX) ? Gap::PERIPHERAL : Gap::CENTRAL;
+            Attempt_t  &attempt = attempts[i];
+
+            if (attempt.active && ((now - attempt.start) >= attemptDuration)) {
+                endAttempt(role, now, true);
+            }
+            launch(role, now);
+
+            uint32_t roleDelay = 0;
+            if (attempt.active) {
+                roleDelay = attemptDuration - (now - attempt.start);
+            } else if (!attempt.awaitingTimeout && countPending(role)) {
+                roleDelay = ((int32_t)(attempt.next - now) > 0) ? (attempt.next - now) : minBackoff;
+            }
+            if ((roleDelay != 0) && ((delay == 0) || (roleDelay < delay))) {
+                delay = roleDelay;
+            }
+        }
+
+        return delay;
+    }
+
+    /**
+     * Get the number of peers being reconnected.
+     */
+    unsigned getPendingCount(void) const {
+        return countPending(Gap::PERIPHERAL) + countPending(Gap::CENTRAL);
+    }
+
+    /**
+     * Get the time it took to reconnect a peer the last time it was
+     * reconnected.
+     *
+     * @param[in]  address
+     *              The peer's address.
+     * @param[out] timeP
+     *              The time from the disconnection to the reconnection, in
+     *              milliseconds.
+     *
+     * @return true if the peer was reconnected at least once.
+     */
+    bool getLastReconnectTime(const BLEProtocol::AddressBytes_t address, uint32_t *timeP) const {
+        int index = findPeer(address);
+        if ((index < 0) || (peers[index].reconnectCount == 0)) {
+            return false;
+        }
+
+        *timeP = peers[index].lastReconnectTime;
+        return true;
+    }
+
+    /**
+     * Get the number of times a peer was reconnected.
+     */
+    uint16_t getReconnectCount(const BLEProtocol::AddressBytes_t address) const {
+        int index = findPeer(address);
+        return (index < 0) ? 0 : peers[index].reconnectCount;
+    }
+
+    /**
+     * Set up the callback invoked when a peer is reconnected.
+     */
+    void onReconnect(void (*callback)(const ReconnectCallbackParams_t *params)) {
+        reconnectCallback.attach(callback);
+    }
+
+    /**
+     * Same as onReconnect(), with an object and a member function.
+     */
+    template <typename T>
+    void onReconnect(T *objPtr, void (T::*memberPtr)(const ReconnectCallbackParams_t *params)) {
+        reconnectCallback.attach(objPtr, memberPtr);
+    }
+
+private:
+    enum {
+        PERIPHERAL_INDEX,
+        CENTRAL_INDEX,
+        NUM_ROLES
+    };
+
+    struct Peer_t {
+        bool                        used;
+        bool                        connected;
+        bool                        pending;           /**< Being reconnected. */
+        BLEProtocol::AddressType_t  type;
+        BLEProtocol::AddressBytes_t address;
+        Gap::Handle_t               handle;
+        Gap::Role_t                 role;              /**< This device's role in the last connection. */
+        Gap::DisconnectionReason_t  reason;            /**< Reason of the last disconnection. */
+        uint32_t                    disconnectedAt;
+        uint32_t                    lastReconnectTime;
+        uint16_t                    reconnectCount;
+        uint32_t                    lastUse;           /**< Order of last use, to replace the least recently used peer. */
+    };
+
+    struct Attempt_t {
+        bool     active;
+        bool     awaitingTimeout; /**< The stack couldn't cancel the initiation; its timeout is awaited. */
+        uint8_t  count;           /**< Failed attempts since the role has peers to reconnect. */
+        uint32_t start;
+        uint32_t next;
+    };
+
+    static unsigned getRoleIndex(Gap::Role_t role) {
+        return (role == Gap::CENTRAL) ? CENTRAL_INDEX : PERIPHERAL_INDEX;
+    }
+
+    uint32_t getTime(void) const {
+        return clock ? clock() : lastNow;
+    }
+
+    int findPeer(const BLEProtocol::AddressBytes_t address) const {
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            if (peers[i].used && (memcmp(peers[i].address, address, BLEProtocol::ADDR_LEN) == 0)) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /**
+     * Add a peer, replacing the least recently used peer which is neither
+     * connected nor being reconnected if there is no room left.
+     *
+     * @return The index of the peer, or -1 if there is no room left.
+     */
+    int allocatePeer(BLEProtocol::AddressType_t type, const BLEProtocol::AddressBytes_t address) {
+        int index = -1;
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            if (!peers[i].used) {
+                index = i;
+                break;
+            }
+            if (!peers[i].connected && !peers[i].pending &&
+                ((index < 0) || ((int32_t)(peers[i].lastUse - peers[index].lastUse) < 0))) {
+                index = i;
+            }
+        }
+        if (index < 0) {
+            return -1;
+        }
+
+        Peer_t &peer = peers[index];
+        peer.used           = true;
+        peer.connected      = false;
+        peer.pending        = false;
+        peer.type           = type;
+        memcpy(peer.address, address, BLEProtocol::ADDR_LEN);
+        peer.handle         = 0;
+        peer.role           = Gap::PERIPHERAL;
+        peer.reason         = Gap::CONNECTION_TIMEOUT;
+        peer.disconnectedAt = 0;
+        peer.lastReconnectTime = 0;
+        peer.reconnectCount = 0;
+        peer.lastUse        = useCount++;
+        return index;
+    }
+
+    unsigned countPending(Gap::Role_t role) const {
+        unsigned count = 0;
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            if (peers[i].used && peers[i].pending && (peers[i].role == role)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Get the delay before the next attempt, after @p failures failed
+     * attempts: a random value between half and all of the exponential
+     * backoff.
+     */
+    uint32_t getBackoff(unsigned failures) {
+        uint32_t backoff = minBackoff;
+        for (unsigned i = 1; (i < failures) && (backoff < maxBackoff); ++i) {
+            backoff *= 2;
+        }
+        if (backoff > maxBackoff) {
+            backoff = maxBackoff;
+        }
+
+        /* xorshift32 */
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+
+        return (backoff / 2) + (randomState % ((backoff / 2) + 1));
+    }
+
+    /**
+     * Load the whitelist with the peers being reconnected.
+     *
+     * @return true if the whitelist was loaded.
+     */
+    bool loadWhitelist(void) {
+        unsigned capacity = gap.getMaxWhitelistSize();
+        if (capacity > MaxPeers) {
+            capacity = MaxPeers;
+        }
+
+        unsigned count = 0;
+        for (unsigned i = 0; (i < MaxPeers) && (count < capacity); ++i) {
+            if (peers[i].used && peers[i].pending) {
+                whitelistAddresses[count++] = BLEProtocol::Address_t(peers[i].type, peers[i].address);
+            }
+        }
+        if ((count == 0) || (count < getPendingCount())) {
+            /* Filtering on a partial whitelist would keep some peers out. */
+            return false;
+        }
+        if (gap.claimWhitelist(this) != BLE_ERROR_NONE) {
+            return false;
+        }
+
+        Gap::Whitelist_t whitelist = { whitelistAddresses, (uint8_t)count, (uint8_t)capacity };
+        return gap.setWhitelist(whitelist) == BLE_ERROR_NONE;
+    }
+
+    /**
+     * Release the whitelist once neither policy filters on it.
+     */
+    void releaseWhitelist(void) {
+        if (!advertisingPolicyFiltered && !initiatorPolicyFiltered) {
+            gap.releaseWhitelist(this);
+        }
+    }
+
+    /**
+     * Start an attempt in @p role if one is due.
+     */
+    void launch(Gap::Role_t role, uint32_t now) {
+        const Attempt_t &attempt = attempts[getRoleIndex(role)];
+        if (running && !attempt.active && !attempt.awaitingTimeout && countPending(role) &&
+            ((int32_t)(now - attempt.next) >= 0)) {
+            startAttempt(role, now);
+        }
+    }
+
+    void startAttempt(Gap::Role_t role, uint32_t now) {
+        Attempt_t &attempt  = attempts[getRoleIndex(role)];
+        bool       filtered = loadWhitelist();
+        ble_error_t rc;
+
+        if (role == Gap::PERIPHERAL) {
+            if (filtered && (gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_FILTER_CONN_REQS) == BLE_ERROR_NONE)) {
+                advertisingPolicyFiltered = true;
+            } else if (advertisingPolicyFiltered) {
+                gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_IGNORE_WHITELIST);
+                advertisingPolicyFiltered = false;
+            }
+            if (gap.getState().advertising) {
+                /* Restart advertising so that the policy applies. */
+                gap.stopAdvertising();
+            }
+            rc = gap.startAdvertising();
+        } else {
+            if (filtered && (gap.setInitiatorPolicyMode(Gap::INIT_POLICY_FILTER_ALL_ADV) == BLE_ERROR_NONE)) {
+                initiatorPolicyFiltered = true;
+            } else if (initiatorPolicyFiltered) {
+                gap.setInitiatorPolicyMode(Gap::INIT_POLICY_IGNORE_WHITELIST);
+                initiatorPolicyFiltered = false;
+            }
+
+            /* Without the whitelist, the peers are attempted in turn. */
+            const Peer_t *target = NULL;
+            for (unsigned i = 0; (i < MaxPeers) && (target == NULL); ++i) {
+                const Peer_t &peer = peers[(nextCentralPeer + i) % MaxPeers];
+                if (peer.used && peer.pending && (peer.role == Gap::CENTRAL)) {
+                    target          = &peer;
+                    nextCentralPeer = (nextCentralPeer + i + 1) % MaxPeers;
+                }
+            }
+            rc = gap.connect(target->address, target->type, NULL, &scanParams);
+        }
+        releaseWhitelist();
+
+        if (rc == BLE_ERROR_NONE) {
+            attempt.active = true;
+            attempt.start  = now;
+        } else {
+            if (attempt.count < 0xFF) {
+                ++attempt.count;
+            }
+            attempt.next = now + getBackoff(attempt.count);
+        }
+    }
+
+    /**
+     * End the attempt in progress in @p role.
+     *
+     * @param[in] failed
+     *              Whether the attempt counts as failed; if not, the next
+     *              attempt is due immediately.
+     */
+    void endAttempt(Gap::Role_t role, uint32_t now, bool failed) {
+        Attempt_t &attempt = attempts[getRoleIndex(role)];
+        if (!attempt.active) {
+            return;
+        }
+
+        attempt.active = false;
+        if (role == Gap::PERIPHERAL) {
+            gap.stopAdvertising();
+        } else if (gap.cancelConnect() != BLE_ERROR_NONE) {
+            attempt.awaitingTimeout = true;
+        }
+
+        if (failed) {
+            if (attempt.count < 0xFF) {
+                ++attempt.count;
+            }
+            attempt.next = now + getBackoff(attempt.count);
+        } else {
+            attempt.next = now;
+        }
+    }
+
+    /**
+     * Stop reconnecting in @p role, which has no more peers to reconnect.
+     */
+    void finish(Gap::Role_t role, uint32_t now) {
+        endAttempt(role, now, false);
+        attempts[getRoleIndex(role)].count = 0;
+
+        if ((role == Gap::PERIPHERAL) && advertisingPolicyFiltered) {
+            gap.setAdvertisingPolicyMode(Gap::ADV_POLICY_IGNORE_WHITELIST);
+            advertisingPolicyFiltered = false;
+        }
+        if ((role == Gap::CENTRAL) && initiatorPolicyFiltered) {
+            gap.setInitiatorPolicyMode(Gap::INIT_POLICY_IGNORE_WHITELIST);
+            initiatorPolicyFiltered = false;
+        }
+        releaseWhitelist();
+    }
+
+    void onConnection(const Gap::ConnectionCallbackParams_t *params) {
+        uint32_t now   = getTime();
+        int      index = findPeer(params->peerAddr);
+        if (index < 0) {
+            if (!learnPeers || ((index = allocatePeer(params->peerAddrType, params->peerAddr)) < 0)) {
+                return;
+            }
+        }
+
+        Peer_t &peer = peers[index];
+        Gap::Role_t previousRole = peer.role;
+        bool        reconnected  = peer.pending;
+
+        peer.connected = true;
+        peer.pending   = false;
+        peer.type      = params->peerAddrType;
+        peer.handle    = params->handle;
+        peer.role      = params->role;
+        peer.lastUse   = useCount++;
+
+        /* A connection in a role ends the attempt in progress in that role. */
+        Attempt_t &attempt = attempts[getRoleIndex(params->role)];
+        if (attempt.active) {
+            attempt.active = false;
+            attempt.next   = now;
+        }
+        if (reconnected && (countPending(previousRole) == 0)) {
+            finish(previousRole, now);
+        }
+        launch(params->role, now);
+
+        if (reconnected) {
+            peer.lastReconnectTime = now - peer.disconnectedAt;
+            if (peer.reconnectCount < 0xFFFF) {
+                ++peer.reconnectCount;
+            }
+
+            ReconnectCallbackParams_t callbackParams;
+            callbackParams.peerAddrType    = peer.type;
+            memcpy(callbackParams.peerAddr, peer.address, BLEProtocol::ADDR_LEN);
+            callbackParams.handle          = peer.handle;
+            callbackParams.role            = peer.role;
+            callbackParams.reason          = peer.reason;
+            callbackParams.timeToReconnect = peer.lastReconnectTime;
+            if (reconnectCallback) {
+                reconnectCallback.call(&callbackParams);
+            }
+        }
+    }
+
+    void onDisconnection(const Gap::DisconnectionCallbackParams_t *params) {
+        Peer_t *peer = NULL;
+        for (unsigned i = 0; i < MaxPeers; ++i) {
+            if (peers[i].used && peers[i].connected && (peers[i].handle == params->handle)) {
+                peer = &peers[i];
+                break;
+            }
+        }
+        if (peer == NULL) {
+            return;
+        }
+
+        peer->connected = false;
+        if (!running) {
+            return;
+        }
+
+        uint32_t now = getTime();
+        uint32_t delay;
+        switch (params->reason) {
+            case Gap::CONNECTION_TIMEOUT:
+            case Gap::CONN_INTERVAL_UNACCEPTABLE:
+                /* Likely an RF dropout: the peer is still around. */
+                delay = 0;
+                break;
+            case Gap::REMOTE_DEV_TERMINATION_DUE_TO_LOW_RESOURCES:
+            case Gap::REMOTE_DEV_TERMINATION_DUE_TO_POWER_OFF:
+                /* Give the peer time to recover. */
+                delay = getBackoff(4);
+                break;
+            default:
+                /* Terminated on purpose. */
+                return;
+        }
+
+        Gap::Role_t role    = peer->role;
+        Attempt_t  &attempt = attempts[getRoleIndex(role)];
+        if (countPending(role) == 0) {
+            attempt.count = 0;
+            attempt.next  = now + delay;
+        } else if ((delay == 0) && ((int32_t)(attempt.next - now) > 0)) {
+            attempt.next = now;
+        }
+
+        peer->pending        = true;
+        peer->reason         = params->reason;
+        peer->disconnectedAt = now;
+
+        /* Restart the attempt in progress so that the whitelist includes the peer. */
+        if (attempt.active && (delay == 0)) {
+            endAttempt(role, now, false);
+        }
+        launch(role, now);
+    }
+
+    void onTimeout(Gap::TimeoutSource_t source) {
+        Gap::Role_t role;
+        if (source == Gap::TIMEOUT_SRC_ADVERTISING) {
+            role = Gap::PERIPHERAL;
+        } else if (source == Gap::TIMEOUT_SRC_CONN) {
+            role = Gap::CENTRAL;
+        } else {
+            return;
+        }
+
+        Attempt_t &attempt = attempts[getRoleIndex(role)];
+        if (attempt.awaitingTimeout) {
+            attempt.awaitingTimeout = false;
+        } else if (attempt.active) {
+            /* The stack ended the attempt before its duration. */
+            attempt.active = false;
+            if (attempt.count < 0xFF) {
+                ++attempt.count;
+            }
+            attempt.next = getTime() + getBackoff(attempt.count);
+        }
+        launch(role, getTime());
+    }
+
+private:
+    /* Disallow copy and assignment. */
+    ReconnectManager(const ReconnectManager &);
+    ReconnectManager& operator=(const ReconnectManager &);
+
+private:
+    Gap                     &gap;
+    uint32_t                 attemptDuration;
+    uint32_t                 minBackoff;
+    uint32_t                 maxBackoff;
+    uint32_t               (*clock)(void);
+    GapScanningParams        scanParams;
+    bool                     learnPeers;
+
+    bool                     running;
+    bool                     advertisingPolicyFiltered;
+    bool                     initiatorPolicyFiltered;
+    uint32_t                 randomState;
+    unsigned                 nextCentralPeer;
+    uint32_t                 lastNow;
+    uint32_t                 useCount;
+    ble_error_t              registrationStatus;
+
+    Peer_t                   peers[MaxPeers];
+    Attempt_t                attempts[NUM_ROLES];
+    BLEProtocol::Address_t   whitelistAddresses[MaxPeers];
+    ReconnectCallback_t      reconnectCallback;
+};
+
+#endif /* ifndef __RECONNECT_MANAGER_H__ */
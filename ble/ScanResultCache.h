@@ -0,0 +1,431 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SCAN_RESULT_CACHE_H__
+#define __SCAN_RESULT_CACHE_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Gap.h"
+#include "BLEProtocol.h"
+#include "GapAdvertisingData.h"
+#include "FunctionPointerWithContext.h"
+
+/**
+ * Weight of a new RSSI sample in the smoothed RSSI of a device, as a power
+ * of two: each sample accounts for 1/2^BLE_SCAN_RESULT_CACHE_RSSI_SHIFT of
+ * the smoothed value.
+ */
+#ifndef BLE_SCAN_RESULT_CACHE_RSSI_SHIFT
+#define BLE_SCAN_RESULT_CACHE_RSSI_SHIFT 2
+#endif
+
+/**
+ * @brief Fixed-memory table of the devices found by a scan.
+ *
+ * In active scanning a peer is reported for every advertising packet and
+ * every scan response it sends. The cache keeps one entry per peer address,
+ * merging its advertising data and scan response, and passes a report to
+ * the application only when a device is new or one of its payloads changed:
+ *
+ * @code
+ * ScanResultCache<32> cache(us_ticker_read_ms);
+ *
+ * void onDevice(const ScanResultCache<32>::Device_t *device) {
+ *     // device->advertisingData, device->scanResponse, device->rssi...
+ * }
+ *
+ * cache.onDeviceUpdate(onDevice);
+ * ble.gap().startScan(&cache, &ScanResultCache<32>::processReport);
+ * @endcode
+ *
+ * Devices are looked up by address in a hash index with open addressing;
+ * when the table is full, the device seen least recently is evicted. Memory
+ * use is fixed by MaxDevices, however many devices are in range.
+ *
+ * @tparam MaxDevices Maximum number of devices held, less than 0xFFFF.
+ */
+template <unsigned MaxDevices>
+class ScanResultCache {
+public:
+    /**
+     * A device of the cache.
+     */
+    struct Device_t {
+        BLEProtocol::AddressBytes_t              peerAddr;                                         /**< The peer's BLE address. */
+        GapAdvertisingParams::AdvertisingType_t  type;                                             /**< The type of the last advertisement. */
+        int8_t                                   rssi;                                             /**< The smoothed RSSI. */
+        uint8_t                                  advertisingDataLen;                               /**< Length of the advertising data. */
+        uint8_t                                  advertisingData[GAP_ADVERTISING_DATA_MAX_PAYLOAD]; /**< The last advertising data. */
+        uint8_t                                  scanResponseLen;                                  /**< Length of the scan response. */
+        uint8_t                                  scanResponse[GAP_ADVERTISING_DATA_MAX_PAYLOAD];    /**< The last scan response. */
+        uint32_t                                 firstSeen;                                        /**< Time of the first report, in milliseconds. */
+        uint32_t                                 lastSeen;                                         /**< Time of the last report, in milliseconds. */
+        uint32_t                                 hitCount;                                         /**< Number of reports received. */
+    };
+
+    /**
+     * Callback invoked with a device which is new or whose payloads changed.
+     */
+    typedef FunctionPointerWithContext<const Device_t *> DeviceUpdateCallback_t;
+
+public:
+    /**
+     * Construct an empty cache.
+     *
+     * @param[in] clockIn
+     *              Function returning the current time in milliseconds,
+     *              used by processReport(). If NULL, the times recorded by
+     *              processReport() are 0.
+     */
+    ScanResultCache(uint32_t (*clockIn)(void) = NULL) :
+        clock(clockIn), deviceUpdateCallback(NULL), evictionCount(0) {
+        clear();
+    }
+
+    /**
+     * Remove every device.
+     */
+    void clear(void) {
+        memset(index, 0, sizeof(index));
+        deviceCount = 0;
+        mostRecent  = NONE;
+        leastRecent = NONE;
+    }
+
+    /**
+     * Record an advertisement report.
+     *
+     * @param[in] params
+     *              The report, as passed to the scan callback.
+     * @param[in] now
+     *              The current time, in milliseconds.
+     * @param[out] changedP
+     *              If not NULL, set to true if the device is new or its
+     *              payload changed.
+     *
+     * @return The device entry; it remains valid until the device is
+     *         evicted or removed.
+     */
+    const Device_t *update(const Gap::AdvertisementCallbackParams_t *params, uint32_t now, bool *changedP = NULL) {
+        bool    changed = false;
+        uint8_t len     = params->advertisingDataLen;
+        if (len > GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+            len = GAP_ADVERTISING_DATA_MAX_PAYLOAD;
+        }
+
+        unsigned slot;
+        uint16_t entry;
+        if (lookup(params->peerAddr, slot)) {
+            entry = index[slot] - 1;
+            unlink(entry);
+        } else {
+            if (deviceCount == MaxDevices) {
+                evict(leastRecent);
+                lookup(params->peerAddr, slot);
+            }
+            entry = allocate();
+            index[slot] = entry + 1;
+
+            Device_t &device = devices[entry];
+            memcpy(device.peerAddr, params->peerAddr, BLEProtocol::ADDR_LEN);
+            device.advertisingDataLen = 0;
+            device.scanResponseLen    = 0;
+            device.firstSeen          = now;
+            device.hitCount           = 0;
+            smoothedRssi[entry]       = params->rssi * (1 << BLE_SCAN_RESULT_CACHE_RSSI_SHIFT);
+            changed = true;
+        }
+        link(entry);
+
+        Device_t &device = devices[entry];
+        uint8_t  *data    = params->isScanResponse ? device.scanResponse    : device.advertisingData;
+        uint8_t  &dataLen = params->isScanResponse ? device.scanResponseLen : device.advertisingDataLen;
+        if ((dataLen != len) || (memcmp(data, params->advertisingData, len) != 0)) {
+            memcpy(data, params->advertisingData, len);
+            dataLen = len;
+            changed = true;
+        }
+
+        smoothedRssi[entry] += params->rssi - (smoothedRssi[entry] / (1 << BLE_SCAN_RESULT_CACHE_RSSI_SHIFT));
+        device.rssi      = (int8_t)(smoothedRssi[entry] / (1 << BLE_SCAN_RESULT_CACHE_RSSI_SHIFT));
+        device.lastSeen  = now;
+        ++device.hitCount;
+        if (!params->isScanResponse) {
+            device.type = params->type;
+        }
+
+        if (changedP != NULL) {
+            *changedP = changed;
+        }
+        return &device;
+    }
+
+    /**
+     * Record an advertisement report, timed with the clock given to the
+     * constructor, and invoke the callback set with onDeviceUpdate() if the
+     * device is new or its payload changed. This can be used as the scan
+     * callback.
+     *
+     * @param[in] params
+     *              The report.
+     */
+    void processReport(const Gap::AdvertisementCallbackParams_t *params) {
+        bool            changed;
+        const Device_t *device = update(params, clock ? clock() : 0, &changed);
+        if (changed && deviceUpdateCallback) {
+            deviceUpdateCallback.call(device);
+        }
+    }
+
+    /**
+     * Set up the callback invoked by processReport() with new devices and
+     * devices whose payloads changed.
+     */
+    void onDeviceUpdate(void (*callback)(const Device_t *device)) {
+        deviceUpdateCallback.attach(callback);
+    }
+
+    /**
+     * Same as onDeviceUpdate(), with an object and a member function.
+     */
+    template <typename T>
+    void onDeviceUpdate(T *objPtr, void (T::*memberPtr)(const Device_t *device)) {
+        deviceUpdateCallback.attach(objPtr, memberPtr);
+    }
+
+    /**
+     * Find a device.
+     *
+     * @return The device entry, or NULL if the device is not in the cache.
+     */
+    const Device_t *find(const BLEProtocol::AddressBytes_t peerAddr) const {
+        unsigned slot;
+        return lookup(peerAddr, slot) ? &devices[index[slot] - 1] : NULL;
+    }
+
+    /**
+     * Remove a device.
+     *
+     * @return true if the device was in the cache.
+     */
+    bool remove(const BLEProtocol::AddressBytes_t peerAddr) {
+        unsigned slot;
+        if (!lookup(peerAddr, slot)) {
+            return false;
+        }
+
+        uint16_t entry = index[slot] - 1;
+        unlink(entry);
+        release(entry);
+        removeSlot(slot);
+        return true;
+    }
+
+    /**
+     * Remove the devices which were not seen for more than @p maxAge
+     * milliseconds.
+     *
+     * @return The number of devices removed.
+     */
+    unsigned expire(uint32_t now, uint32_t maxAge) {
+        unsigned count = 0;
+        while ((leastRecent != NONE) && ((now - devices[leastRecent].lastSeen) > maxAge)) {
+            evict(leastRecent);
+            ++count;
+        }
+
+        return count;
+    }
+
+    /**
+     * Get the number of devices in the cache.
+     */
+    unsigned getDeviceCount(void) const {
+        return deviceCount;
+    }
+
+    /**
+     * Get the number of devices evicted to make room for new ones.
+     */
+    uint32_t getEvictionCount(void) const {
+        return evictionCount;
+    }
+
+private:
+    /**
+     * Number of slots of the hash index; a load factor of at most 1/2 keeps
+     * the probe sequences short.
+     */
+    static const unsigned INDEX_SIZE = 2 * MaxDevices + 1;
+
+    /**
+     * Null link of the recency list.
+     */
+    static const uint16_t NONE = 0xFFFF;
+
+    /* Disallow copy and assignment. */
+    ScanResultCache(const ScanResultCache &);
+    ScanResultCache& operator=(const ScanResultCache &);
+
+    static unsigned hash(const BLEProtocol::AddressBytes_t peerAddr) {
+        /* FNV-1a */
+        uint32_t h = 2166136261UL;
+        for (unsigned i = 0; i < BLEProtocol::ADDR_LEN; ++i) {
+            h = (h ^ peerAddr[i]) * 16777619UL;
+        }
+        return h % INDEX_SIZE;
+    }
+
+    /**
+     * Look a device up in the index.
+     *
+     * @param[out] slot
+     *              Set to the slot of the device if it is found, otherwise
+     *              to the free slot where it would be inserted.
+     *
+     * @return true if the device was found.
+     */
+    bool lookup(const BLEProtocol::AddressBytes_t peerAddr, unsigned &slot) const {
+        for (slot = hash(peerAddr); index[slot] != 0; slot = (slot + 1) % INDEX_SIZE) {
+            if (memcmp(devices[index[slot] - 1].peerAddr, peerAddr, BLEProtocol::ADDR_LEN) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Free an index slot, moving back the entries of the probe sequence
+     * which follows it so that lookups keep finding them.
+     */
+    void removeSlot(unsigned slot) {
+        unsigned next = slot;
+        for (;;) {
+            index[slot] = 0;
+            for (;;) {
+                next = (next + 1) % INDEX_SIZE;
+                if (index[next] == 0) {
+                    return;
+                }
+
+                /* The entry can fill the hole if its home slot is not between the hole and itself. */
+                unsigned home = hash(devices[index[next] - 1].peerAddr);
+                if ((slot <= next) ? ((home <= slot) || (home > next)) : ((home <= slot) && (home > next))) {
+                    break;
+                }
+            }
+            index[slot] = index[next];
+            slot        = next;
+        }
+    }
+
+    void evict(uint16_t entry) {
+        unsigned slot;
+        lookup(devices[entry].peerAddr, slot);
+        unlink(entry);
+        release(entry);
+        removeSlot(slot);
+        ++evictionCount;
+    }
+
+    /**
+     * Get a free entry. The devices are kept in the first deviceCount
+     * entries.
+     */
+    uint16_t allocate(void) {
+        return deviceCount++;
+    }
+
+    /**
+     * Free an entry unlinked from the recency list, by moving the last
+     * entry in its place.
+     */
+    void release(uint16_t entry) {
+        uint16_t last = --deviceCount;
+        if (entry == last) {
+            return;
+        }
+
+        unsigned slot;
+        lookup(devices[last].peerAddr, slot);
+        index[slot] = entry + 1;
+
+        devices[entry]      = devices[last];
+        smoothedRssi[entry] = smoothedRssi[last];
+        prev[entry]         = prev[last];
+        next[entry]         = next[last];
+        if (prev[entry] != NONE) {
+            next[prev[entry]] = entry;
+        } else {
+            mostRecent = entry;
+        }
+        if (next[entry] != NONE) {
+            prev[next[entry]] = entry;
+        } else {
+            leastRecent = entry;
+        }
+    }
+
+    /**
+     * Insert an entry at the head of the recency list.
+     */
+    void link(uint16_t entry) {
+        prev[entry] = NONE;
+        next[entry] = mostRecent;
+        if (mostRecent != NONE) {
+            prev[mostRecent] = entry;
+        } else {
+            leastRecent = entry;
+        }
+        mostRecent = entry;
+    }
+
+    /**
+     * Remove an entry from the recency list.
+     */
+    void unlink(uint16_t entry) {
+        if (prev[entry] != NONE) {
+            next[prev[entry]] = next[entry];
+        } else {
+            mostRecent = next[entry];
+        }
+        if (next[entry] != NONE) {
+            prev[next[entry]] = prev[entry];
+        } else {
+            leastRecent = prev[entry];
+        }
+    }
+
+private:
+    uint32_t               (*clock)(void);
+    DeviceUpdateCallback_t   deviceUpdateCallback;
+    uint32_t                 evictionCount;
+
+    Device_t                 devices[MaxDevices];
+    int16_t                  smoothedRssi[MaxDevices];
+    uint16_t                 prev[MaxDevices];
+    uint16_t                 next[MaxDevices];
+    uint16_t                 deviceCount;
+    uint16_t                 mostRecent;
+    uint16_t                 leastRecent;
+
+    uint16_t                 index[INDEX_SIZE];
+};
+
+#endif /* ifndef __SCAN_RESULT_CACHE_H__ */
@@ -22,6 +22,14 @@
 #include "Gap.h"
 #include "CallChainOfFunctionPointersWithContext.h"
 
+/**
+ * Capacity of the node pools backing the callchains of SecurityManager when
+ * BLE_CALLCHAIN_USE_NODE_POOL is defined.
+ */
+#ifndef BLE_SECURITY_MANAGER_CALLCHAIN_POOL_CAPACITY
+#define BLE_SECURITY_MANAGER_CALLCHAIN_POOL_CAPACITY BLE_CALLCHAIN_POOL_DEFAULT_CAPACITY
+#endif
+
 class SecurityManager {
 public:
     enum SecurityMode_t {
@@ -76,6 +84,31 @@ public:
     static const unsigned PASSKEY_LEN = 6;
     typedef uint8_t Passkey_t[PASSKEY_LEN];         /**< 6-digit passkey in ASCII ('0'-'9' digits only). */
 
+    /**
+     * Identity Resolving Key distributed by a peer during bonding, in LSB
+     * format as in the Identity Information PDU.
+     */
+    static const unsigned IRK_LEN = 16;
+    typedef uint8_t Irk_t[IRK_LEN];
+
+    /**
+     * Identity of a bonded peer: its identity address and the key used to
+     * resolve its resolvable private addresses.
+     */
+    struct Identity_t {
+        BLEProtocol::Address_t address; /**< The identity address of the peer. */
+        Irk_t                  irk;     /**< The IRK of the peer. */
+    };
+
+    /**
+     * A list of identities of bonded peers.
+     */
+    struct IdentityList_t {
+        Identity_t *identities; /**< The identities. */
+        uint16_t    size;       /**< Number of identities in the list. */
+        uint16_t    capacity;   /**< Maximum number of identities in the list. */
+    };
+
 public:
     typedef void (*HandleSpecificEvent_t)(Gap::Handle_t handle);
     typedef void (*SecuritySetupInitiatedCallback_t)(Gap::Handle_t, bool allowBonding, bool requireMITM, SecurityIOCapabilities_t iocaps);
@@ -84,7 +117,7 @@ public:
     typedef void (*PasskeyDisplayCallback_t)(Gap::Handle_t handle, const Passkey_t passkey);
 
     typedef FunctionPointerWithContext<const SecurityManager *> SecurityManagerShutdownCallback_t;
-    typedef CallChainOfFunctionPointersWithContext<const SecurityManager *> SecurityManagerShutdownCallbackChain_t;
+    typedef CallChainOfFunctionPointersWithContext<const SecurityManager *, BLE_CALLCHAIN_ALLOCATOR(BLE_SECURITY_MANAGER_CALLCHAIN_POOL_CAPACITY, SecurityManager)> SecurityManagerShutdownCallbackChain_t;
 
     /*
      * The following functions are meant to be overridden in the platform-specific sub-class.
@@ -185,6 +218,30 @@ public:
         return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porters: override this API if security is supported. */
     }
 
+    /**
+     * Get the identity addresses and IRKs of all peers in the bond table
+     * which distributed an IRK. This is what PrivateAddressResolver needs to
+     * resolve the private addresses of the bonded peers on the host.
+     *
+     * @param[in,out]   identities
+     *                  (on input) identities.capacity contains the maximum
+     *                  number of identities to be returned.
+     *                  (on output) The populated list with copies of the
+     *                  identities in the bond table.
+     *
+     * @retval BLE_ERROR_NONE             On success, else an error code indicating reason for failure.
+     * @retval BLE_ERROR_INVALID_STATE    If the API is called without module initialization or
+     *                                    application registration.
+     *
+     * @experimental
+     */
+    virtual ble_error_t getIdentitiesFromBondTable(IdentityList_t &identities) const {
+        /* Avoid compiler warnings about unused variables */
+        (void) identities;
+
+        return BLE_ERROR_NOT_IMPLEMENTED; /* Requesting action from porters: override this API if security is supported. */
+    }
+
     /* Event callback handlers. */
 public:
     /**
@@ -200,13 +257,16 @@ public:
      * some object.
      *
      * @note It is possible to unregister a callback using onShutdown().detach(callback)
+     *
+     * @return BLE_ERROR_NONE if the callback was registered, or
+     *         BLE_ERROR_NO_MEM if the node pool of the callchain is exhausted.
      */
-    void onShutdown(const SecurityManagerShutdownCallback_t& callback) {
-        shutdownCallChain.add(callback);
+    ble_error_t onShutdown(const SecurityManagerShutdownCallback_t& callback) {
+        return shutdownCallChain.add(callback) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
     template <typename T>
-    void onShutdown(T *objPtr, void (T::*memberPtr)(const SecurityManager *)) {
-        shutdownCallChain.add(objPtr, memberPtr);
+    ble_error_t onShutdown(T *objPtr, void (T::*memberPtr)(const SecurityManager *)) {
+        return shutdownCallChain.add(objPtr, memberPtr) ? BLE_ERROR_NONE : BLE_ERROR_NO_MEM;
     }
 
     /**
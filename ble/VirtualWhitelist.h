@@ -0,0 +1,248 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VIRTUAL_WHITELIST_H__
+#define __VIRTUAL_WHITELIST_H__
+
+#include <stdint.h>
+
+#include "BLEProtocol.h"
+#include "blecommon.h"
+
+class Gap;
+
+/**
+ * Maximum number of entries a VirtualWhitelist pushes to the whitelist of
+ * the controller. The number actually pushed is also bounded by
+ * Gap::getMaxWhitelistSize().
+ */
+#ifndef BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE
+#define BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE 8
+#endif
+
+#if (BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE < 1) || (BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE > 255)
+#error "BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE must be between 1 and 255"
+#endif
+
+/**
+ * @brief Whitelist of arbitrary size maintained by the host.
+ *
+ * The whitelist of the controller is usually limited to a handful of
+ * addresses (see Gap::getMaxWhitelistSize()). A VirtualWhitelist holds as
+ * many addresses as the storage given to it, sorted so that a lookup is a
+ * binary search. Once set with Gap::setVirtualWhitelist(), the Gap discards
+ * the advertisement reports of peers not in the list, and disconnects the
+ * peers not in the list which connect to it as a peripheral.
+ *
+ * Every accepted report or connection marks its entry as active. The most
+ * recently active entries are pushed to the whitelist of the controller by
+ * syncHardwareWhitelist(), so that the filter policies (see
+ * Gap::setScanningPolicyMode(), Gap::setAdvertisingPolicyMode() and
+ * Gap::setInitiatorPolicyMode()) can filter the hot set in the controller:
+ *
+ * @code
+ * static VirtualWhitelist::Entry_t tagStorage[300];
+ * VirtualWhitelist tags(tagStorage, 300);
+ *
+ * tags.add(tagAddress);
+ * ble.gap().setVirtualWhitelist(&tags);
+ * // ...and periodically, when the whitelist of the controller is not in use:
+ * tags.syncHardwareWhitelist(ble.gap());
+ * @endcode
+ *
+ * @note Lookups compare the address bytes only, since advertisement reports
+ *       do not carry the type of the peer address.
+ * @note Peers using resolvable private addresses match only once their
+ *       current address is in the list.
+ * @note The Gap accesses the whitelist where it dispatches events. With
+ *       deferred event dispatch (see BLE::enableDeferredEventDispatch()),
+ *       this is the application context, from which the whitelist can be
+ *       modified and synchronized safely.
+ */
+class VirtualWhitelist {
+public:
+    /**
+     * An entry of the whitelist.
+     */
+    struct Entry_t {
+        BLEProtocol::AddressBytes_t address;    /**< The BLE address. */
+        uint8_t                     type;       /**< The BLE address type, a BLEProtocol::AddressType_t. */
+        uint32_t                    lastActive; /**< Activity stamp of the last accepted report or connection, 0 if none. */
+    };
+
+public:
+    /**
+     * Construct an empty whitelist.
+     *
+     * @param[in] storage
+     *              Storage for the entries.
+     * @param[in] capacityIn
+     *              Number of entries in @p storage.
+     */
+    VirtualWhitelist(Entry_t *storage, uint16_t capacityIn);
+
+    /**
+     * Add an address to the whitelist. If its bytes are already in the
+     * whitelist, the type of the entry is updated.
+     *
+     * @return BLE_ERROR_NONE if the address is in the whitelist;
+     *         BLE_ERROR_NO_MEM if the whitelist is full.
+     */
+    ble_error_t add(const BLEProtocol::Address_t &address);
+
+    /**
+     * Remove an address from the whitelist.
+     *
+     * @return BLE_ERROR_NONE if the address was removed;
+     *         BLE_ERROR_INVALID_PARAM if it is not in the whitelist.
+     */
+    ble_error_t remove(const BLEProtocol::AddressBytes_t address);
+
+    /**
+     * Remove every address.
+     */
+    void clear(void);
+
+    /**
+     * Check whether an address is in the whitelist.
+     */
+    bool contains(const BLEProtocol::AddressBytes_t address) const {
+        return find(address) != NULL;
+    }
+
+    /**
+     * Filter an advertisement report: if the address of the peer is in the
+     * whitelist, mark its entry as active.
+     *
+     * @return true if the report should be passed on.
+     */
+    bool acceptAdvertisement(const BLEProtocol::AddressBytes_t address);
+
+    /**
+     * Filter an incoming connection: if the address of the peer is in the
+     * whitelist, mark its entry as active.
+     *
+     * @return true if the connection should be kept.
+     */
+    bool acceptConnection(const BLEProtocol::AddressBytes_t address);
+
+    /**
+     * Push the most recently active entries to the whitelist of the
+     * controller, if they changed since the last push. Entries with
+     * non-resolvable private addresses are never pushed.
+     *
+     * @param[in] gap
+     *              The Gap which whitelist is updated.
+     *
+     * @return BLE_ERROR_NONE if the whitelist of the controller holds the
+     *         hot set; BLE_ERROR_NOT_IMPLEMENTED if the controller has no
+     *         whitelist; BLE_ERROR_INVALID_STATE if another owner holds it
+     *         (see Gap::claimWhitelist()); otherwise the error of
+     *         Gap::setWhitelist().
+     *
+     * @note The whitelist of the controller remains claimed by this object
+     *       until releaseHardwareWhitelist() is called.
+     * @note Controllers may refuse to change their whitelist while it is used
+     *       by advertising, scanning or initiating.
+     */
+    ble_error_t syncHardwareWhitelist(Gap &gap);
+
+    /**
+     * Release the whitelist of the controller claimed by
+     * syncHardwareWhitelist(), once the filter policies no longer use it.
+     * The next synchronization pushes the hot set again.
+     */
+    void releaseHardwareWhitelist(Gap &gap);
+
+    /**
+     * Get the number of addresses in the whitelist.
+     */
+    uint16_t size(void) const {
+        return count;
+    }
+
+    /**
+     * Get the maximum number of addresses in the whitelist.
+     */
+    uint16_t capacity(void) const {
+        return maxCount;
+    }
+
+    /**
+     * Get the entry at @p index, in the order of the addresses.
+     */
+    const Entry_t &getEntry(uint16_t index) const {
+        return entries[index];
+    }
+
+    /**
+     * Get the number of advertisement reports discarded.
+     */
+    uint32_t getAdvertisementRejectCount(void) const {
+        return advertisementRejectCount;
+    }
+
+    /**
+     * Get the number of incoming connections rejected.
+     */
+    uint32_t getConnectionRejectCount(void) const {
+        return connectionRejectCount;
+    }
+
+    /**
+     * Get the number of times the whitelist of the controller was updated.
+     */
+    uint32_t getHardwareUpdateCount(void) const {
+        return hardwareUpdateCount;
+    }
+
+private:
+    /**
+     * Get the index of the first entry which address is not lower than
+     * @p address.
+     */
+    uint16_t lowerBound(const BLEProtocol::AddressBytes_t address) const;
+
+    const Entry_t *find(const BLEProtocol::AddressBytes_t address) const;
+
+    /**
+     * Mark the entry of @p address as active.
+     *
+     * @return false if @p address is not in the whitelist.
+     */
+    bool markActive(const BLEProtocol::AddressBytes_t address);
+
+private:
+    /* Disallow copy and assignment. */
+    VirtualWhitelist(const VirtualWhitelist &);
+    VirtualWhitelist& operator=(const VirtualWhitelist &);
+
+private:
+    Entry_t                *entries;
+    uint16_t                maxCount;
+    uint16_t                count;
+    uint32_t                activityStamp; /**< Stamp of the last activity, increasing. */
+
+    BLEProtocol::Address_t  hardwareEntries[BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE]; /**< Entries last pushed to the controller. */
+    uint8_t                 hardwareCount;
+    bool                    hardwareValid; /**< Whether hardwareEntries is the whitelist of the controller. */
+
+    uint32_t                advertisementRejectCount;
+    uint32_t                connectionRejectCount;
+    uint32_t                hardwareUpdateCount;
+};
+
+#endif /* ifndef __VIRTUAL_WHITELIST_H__ */
@@ -80,7 +80,9 @@ public:
         handoverCallback = _handoverCallback;
         serviceAdded     = true;
 
-        ble.onDataWritten(this, &DFUService::onDataWritten);
+        if (ble.gattServer().onDataWritten(getControlHandle(), this, &DFUService::onDataWritten) != BLE_ERROR_NONE) {
+            ble.onDataWritten(this, &DFUService::onDataWritten);
+        }
     }
 
     /**
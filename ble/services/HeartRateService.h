@@ -131,7 +131,9 @@ protected:
         GattService         hrmService(GattService::UUID_HEART_RATE_SERVICE, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
 
         ble.addService(hrmService);
-        ble.onDataWritten(this, &HeartRateService::onDataWritten);
+        if (ble.gattServer().onDataWritten(controlPoint.getValueAttribute().getHandle(), this, &HeartRateService::onDataWritten) != BLE_ERROR_NONE) {
+            ble.onDataWritten(this, &HeartRateService::onDataWritten);
+        }
     }
 
 protected:
@@ -56,7 +56,9 @@ public:
         serviceAdded = true;
 
         ble.gap().onDisconnection(this, &LinkLossService::onDisconnectionFilter);
-        ble.gattServer().onDataWritten(this, &LinkLossService::onDataWritten);
+        if (ble.gattServer().onDataWritten(alertLevelChar.getValueHandle(), this, &LinkLossService::onDataWritten) != BLE_ERROR_NONE) {
+            ble.gattServer().onDataWritten(this, &LinkLossService::onDataWritten);
+        }
     }
 
     /**
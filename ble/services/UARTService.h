@@ -28,6 +28,20 @@
 #include "ble/UUID.h"
 #include "ble/BLE.h"
 
+/**
+ * Capacity, in bytes, of the send and receive buffers of the UART service.
+ * Outbound data is pushed in notifications of up to ATT_MTU - 3 bytes; the
+ * default is the largest attribute value carried by a single link layer
+ * PDU. It can be lowered to BLE_GATT_MTU_SIZE_DEFAULT - 3 to save memory if
+ * the peers never negotiate a larger ATT_MTU.
+ */
+#ifndef BLE_UART_SERVICE_BUFFER_SIZE
+#define BLE_UART_SERVICE_BUFFER_SIZE 244
+#endif
+#if (BLE_UART_SERVICE_BUFFER_SIZE < (BLE_GATT_MTU_SIZE_DEFAULT - 3)) || (BLE_UART_SERVICE_BUFFER_SIZE > 512)
+#error "BLE_UART_SERVICE_BUFFER_SIZE must be between BLE_GATT_MTU_SIZE_DEFAULT - 3 and 512"
+#endif
+
 extern const uint8_t  UARTServiceBaseUUID[UUID::LENGTH_OF_LONG_UUID];
 extern const uint16_t UARTServiceShortUUID;
 extern const uint16_t UARTServiceTXCharacteristicShortUUID;
@@ -46,7 +60,7 @@ extern const uint8_t  UARTServiceRXCharacteristicUUID[UUID::LENGTH_OF_LONG_UUID]
 class UARTService {
 public:
     /**< Maximum length of data (in bytes) that the UART service module can transmit to the peer. */
-    static const unsigned BLE_UART_SERVICE_MAX_DATA_LEN = (BLE_GATT_MTU_SIZE_DEFAULT - 3);
+    static const unsigned BLE_UART_SERVICE_MAX_DATA_LEN = BLE_UART_SERVICE_BUFFER_SIZE;
 
 public:
 
@@ -61,6 +75,7 @@ public:
         sendBufferIndex(0),
         numBytesReceived(0),
         receiveBufferIndex(0),
+        maxPayloadLen(BLE_GATT_MTU_SIZE_DEFAULT - 3),
         txCharacteristic(UARTServiceTXCharacteristicUUID, receiveBuffer, 1, BLE_UART_SERVICE_MAX_DATA_LEN,
                          GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE),
         rxCharacteristic(UARTServiceRXCharacteristicUUID, sendBuffer, 1, BLE_UART_SERVICE_MAX_DATA_LEN, GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY) {
@@ -68,7 +83,9 @@ public:
         GattService         uartService(UARTServiceUUID, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
 
         ble.addService(uartService);
-        ble.onDataWritten(this, &UARTService::onDataWritten);
+        if (ble.gattServer().onDataWritten(getTXCharacteristicHandle(), this, &UARTService::onDataWritten) != BLE_ERROR_NONE) {
+            ble.onDataWritten(this, &UARTService::onDataWritten);
+        }
     }
 
     /**
@@ -96,7 +113,9 @@ public:
      * updates. But we shouldn't buffer a large amount of data before updating
      * the characteristic, otherwise the client needs to turn around and make
      * a long read request; this is because notifications include only the first
-     * 20 bytes of the updated data.
+     * ATT_MTU - 3 bytes of the updated data. Data is therefore pushed as soon
+     * as that many bytes are collected, for the subscribed connection with
+     * the smallest ATT_MTU, and at most BLE_UART_SERVICE_MAX_DATA_LEN.
      *
      * @param  buffer The received update.
      * @param  length Number of characters to be appended.
@@ -109,7 +128,11 @@ public:
         if (ble.getGapState().connected) {
             unsigned bufferIndex = 0;
             while (length) {
-                unsigned bytesRemainingInSendBuffer = BLE_UART_SERVICE_MAX_DATA_LEN - sendBufferIndex;
+                if (sendBufferIndex == 0) {
+                    maxPayloadLen = getMaxPayloadLen();
+                }
+
+                unsigned bytesRemainingInSendBuffer = (sendBufferIndex < maxPayloadLen) ? (maxPayloadLen - sendBufferIndex) : 0;
                 unsigned bytesToCopy                = (length < bytesRemainingInSendBuffer) ? length : bytesRemainingInSendBuffer;
 
                 /* Copy bytes into sendBuffer. */
@@ -119,7 +142,7 @@ public:
                 bufferIndex     += bytesToCopy;
 
                 /* Have we collected enough? */
-                if ((sendBufferIndex == BLE_UART_SERVICE_MAX_DATA_LEN) ||
+                if ((sendBufferIndex >= maxPayloadLen) ||
                     // (sendBuffer[sendBufferIndex - 1] == '\r')          ||
                     (sendBuffer[sendBufferIndex - 1] == '\n')) {
                     ble.gattServer().write(getRXCharacteristicHandle(), static_cast<const uint8_t *>(sendBuffer), sendBufferIndex);
@@ -182,6 +205,35 @@ protected:
         }
     }
 
+    /**
+     * Get the number of bytes a notification of the rxCharacteristic carries
+     * in full to every connection subscribed to it: ATT_MTU - 3 of the
+     * subscribed connection with the smallest ATT_MTU, within the buffer
+     * capacity. If the stack cannot tell which connections are subscribed,
+     * every connection is taken into account; if none is, the length for
+     * the default ATT_MTU is used.
+     */
+    uint16_t getMaxPayloadLen(void) {
+        unsigned payloadLen  = BLE_UART_SERVICE_MAX_DATA_LEN;
+        bool     subscribers = false;
+        for (const Gap::ConnectionEntry_t *entry = ble.gap().getNextConnection(NULL);
+             entry != NULL;
+             entry = ble.gap().getNextConnection(entry)) {
+            bool enabled;
+            if ((ble.gattServer().areUpdatesEnabled(entry->handle, rxCharacteristic, &enabled) == BLE_ERROR_NONE) && !enabled) {
+                continue;
+            }
+
+            unsigned connectionPayloadLen = ble.gattServer().getEffectiveMtu(entry->handle) - 3;
+            if (connectionPayloadLen < payloadLen) {
+                payloadLen = connectionPayloadLen;
+            }
+            subscribers = true;
+        }
+
+        return subscribers ? payloadLen : (BLE_GATT_MTU_SIZE_DEFAULT - 3);
+    }
+
 protected:
     BLE                &ble;
 
@@ -192,9 +244,11 @@ protected:
     uint8_t             sendBuffer[BLE_UART_SERVICE_MAX_DATA_LEN];    /**< The local buffer into which outbound data is
                                                                        *   accumulated before being pushed to the
                                                                        *   rxCharacteristic. */
-    uint8_t             sendBufferIndex;
-    uint8_t             numBytesReceived;
-    uint8_t             receiveBufferIndex;
+    uint16_t            sendBufferIndex;
+    uint16_t            numBytesReceived;
+    uint16_t            receiveBufferIndex;
+    uint16_t            maxPayloadLen;    /**< Number of bytes collected before updating the rxCharacteristic,
+                                           *   from getMaxPayloadLen() when the collection started. */
 
     GattCharacteristic  txCharacteristic; /**< From the point of view of the external client, this is the characteristic
                                            *   they'd write into in order to communicate with this application. */
@@ -56,10 +56,13 @@ public:
             uint16_t        compID = 0x004C) :
         ble(_ble), data(uuid, majNum, minNum, txP, compID)
     {
+        // Build the payload with a single update of the stack.
+        Gap::AdvertisingPayloadTransaction transaction(ble.gap());
         // Generate the 0x020106 part of the iBeacon Prefix.
-        ble.accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE );
+        ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE );
         // Generate the 0x1AFF part of the iBeacon Prefix.
-        ble.accumulateAdvertisingPayload(GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA, data.raw, sizeof(data.raw));
+        ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::MANUFACTURER_SPECIFIC_DATA, data.raw, sizeof(data.raw));
+        transaction.commit();
 
         // Set advertising type.
         ble.setAdvertisingType(GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED);
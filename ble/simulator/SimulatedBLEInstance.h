@@ -0,0 +1,132 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_BLE_INSTANCE_H__
+#define __SIMULATED_BLE_INSTANCE_H__
+
+#include "ble/BLE.h"
+#include "ble/BLEInstanceBase.h"
+#include "SimulatedMedium.h"
+#include "SimulatedGap.h"
+#include "SimulatedGattServer.h"
+#include "SimulatedGattClient.h"
+#include "SimulatedSecurityManager.h"
+
+/**
+ * A BLE transport simulated in software on a SimulatedMedium, for hosts
+ * without a radio.
+ *
+ * The simulator is built when BLE_SIMULATOR is defined; it then provides
+ * createBLEInstance(). To simulate several devices in one process, declare
+ * one BLE instance per device in the configuration, each created by a
+ * different createSimulatedBLEInstance():
+ *
+ * @code
+ * -DBLE_SIMULATOR -DYOTTA_CFG_BLE_INSTANCES_COUNT=2
+ * -DYOTTA_CFG_BLE_INSTANCES_0_INITIALIZER=createSimulatedBLEInstance<0>
+ * -DYOTTA_CFG_BLE_INSTANCES_1_INITIALIZER=createSimulatedBLEInstance<1>
+ * @endcode
+ *
+ * waitForEvent() advances the virtual clock to the next event of the
+ * medium; SimulatedMedium::runFor() runs all the devices for a given time.
+ */
+class SimulatedBLEInstance : public BLEInstanceBase {
+public:
+    SimulatedBLEInstance(SimulatedMedium &medium);
+    virtual ~SimulatedBLEInstance(void);
+
+    virtual ble_error_t init(BLE::InstanceID_t instanceID,
+                             FunctionPointerWithContext<BLE::InitializationCompleteCallbackContext *> callback);
+    virtual bool        hasInitialized(void) const {
+        return initialized;
+    }
+    virtual ble_error_t shutdown(void);
+    virtual const char *getVersion(void);
+
+    virtual Gap &getGap() {
+        return gap;
+    }
+    virtual const Gap &getGap() const {
+        return gap;
+    }
+    virtual GattServer &getGattServer() {
+        return gattServer;
+    }
+    virtual const GattServer &getGattServer() const {
+        return gattServer;
+    }
+    virtual GattClient &getGattClient() {
+        return gattClient;
+    }
+    virtual SecurityManager &getSecurityManager() {
+        return securityManager;
+    }
+    virtual const SecurityManager &getSecurityManager() const {
+        return securityManager;
+    }
+
+    virtual void waitForEvent(void);
+    virtual void processEvents(void);
+
+public:
+    /* Accessors used by the medium and by the components of the peers. */
+
+    SimulatedGap &getSimulatedGap(void) {
+        return gap;
+    }
+    SimulatedGattServer &getSimulatedGattServer(void) {
+        return gattServer;
+    }
+    SimulatedGattClient &getSimulatedGattClient(void) {
+        return gattClient;
+    }
+    SimulatedSecurityManager &getSimulatedSecurityManager(void) {
+        return securityManager;
+    }
+    SimulatedMedium &getMedium(void) {
+        return medium;
+    }
+
+    /**
+     * Get the index of the device in its medium, or -1 if the medium was
+     * full when the device was created.
+     */
+    int getIndex(void) const {
+        return index;
+    }
+
+private:
+    SimulatedMedium          &medium;
+    int                       index;
+    bool                      initialized;
+    BLE::InstanceID_t         instanceID;
+    SimulatedGap              gap;
+    SimulatedGattServer       gattServer;
+    SimulatedGattClient       gattClient;
+    SimulatedSecurityManager  securityManager;
+};
+
+/**
+ * Create the simulated device @p Index on the default medium. There is a
+ * single device per index.
+ */
+template <unsigned Index>
+BLEInstanceBase *createSimulatedBLEInstance(void) {
+    static SimulatedBLEInstance instance(SimulatedMedium::getDefault());
+    return &instance;
+}
+
+#endif /* ifndef __SIMULATED_BLE_INSTANCE_H__ */
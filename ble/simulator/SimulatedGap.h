@@ -0,0 +1,207 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_GAP_H__
+#define __SIMULATED_GAP_H__
+
+#include "ble/Gap.h"
+#include "SimulatedMedium.h"
+
+/**
+ * Maximum length of the device name held by a simulated device.
+ */
+#ifndef BLE_SIMULATOR_MAX_DEVICE_NAME_LEN
+#define BLE_SIMULATOR_MAX_DEVICE_NAME_LEN 31
+#endif
+
+/**
+ * Gap of a simulated device.
+ *
+ * Advertising packets are sent at the advertising interval plus a random
+ * delay of up to 10ms, as a controller would. They are received by the
+ * scanning devices whose scan window is open at that time.
+ */
+class SimulatedGap : public Gap {
+public:
+    SimulatedGap(SimulatedMedium &medium, SimulatedBLEInstance &device);
+
+    /* Functions which must be implemented by sub-class. */
+    virtual ble_error_t setAddress(BLEProtocol::AddressType_t type, const BLEProtocol::AddressBytes_t address);
+    virtual ble_error_t getAddress(BLEProtocol::AddressType_t *typeP, BLEProtocol::AddressBytes_t address);
+
+    virtual uint16_t    getMinAdvertisingInterval(void) const;
+    virtual uint16_t    getMinNonConnectableAdvertisingInterval(void) const;
+    virtual uint16_t    getMaxAdvertisingInterval(void) const;
+
+    virtual ble_error_t stopAdvertising(void);
+    virtual ble_error_t stopScan(void);
+
+    virtual ble_error_t connect(const BLEProtocol::AddressBytes_t  peerAddr,
+                                BLEProtocol::AddressType_t         peerAddrType,
+                                const ConnectionParams_t          *connectionParams,
+                                const GapScanningParams           *scanParams);
+    virtual ble_error_t cancelConnect(void);
+    virtual ble_error_t disconnect(Handle_t connectionHandle, DisconnectionReason_t reason);
+    virtual ble_error_t disconnect(DisconnectionReason_t reason);
+
+    virtual ble_error_t getPreferredConnectionParams(ConnectionParams_t *params);
+    virtual ble_error_t setPreferredConnectionParams(const ConnectionParams_t *params);
+    virtual ble_error_t updateConnectionParams(Handle_t handle, const ConnectionParams_t *params);
+
+    virtual ble_error_t setPreferredDataLength(uint16_t maxTxOctets = DATA_LENGTH_MAX);
+    virtual ble_error_t updateDataLength(Handle_t handle, uint16_t maxTxOctets = DATA_LENGTH_MAX);
+    virtual ble_error_t setPreferredPhys(uint8_t txPhys = PHY_1M | PHY_2M, uint8_t rxPhys = PHY_1M | PHY_2M);
+    virtual ble_error_t updatePhy(Handle_t handle, uint8_t txPhys = PHY_2M, uint8_t rxPhys = PHY_2M);
+
+    virtual ble_error_t setDeviceName(const uint8_t *deviceName);
+    virtual ble_error_t getDeviceName(uint8_t *deviceName, unsigned *lengthP);
+    virtual ble_error_t setAppearance(GapAdvertisingData::Appearance appearance);
+    virtual ble_error_t getAppearance(GapAdvertisingData::Appearance *appearanceP);
+
+    virtual ble_error_t setTxPower(int8_t txPower);
+    virtual void        getPermittedTxPowerValues(const int8_t **valueArrayPP, size_t *countP);
+
+    virtual ble_error_t reset(void);
+
+public:
+    /* Entry points for the medium. */
+
+    /**
+     * Receive an advertising packet sent by @p advertiser.
+     *
+     * @return The number of advertisement reports passed to the application.
+     */
+    unsigned receiveAdvertisingPacket(SimulatedBLEInstance                    &advertiser,
+                                      GapAdvertisingParams::AdvertisingType_t  type,
+                                      const uint8_t                           *advertisingData,
+                                      uint8_t                                  advertisingDataLen,
+                                      const uint8_t                           *scanResponse,
+                                      uint8_t                                  scanResponseLen,
+                                      int8_t                                   rssi);
+
+    /**
+     * Check whether this device is waiting for a connection to @p advertiser.
+     */
+    bool isInitiatingTo(SimulatedBLEInstance &advertiser) const;
+
+    /**
+     * Get the parameters requested for the connection being initiated.
+     */
+    const ConnectionParams_t &getInitiationParams(void) const {
+        return initiationParams;
+    }
+
+    /**
+     * Report a new connection in @p role on @p link.
+     */
+    void onLinkEstablished(const SimulatedMedium::Link &link, Role_t role);
+
+    /**
+     * Report new connection parameters on @p link.
+     */
+    void onLinkParamsUpdated(const SimulatedMedium::Link &link);
+
+    /**
+     * Report new link layer payload sizes on @p link.
+     */
+    void onLinkDataLengthUpdated(const SimulatedMedium::Link &link);
+
+    /**
+     * Report the completion of a PHY update on @p link.
+     */
+    void onLinkPhyUpdated(const SimulatedMedium::Link &link);
+
+    /**
+     * Get the link layer payload size suggested for new connections.
+     */
+    uint16_t getPreferredDataLength(void) const {
+        return preferredTxOctets;
+    }
+
+    /**
+     * Get the set of PHYs accepted in both directions. Links use the same
+     * PHY in both directions.
+     */
+    uint8_t getPreferredPhys(void) const {
+        return preferredTxPhys & preferredRxPhys;
+    }
+
+    /**
+     * Report the termination of the connection @p handle.
+     */
+    void onLinkTerminated(Handle_t handle, DisconnectionReason_t reason);
+
+    int8_t getTxPower(void) const {
+        return txPower;
+    }
+
+    const uint8_t *getOwnAddress(void) const {
+        return address;
+    }
+
+    BLEProtocol::AddressType_t getOwnAddressType(void) const {
+        return addressType;
+    }
+
+protected:
+    virtual ble_error_t startRadioScan(const GapScanningParams &scanningParams);
+
+private:
+    virtual ble_error_t setAdvertisingData(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse);
+    virtual ble_error_t startAdvertising(const GapAdvertisingParams &params);
+
+    void onAdvertisingTimer(SimulatedMedium::Timer *timer);
+    void onAdvertisingTimeout(SimulatedMedium::Timer *timer);
+    void onScanTimeout(SimulatedMedium::Timer *timer);
+    void onConnectionTimeout(SimulatedMedium::Timer *timer);
+    bool isScanWindowOpen(void) const;
+
+private:
+    SimulatedMedium                &medium;
+    SimulatedBLEInstance           &device;
+
+    BLEProtocol::AddressType_t      addressType;
+    BLEProtocol::AddressBytes_t     address;
+
+    GapAdvertisingParams            advertisingParams;
+    GapAdvertisingData              advertisingData;
+    GapAdvertisingData              scanResponseData;
+    SimulatedMedium::Timer          advertisingTimer;
+    SimulatedMedium::Timer          advertisingTimeoutTimer;
+
+    bool                            scanning;
+    bool                            activeScanning;
+    SimulatedMedium::Time_t         scanStart;
+    SimulatedMedium::Time_t         scanInterval;
+    SimulatedMedium::Time_t         scanWindow;
+    SimulatedMedium::Timer          scanTimeoutTimer;
+
+    bool                            initiating;
+    BLEProtocol::AddressBytes_t     initiationPeerAddress;
+    ConnectionParams_t              initiationParams;
+    SimulatedMedium::Timer          connectionTimeoutTimer;
+
+    ConnectionParams_t              preferredConnectionParams;
+    uint16_t                        preferredTxOctets;
+    uint8_t                         preferredTxPhys;
+    uint8_t                         preferredRxPhys;
+    uint8_t                         deviceName[BLE_SIMULATOR_MAX_DEVICE_NAME_LEN];
+    unsigned                        deviceNameLength;
+    GapAdvertisingData::Appearance  appearance;
+    int8_t                          txPower;
+};
+
+#endif /* ifndef __SIMULATED_GAP_H__ */
@@ -0,0 +1,117 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_GATT_CLIENT_H__
+#define __SIMULATED_GATT_CLIENT_H__
+
+#include "ble/GattClient.h"
+#include "ble/DiscoveredService.h"
+#include "ble/DiscoveredCharacteristic.h"
+#include "SimulatedMedium.h"
+
+/**
+ * DiscoveredCharacteristic filled from the ATT table of a simulated peer.
+ */
+class SimulatedDiscoveredCharacteristic : public DiscoveredCharacteristic {
+public:
+    void setup(GattClient              *gattcIn,
+               Gap::Handle_t            connectionHandleIn,
+               const UUID              &uuidIn,
+               uint8_t                  propertiesIn,
+               GattAttribute::Handle_t  declHandleIn,
+               GattAttribute::Handle_t  valueHandleIn,
+               GattAttribute::Handle_t  lastHandleIn);
+};
+
+/**
+ * GattClient of a simulated device.
+ *
+ * Requests are queued on the link of the connection and answered by the
+ * GattServer of the peer; the responses are reported at the connection
+ * event following the one which carried the request. Service discovery
+ * reports one service, with its characteristics, per connection event.
+ */
+class SimulatedGattClient : public GattClient {
+public:
+    SimulatedGattClient(SimulatedMedium &medium, SimulatedBLEInstance &device);
+
+    virtual ble_error_t launchServiceDiscovery(Gap::Handle_t                               connectionHandle,
+                                               ServiceDiscovery::ServiceCallback_t         sc                           = NULL,
+                                               ServiceDiscovery::CharacteristicCallback_t  cc                           = NULL,
+                                               const UUID                                 &matchingServiceUUID          = UUID::ShortUUIDBytes_t(BLE_UUID_UNKNOWN),
+                                               const UUID                                 &matchingCharacteristicUUIDIn = UUID::ShortUUIDBytes_t(BLE_UUID_UNKNOWN));
+
+    virtual void onServiceDiscoveryTermination(ServiceDiscovery::TerminationCallback_t callback) {
+        terminationCallback = callback;
+    }
+
+    virtual bool isServiceDiscoveryActive(void) const {
+        return discoveryActive;
+    }
+
+    virtual void terminateServiceDiscovery(void);
+
+    virtual ble_error_t read(Gap::Handle_t connHandle, GattAttribute::Handle_t attributeHandle, uint16_t offset) const;
+
+    virtual ble_error_t write(GattClient::WriteOp_t    cmd,
+                              Gap::Handle_t            connHandle,
+                              GattAttribute::Handle_t  attributeHandle,
+                              size_t                   length,
+                              const uint8_t           *value) const;
+
+    virtual ble_error_t negotiateAttMtu(Gap::Handle_t connHandle);
+
+    virtual uint16_t getEffectiveMtu(Gap::Handle_t connHandle) const;
+
+    virtual ble_error_t reset(void);
+
+public:
+    /* Entry points for the medium. */
+
+    /**
+     * Handle a response or an update received on @p link.
+     */
+    void onPduReceived(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu);
+
+    /**
+     * Make progress on the procedures running on @p link at the start of
+     * each of its connection events.
+     */
+    void onConnectionEvent(SimulatedMedium::Link &link);
+
+    /**
+     * Abort the procedures running on the connection @p handle.
+     */
+    void onLinkTerminated(Gap::Handle_t handle);
+
+private:
+    void endServiceDiscovery(void);
+
+private:
+    SimulatedMedium                          &medium;
+    SimulatedBLEInstance                     &device;
+
+    bool                                      discoveryActive;
+    Gap::Handle_t                             discoveryConnectionHandle;
+    GattAttribute::Handle_t                   discoveryNextHandle;
+    ServiceDiscovery::ServiceCallback_t       serviceCallback;
+    ServiceDiscovery::CharacteristicCallback_t characteristicCallback;
+    UUID                                      matchingServiceUUID;
+    UUID                                      matchingCharacteristicUUID;
+    ServiceDiscovery::TerminationCallback_t   terminationCallback;
+};
+
+#endif /* ifndef __SIMULATED_GATT_CLIENT_H__ */
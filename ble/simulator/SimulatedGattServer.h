@@ -0,0 +1,155 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_GATT_SERVER_H__
+#define __SIMULATED_GATT_SERVER_H__
+
+#include "ble/GattServer.h"
+#include "SimulatedMedium.h"
+
+/**
+ * Maximum number of attributes in the ATT table of a simulated device.
+ */
+#ifndef BLE_SIMULATOR_MAX_ATTRIBUTES
+#define BLE_SIMULATOR_MAX_ATTRIBUTES 64
+#endif
+
+/**
+ * Bytes reserved for the values of the attributes of a simulated device.
+ */
+#ifndef BLE_SIMULATOR_ATTRIBUTE_STORAGE_SIZE
+#define BLE_SIMULATOR_ATTRIBUTE_STORAGE_SIZE 2048
+#endif
+
+/**
+ * GattServer of a simulated device.
+ *
+ * addService() lays the services out in an ATT table with sequential
+ * handles: the service declaration, then for each characteristic its
+ * declaration, its value, a client characteristic configuration descriptor
+ * if it can be notified or indicated, and its descriptors. As in a real
+ * stack, attribute values are copied in storage owned by the server.
+ */
+class SimulatedGattServer : public GattServer {
+public:
+    /**
+     * Kind of an entry of the ATT table.
+     */
+    enum AttributeKind_t {
+        SERVICE_DECLARATION,
+        CHARACTERISTIC_DECLARATION,
+        CHARACTERISTIC_VALUE,
+        CCCD,
+        DESCRIPTOR
+    };
+
+    /**
+     * Entry of the ATT table.
+     */
+    struct Attribute {
+        uint8_t              kind;           /**< One of AttributeKind_t. */
+        GattService         *service;
+        GattCharacteristic  *characteristic; /**< NULL for service declarations. */
+        GattAttribute       *attribute;      /**< Value or descriptor attribute, if any. */
+        uint16_t             valueOffset;    /**< Offset of the value in the storage. */
+        uint16_t             length;
+        uint16_t             maxLength;
+        uint16_t             notifyMask;     /**< CCCDs: links which enabled notifications. */
+        uint16_t             indicateMask;   /**< CCCDs: links which enabled indications. */
+        GattAttribute::Handle_t cccdHandle;  /**< Characteristic values: handle of their CCCD. */
+    };
+
+public:
+    SimulatedGattServer(SimulatedMedium &medium, SimulatedBLEInstance &device);
+
+    /* Functions that must be implemented from GattServer */
+    virtual ble_error_t addService(GattService &service);
+
+    virtual ble_error_t read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP);
+    virtual ble_error_t read(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP);
+    virtual ble_error_t write(GattAttribute::Handle_t, const uint8_t[], uint16_t, bool localOnly = false);
+    virtual ble_error_t write(Gap::Handle_t connectionHandle, GattAttribute::Handle_t, const uint8_t[], uint16_t, bool localOnly = false);
+
+    virtual ble_error_t areUpdatesEnabled(const GattCharacteristic &characteristic, bool *enabledP);
+    virtual ble_error_t areUpdatesEnabled(Gap::Handle_t connectionHandle, const GattCharacteristic &characteristic, bool *enabledP);
+
+    virtual bool isOnDataReadAvailable() const {
+        return true;
+    }
+
+    virtual uint16_t getEffectiveMtu(Gap::Handle_t connectionHandle) const;
+
+    virtual ble_error_t reset(void);
+
+public:
+    /* Entry points for the medium and the GattClient of the peers. */
+
+    /**
+     * Get the entry of the ATT table for @p handle.
+     *
+     * @return NULL if there is no such attribute.
+     */
+    const Attribute *getAttribute(GattAttribute::Handle_t handle) const {
+        if ((handle == GattAttribute::INVALID_HANDLE) || (handle > attributeCount)) {
+            return NULL;
+        }
+        return &attributes[handle - 1];
+    }
+
+    /**
+     * Get the number of entries of the ATT table; handles go from 1 to this
+     * value.
+     */
+    uint16_t getAttributeCount(void) const {
+        return attributeCount;
+    }
+
+    /**
+     * Handle a request, command or confirmation received on @p link.
+     */
+    void onPduReceived(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu);
+
+    /**
+     * Account for a notification delivered on @p link.
+     */
+    void onPduDelivered(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu);
+
+    /**
+     * Forget the configuration written by the client of the connection
+     * @p handle.
+     */
+    void onLinkTerminated(Gap::Handle_t handle);
+
+private:
+    Attribute *getAttribute(GattAttribute::Handle_t handle) {
+        return const_cast<Attribute *>(static_cast<const SimulatedGattServer *>(this)->getAttribute(handle));
+    }
+
+    Attribute *addAttribute(uint8_t kind, GattService &service, GattCharacteristic *characteristic, GattAttribute *attribute);
+    bool updateValue(Attribute &attribute, uint16_t offset, const uint8_t *value, uint16_t length);
+    ble_error_t sendUpdate(SimulatedMedium::Link &link, const Attribute &value, bool indicate);
+    void sendError(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &request, uint16_t errorCode);
+
+private:
+    SimulatedMedium      &medium;
+    SimulatedBLEInstance &device;
+    Attribute             attributes[BLE_SIMULATOR_MAX_ATTRIBUTES];
+    uint16_t              attributeCount;
+    uint8_t               storage[BLE_SIMULATOR_ATTRIBUTE_STORAGE_SIZE];
+    uint16_t              storageUsed;
+};
+
+#endif /* ifndef __SIMULATED_GATT_SERVER_H__ */
@@ -0,0 +1,436 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_MEDIUM_H__
+#define __SIMULATED_MEDIUM_H__
+
+#include <stdint.h>
+#include "ble/Gap.h"
+#include "ble/FunctionPointerWithContext.h"
+
+/**
+ * Maximum number of simulated devices sharing a medium.
+ */
+#ifndef BLE_SIMULATOR_MAX_DEVICES
+#define BLE_SIMULATOR_MAX_DEVICES 8
+#endif
+
+/**
+ * Maximum number of simultaneous connections in a medium. Connection handles
+ * are indices in the link table, so this can't exceed 16.
+ */
+#ifndef BLE_SIMULATOR_MAX_LINKS
+#define BLE_SIMULATOR_MAX_LINKS 8
+#endif
+
+/**
+ * Number of PDUs which can be queued in each direction of a connection.
+ */
+#ifndef BLE_SIMULATOR_LINK_QUEUE_SIZE
+#define BLE_SIMULATOR_LINK_QUEUE_SIZE 8
+#endif
+
+/**
+ * Maximum number of packet exchanges in a connection event, the limit imposed
+ * by most controllers regardless of the connection interval.
+ */
+#ifndef BLE_SIMULATOR_MAX_PACKETS_PER_EVENT
+#define BLE_SIMULATOR_MAX_PACKETS_PER_EVENT 6
+#endif
+
+/**
+ * Largest ATT PDU payload carried by the simulated links.
+ */
+#ifndef BLE_SIMULATOR_MAX_PDU_DATA_LEN
+#define BLE_SIMULATOR_MAX_PDU_DATA_LEN 251
+#endif
+
+/**
+ * Largest ATT_MTU the simulated devices accept in an MTU exchange. Read
+ * responses carry up to ATT_MTU - 1 bytes of the value, which must fit in a
+ * PDU.
+ */
+#ifndef BLE_SIMULATOR_MAX_ATT_MTU
+#define BLE_SIMULATOR_MAX_ATT_MTU 247
+#endif
+#if (BLE_SIMULATOR_MAX_ATT_MTU < BLE_GATT_MTU_SIZE_DEFAULT) || (BLE_SIMULATOR_MAX_ATT_MTU > (BLE_SIMULATOR_MAX_PDU_DATA_LEN + 1))
+#error "BLE_SIMULATOR_MAX_ATT_MTU must be between BLE_GATT_MTU_SIZE_DEFAULT and BLE_SIMULATOR_MAX_PDU_DATA_LEN + 1"
+#endif
+
+/**
+ * Default attenuation, in dB, between the transmit power of a device and the
+ * RSSI measured by its peers.
+ */
+#ifndef BLE_SIMULATOR_DEFAULT_PATH_LOSS
+#define BLE_SIMULATOR_DEFAULT_PATH_LOSS 50
+#endif
+
+class SimulatedBLEInstance;
+
+/**
+ * The radio medium shared by simulated devices.
+ *
+ * The medium owns a virtual clock, in microseconds, and a list of timers
+ * armed by the simulated devices. Time only moves when the medium is run:
+ * step() advances the clock to the earliest timer and runs it; every event
+ * reported to the application is therefore reported from within step(),
+ * runFor() or runUntil().
+ *
+ * Advertising packets are delivered to every other device of the medium
+ * which is scanning at the time they are sent. Connections are modelled as
+ * links carrying ATT PDUs, exchanged at each connection event within the
+ * limits of the connection interval and of the airtime of the packets.
+ *
+ * @code
+ * SimulatedMedium &medium = SimulatedMedium::getDefault();
+ *
+ * BLE::Instance(0).init(onPeripheralInit);
+ * BLE::Instance(1).init(onCentralInit);
+ *
+ * medium.runFor(10 * SimulatedMedium::ONE_SECOND);
+ * @endcode
+ */
+class SimulatedMedium {
+public:
+    /**
+     * Type of the time points and durations of the virtual clock, in
+     * microseconds.
+     */
+    typedef uint64_t Time_t;
+
+    static const Time_t ONE_MILLISECOND = 1000;
+    static const Time_t ONE_SECOND      = 1000000;
+
+    /**
+     * Inter frame space, in microseconds.
+     */
+    static const Time_t T_IFS = 150;
+
+    /**
+     * A timer of the virtual clock. The handler is invoked with the timer as
+     * context when the clock reaches its deadline.
+     */
+    struct Timer {
+        Timer() : deadline(0), next(NULL), armed(false), handler() {
+            /* empty */
+        }
+
+        Time_t                         deadline;
+        Timer                         *next;
+        bool                           armed;
+        FunctionPointerWithContext<Timer *> handler;
+
+    private:
+        /* Disallow copy and assignment. */
+        Timer(const Timer &);
+        Timer& operator=(const Timer &);
+    };
+
+    /**
+     * An ATT or link layer PDU queued on a link.
+     */
+    struct Pdu {
+        enum Type_t {
+            ATT_ERROR_RSP,
+            ATT_READ_REQ,
+            ATT_READ_RSP,
+            ATT_WRITE_REQ,
+            ATT_WRITE_CMD,
+            ATT_WRITE_RSP,
+            ATT_HANDLE_VALUE_NTF,
+            ATT_HANDLE_VALUE_IND,
+            ATT_HANDLE_VALUE_CFM,
+            ATT_EXCHANGE_MTU_REQ,
+            ATT_EXCHANGE_MTU_RSP
+        };
+
+        uint8_t  type;            /**< One of Type_t. */
+        uint16_t attributeHandle;
+        uint16_t offset;
+        uint16_t errorCode;       /**< For ATT_ERROR_RSP. */
+        uint16_t mtu;             /**< For the MTU exchange: Rx MTU of the sender. */
+        uint16_t length;
+        uint8_t  data[BLE_SIMULATOR_MAX_PDU_DATA_LEN];
+    };
+
+    /**
+     * A connection between two devices.
+     */
+    struct Link {
+        enum {
+            FROM_CENTRAL    = 0,
+            FROM_PERIPHERAL = 1
+        };
+
+        /**
+         * A ring of PDUs sent in one direction.
+         */
+        struct Queue {
+            Pdu      pdus[BLE_SIMULATOR_LINK_QUEUE_SIZE];
+            unsigned head;
+            unsigned count;
+            uint8_t  fragmentsSent; /**< Link layer fragments of the head PDU already sent. */
+        };
+
+        bool                     inUse;
+        Gap::Handle_t            handle;
+        SimulatedBLEInstance    *central;
+        SimulatedBLEInstance    *peripheral;
+        Gap::ConnectionParams_t  params;
+        Timer                    eventTimer;
+        Time_t                   anchor;           /**< Start of the current connection event. */
+        unsigned                 exchangesInEvent; /**< Packet exchanges done in the current event. */
+        bool                     terminating;
+        uint8_t                  terminatingSide;  /**< FROM_CENTRAL or FROM_PERIPHERAL. */
+        uint8_t                  terminationReason;
+        bool                     encrypted;
+        bool                     encryptionPending;
+        uint8_t                  securityMode;
+        bool                     requestPending[2]; /**< A client request is waiting for its response. */
+        bool                     indicationPending[2];
+        uint16_t                 attMtu;
+        bool                     mtuExchanged;     /**< The MTU exchange can only be run once. */
+        uint16_t                 maxTxOctets;      /**< Link layer payload size, the same in both directions. */
+        uint8_t                  phy;              /**< Gap::Phy_t, the same in both directions. */
+        bool                     dataLengthPending; /**< A data length update completes at the next connection event. */
+        uint16_t                 pendingTxOctets;
+        bool                     phyPending;       /**< A PHY update completes at the next connection event. */
+        uint8_t                  pendingPhy;
+        Queue                    queues[2];
+        uint32_t                 eventCount;
+    };
+
+    /**
+     * Counters accumulated since the medium was created.
+     */
+    struct Statistics_t {
+        uint32_t advertisingPackets;
+        uint32_t advertisingReports;
+        uint32_t connectionEvents;
+        uint32_t pdusDelivered;
+        uint32_t pduBytesDelivered;
+        uint32_t timersRun;
+    };
+
+public:
+    SimulatedMedium();
+
+    /**
+     * Get the medium used by the instances returned by
+     * createSimulatedBLEInstance().
+     */
+    static SimulatedMedium &getDefault(void);
+
+    /**
+     * Get the current time of the virtual clock.
+     */
+    Time_t getTime(void) const {
+        return now;
+    }
+
+    /**
+     * Advance the virtual clock to the earliest armed timer and run it.
+     *
+     * @return false if no timer is armed; the clock doesn't move then.
+     */
+    bool step(void);
+
+    /**
+     * Run all the timers due before @p deadline, then advance the clock to
+     * @p deadline.
+     */
+    void runUntil(Time_t deadline);
+
+    /**
+     * Run the medium for @p duration microseconds.
+     */
+    void runFor(Time_t duration) {
+        runUntil(now + duration);
+    }
+
+    /**
+     * Arm @p timer to expire @p delay microseconds from now. A timer already
+     * armed is rescheduled.
+     */
+    void arm(Timer &timer, Time_t delay) {
+        armAt(timer, now + delay);
+    }
+
+    /**
+     * Arm @p timer to expire at @p deadline. A timer already armed is
+     * rescheduled.
+     */
+    void armAt(Timer &timer, Time_t deadline);
+
+    /**
+     * Disarm @p timer if it is armed.
+     */
+    void disarm(Timer &timer);
+
+    /**
+     * Set the attenuation, in dB, between the transmit power of a device and
+     * the RSSI measured by its peers, and the amplitude of the random
+     * variation added to each measure.
+     */
+    void setPathLoss(uint8_t pathLossIn, uint8_t rssiJitterIn = 0) {
+        pathLoss   = pathLossIn;
+        rssiJitter = rssiJitterIn;
+    }
+
+    /**
+     * Seed the pseudo random generator used for advertising delays and RSSI
+     * variations. Runs with the same seed are reproducible.
+     */
+    void setSeed(uint32_t seed) {
+        randomState = seed ? seed : 1;
+    }
+
+    /**
+     * Get a pseudo random number in [0, range).
+     */
+    uint32_t random(uint32_t range);
+
+    /**
+     * Get the counters of the medium.
+     */
+    const Statistics_t &getStatistics(void) const {
+        return statistics;
+    }
+
+public:
+    /* Entry points for the simulated devices. */
+
+    /**
+     * Register a device; its index in the medium determines its default
+     * address.
+     *
+     * @return The index of the device or -1 if the medium is full.
+     */
+    int registerDevice(SimulatedBLEInstance *device);
+
+    /**
+     * Deliver an advertising packet from @p advertiser to the scanning
+     * devices, and to the device initiating a connection to it.
+     */
+    void broadcastAdvertisingPacket(SimulatedBLEInstance                    &advertiser,
+                                    GapAdvertisingParams::AdvertisingType_t  type,
+                                    const uint8_t                           *advertisingData,
+                                    uint8_t                                  advertisingDataLen,
+                                    const uint8_t                           *scanResponse,
+                                    uint8_t                                  scanResponseLen,
+                                    int8_t                                   txPower);
+
+    /**
+     * Get the link identified by @p handle.
+     *
+     * @return NULL if there is no such connection.
+     */
+    Link *getLink(Gap::Handle_t handle);
+
+    /**
+     * Get the peer of @p device on @p link.
+     */
+    static SimulatedBLEInstance *getPeer(const Link &link, const SimulatedBLEInstance *device) {
+        return (link.central == device) ? link.peripheral : link.central;
+    }
+
+    /**
+     * Get the direction in which @p device sends on @p link:
+     * Link::FROM_CENTRAL or Link::FROM_PERIPHERAL.
+     */
+    static unsigned getSide(const Link &link, const SimulatedBLEInstance *device) {
+        return (link.central == device) ? (unsigned)Link::FROM_CENTRAL : (unsigned)Link::FROM_PERIPHERAL;
+    }
+
+    /**
+     * Queue @p pdu on @p link, from @p sender to its peer. It is delivered at
+     * a following connection event.
+     *
+     * @return false if the queue of the sender is full.
+     */
+    bool send(Link &link, const SimulatedBLEInstance *sender, const Pdu &pdu);
+
+    /**
+     * Get the number of PDUs @p sender can still queue on @p link.
+     */
+    unsigned getFreeQueueSlots(const Link &link, const SimulatedBLEInstance *sender) const;
+
+    /**
+     * Request the termination of @p link by @p device. Both sides are
+     * notified at the next connection event.
+     */
+    void terminate(Link &link, const SimulatedBLEInstance *device, Gap::DisconnectionReason_t reason);
+
+    /**
+     * Drop all the links of @p device without notifying it; its peers are
+     * notified of a connection timeout.
+     */
+    void dropLinks(const SimulatedBLEInstance *device);
+
+    /**
+     * Get the time needed to transmit @p octets of link layer payload on
+     * @p link, packet overhead included.
+     */
+    static Time_t getAirTime(const Link &link, uint16_t octets) {
+        /* Preamble, access address, header and CRC. */
+        static const uint16_t LL_PACKET_OVERHEAD = 10;
+        /* Microseconds per octet; the coded PHY is modelled with S=8. */
+        Time_t octetTime = (link.phy == Gap::PHY_2M) ? 4 : ((link.phy == Gap::PHY_CODED) ? 64 : 8);
+        return (Time_t)(octets + LL_PACKET_OVERHEAD) * octetTime;
+    }
+
+    /**
+     * Pick the PHY of a link among the set @p phys acceptable to both
+     * devices: the fastest one.
+     *
+     * @return The PHY, or 0 if @p phys is empty.
+     */
+    static uint8_t selectPhy(uint8_t phys) {
+        if (phys & Gap::PHY_2M) {
+            return Gap::PHY_2M;
+        }
+        if (phys & Gap::PHY_1M) {
+            return Gap::PHY_1M;
+        }
+        return phys & Gap::PHY_CODED;
+    }
+
+private:
+    void establishLink(SimulatedBLEInstance &central, SimulatedBLEInstance &peripheral);
+    void onConnectionEvent(Timer *timer);
+    void closeLink(Link &link, unsigned initiatingSide, uint8_t reason);
+    Time_t exchange(Link &link);
+    void deliver(Link &link, unsigned side, const Pdu &pdu);
+    static uint16_t getLinkLayerLength(const Pdu &pdu);
+
+private:
+    Time_t                 now;
+    Timer                 *timers;
+    SimulatedBLEInstance  *devices[BLE_SIMULATOR_MAX_DEVICES];
+    unsigned               deviceCount;
+    Link                   links[BLE_SIMULATOR_MAX_LINKS];
+    uint8_t                pathLoss;
+    uint8_t                rssiJitter;
+    uint32_t               randomState;
+    Statistics_t           statistics;
+
+private:
+    /* Disallow copy and assignment. */
+    SimulatedMedium(const SimulatedMedium &);
+    SimulatedMedium& operator=(const SimulatedMedium &);
+};
+
+#endif /* ifndef __SIMULATED_MEDIUM_H__ */
@@ -0,0 +1,38 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_PLATFORM_H__
+#define __SIMULATED_PLATFORM_H__
+
+/*
+ * Replacements for the mbed platform facilities used by BLE API, for hosts
+ * running the simulator without mbed.
+ */
+
+#ifndef MBED_WEAK
+#if defined(__GNUC__) || defined(__clang__)
+#define MBED_WEAK __attribute__((weak))
+#else
+#define MBED_WEAK
+#endif
+#endif
+
+/**
+ * Report a fatal error and terminate the process, like the mbed error().
+ */
+void error(const char *format, ...);
+
+#endif /* ifndef __SIMULATED_PLATFORM_H__ */
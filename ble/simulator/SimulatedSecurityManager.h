@@ -0,0 +1,61 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SIMULATED_SECURITY_MANAGER_H__
+#define __SIMULATED_SECURITY_MANAGER_H__
+
+#include "ble/SecurityManager.h"
+#include "SimulatedMedium.h"
+
+/**
+ * SecurityManager of a simulated device.
+ *
+ * No key is exchanged: a security procedure requested on a link completes
+ * successfully at its next connection event, on both sides.
+ */
+class SimulatedSecurityManager : public SecurityManager {
+public:
+    SimulatedSecurityManager(SimulatedMedium &medium, SimulatedBLEInstance &device);
+
+    virtual ble_error_t init(bool                     enableBonding = true,
+                             bool                     requireMITM   = true,
+                             SecurityIOCapabilities_t iocaps        = IO_CAPS_NONE,
+                             const Passkey_t          passkey       = NULL);
+
+    virtual ble_error_t getLinkSecurity(Gap::Handle_t connectionHandle, LinkSecurityStatus_t *securityStatusP);
+    virtual ble_error_t setLinkSecurity(Gap::Handle_t connectionHandle, SecurityMode_t securityMode);
+    virtual ble_error_t purgeAllBondingState(void);
+
+    virtual ble_error_t reset(void);
+
+public:
+    /* Entry points for the medium. */
+
+    /**
+     * Report the completion of the security procedure requested on @p link.
+     */
+    void onLinkSecured(const SimulatedMedium::Link &link);
+
+private:
+    SimulatedMedium          &medium;
+    SimulatedBLEInstance     &device;
+    bool                      initialized;
+    bool                      bondingEnabled;
+    bool                      mitmRequired;
+    SecurityIOCapabilities_t  ioCapabilities;
+};
+
+#endif /* ifndef __SIMULATED_SECURITY_MANAGER_H__ */
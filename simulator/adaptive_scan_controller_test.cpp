@@ -0,0 +1,79 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AdaptiveScanController against a FakeGap: the scan slows down one level
+ * per quiet evaluation period, and returns to the fast settings on a burst
+ * of discoveries; the radio scan is only restarted when the settings
+ * change.
+ */
+
+#include "fake_gap.h"
+#include "ble/AdaptiveScanController.h"
+
+static void onAdvertisementReport(const Gap::AdvertisementCallbackParams_t *params)
+{
+    (void)params;
+}
+
+static bool isScanning(const FakeGap &gap, uint16_t interval, uint16_t window)
+{
+    return (gap.lastScanInterval == GapScanningParams::MSEC_TO_SCAN_DURATION_UNITS(interval)) &&
+           (gap.lastScanWindow   == GapScanningParams::MSEC_TO_SCAN_DURATION_UNITS(window));
+}
+
+int main(void)
+{
+    FakeGap gap;
+    gap.setScanParams(100, 100);
+    CHECK(gap.startScan(onAdvertisementReport) == BLE_ERROR_NONE);
+    CHECK(gap.scanStartCount == 1);
+
+    /* Four levels: 100/100, 400/84, 700/67 and 1000/50 ms. */
+    AdaptiveScanController controller(gap, 100, 100, 1000, 50, 5000, 2);
+    CHECK(controller.start(0) == BLE_ERROR_NONE);
+    CHECK((controller.getLevel() == 0) && (gap.scanStartCount == 1));
+
+    /* Quiet periods: one level slower each. */
+    CHECK(controller.process(4000) == 1000);
+    CHECK(controller.process(5000) == 5000);
+    CHECK((controller.getLevel() == 1) && (gap.scanStartCount == 2) && isScanning(gap, 400, 84));
+    controller.process(10000);
+    controller.process(15000);
+    CHECK((controller.getLevel() == 3) && (gap.scanStartCount == 4) && isScanning(gap, 1000, 50));
+    controller.process(20000);
+    CHECK((controller.getLevel() == 3) && (gap.scanStartCount == 4));
+
+    /* Fewer discoveries than the threshold: the settings are kept. */
+    controller.recordNewDevice();
+    controller.process(25000);
+    CHECK((controller.getLevel() == 3) && (gap.scanStartCount == 4));
+
+    /* A burst: back to the fast settings at once. */
+    controller.recordNewDevice();
+    controller.recordNewDevice();
+    controller.process(30000);
+    CHECK((controller.getLevel() == 0) && (gap.scanStartCount == 5) && isScanning(gap, 100, 100));
+    CHECK(controller.getUpdateCount() == 4);
+
+    /* Out of range settings are refused and leave the scan alone. */
+    CHECK(gap.updateScanParams(50, 100) == BLE_ERROR_PARAM_OUT_OF_RANGE);
+    CHECK(gap.updateScanParams(100, 100) == BLE_ERROR_NONE);
+    CHECK(gap.scanStartCount == 5);
+
+    printf("adaptive scan controller test passed\n");
+    return 0;
+}
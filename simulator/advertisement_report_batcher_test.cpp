@@ -0,0 +1,112 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AdvertisementReportBatcher: delivery of a batch when it holds its maximum
+ * number of reports, when the arena can't hold the next payload, and when
+ * its oldest report reaches the maximum latency.
+ */
+
+#include "fake_gap.h"
+#include "ble/AdvertisementReportBatcher.h"
+
+typedef AdvertisementReportBatcher<4, 64> Batcher;
+
+static uint32_t currentTime;
+static unsigned batchCount;
+static unsigned lastBatchSize;
+static bool     payloadsIntact;
+
+static uint32_t clock(void)
+{
+    return currentTime;
+}
+
+/* Every report carries its sequence number as peer address and payload. */
+static void onBatch(const Batcher::Batch_t *batch)
+{
+    ++batchCount;
+    lastBatchSize = batch->count;
+    for (unsigned i = 0; i < batch->count; ++i) {
+        const Gap::AdvertisementCallbackParams_t &report = batch->reports[i];
+        for (unsigned j = 0; j < report.advertisingDataLen; ++j) {
+            payloadsIntact = payloadsIntact && (report.advertisingData[j] == report.peerAddr[0]);
+        }
+    }
+}
+
+static void report(Batcher &batcher, uint8_t sequence, uint8_t length)
+{
+    uint8_t                            data[64];
+    Gap::AdvertisementCallbackParams_t params;
+    memset(&params, 0, sizeof(params));
+    memset(data, sequence, sizeof(data));
+    FakeGap::makeAddress(sequence, params.peerAddr);
+    params.advertisingData    = data;
+    params.advertisingDataLen = length;
+    batcher.processReport(&params);
+}
+
+int main(void)
+{
+    Batcher batcher(100, clock);
+    batcher.onBatch(onBatch);
+    payloadsIntact = true;
+
+    /* Full on count. */
+    for (uint8_t i = 0; i < 4; ++i) {
+        report(batcher, i, 10);
+    }
+    CHECK((batchCount == 1) && (lastBatchSize == 4) && (batcher.getPendingCount() == 0));
+
+    /* The arena can't hold the third payload: the first two are delivered. */
+    report(batcher, 4, 31);
+    report(batcher, 5, 31);
+    CHECK(batchCount == 1);
+    report(batcher, 6, 31);
+    CHECK((batchCount == 2) && (lastBatchSize == 2) && (batcher.getPendingCount() == 1));
+
+    /* The latency of the oldest report expires on the next report. */
+    currentTime = 60;
+    report(batcher, 7, 1);
+    CHECK(batchCount == 2);
+    currentTime = 100;
+    report(batcher, 8, 1);
+    CHECK((batchCount == 3) && (lastBatchSize == 3));
+
+    /* ...or from process(), in a quiet period. */
+    currentTime = 150;
+    report(batcher, 9, 1);
+    CHECK(batcher.process(200) == 50);
+    CHECK(batcher.process(250) == 0);
+    CHECK((batchCount == 4) && (lastBatchSize == 1));
+    CHECK(batcher.process(300) == 0);
+    CHECK(batchCount == 4);
+
+    /* A payload larger than the arena is dropped. */
+    Gap::AdvertisementCallbackParams_t oversized;
+    uint8_t                            data[65] = { 0 };
+    memset(&oversized, 0, sizeof(oversized));
+    oversized.advertisingData    = data;
+    oversized.advertisingDataLen = sizeof(data);
+    batcher.processReport(&oversized);
+    CHECK((batcher.getDroppedCount() == 1) && (batcher.getPendingCount() == 0));
+
+    CHECK(payloadsIntact);
+
+    printf("advertisement report batcher test passed\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ConnectionParamsPolicy against a FakeGap: profile changes on bursts of
+ * traffic and on idle timeouts, relaxed retries of rejected requests, and
+ * bulk transfers.
+ */
+
+#include "fake_gap.h"
+#include "ble/ConnectionParamsPolicy.h"
+
+int main(void)
+{
+    FakeGap gap;
+
+    {
+        ConnectionParamsPolicy policy(gap);
+        CHECK(policy.getRegistrationStatus() == BLE_ERROR_NONE);
+
+        /* A new connection goes to the idle profile. */
+        gap.connected(1, 7, Gap::PERIPHERAL);
+        policy.process(0);
+        CHECK((gap.updateParamsCount == 1) && (gap.lastParams.minConnectionInterval == 320));
+        gap.processConnectionParamsUpdateEvent(7, BLE_ERROR_NONE, &gap.lastParams);
+        CHECK(policy.getProfile(7) == ConnectionParamsPolicy::PROFILE_LOW_POWER);
+
+        /* A burst moves it to the active profile. */
+        policy.recordTraffic(7, 100);
+        policy.recordTraffic(7, 200);
+        CHECK(gap.updateParamsCount == 1);
+        policy.recordTraffic(7, 300);
+        CHECK((gap.updateParamsCount == 2) && (gap.lastParams.maxConnectionInterval == 6));
+
+        /* Rejected requests are retried with doubled intervals, then given up. */
+        gap.processConnectionParamsUpdateEvent(7, BLE_ERROR_OPERATION_NOT_PERMITTED, NULL);
+        CHECK((gap.updateParamsCount == 3) && (gap.lastParams.minConnectionInterval == 12) && (gap.lastParams.maxConnectionInterval == 12));
+        gap.processConnectionParamsUpdateEvent(7, BLE_ERROR_OPERATION_NOT_PERMITTED, NULL);
+        CHECK((gap.updateParamsCount == 4) && (gap.lastParams.maxConnectionInterval == 24));
+        gap.processConnectionParamsUpdateEvent(7, BLE_ERROR_OPERATION_NOT_PERMITTED, NULL);
+        CHECK((gap.updateParamsCount == 4) && (policy.getRejectCount() == 3));
+
+        /* Idle again: the connection already has the idle parameters. */
+        CHECK(policy.process(1000) == 1300);
+        policy.process(2300);
+        CHECK(gap.updateParamsCount == 4);
+
+        /* A bulk transfer holds the maximum throughput profile. */
+        policy.setBulkTransfer(7, 2400, true);
+        CHECK((gap.updateParamsCount == 5) && (gap.lastParams.minConnectionInterval == 12));
+        gap.processConnectionParamsUpdateEvent(7, BLE_ERROR_NONE, &gap.lastParams);
+        CHECK(policy.getProfile(7) == ConnectionParamsPolicy::PROFILE_MAX_THROUGHPUT);
+        policy.process(10000);
+        CHECK(gap.updateParamsCount == 5);
+
+        const Gap::ConnectionParams_t invalid = { 6, 6, 10, 10 };
+        CHECK(policy.setProfileParams(ConnectionParamsPolicy::PROFILE_BALANCED, invalid) == BLE_ERROR_INVALID_PARAM);
+
+        gap.processDisconnectionEvent(7, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+        CHECK(policy.getProfile(7) == ConnectionParamsPolicy::PROFILE_NONE);
+    }
+
+    /* The destroyed policy is no longer called. */
+    gap.connected(2, 8, Gap::PERIPHERAL);
+    gap.processConnectionParamsUpdateEvent(8, BLE_ERROR_OPERATION_NOT_PERMITTED, NULL);
+    gap.processDisconnectionEvent(8, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+    CHECK(gap.updateParamsCount == 5);
+
+    printf("connection params policy test passed\n");
+    return 0;
+}
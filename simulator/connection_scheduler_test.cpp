@@ -0,0 +1,254 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ConnectionScheduler against a FakeGap: attempt timeouts and backoff,
+ * timeouts reported by the controller, and the claim of the whitelist with
+ * auto-connect.
+ */
+
+#include "fake_gap.h"
+#include "ble/ConnectionScheduler.h"
+
+typedef ConnectionScheduler<8> Scheduler;
+
+static uint32_t           currentTime;
+static Scheduler::Result_t results[8];
+static unsigned           resultCount;
+
+static uint32_t clock(void)
+{
+    return currentTime;
+}
+
+static void onResult(const Scheduler::Result_t *result)
+{
+    results[resultCount++] = *result;
+}
+
+static void addTarget(Scheduler &scheduler, uint8_t peer, uint8_t priority)
+{
+    BLEProtocol::AddressBytes_t address;
+    FakeGap::makeAddress(peer, address);
+    scheduler.addTarget(BLEProtocol::AddressType::PUBLIC, address, priority);
+}
+
+static int testBackoff(void)
+{
+    FakeGap   gap;
+    Scheduler scheduler(gap, 1500, 1000, 4000, 3, clock);
+    scheduler.onResult(onResult);
+    resultCount = 0;
+    currentTime = 0;
+
+    addTarget(scheduler, 1, 0);
+    CHECK(scheduler.start(0) == BLE_ERROR_NONE);
+    CHECK((gap.connectCount == 1) && (gap.lastPeer == 1));
+    CHECK(scheduler.process(500) == 1000);
+
+    /* The first attempt times out: retried after the minimum backoff. */
+    CHECK(scheduler.process(1500) == 1000);
+    CHECK((gap.cancelConnectCount == 1) && (gap.connectCount == 1));
+    CHECK(scheduler.process(2500) == 1500);
+    CHECK(gap.connectCount == 2);
+
+    /* The backoff doubles. */
+    CHECK(scheduler.process(4000) == 2000);
+    scheduler.process(5999);
+    CHECK(gap.connectCount == 2);
+    scheduler.process(6000);
+    CHECK(gap.connectCount == 3);
+
+    /* The target is given up after its last attempt. */
+    CHECK(scheduler.process(7500) == 0);
+    CHECK(resultCount == 1);
+    CHECK((results[0].status != BLE_ERROR_NONE) && (results[0].attempts == 3) && (results[0].latency == 7500));
+    CHECK(scheduler.getTargetCount() == 0);
+
+    /* Without a limit, the backoff is capped. */
+    Scheduler unlimited(gap, 1000, 1000, 1500, 0, clock);
+    addTarget(unlimited, 2, 0);
+    unlimited.start(10000);
+    CHECK(unlimited.process(11000) == 1000);
+    unlimited.process(12000);
+    CHECK(unlimited.process(13000) == 1500);
+    unlimited.process(14500);
+    CHECK(unlimited.process(15500) == 1500);
+    CHECK(unlimited.getTargetCount() == 1);
+
+    return 0;
+}
+
+static int testConnection(void)
+{
+    FakeGap   gap;
+    Scheduler scheduler(gap, 1500, 1000, 4000, 3, clock);
+    scheduler.onResult(onResult);
+    resultCount = 0;
+    currentTime = 0;
+
+    /* Targets of higher priority first, then in turn. */
+    addTarget(scheduler, 1, 0);
+    addTarget(scheduler, 2, 5);
+    addTarget(scheduler, 3, 0);
+    scheduler.start(0);
+    CHECK((gap.connectCount == 1) && (gap.lastPeer == 2));
+
+    currentTime = 400;
+    gap.connected(2, 10, Gap::CENTRAL);
+    CHECK(resultCount == 1);
+    CHECK((results[0].status == BLE_ERROR_NONE) && (results[0].handle == 10) && (results[0].latency == 400) && (results[0].attempts == 1));
+    CHECK((gap.connectCount == 2) && (gap.lastPeer == 1));
+
+    /* Connections as a peripheral are not ours. */
+    gap.connected(1, 11, Gap::PERIPHERAL);
+    CHECK((resultCount == 1) && (scheduler.getTargetCount() == 2));
+
+    return 0;
+}
+
+static int testControllerTimeout(void)
+{
+    FakeGap   gap;
+    Scheduler scheduler(gap, 1500, 1000, 4000, 0, clock);
+    resultCount = 0;
+    currentTime = 0;
+
+    addTarget(scheduler, 1, 1);
+    addTarget(scheduler, 2, 0);
+    scheduler.start(0);
+    CHECK(gap.lastPeer == 1);
+
+    /* The controller ends the attempt: the next target is attempted. */
+    currentTime = 800;
+    gap.processTimeoutEvent(Gap::TIMEOUT_SRC_CONN);
+    CHECK((gap.connectCount == 2) && (gap.lastPeer == 2));
+    CHECK(scheduler.process(800) == 1000);
+
+    /* An attempt which can't be cancelled ends with a timeout event of the
+     * controller, which must not fail the next attempt. */
+    gap.cancelConnectStatus = BLE_ERROR_NOT_IMPLEMENTED;
+    scheduler.process(2300);
+    CHECK(gap.connectCount == 3);
+    CHECK(gap.lastPeer == 1);
+    gap.processTimeoutEvent(Gap::TIMEOUT_SRC_CONN);
+    CHECK(scheduler.getInitiationCount() == 1);
+    CHECK(scheduler.process(2300) == 1000);
+
+    /* A busy stack doesn't consume attempts. */
+    scheduler.stop();
+    gap.connectStatus = BLE_STACK_BUSY;
+    scheduler.start(10000);
+    CHECK(scheduler.getInitiationCount() == 0);
+    CHECK(scheduler.process(10000) == 1000);
+    gap.connectStatus = BLE_ERROR_NONE;
+    scheduler.process(11000);
+    CHECK(scheduler.getInitiationCount() == 1);
+
+    return 0;
+}
+
+static int testWhitelist(void)
+{
+    int     application;
+    FakeGap gap;
+    gap.maxWhitelistSize = 4;
+    resultCount = 0;
+    currentTime = 0;
+
+    Scheduler scheduler(gap, 1500, 1000, 4000, 0, clock);
+    scheduler.onResult(onResult);
+    scheduler.setAutoConnect(true);
+    for (uint8_t peer = 1; peer <= 6; ++peer) {
+        addTarget(scheduler, peer, peer);
+    }
+
+    /* The targets of highest priority go to the whitelist, which is claimed. */
+    scheduler.start(0);
+    CHECK(scheduler.isUsingWhitelist() && (gap.getWhitelistOwner() == &scheduler));
+    CHECK(gap.initiatorPolicy == Gap::INIT_POLICY_FILTER_ALL_ADV);
+    CHECK((gap.whitelistCount == 4) && gap.isWhitelisted(6) && gap.isWhitelisted(3) && !gap.isWhitelisted(2));
+    CHECK(gap.claimWhitelist(&application) == BLE_ERROR_INVALID_STATE);
+
+    /* A connection refills it. */
+    currentTime = 100;
+    gap.connected(5, 1, Gap::CENTRAL);
+    CHECK((resultCount == 1) && (results[0].peerAddr[0] == 5));
+    CHECK(scheduler.isUsingWhitelist() && (gap.connectCount == 2));
+    CHECK((gap.whitelistCount == 4) && gap.isWhitelisted(2) && !gap.isWhitelisted(5));
+
+    /* The attempt times out with one target left due, attempted alone and
+     * unfiltered: the whitelist is released. */
+    scheduler.process(1600);
+    CHECK(!scheduler.isUsingWhitelist() && (gap.lastPeer == 1));
+    CHECK(gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST);
+    CHECK(gap.getWhitelistOwner() == NULL);
+
+    /* The scheduler stays off a whitelist held by the application. */
+    CHECK(gap.claimWhitelist(&application) == BLE_ERROR_NONE);
+    unsigned connects = gap.connectCount;
+    scheduler.process(3100);
+    CHECK(!scheduler.isUsingWhitelist() && (gap.connectCount == connects + 1));
+    CHECK((gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST) && (gap.getWhitelistOwner() == &application));
+    gap.releaseWhitelist(&application);
+
+    /* Stopping releases it. */
+    scheduler.stop();
+    scheduler.start(20000);
+    CHECK(gap.getWhitelistOwner() == &scheduler);
+    scheduler.stop();
+    CHECK((gap.getWhitelistOwner() == NULL) && (gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST));
+
+    return 0;
+}
+
+static int testWhitelistIdle(void)
+{
+    FakeGap gap;
+    gap.maxWhitelistSize = 4;
+
+    Scheduler scheduler(gap, 1500, 1000, 4000, 0, clock);
+    scheduler.setAutoConnect(true);
+    addTarget(scheduler, 1, 0);
+    addTarget(scheduler, 2, 0);
+    scheduler.start(0);
+    CHECK(scheduler.isUsingWhitelist() && (gap.getWhitelistOwner() == &scheduler));
+
+    /* Both targets back off: the whitelist is not held meanwhile. */
+    CHECK(scheduler.process(1500) == 1000);
+    CHECK(!scheduler.isUsingWhitelist() && (gap.connectCount == 1));
+    CHECK((gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST) && (gap.getWhitelistOwner() == NULL));
+
+    /* The last connection releases it too. */
+    scheduler.process(2500);
+    CHECK(gap.getWhitelistOwner() == &scheduler);
+    gap.connected(1, 1, Gap::CENTRAL);
+    gap.connected(2, 2, Gap::CENTRAL);
+    CHECK(scheduler.getTargetCount() == 0);
+    CHECK((gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST) && (gap.getWhitelistOwner() == NULL));
+
+    return 0;
+}
+
+int main(void)
+{
+    if (testBackoff() || testConnection() || testControllerTimeout() || testWhitelist() || testWhitelistIdle()) {
+        return 1;
+    }
+
+    printf("connection scheduler test passed\n");
+    return 0;
+}
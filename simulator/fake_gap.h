@@ -0,0 +1,213 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FAKE_GAP_H__
+#define __FAKE_GAP_H__
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ble/Gap.h"
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                           \
+        }                                                                       \
+    } while (0)
+
+/**
+ * Gap without a controller, for the tests of the components which drive a
+ * Gap: it records the requests it receives, and the tests inject the events
+ * of the controller with the Gap::processXXX() functions.
+ *
+ * Peers are identified by a single byte, the first byte of their public
+ * address.
+ */
+class FakeGap : public Gap {
+public:
+    FakeGap() :
+        connectStatus(BLE_ERROR_NONE),
+        cancelConnectStatus(BLE_ERROR_NONE),
+        maxInitiations(1),
+        maxWhitelistSize(0),
+        connectCount(0),
+        cancelConnectCount(0),
+        disconnectCount(0),
+        advertisingStartCount(0),
+        advertisingStopCount(0),
+        scanStartCount(0),
+        whitelistCount(0),
+        updateParamsCount(0),
+        lastPeer(0),
+        lastScanInterval(0),
+        lastScanWindow(0),
+        initiatorPolicy(INIT_POLICY_IGNORE_WHITELIST),
+        advertisingPolicy(ADV_POLICY_IGNORE_WHITELIST) {
+        memset(&lastParams, 0, sizeof(lastParams));
+    }
+
+    static void makeAddress(uint8_t peer, BLEProtocol::AddressBytes_t address) {
+        memset(address, 0, BLEProtocol::ADDR_LEN);
+        address[0] = peer;
+    }
+
+    /**
+     * Report a connection to @p peer.
+     */
+    void connected(uint8_t peer, Handle_t handle, Role_t role) {
+        BLEProtocol::AddressBytes_t address;
+        makeAddress(peer, address);
+        processConnectionEvent(handle, role, BLEProtocol::AddressType::PUBLIC, address, BLEProtocol::AddressType::PUBLIC, address, NULL);
+    }
+
+    /**
+     * Report an advertising packet of @p peer.
+     */
+    void advertised(uint8_t peer) {
+        BLEProtocol::AddressBytes_t address;
+        makeAddress(peer, address);
+        processAdvertisementReport(address, -50, false, GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED, 0, NULL);
+    }
+
+    /**
+     * Check whether the whitelist holds @p peer.
+     */
+    bool isWhitelisted(uint8_t peer) const {
+        for (unsigned i = 0; i < whitelistCount; ++i) {
+            if (whitelist[i].address[0] == peer) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    virtual ble_error_t connect(const BLEProtocol::AddressBytes_t  peerAddr,
+                                BLEProtocol::AddressType_t         peerAddrType,
+                                const ConnectionParams_t          *connectionParams,
+                                const GapScanningParams           *scanParams) {
+        (void)peerAddrType;
+        (void)connectionParams;
+        (void)scanParams;
+        if (connectStatus == BLE_ERROR_NONE) {
+            ++connectCount;
+            lastPeer = peerAddr[0];
+        }
+        return connectStatus;
+    }
+
+    virtual ble_error_t cancelConnect(void) {
+        ++cancelConnectCount;
+        return cancelConnectStatus;
+    }
+
+    virtual uint8_t getMaxConcurrentConnectionInitiations(void) const {
+        return maxInitiations;
+    }
+
+    virtual ble_error_t disconnect(Handle_t connectionHandle, DisconnectionReason_t reason) {
+        (void)connectionHandle;
+        (void)reason;
+        ++disconnectCount;
+        return BLE_ERROR_NONE;
+    }
+
+    virtual ble_error_t updateConnectionParams(Handle_t handle, const ConnectionParams_t *params) {
+        (void)handle;
+        ++updateParamsCount;
+        lastParams = *params;
+        return BLE_ERROR_NONE;
+    }
+
+    virtual ble_error_t stopAdvertising(void) {
+        ++advertisingStopCount;
+        state.advertising = 0;
+        return BLE_ERROR_NONE;
+    }
+
+    virtual uint8_t getMaxWhitelistSize(void) const {
+        return maxWhitelistSize;
+    }
+
+    virtual ble_error_t setWhitelist(const Whitelist_t &list) {
+        if (list.size > maxWhitelistSize) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+        whitelistCount = list.size;
+        for (unsigned i = 0; i < list.size; ++i) {
+            whitelist[i] = list.addresses[i];
+        }
+        return BLE_ERROR_NONE;
+    }
+
+    virtual ble_error_t setAdvertisingPolicyMode(AdvertisingPolicyMode_t mode) {
+        advertisingPolicy = mode;
+        return BLE_ERROR_NONE;
+    }
+
+    virtual ble_error_t setInitiatorPolicyMode(InitiatorPolicyMode_t mode) {
+        initiatorPolicy = mode;
+        return BLE_ERROR_NONE;
+    }
+
+protected:
+    virtual ble_error_t startRadioScan(const GapScanningParams &scanningParams) {
+        ++scanStartCount;
+        lastScanInterval = scanningParams.getInterval();
+        lastScanWindow   = scanningParams.getWindow();
+        return BLE_ERROR_NONE;
+    }
+
+private:
+    virtual ble_error_t setAdvertisingData(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse) {
+        (void)advData;
+        (void)scanResponse;
+        return BLE_ERROR_NONE;
+    }
+
+    virtual ble_error_t startAdvertising(const GapAdvertisingParams &params) {
+        (void)params;
+        ++advertisingStartCount;
+        return BLE_ERROR_NONE;
+    }
+
+public:
+    /* Behaviour of the controller. */
+    ble_error_t             connectStatus;
+    ble_error_t             cancelConnectStatus;
+    uint8_t                 maxInitiations;
+    uint8_t                 maxWhitelistSize;
+
+    /* Requests received. */
+    unsigned                connectCount;
+    unsigned                cancelConnectCount;
+    unsigned                disconnectCount;
+    unsigned                advertisingStartCount;
+    unsigned                advertisingStopCount;
+    unsigned                scanStartCount;
+    unsigned                whitelistCount;
+    unsigned                updateParamsCount;
+    uint8_t                 lastPeer;
+    ConnectionParams_t      lastParams;
+    uint16_t                lastScanInterval;
+    uint16_t                lastScanWindow;
+    InitiatorPolicyMode_t   initiatorPolicy;
+    AdvertisingPolicyMode_t advertisingPolicy;
+    BLEProtocol::Address_t  whitelist[8];
+};
+
+#endif /* ifndef __FAKE_GAP_H__ */
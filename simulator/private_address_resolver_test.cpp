@@ -0,0 +1,81 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Resolution of peer addresses by PrivateAddressResolver: the random
+ * address hash function against the sample data of the Core Specification,
+ * and identity addresses which look like resolvable private addresses.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ble/PrivateAddressResolver.h"
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                           \
+        }                                                                       \
+    } while (0)
+
+/* Core Specification, Vol 3, Part H, D.7: IRK ec0234a357c8ad05341010a60a397d9b,
+ * prand 708194, hash 0dfbaa; both least significant octet first. */
+static const SecurityManager::Irk_t SAMPLE_IRK = {
+    0x9B, 0x7D, 0x39, 0x0A, 0xA6, 0x10, 0x10, 0x34, 0x05, 0xAD, 0xC8, 0x57, 0xA3, 0x34, 0x02, 0xEC
+};
+static const BLEProtocol::AddressBytes_t SAMPLE_RPA = { 0xAA, 0xFB, 0x0D, 0x94, 0x81, 0x70 };
+
+static SecurityManager::Identity_t          identities[4];
+static PrivateAddressResolver::CacheEntry_t cache[8];
+
+int main(void)
+{
+    PrivateAddressResolver resolver(identities, 4, cache, 8);
+
+    /* ah() sample data. */
+    CHECK(PrivateAddressResolver::isResolvable(SAMPLE_RPA));
+    CHECK(PrivateAddressResolver::matchesIrk(SAMPLE_IRK, SAMPLE_RPA));
+    BLEProtocol::AddressBytes_t tampered;
+    memcpy(tampered, SAMPLE_RPA, sizeof(tampered));
+    tampered[0] ^= 0x01;
+    CHECK(!PrivateAddressResolver::matchesIrk(SAMPLE_IRK, tampered));
+
+    const BLEProtocol::AddressBytes_t sampleIdentity = { 0x01, 0x02, 0x03, 0x04, 0x05, 0xC6 };
+    CHECK(resolver.addIdentity(BLEProtocol::Address_t(BLEProtocol::AddressType::RANDOM_STATIC, sampleIdentity), SAMPLE_IRK) == BLE_ERROR_NONE);
+    BLEProtocol::Address_t identity;
+    CHECK(resolver.resolve(SAMPLE_RPA, &identity));
+    CHECK(memcmp(identity.address, sampleIdentity, sizeof(sampleIdentity)) == 0);
+    CHECK(!resolver.resolve(tampered));
+
+    /* A public address 66:55:44:33:22:11 has the top bits of a resolvable
+     * private address, and resolves to itself all the same. */
+    const BLEProtocol::AddressBytes_t publicAddress = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+    CHECK(PrivateAddressResolver::isResolvable(publicAddress));
+    CHECK(resolver.addIdentity(BLEProtocol::Address_t(BLEProtocol::AddressType::PUBLIC, publicAddress), SAMPLE_IRK) == BLE_ERROR_NONE);
+    CHECK(resolver.resolve(publicAddress, &identity));
+    CHECK(identity.type == BLEProtocol::AddressType::PUBLIC);
+    CHECK(memcmp(identity.address, publicAddress, sizeof(publicAddress)) == 0);
+
+    /* Answered from the cache the second time. */
+    uint32_t ciphers = resolver.getCipherCount();
+    CHECK(resolver.resolve(publicAddress));
+    CHECK(resolver.getCipherCount() == ciphers);
+
+    printf("private address resolver test passed\n");
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ReconnectManager against a FakeGap: reactions to the disconnection
+ * reasons, attempt timeouts and randomized backoff, and the claim of the
+ * whitelist while the policies filter on it.
+ */
+
+#include "fake_gap.h"
+#include "ble/ReconnectManager.h"
+
+typedef ReconnectManager<4> Manager;
+
+static uint32_t                            currentTime;
+static unsigned                            reconnectCount;
+static Manager::ReconnectCallbackParams_t  lastReconnect;
+
+static uint32_t clock(void)
+{
+    return currentTime;
+}
+
+static void onReconnect(const Manager::ReconnectCallbackParams_t *params)
+{
+    ++reconnectCount;
+    lastReconnect = *params;
+}
+
+static int testPeripheral(void)
+{
+    FakeGap gap;
+    gap.maxWhitelistSize = 4;
+    Manager manager(gap, 2000, 500, 8000, clock, 7);
+    manager.onReconnect(onReconnect);
+    reconnectCount = 0;
+    currentTime    = 0;
+    CHECK(manager.start(0) == BLE_ERROR_NONE);
+
+    /* Terminated on purpose: no reconnection. */
+    gap.connected(1, 10, Gap::PERIPHERAL);
+    currentTime = 100;
+    gap.processDisconnectionEvent(10, Gap::REMOTE_USER_TERMINATED_CONNECTION);
+    CHECK((manager.getPendingCount() == 0) && (gap.advertisingStartCount == 0));
+
+    /* Dropout: advertising at once, filtered on the claimed whitelist. */
+    gap.connected(1, 11, Gap::PERIPHERAL);
+    currentTime = 200;
+    gap.processDisconnectionEvent(11, Gap::CONNECTION_TIMEOUT);
+    CHECK((manager.getPendingCount() == 1) && (gap.advertisingStartCount == 1));
+    CHECK((gap.whitelistCount == 1) && gap.isWhitelisted(1));
+    CHECK(gap.advertisingPolicy == Gap::ADV_POLICY_FILTER_CONN_REQS);
+    CHECK(gap.getWhitelistOwner() == &manager);
+
+    /* Reconnection: reported, and the whitelist is released. */
+    currentTime = 700;
+    gap.connected(1, 12, Gap::PERIPHERAL);
+    CHECK((reconnectCount == 1) && (lastReconnect.timeToReconnect == 500) && (lastReconnect.handle == 12));
+    CHECK(lastReconnect.reason == Gap::CONNECTION_TIMEOUT);
+    CHECK(gap.advertisingPolicy == Gap::ADV_POLICY_IGNORE_WHITELIST);
+    CHECK(gap.getWhitelistOwner() == NULL);
+
+    BLEProtocol::AddressBytes_t address;
+    uint32_t                    time;
+    FakeGap::makeAddress(1, address);
+    CHECK(manager.getLastReconnectTime(address, &time) && (time == 500) && (manager.getReconnectCount(address) == 1));
+
+    /* The peer powered off: the attempt waits for a long backoff. */
+    currentTime = 1000;
+    gap.processDisconnectionEvent(12, Gap::REMOTE_DEV_TERMINATION_DUE_TO_POWER_OFF);
+    CHECK((manager.getPendingCount() == 1) && (gap.advertisingStartCount == 1));
+    uint32_t delay = manager.process(1000);
+    CHECK((delay >= 2000) && (delay <= 4000));
+    manager.process(1000 + delay);
+    CHECK(gap.advertisingStartCount == 2);
+
+    manager.stop();
+    CHECK((manager.getPendingCount() == 0) && (gap.getWhitelistOwner() == NULL));
+
+    return 0;
+}
+
+static int testCentral(void)
+{
+    FakeGap gap;
+    gap.maxWhitelistSize = 4;
+    Manager manager(gap, 2000, 500, 8000, clock, 7);
+    manager.onReconnect(onReconnect);
+    reconnectCount = 0;
+    currentTime    = 0;
+    manager.start(0);
+
+    gap.connected(2, 20, Gap::CENTRAL);
+    gap.connected(3, 21, Gap::CENTRAL);
+
+    /* Dropouts: a single initiation filtered on both peers. */
+    currentTime = 1000;
+    gap.processDisconnectionEvent(20, Gap::CONNECTION_TIMEOUT);
+    CHECK((gap.connectCount == 1) && (gap.initiatorPolicy == Gap::INIT_POLICY_FILTER_ALL_ADV));
+    currentTime = 1100;
+    gap.processDisconnectionEvent(21, Gap::CONNECTION_TIMEOUT);
+    CHECK((gap.cancelConnectCount == 1) && (gap.connectCount == 2));
+    CHECK((gap.whitelistCount == 2) && gap.isWhitelisted(2) && gap.isWhitelisted(3));
+    CHECK(gap.getWhitelistOwner() == &manager);
+
+    /* The attempt times out: retried after half to all of the backoff. */
+    CHECK(manager.process(1500) == 1600);
+    uint32_t delay = manager.process(3100);
+    CHECK((gap.cancelConnectCount == 2) && (delay >= 250) && (delay <= 500));
+    manager.process(3100 + delay - 1);
+    CHECK(gap.connectCount == 2);
+    manager.process(3100 + delay);
+    CHECK(gap.connectCount == 3);
+
+    /* The controller ends the next attempt early: it counts as failed, and
+     * the backoff doubles. */
+    currentTime = 3100 + delay;
+    gap.processTimeoutEvent(Gap::TIMEOUT_SRC_CONN);
+    uint32_t nextDelay = manager.process(currentTime);
+    CHECK((nextDelay >= 500) && (nextDelay <= 1000));
+    currentTime += nextDelay;
+    manager.process(currentTime);
+    CHECK(gap.connectCount == 4);
+
+    /* One peer back: the other one is attempted alone. */
+    gap.connected(3, 22, Gap::CENTRAL);
+    CHECK((reconnectCount == 1) && (lastReconnect.role == Gap::CENTRAL));
+    CHECK((gap.connectCount == 5) && (gap.whitelistCount == 1) && gap.isWhitelisted(2));
+    gap.connected(2, 23, Gap::CENTRAL);
+    CHECK((reconnectCount == 2) && (manager.getPendingCount() == 0));
+    CHECK((gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST) && (gap.getWhitelistOwner() == NULL));
+
+    return 0;
+}
+
+static int testWhitelistHeld(void)
+{
+    int     application;
+    FakeGap gap;
+    gap.maxWhitelistSize = 4;
+    CHECK(gap.claimWhitelist(&application) == BLE_ERROR_NONE);
+
+    Manager manager(gap, 2000, 500, 8000, clock, 7);
+    currentTime = 0;
+    manager.start(0);
+    gap.connected(1, 10, Gap::PERIPHERAL);
+    gap.connected(2, 11, Gap::CENTRAL);
+    gap.connected(3, 12, Gap::CENTRAL);
+
+    /* Unfiltered, and the central peers are attempted in turn. */
+    gap.processDisconnectionEvent(11, Gap::CONNECTION_TIMEOUT);
+    gap.processDisconnectionEvent(12, Gap::CONNECTION_TIMEOUT);
+    CHECK((gap.connectCount == 2) && (gap.lastPeer == 3));
+    CHECK(gap.initiatorPolicy == Gap::INIT_POLICY_IGNORE_WHITELIST);
+    manager.process(2000);
+    uint32_t delay = manager.process(2000);
+    manager.process(2000 + delay);
+    CHECK((gap.connectCount == 3) && (gap.lastPeer == 2));
+
+    /* The whitelist of the application is left alone. */
+    gap.processDisconnectionEvent(10, Gap::CONNECTION_TIMEOUT);
+    CHECK((gap.advertisingStartCount == 1) && (gap.advertisingPolicy == Gap::ADV_POLICY_IGNORE_WHITELIST));
+    CHECK((gap.whitelistCount == 0) && (gap.getWhitelistOwner() == &application));
+
+    return 0;
+}
+
+int main(void)
+{
+    if (testPeripheral() || testCentral() || testWhitelistHeld()) {
+        return 1;
+    }
+
+    printf("reconnect manager test passed\n");
+    return 0;
+}
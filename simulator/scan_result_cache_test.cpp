@@ -0,0 +1,245 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ScanResultCache: merging of the reports of a device, eviction of the
+ * device seen least recently, and removals from clusters of the hash index,
+ * which are checked against a plain list of the devices.
+ */
+
+#include "fake_gap.h"
+#include "ble/ScanResultCache.h"
+
+typedef ScanResultCache<8> Cache;
+
+/* Size of the hash index of Cache, and its hash function (FNV-1a). */
+static const unsigned INDEX_SIZE = 2 * 8 + 1;
+
+static uint32_t currentTime;
+static unsigned updateCount;
+
+static uint32_t clock(void)
+{
+    return currentTime;
+}
+
+static void onDeviceUpdate(const Cache::Device_t *device)
+{
+    (void)device;
+    ++updateCount;
+}
+
+static unsigned homeSlot(const BLEProtocol::AddressBytes_t address)
+{
+    uint32_t h = 2166136261UL;
+    for (unsigned i = 0; i < BLEProtocol::ADDR_LEN; ++i) {
+        h = (h ^ address[i]) * 16777619UL;
+    }
+    return h % INDEX_SIZE;
+}
+
+static void makeAddress(unsigned id, BLEProtocol::AddressBytes_t address)
+{
+    memset(address, 0, BLEProtocol::ADDR_LEN);
+    address[0] = id & 0xFF;
+    address[1] = (id >> 8) & 0xFF;
+}
+
+static void report(Cache &cache, unsigned id, uint32_t now)
+{
+    static uint8_t                     data[] = { 0x02, 0x01, 0x06 };
+    Gap::AdvertisementCallbackParams_t params;
+    memset(&params, 0, sizeof(params));
+    makeAddress(id, params.peerAddr);
+    params.rssi               = -50;
+    params.advertisingData    = data;
+    params.advertisingDataLen = sizeof(data);
+    cache.update(&params, now);
+}
+
+static bool contains(const Cache &cache, unsigned id)
+{
+    BLEProtocol::AddressBytes_t address;
+    makeAddress(id, address);
+    return cache.find(address) != NULL;
+}
+
+static bool remove(Cache &cache, unsigned id)
+{
+    BLEProtocol::AddressBytes_t address;
+    makeAddress(id, address);
+    return cache.remove(address);
+}
+
+static int testReports(void)
+{
+    Cache cache(clock);
+    cache.onDeviceUpdate(onDeviceUpdate);
+    updateCount = 0;
+
+    uint8_t                            data[] = { 0x02, 0x01, 0x06 };
+    uint8_t                            response[] = { 0x03, 0x09, 'a', 'b' };
+    Gap::AdvertisementCallbackParams_t params;
+    memset(&params, 0, sizeof(params));
+    FakeGap::makeAddress(1, params.peerAddr);
+    params.rssi               = -40;
+    params.advertisingData    = data;
+    params.advertisingDataLen = sizeof(data);
+
+    /* Repeated reports are merged; only changes are passed on. */
+    for (unsigned i = 0; i < 4; ++i) {
+        currentTime = i * 10;
+        cache.processReport(&params);
+    }
+    CHECK((updateCount == 1) && (cache.getDeviceCount() == 1));
+
+    params.isScanResponse     = true;
+    params.advertisingData    = response;
+    params.advertisingDataLen = sizeof(response);
+    cache.processReport(&params);
+    cache.processReport(&params);
+    CHECK(updateCount == 2);
+
+    const Cache::Device_t *device = cache.find(params.peerAddr);
+    CHECK((device != NULL) && (device->hitCount == 6) && (device->firstSeen == 0) && (device->lastSeen == 30));
+    CHECK((device->advertisingDataLen == sizeof(data)) && (device->scanResponseLen == sizeof(response)));
+    CHECK(memcmp(device->scanResponse, response, sizeof(response)) == 0);
+    CHECK(device->rssi == -40);
+
+    return 0;
+}
+
+static int testEviction(void)
+{
+    Cache cache;
+
+    for (unsigned id = 1; id <= 8; ++id) {
+        report(cache, id, id);
+    }
+    CHECK((cache.getDeviceCount() == 8) && (cache.getEvictionCount() == 0));
+
+    /* The device seen least recently makes room. */
+    report(cache, 1, 20);
+    report(cache, 9, 21);
+    CHECK((cache.getDeviceCount() == 8) && (cache.getEvictionCount() == 1));
+    CHECK(!contains(cache, 2) && contains(cache, 1) && contains(cache, 9));
+    report(cache, 10, 22);
+    CHECK(!contains(cache, 3) && contains(cache, 4));
+
+    /* Expiry removes the devices not seen for too long. */
+    CHECK(cache.expire(22, 10) == 5);
+    CHECK((cache.getDeviceCount() == 3) && contains(cache, 1) && contains(cache, 9) && contains(cache, 10));
+
+    return 0;
+}
+
+static int testRemovalFromCluster(void)
+{
+    /* Four devices of the same home slot, the last two of which wrap around
+     * the end of the index, and one device whose home slot is taken by the
+     * cluster. */
+    unsigned cluster[4];
+    unsigned count = 0;
+    unsigned inside = 0;
+    for (unsigned id = 1; (count < 4) || !inside; ++id) {
+        BLEProtocol::AddressBytes_t address;
+        makeAddress(id, address);
+        unsigned slot = homeSlot(address);
+        if ((slot == INDEX_SIZE - 2) && (count < 4)) {
+            cluster[count++] = id;
+        } else if ((slot == 0) && !inside) {
+            inside = id;
+        }
+    }
+
+    for (unsigned first = 0; first < 4; ++first) {
+        Cache cache;
+        for (unsigned i = 0; i < 4; ++i) {
+            report(cache, cluster[i], i);
+        }
+        report(cache, inside, 4);
+
+        /* Every other device stays reachable after the removal. */
+        CHECK(remove(cache, cluster[first]));
+        CHECK(!contains(cache, cluster[first]));
+        for (unsigned i = 0; i < 4; ++i) {
+            CHECK((i == first) || contains(cache, cluster[i]));
+        }
+        CHECK(contains(cache, inside));
+        CHECK(!remove(cache, cluster[first]));
+    }
+
+    return 0;
+}
+
+static int testAgainstList(void)
+{
+    Cache    cache;
+    unsigned list[8];    /* Most recent first. */
+    unsigned listSize = 0;
+    uint32_t random   = 1;
+
+    for (unsigned step = 0; step < 20000; ++step) {
+        random = random * 1103515245UL + 12345;
+        unsigned id = 1 + ((random >> 16) % 40);
+
+        unsigned position = 0;
+        while ((position < listSize) && (list[position] != id)) {
+            ++position;
+        }
+        bool listed = (position < listSize);
+
+        if (((random >> 8) & 3) == 0) {
+            CHECK(remove(cache, id) == listed);
+            if (listed) {
+                memmove(&list[position], &list[position + 1], (listSize - position - 1) * sizeof(list[0]));
+                --listSize;
+            }
+        } else {
+            report(cache, id, step);
+            if (listed) {
+                memmove(&list[position], &list[position + 1], (listSize - position - 1) * sizeof(list[0]));
+                --listSize;
+            } else if (listSize == 8) {
+                --listSize;
+            }
+            memmove(&list[1], &list[0], listSize * sizeof(list[0]));
+            list[0] = id;
+            ++listSize;
+        }
+
+        CHECK(cache.getDeviceCount() == listSize);
+        for (unsigned other = 1; other <= 40; ++other) {
+            bool expected = false;
+            for (unsigned i = 0; i < listSize; ++i) {
+                expected = expected || (list[i] == other);
+            }
+            CHECK(contains(cache, other) == expected);
+        }
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    if (testReports() || testEviction() || testRemovalFromCluster() || testAgainstList()) {
+        return 1;
+    }
+
+    printf("scan result cache test passed\n");
+    return 0;
+}
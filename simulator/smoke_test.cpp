@@ -0,0 +1,174 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Smoke test of the simulated transport: a central (instance 0) finds a
+ * peripheral (instance 1) advertising, connects to it, discovers its
+ * service, writes a characteristic and receives a notification.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ble/BLE.h"
+#include "ble/DiscoveredCharacteristic.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                           \
+        }                                                                       \
+    } while (0)
+
+static const uint16_t SERVICE_UUID = 0xA000;
+static const uint16_t NOTIFY_UUID  = 0xA001;
+static const uint16_t WRITE_UUID   = 0xA002;
+
+static uint8_t notifyValue[4];
+static uint8_t writeValue[4];
+static GattCharacteristic notifyCharacteristic(NOTIFY_UUID, notifyValue, sizeof(notifyValue), sizeof(notifyValue),
+                                               GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY);
+static GattCharacteristic writeCharacteristic(WRITE_UUID, writeValue, sizeof(writeValue), sizeof(writeValue),
+                                              GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE);
+static GattCharacteristic *characteristics[] = { &notifyCharacteristic, &writeCharacteristic };
+static GattService service(SERVICE_UUID, characteristics, sizeof(characteristics) / sizeof(GattCharacteristic *));
+
+static Gap::Handle_t            centralHandle;
+static unsigned                 connections[2];
+static unsigned                 discoveryDone;
+static GattAttribute::Handle_t  notifyValueHandle;
+static GattAttribute::Handle_t  writeValueHandle;
+static unsigned                 writeResponses;
+static unsigned                 writesReceived;
+static uint8_t                  lastWritten[4];
+static unsigned                 notifications;
+static uint8_t                  lastNotified[4];
+
+static void onInit(BLE::InitializationCompleteCallbackContext *context)
+{
+    (void)context;
+}
+
+static void onAdvertisementReport(const Gap::AdvertisementCallbackParams_t *params)
+{
+    BLE &central = BLE::Instance(0);
+    central.gap().stopScan();
+    central.gap().connect(params->peerAddr, BLEProtocol::AddressType::RANDOM_STATIC, NULL, NULL);
+}
+
+static void onCentralConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    ++connections[0];
+    centralHandle = params->handle;
+}
+
+static void onPeripheralConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    (void)params;
+    ++connections[1];
+}
+
+static void onCharacteristic(const DiscoveredCharacteristic *characteristic)
+{
+    if (characteristic->getUUID().getShortUUID() == NOTIFY_UUID) {
+        notifyValueHandle = characteristic->getValueHandle();
+    } else if (characteristic->getUUID().getShortUUID() == WRITE_UUID) {
+        writeValueHandle = characteristic->getValueHandle();
+    }
+}
+
+static void onDiscoveryTermination(Gap::Handle_t handle)
+{
+    (void)handle;
+    ++discoveryDone;
+}
+
+static void onWriteResponse(const GattWriteCallbackParams *params)
+{
+    (void)params;
+    ++writeResponses;
+}
+
+static void onDataWritten(const GattWriteCallbackParams *params)
+{
+    if ((params->handle == writeCharacteristic.getValueHandle()) && (params->len == sizeof(lastWritten))) {
+        ++writesReceived;
+        memcpy(lastWritten, params->data, sizeof(lastWritten));
+    }
+}
+
+static void onHVX(const GattHVXCallbackParams *params)
+{
+    if ((params->handle == notifyValueHandle) && (params->len == sizeof(lastNotified))) {
+        ++notifications;
+        memcpy(lastNotified, params->data, sizeof(lastNotified));
+    }
+}
+
+int main(void)
+{
+    SimulatedMedium &medium     = SimulatedMedium::getDefault();
+    BLE             &central    = BLE::Instance(0);
+    BLE             &peripheral = BLE::Instance(1);
+
+    CHECK(central.init(onInit) == BLE_ERROR_NONE);
+    CHECK(peripheral.init(onInit) == BLE_ERROR_NONE);
+    CHECK(peripheral.gattServer().addService(service) == BLE_ERROR_NONE);
+
+    central.gap().onConnection(onCentralConnection);
+    peripheral.gap().onConnection(onPeripheralConnection);
+    central.gattClient().onServiceDiscoveryTermination(onDiscoveryTermination);
+    central.gattClient().onDataWritten(onWriteResponse);
+    central.gattClient().onHVX(onHVX);
+    peripheral.gattServer().onDataWritten(onDataWritten);
+
+    /* Advertise and connect. */
+    peripheral.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+    peripheral.gap().setAdvertisingInterval(100);
+    CHECK(peripheral.gap().startAdvertising() == BLE_ERROR_NONE);
+    central.gap().setScanParams(100, 100);
+    CHECK(central.gap().startScan(onAdvertisementReport) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK((connections[0] == 1) && (connections[1] == 1));
+
+    /* Discover the service. */
+    CHECK(central.gattClient().launchServiceDiscovery(centralHandle, NULL, onCharacteristic, SERVICE_UUID) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK(discoveryDone == 1);
+    CHECK((notifyValueHandle != 0) && (writeValueHandle != 0));
+
+    /* Write a characteristic. */
+    const uint8_t written[4] = { 1, 2, 3, 4 };
+    CHECK(central.gattClient().write(GattClient::GATT_OP_WRITE_REQ, centralHandle, writeValueHandle, sizeof(written), written) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK((writesReceived == 1) && (writeResponses == 1));
+    CHECK(memcmp(lastWritten, written, sizeof(written)) == 0);
+
+    /* Subscribe, then notify. */
+    const uint8_t cccd[2] = { BLE_HVX_NOTIFICATION, 0 };
+    CHECK(central.gattClient().write(GattClient::GATT_OP_WRITE_REQ, centralHandle, notifyValueHandle + 1, sizeof(cccd), cccd) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    const uint8_t notified[4] = { 5, 6, 7, 8 };
+    CHECK(peripheral.gattServer().write(notifyCharacteristic.getValueHandle(), notified, sizeof(notified)) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK(notifications == 1);
+    CHECK(memcmp(lastNotified, notified, sizeof(notified)) == 0);
+
+    printf("smoke test passed\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Notification throughput on the simulated transport, on a 7.5 ms
+ * connection interval: with 20-byte notifications first, then with the
+ * ATT MTU, data length and PHY updates applied one after the other. The
+ * results are in bytes per second of simulated time, so they don't depend
+ * on the host.
+ */
+
+#include <stdio.h>
+
+#include "ble/BLE.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+static const unsigned MAX_PAYLOAD_LEN = BLE_SIMULATOR_MAX_ATT_MTU - 3;
+
+static uint8_t            value[MAX_PAYLOAD_LEN];
+static GattCharacteristic notifyCharacteristic(0xA001, value, MAX_PAYLOAD_LEN, MAX_PAYLOAD_LEN,
+                                               GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY);
+static GattCharacteristic *characteristics[] = { &notifyCharacteristic };
+static GattService service(0xA000, characteristics, 1);
+
+static Gap::Handle_t centralHandle;
+static bool          connected;
+static uint16_t      payloadLen = 20;
+static bool          streaming;
+static unsigned      receivedBytes;
+
+static void onInit(BLE::InitializationCompleteCallbackContext *context)
+{
+    (void)context;
+}
+
+static void onAdvertisementReport(const Gap::AdvertisementCallbackParams_t *params)
+{
+    BLE &central = BLE::Instance(0);
+    central.gap().stopScan();
+    central.gap().connect(params->peerAddr, BLEProtocol::AddressType::RANDOM_STATIC, NULL, NULL);
+}
+
+static void onConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    centralHandle = params->handle;
+    connected     = true;
+}
+
+static void onHVX(const GattHVXCallbackParams *params)
+{
+    receivedBytes += params->len;
+}
+
+/* Queue notifications until the transmit queue is full. */
+static void pump(void)
+{
+    while (streaming &&
+           (BLE::Instance(1).gattServer().write(notifyCharacteristic.getValueHandle(), value, payloadLen) == BLE_ERROR_NONE)) {
+        /* keep queuing */
+    }
+}
+
+static void onDataSent(unsigned count)
+{
+    (void)count;
+    pump();
+}
+
+static unsigned measure(SimulatedMedium &medium, const char *label)
+{
+    static const unsigned SECONDS = 5;
+
+    receivedBytes = 0;
+    streaming     = true;
+    pump();
+    medium.runFor(SECONDS * SimulatedMedium::ONE_SECOND);
+    streaming = false;
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+
+    unsigned throughput = receivedBytes / SECONDS;
+    printf("%-32s %7u B/s\n", label, throughput);
+    return throughput;
+}
+
+int main(void)
+{
+    SimulatedMedium &medium     = SimulatedMedium::getDefault();
+    BLE             &central    = BLE::Instance(0);
+    BLE             &peripheral = BLE::Instance(1);
+
+    central.init(onInit);
+    peripheral.init(onInit);
+    peripheral.gattServer().addService(service);
+    central.gap().onConnection(onConnection);
+    central.gattClient().onHVX(onHVX);
+    peripheral.gattServer().onDataSent(onDataSent);
+
+    peripheral.gap().accumulateAdvertisingPayload(GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE);
+    peripheral.gap().setAdvertisingInterval(100);
+    peripheral.gap().startAdvertising();
+    central.gap().setScanParams(100, 100);
+    central.gap().startScan(onAdvertisementReport);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    if (!connected) {
+        fprintf(stderr, "no connection\n");
+        return 1;
+    }
+
+    const Gap::ConnectionParams_t params = { 6, 6, 0, 400 };
+    central.gap().updateConnectionParams(centralHandle, &params);
+    const uint8_t cccd[2] = { BLE_HVX_NOTIFICATION, 0 };
+    central.gattClient().write(GattClient::GATT_OP_WRITE_REQ, centralHandle, notifyCharacteristic.getValueHandle() + 1, sizeof(cccd), cccd);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+
+    unsigned baseline = measure(medium, "20 B payload, 1M, 27 B PDU");
+
+    central.gattClient().negotiateAttMtu(centralHandle);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    payloadLen = MAX_PAYLOAD_LEN;
+    measure(medium, "244 B payload, 1M, 27 B PDU");
+
+    central.gap().updateDataLength(centralHandle);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    measure(medium, "244 B payload, 1M, 251 B PDU");
+
+    central.gap().updatePhy(centralHandle);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    unsigned best = measure(medium, "244 B payload, 2M, 251 B PDU");
+
+    return ((baseline > 0) && (best > baseline)) ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * VirtualWhitelist on the simulated transport: a central (instance 0)
+ * ignores the advertising of a peripheral (instance 1) until it is listed,
+ * and the peripheral disconnects the central, silently, until it is listed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ble/BLE.h"
+#include "ble/VirtualWhitelist.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                           \
+        }                                                                       \
+    } while (0)
+
+static VirtualWhitelist::Entry_t centralStorage[4];
+static VirtualWhitelist::Entry_t peripheralStorage[4];
+static VirtualWhitelist          centralWhitelist(centralStorage, 4);
+static VirtualWhitelist          peripheralWhitelist(peripheralStorage, 4);
+
+static unsigned reports;
+static unsigned connections[2];
+static unsigned disconnections[2];
+
+static void onInit(BLE::InitializationCompleteCallbackContext *context)
+{
+    (void)context;
+}
+
+static void onAdvertisementReport(const Gap::AdvertisementCallbackParams_t *params)
+{
+    BLE &central = BLE::Instance(0);
+    ++reports;
+    central.gap().stopScan();
+    central.gap().connect(params->peerAddr, BLEProtocol::AddressType::RANDOM_STATIC, NULL, NULL);
+}
+
+static void onCentralConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    (void)params;
+    ++connections[0];
+}
+
+static void onPeripheralConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    (void)params;
+    ++connections[1];
+}
+
+static void onCentralDisconnection(const Gap::DisconnectionCallbackParams_t *params)
+{
+    (void)params;
+    ++disconnections[0];
+}
+
+static void onPeripheralDisconnection(const Gap::DisconnectionCallbackParams_t *params)
+{
+    (void)params;
+    ++disconnections[1];
+}
+
+static BLEProtocol::Address_t getAddress(BLE &ble)
+{
+    BLEProtocol::Address_t address;
+    ble.gap().getAddress(&address.type, address.address);
+    return address;
+}
+
+int main(void)
+{
+    SimulatedMedium &medium     = SimulatedMedium::getDefault();
+    BLE             &central    = BLE::Instance(0);
+    BLE             &peripheral = BLE::Instance(1);
+
+    CHECK(central.init(onInit) == BLE_ERROR_NONE);
+    CHECK(peripheral.init(onInit) == BLE_ERROR_NONE);
+
+    central.gap().onConnection(onCentralConnection);
+    central.gap().onDisconnection(onCentralDisconnection);
+    peripheral.gap().onConnection(onPeripheralConnection);
+    peripheral.gap().onDisconnection(onPeripheralDisconnection);
+
+    /* Each device lists an unrelated address only. */
+    const BLEProtocol::AddressBytes_t unrelated = { 0x01, 0x02, 0x03, 0x04, 0x05, 0xC6 };
+    CHECK(centralWhitelist.add(BLEProtocol::Address_t(BLEProtocol::AddressType::RANDOM_STATIC, unrelated)) == BLE_ERROR_NONE);
+    CHECK(peripheralWhitelist.add(BLEProtocol::Address_t(BLEProtocol::AddressType::RANDOM_STATIC, unrelated)) == BLE_ERROR_NONE);
+    central.gap().setVirtualWhitelist(&centralWhitelist);
+    peripheral.gap().setVirtualWhitelist(&peripheralWhitelist);
+
+    /* The advertising of the peripheral is filtered out. */
+    peripheral.gap().setAdvertisingInterval(100);
+    CHECK(peripheral.gap().startAdvertising() == BLE_ERROR_NONE);
+    central.gap().setScanParams(100, 100);
+    CHECK(central.gap().startScan(onAdvertisementReport) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK((reports == 0) && (centralWhitelist.getAdvertisementRejectCount() > 0));
+
+    /* Listed, it is reported, and the central connects; the peripheral
+     * rejects the connection without reporting it, and advertises again. */
+    CHECK(centralWhitelist.add(getAddress(peripheral)) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK((reports == 1) && (connections[0] == 1) && (disconnections[0] == 1));
+    CHECK((connections[1] == 0) && (disconnections[1] == 0));
+    CHECK(peripheralWhitelist.getConnectionRejectCount() == 1);
+    CHECK(peripheral.gap().getState().advertising && !peripheral.gap().getState().connected);
+
+    /* Listed on the peripheral too, the central stays connected. */
+    CHECK(peripheralWhitelist.add(getAddress(central)) == BLE_ERROR_NONE);
+    CHECK(central.gap().startScan(onAdvertisementReport) == BLE_ERROR_NONE);
+    medium.runFor(SimulatedMedium::ONE_SECOND);
+    CHECK((reports == 2) && (connections[0] == 2) && (disconnections[0] == 1));
+    CHECK((connections[1] == 1) && (disconnections[1] == 0));
+    CHECK(peripheralWhitelist.getConnectionRejectCount() == 1);
+
+    printf("virtual whitelist test passed\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ble/Gap.h"
+#include "ble/AdaptiveScanController.h"
+
+AdaptiveScanController::AdaptiveScanController(Gap      &gapIn,
+                                               uint16_t  fastIntervalIn,
+                                               uint16_t  fastWindowIn,
+                                               uint16_t  slowIntervalIn,
+                                               uint16_t  slowWindowIn,
+                                               uint32_t  evaluationPeriodIn,
+                                               uint8_t   burstThresholdIn) :
+    gap(gapIn),
+    fastInterval(fastIntervalIn),
+    fastWindow(fastWindowIn),
+    slowInterval(slowIntervalIn),
+    slowWindow(slowWindowIn),
+    evaluationPeriod(evaluationPeriodIn),
+    burstThreshold(burstThresholdIn ? burstThresholdIn : 1),
+    level(0),
+    newDevices(0),
+    periodEnd(0),
+    updateCount(0)
+{
+    /* empty */
+}
+
+ble_error_t
+AdaptiveScanController::start(uint32_t now)
+{
+    newDevices = 0;
+    periodEnd  = now + evaluationPeriod;
+    return applyLevel(0);
+}
+
+uint32_t
+AdaptiveScanController::process(uint32_t now)
+{
+    if ((int32_t)(now - periodEnd) < 0) {
+        return periodEnd - now;
+    }
+
+    if (newDevices >= burstThreshold) {
+        applyLevel(0);
+    } else if ((newDevices == 0) && (level < (BLE_ADAPTIVE_SCAN_LEVELS - 1))) {
+        applyLevel(level + 1);
+    }
+
+    newDevices = 0;
+    periodEnd  = now + evaluationPeriod;
+    return evaluationPeriod;
+}
+
+ble_error_t
+AdaptiveScanController::applyLevel(uint8_t newLevel)
+{
+    /* Interpolate linearly between the fast and the slow settings. */
+    int32_t  steps    = BLE_ADAPTIVE_SCAN_LEVELS - 1;
+    uint16_t interval = fastInterval + (((int32_t)slowInterval - fastInterval) * newLevel) / steps;
+    uint16_t window   = fastWindow   + (((int32_t)slowWindow   - fastWindow)   * newLevel) / steps;
+
+    ble_error_t rc = gap.updateScanParams(interval, window);
+    if (rc == BLE_ERROR_NONE) {
+        if (newLevel != level) {
+            ++updateCount;
+        }
+        level = newLevel;
+    }
+
+    return rc;
+}
@@ -21,11 +21,17 @@
 #include "ble/services/DFUService.h"
 #endif
 
+#if defined(BLE_SIMULATOR)
+#include "ble/simulator/SimulatedBLEInstance.h"
+#endif
+
 #ifdef YOTTA_CFG_MBED_OS
 #include <minar/minar.h>
 #endif
 
-#if !defined(YOTTA_CFG_MBED_OS)
+#if defined(BLE_SIMULATOR)
+#include "ble/simulator/SimulatedPlatform.h"
+#elif !defined(YOTTA_CFG_MBED_OS)
 #include <mbed_error.h>
 #include <toolchain.h>
 #endif
@@ -139,7 +145,7 @@ void defaultSchedulingCallback(BLE::OnEventsToProcessCallbackContext* params) {
 
 
 BLE::BLE(InstanceID_t instanceIDIn) : instanceID(instanceIDIn), transport(),
-    whenEventsToProcess(defaultSchedulingCallback)
+    whenEventsToProcess(defaultSchedulingCallback), deferredEventQueue(NULL), deferredEventBudget(0)
 {
     static BLEInstanceBase *transportInstances[NUM_INSTANCES];
 
@@ -268,6 +274,104 @@ void BLE::processEvents()
     }
 
     transport->processEvents();
+
+    if (deferredEventQueue && dispatchDeferredEvents(deferredEventBudget)) {
+        /* The budget is exhausted; ask to be called again for the rest. */
+        signalEventsToProcess();
+    }
+}
+
+ble_error_t BLE::enableDeferredEventDispatch(DeferredEventQueue &queue, unsigned budget)
+{
+    if (!transport) {
+        error("bad handle to underlying transport");
+    }
+
+    if (!queue.isValid()) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    if (deferredEventQueue) {
+        disableDeferredEventDispatch();
+    }
+
+    deferredEventQueue  = &queue;
+    deferredEventBudget = budget;
+    queue.setEventsPendingCallback(makeFunctionPointer(this, &BLE::signalDeferredEvents));
+
+    transport->getGap().setDeferredEventQueue(&queue);
+    transport->getGattServer().setDeferredEventQueue(&queue);
+    transport->getGattClient().setDeferredEventQueue(&queue);
+
+    return BLE_ERROR_NONE;
+}
+
+void BLE::disableDeferredEventDispatch(void)
+{
+    if (!deferredEventQueue) {
+        return;
+    }
+
+    transport->getGap().setDeferredEventQueue(NULL);
+    transport->getGattServer().setDeferredEventQueue(NULL);
+    transport->getGattClient().setDeferredEventQueue(NULL);
+
+    dispatchDeferredEvents(0);
+    deferredEventQueue->setEventsPendingCallback(NULL);
+    deferredEventQueue = NULL;
+}
+
+void BLE::signalDeferredEvents(DeferredEventQueue *)
+{
+    signalEventsToProcess();
+}
+
+bool BLE::dispatchDeferredEvents(unsigned budget)
+{
+    const DeferredEvent_t *pending;
+    unsigned dispatched = 0;
+
+    while (deferredEventQueue && ((pending = deferredEventQueue->front()) != NULL)) {
+        if (budget && (dispatched == budget)) {
+            return true;
+        }
+
+        /* Release the slot before dispatching; callbacks may reenter this function. */
+        DeferredEvent_t event = *pending;
+        deferredEventQueue->pop();
+        ++dispatched;
+
+        switch (event.type) {
+            case DeferredEvent_t::GAP_CONNECTION:
+            case DeferredEvent_t::GAP_DISCONNECTION:
+            case DeferredEvent_t::GAP_ADVERTISEMENT_REPORT:
+            case DeferredEvent_t::GAP_TIMEOUT:
+            case DeferredEvent_t::GAP_CONNECTION_PARAMS_UPDATE:
+            case DeferredEvent_t::GAP_DATA_LENGTH_UPDATE:
+            case DeferredEvent_t::GAP_PHY_UPDATE:
+                transport->getGap().dispatchDeferredEvent(event);
+                break;
+            case DeferredEvent_t::GATT_SERVER_DATA_WRITTEN:
+            case DeferredEvent_t::GATT_SERVER_DATA_READ:
+            case DeferredEvent_t::GATT_SERVER_EVENT:
+            case DeferredEvent_t::GATT_SERVER_DATA_SENT:
+            case DeferredEvent_t::GATT_SERVER_ATT_MTU_CHANGE:
+                transport->getGattServer().dispatchDeferredEvent(event);
+                break;
+            case DeferredEvent_t::GATT_CLIENT_READ_RESPONSE:
+            case DeferredEvent_t::GATT_CLIENT_WRITE_RESPONSE:
+            case DeferredEvent_t::GATT_CLIENT_HVX:
+            case DeferredEvent_t::GATT_CLIENT_ATT_MTU_CHANGE:
+                transport->getGattClient().dispatchDeferredEvent(event);
+                break;
+            default:
+                /* Every type of event must be routed above. */
+                error("unrouted deferred event type %u", (unsigned)event.type);
+                break;
+        }
+    }
+
+    return false;
 }
 
 void BLE::onEventsToProcess(const BLE::OnEventsToProcessCallback_t& callback)
@@ -0,0 +1,342 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ble/ConnectionParamsPolicy.h"
+
+const uint32_t ConnectionParamsPolicy::REQUEST_TIMEOUT;
+
+/* Limits of the connection parameters, in their respective units. */
+static const uint16_t MIN_CONNECTION_INTERVAL = 6;    /* 7.5 ms */
+static const uint16_t MAX_CONNECTION_INTERVAL = 3200; /* 4 s */
+static const uint16_t MAX_SLAVE_LATENCY       = 499;
+static const uint16_t MIN_SUPERVISION_TIMEOUT = 10;   /* 100 ms */
+static const uint16_t MAX_SUPERVISION_TIMEOUT = 3200; /* 32 s */
+
+/* Default parameters of the profiles, in the order of Profile_t. */
+static const Gap::ConnectionParams_t defaultProfiles[ConnectionParamsPolicy::NUM_PROFILES] = {
+    {   6,   6, 0, 200 }, /* PROFILE_LOW_LATENCY:    7.5 ms,       2 s timeout */
+    {  12,  24, 0, 400 }, /* PROFILE_MAX_THROUGHPUT: 15 - 30 ms,   4 s timeout */
+    {  40,  80, 0, 400 }, /* PROFILE_BALANCED:       50 - 100 ms,  4 s timeout */
+    { 320, 400, 4, 600 }  /* PROFILE_LOW_POWER:      400 - 500 ms, latency 4, 6 s timeout */
+};
+
+/**
+ * The supervision timeout must be larger than (1 + slaveLatency) * maxConnectionInterval * 2,
+ * that is timeout * 10 ms > (1 + latency) * interval * 1.25 ms * 2.
+ */
+static bool isSupervisionTimeoutValid(uint16_t timeout, uint16_t latency, uint16_t maxInterval)
+{
+    return ((uint32_t)timeout * 4) > ((uint32_t)(1 + latency) * maxInterval);
+}
+
+ConnectionParamsPolicy::ConnectionParamsPolicy(Gap       &gapIn,
+                                               Profile_t  activeProfileIn,
+                                               Profile_t  idleProfileIn,
+                                               uint32_t   idleTimeoutIn,
+                                               uint16_t   burstThresholdIn,
+                                               uint32_t   burstWindowIn) :
+    gap(gapIn),
+    activeProfile((activeProfileIn < NUM_PROFILES) ? activeProfileIn : PROFILE_LOW_LATENCY),
+    idleProfile((idleProfileIn < NUM_PROFILES) ? idleProfileIn : PROFILE_LOW_POWER),
+    idleTimeout(idleTimeoutIn),
+    burstThreshold(burstThresholdIn ? burstThresholdIn : 1),
+    burstWindow(burstWindowIn),
+    links(),
+    lastNow(0),
+    requestCount(0),
+    rejectCount(0),
+    registrationStatus(BLE_ERROR_NONE)
+{
+    for (unsigned i = 0; i < NUM_PROFILES; ++i) {
+        profiles[i] = defaultProfiles[i];
+    }
+
+    if ((gap.onConnection(this, &ConnectionParamsPolicy::onConnection) != BLE_ERROR_NONE) ||
+        (gap.onDisconnection(this, &ConnectionParamsPolicy::onDisconnection) != BLE_ERROR_NONE) ||
+        (gap.onConnectionParamsUpdate(this, &ConnectionParamsPolicy::onConnectionParamsUpdate) != BLE_ERROR_NONE)) {
+        registrationStatus = BLE_ERROR_NO_MEM;
+    }
+}
+
+ConnectionParamsPolicy::~ConnectionParamsPolicy()
+{
+    gap.onConnection().detach(Gap::ConnectionEventCallback_t(this, &ConnectionParamsPolicy::onConnection));
+    gap.onDisconnection().detach(Gap::DisconnectionEventCallback_t(this, &ConnectionParamsPolicy::onDisconnection));
+    gap.onConnectionParamsUpdate().detach(Gap::ConnectionParamsUpdateEventCallback_t(this, &ConnectionParamsPolicy::onConnectionParamsUpdate));
+}
+
+ble_error_t
+ConnectionParamsPolicy::setProfileParams(Profile_t profile, const Gap::ConnectionParams_t &params)
+{
+    if (profile >= NUM_PROFILES) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+    if ((params.minConnectionInterval < MIN_CONNECTION_INTERVAL) ||
+        (params.maxConnectionInterval > MAX_CONNECTION_INTERVAL) ||
+        (params.minConnectionInterval > params.maxConnectionInterval) ||
+        (params.slaveLatency > MAX_SLAVE_LATENCY) ||
+        (params.connectionSupervisionTimeout < MIN_SUPERVISION_TIMEOUT) ||
+        (params.connectionSupervisionTimeout > MAX_SUPERVISION_TIMEOUT) ||
+        !isSupervisionTimeoutValid(params.connectionSupervisionTimeout, params.slaveLatency, params.maxConnectionInterval)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    profiles[profile] = params;
+    return BLE_ERROR_NONE;
+}
+
+void
+ConnectionParamsPolicy::recordTraffic(Gap::Handle_t handle, uint32_t now, uint16_t packets)
+{
+    lastNow = now;
+
+    Link_t *link = findLink(handle);
+    if (link == NULL) {
+        return;
+    }
+
+    if ((now - link->windowStart) >= burstWindow) {
+        link->windowStart = now;
+        link->packets     = 0;
+    }
+    link->packets      = ((uint32_t)link->packets + packets > 0xFFFF) ? 0xFFFF : (link->packets + packets);
+    link->lastActivity = now;
+    if (link->packets >= burstThreshold) {
+        link->active = true;
+    }
+
+    update(*link, now);
+}
+
+void
+ConnectionParamsPolicy::setBulkTransfer(Gap::Handle_t handle, uint32_t now, bool active)
+{
+    lastNow = now;
+
+    Link_t *link = findLink(handle);
+    if (link == NULL) {
+        return;
+    }
+
+    link->bulk         = active;
+    link->lastActivity = now;
+    update(*link, now);
+}
+
+uint32_t
+ConnectionParamsPolicy::process(uint32_t now)
+{
+    lastNow = now;
+
+    uint32_t delay = 0;
+    for (unsigned i = 0; i < BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS; ++i) {
+        Link_t &link = links[i];
+        if (!link.used) {
+            continue;
+        }
+
+        if (link.pending && ((now - link.requestTime) >= REQUEST_TIMEOUT)) {
+            handleRejection(link, now);
+        }
+
+        if (link.active && !link.bulk && ((now - link.lastActivity) >= idleTimeout)) {
+            link.active = false;
+        }
+        update(link, now);
+
+        /* Compute the delay until the next timeout of this link. */
+        uint32_t linkDelay = 0;
+        if (link.pending) {
+            linkDelay = REQUEST_TIMEOUT - (now - link.requestTime);
+        }
+        if (link.active && !link.bulk) {
+            uint32_t idleDelay = idleTimeout - (now - link.lastActivity);
+            if ((linkDelay == 0) || (idleDelay < linkDelay)) {
+                linkDelay = idleDelay;
+            }
+        }
+        if ((linkDelay != 0) && ((delay == 0) || (linkDelay < delay))) {
+            delay = linkDelay;
+        }
+    }
+
+    return delay;
+}
+
+ConnectionParamsPolicy::Profile_t
+ConnectionParamsPolicy::getProfile(Gap::Handle_t handle) const
+{
+    for (unsigned i = 0; i < BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS; ++i) {
+        if (links[i].used && (links[i].handle == handle)) {
+            return static_cast<Profile_t>(links[i].profile);
+        }
+    }
+
+    return PROFILE_NONE;
+}
+
+void
+ConnectionParamsPolicy::onConnection(const Gap::ConnectionCallbackParams_t *params)
+{
+    for (unsigned i = 0; i < BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS; ++i) {
+        Link_t &link = links[i];
+        if (link.used) {
+            continue;
+        }
+
+        link.handle       = params->handle;
+        link.used         = true;
+        link.pending      = false;
+        link.bulk         = false;
+        link.active       = false;
+        link.profile      = PROFILE_NONE;
+        link.wanted       = PROFILE_NONE;
+        link.requested    = PROFILE_NONE;
+        link.retries      = 0;
+        link.packets      = 0;
+        link.windowStart  = lastNow;
+        link.lastActivity = lastNow;
+        link.requestTime  = 0;
+        return;
+    }
+}
+
+void
+ConnectionParamsPolicy::onDisconnection(const Gap::DisconnectionCallbackParams_t *params)
+{
+    Link_t *link = findLink(params->handle);
+    if (link != NULL) {
+        link->used = false;
+    }
+}
+
+void
+ConnectionParamsPolicy::onConnectionParamsUpdate(const Gap::ConnectionParamsUpdateCallbackParams_t *params)
+{
+    Link_t *link = findLink(params->handle);
+    if (link == NULL) {
+        return;
+    }
+
+    if (!link->pending) {
+        /* Procedure started by the peer. */
+        if (params->status == BLE_ERROR_NONE) {
+            link->profile = PROFILE_NONE;
+        }
+        return;
+    }
+
+    if (params->status != BLE_ERROR_NONE) {
+        handleRejection(*link, lastNow);
+        return;
+    }
+
+    link->pending = false;
+    link->profile = link->requested;
+    if (link->requested != link->wanted) {
+        /* The wanted profile changed while the request was in progress. */
+        request(*link, lastNow);
+    }
+}
+
+ConnectionParamsPolicy::Link_t *
+ConnectionParamsPolicy::findLink(Gap::Handle_t handle)
+{
+    for (unsigned i = 0; i < BLE_CONNECTION_PARAMS_POLICY_MAX_LINKS; ++i) {
+        if (links[i].used && (links[i].handle == handle)) {
+            return &links[i];
+        }
+    }
+
+    return NULL;
+}
+
+void
+ConnectionParamsPolicy::update(Link_t &link, uint32_t now)
+{
+    uint8_t wanted;
+    if (link.bulk) {
+        wanted = PROFILE_MAX_THROUGHPUT;
+    } else if (link.active) {
+        wanted = activeProfile;
+    } else {
+        wanted = idleProfile;
+    }
+
+    if (wanted == link.wanted) {
+        return;
+    }
+
+    link.wanted  = wanted;
+    link.retries = 0;
+    if (!link.pending) {
+        request(link, now);
+    }
+}
+
+void
+ConnectionParamsPolicy::request(Link_t &link, uint32_t now)
+{
+    if (link.wanted == link.profile) {
+        return;
+    }
+
+    /* Every retry doubles the connection intervals. */
+    Gap::ConnectionParams_t params = profiles[link.wanted];
+    for (unsigned i = 0; i < link.retries; ++i) {
+        params.minConnectionInterval = (params.minConnectionInterval * 2 > MAX_CONNECTION_INTERVAL) ?
+                                       MAX_CONNECTION_INTERVAL : (params.minConnectionInterval * 2);
+        params.maxConnectionInterval = (params.maxConnectionInterval * 2 > MAX_CONNECTION_INTERVAL) ?
+                                       MAX_CONNECTION_INTERVAL : (params.maxConnectionInterval * 2);
+    }
+    while (!isSupervisionTimeoutValid(params.connectionSupervisionTimeout, params.slaveLatency, params.maxConnectionInterval)) {
+        if (params.connectionSupervisionTimeout < MAX_SUPERVISION_TIMEOUT) {
+            params.connectionSupervisionTimeout = MAX_SUPERVISION_TIMEOUT;
+        } else {
+            --params.slaveLatency;
+        }
+    }
+
+    /* The stack may report the outcome before updateConnectionParams() returns. */
+    ++requestCount;
+    link.pending     = true;
+    link.requested   = link.wanted;
+    link.requestTime = now;
+    if (gap.updateConnectionParams(link.handle, &params) != BLE_ERROR_NONE) {
+        /* The request is retried when the wanted profile changes. */
+        --requestCount;
+        link.pending = false;
+    }
+}
+
+void
+ConnectionParamsPolicy::handleRejection(Link_t &link, uint32_t now)
+{
+    ++rejectCount;
+    link.pending = false;
+
+    if (link.requested != link.wanted) {
+        /* The wanted profile changed while the request was in progress. */
+        link.retries = 0;
+    } else if (link.retries < BLE_CONNECTION_PARAMS_POLICY_MAX_RETRIES) {
+        ++link.retries;
+    } else {
+        /* Give up on this profile until the wanted profile changes. */
+        return;
+    }
+
+    request(link, now);
+}
@@ -32,11 +32,28 @@ DiscoveredCharacteristic::read(uint16_t offset) const
 }
 
 struct OneShotReadCallback {
-    static void launch(GattClient* client, Gap::Handle_t connHandle,
-                       GattAttribute::Handle_t handle, const GattClient::ReadCallback_t& cb) {
+    /**
+     * Register a one-shot callback; it deletes itself once called.
+     *
+     * @return The callback, or NULL if it could not be registered.
+     */
+    static OneShotReadCallback* launch(GattClient* client, Gap::Handle_t connHandle,
+                                     GattAttribute::Handle_t handle, const GattClient::ReadCallback_t& cb) {
         OneShotReadCallback* oneShot = new OneShotReadCallback(client, connHandle, handle, cb);
-        oneShot->attach();
-        // delete will be made when this callback is called
+        if (oneShot && !oneShot->attach()) {
+            delete oneShot;
+            return NULL;
+        }
+        // otherwise, delete will be made when this callback is called
+        return oneShot;
+    }
+
+    /**
+     * Unregister and delete a callback which will not be called.
+     */
+    void cancel() {
+        _client->onDataRead().detach(_registration);
+        delete this;
     }
 
 private:
@@ -45,17 +62,19 @@ private:
         _client(client),
         _connHandle(connHandle),
         _handle(handle),
-        _callback(cb) { }
+        _callback(cb),
+        _registration(NULL) { }
 
-    void attach() {
-        _client->onDataRead(makeFunctionPointer(this, &OneShotReadCallback::call));
+    bool attach() {
+        _registration = _client->onDataRead().add(makeFunctionPointer(this, &OneShotReadCallback::call));
+        return _registration != NULL;
     }
 
     void call(const GattReadCallbackParams* params) {
         // verifiy that it is the right characteristic on the right connection
         if (params->connHandle == _connHandle && params->handle == _handle) {
             _callback(params);
-            _client->onDataRead().detach(makeFunctionPointer(this, &OneShotReadCallback::call));
+            _client->onDataRead().detach(_registration);
             delete this;
         }
     }
@@ -64,16 +83,29 @@ private:
     Gap::Handle_t _connHandle;
     GattAttribute::Handle_t _handle;
     GattClient::ReadCallback_t _callback;
+    GattClient::ReadCallbackChain_t::pFunctionPointerWithContext_t _registration;
 };
 
 ble_error_t DiscoveredCharacteristic::read(uint16_t offset, const GattClient::ReadCallback_t& onRead) const {
+    if (!props.read()) {
+        return BLE_ERROR_OPERATION_NOT_PERMITTED;
+    }
+
+    if (!gattc) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    // register first: the response may be reported before read() returns
+    OneShotReadCallback* oneShot = OneShotReadCallback::launch(gattc, connHandle, valueHandle, onRead);
+    if (!oneShot) {
+        return BLE_ERROR_NO_MEM;
+    }
+
     ble_error_t error = read(offset);
     if (error) {
-        return error;
+        oneShot->cancel();
     }
 
-    OneShotReadCallback::launch(gattc, connHandle, valueHandle, onRead);
-
     return error;
 }
 
@@ -106,11 +138,28 @@ DiscoveredCharacteristic::writeWoResponse(uint16_t length, const uint8_t *value)
 }
 
 struct OneShotWriteCallback {
-    static void launch(GattClient* client, Gap::Handle_t connHandle,
-                       GattAttribute::Handle_t handle, const GattClient::WriteCallback_t& cb) {
+    /**
+     * Register a one-shot callback; it deletes itself once called.
+     *
+     * @return The callback, or NULL if it could not be registered.
+     */
+    static OneShotWriteCallback* launch(GattClient* client, Gap::Handle_t connHandle,
+                                     GattAttribute::Handle_t handle, const GattClient::WriteCallback_t& cb) {
         OneShotWriteCallback* oneShot = new OneShotWriteCallback(client, connHandle, handle, cb);
-        oneShot->attach();
-        // delete will be made when this callback is called
+        if (oneShot && !oneShot->attach()) {
+            delete oneShot;
+            return NULL;
+        }
+        // otherwise, delete will be made when this callback is called
+        return oneShot;
+    }
+
+    /**
+     * Unregister and delete a callback which will not be called.
+     */
+    void cancel() {
+        _client->onDataWritten().detach(_registration);
+        delete this;
     }
 
 private:
@@ -119,17 +168,19 @@ private:
         _client(client),
         _connHandle(connHandle),
         _handle(handle),
-        _callback(cb) { }
+        _callback(cb),
+        _registration(NULL) { }
 
-    void attach() {
-        _client->onDataWritten(makeFunctionPointer(this, &OneShotWriteCallback::call));
+    bool attach() {
+        _registration = _client->onDataWritten().add(makeFunctionPointer(this, &OneShotWriteCallback::call));
+        return _registration != NULL;
     }
 
     void call(const GattWriteCallbackParams* params) {
         // verifiy that it is the right characteristic on the right connection
         if (params->connHandle == _connHandle && params->handle == _handle) {
             _callback(params);
-            _client->onDataWritten().detach(makeFunctionPointer(this, &OneShotWriteCallback::call));
+            _client->onDataWritten().detach(_registration);
             delete this;
         }
     }
@@ -138,16 +189,29 @@ private:
     Gap::Handle_t _connHandle;
     GattAttribute::Handle_t _handle;
     GattClient::WriteCallback_t _callback;
+    GattClient::WriteCallbackChain_t::pFunctionPointerWithContext_t _registration;
 };
 
 ble_error_t DiscoveredCharacteristic::write(uint16_t length, const uint8_t *value, const GattClient::WriteCallback_t& onRead) const {
+    if (!props.write()) {
+        return BLE_ERROR_OPERATION_NOT_PERMITTED;
+    }
+
+    if (!gattc) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    // register first: the response may be reported before write() returns
+    OneShotWriteCallback* oneShot = OneShotWriteCallback::launch(gattc, connHandle, valueHandle, onRead);
+    if (!oneShot) {
+        return BLE_ERROR_NO_MEM;
+    }
+
     ble_error_t error = write(length, value);
     if (error) {
-        return error;
+        oneShot->cancel();
     }
 
-    OneShotWriteCallback::launch(gattc, connHandle, valueHandle, onRead);
-
     return error;
 }
 
@@ -0,0 +1,34 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ble/GapScanFilter.h"
+#include "ble/PrivateAddressResolver.h"
+
+bool
+GapScanFilter::matchIdentity(const BLEProtocol::AddressBytes_t peerAddr) const
+{
+    BLEProtocol::Address_t identity;
+    bool                   resolved = resolver->resolve(peerAddr, &identity);
+
+    if ((criteria & CRITERION_BONDED) && !resolved) {
+        return false;
+    }
+    if (criteria & CRITERION_ADDRESS) {
+        return matchAddress(peerAddr) || (resolved && matchAddress(identity.address));
+    }
+
+    return true;
+}
@@ -0,0 +1,305 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "ble/PrivateAddressResolver.h"
+
+const uint16_t PrivateAddressResolver::NO_IDENTITY;
+const uint16_t PrivateAddressResolver::EMPTY_ENTRY;
+
+/* AES-128 block cipher (FIPS-197), the security function e of the Core
+ * Specification. Round keys are derived on the fly, so nothing is stored per
+ * key. */
+
+static const unsigned AES_BLOCK_LEN = 16;
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static uint8_t xtime(uint8_t value)
+{
+    return (uint8_t)((value << 1) ^ ((value & 0x80) ? 0x1B : 0x00));
+}
+
+/**
+ * Encrypt @p block in place with @p key, both most significant octet first.
+ */
+static void aes128Encrypt(const uint8_t key[AES_BLOCK_LEN], uint8_t block[AES_BLOCK_LEN])
+{
+    uint8_t roundKey[AES_BLOCK_LEN];
+    memcpy(roundKey, key, AES_BLOCK_LEN);
+    for (unsigned i = 0; i < AES_BLOCK_LEN; ++i) {
+        block[i] ^= roundKey[i];
+    }
+
+    uint8_t rcon = 0x01;
+    for (unsigned round = 1; round <= 10; ++round) {
+        /* SubBytes and ShiftRows; the state is stored column by column. */
+        uint8_t state[AES_BLOCK_LEN];
+        for (unsigned column = 0; column < 4; ++column) {
+            for (unsigned row = 0; row < 4; ++row) {
+                state[(4 * column) + row] = sbox[block[(4 * ((column + row) % 4)) + row]];
+            }
+        }
+
+        /* MixColumns, except in the last round. */
+        if (round != 10) {
+            for (unsigned column = 0; column < 4; ++column) {
+                uint8_t *a  = &state[4 * column];
+                uint8_t  a0 = a[0];
+                uint8_t  t  = a[0] ^ a[1] ^ a[2] ^ a[3];
+                a[0] ^= t ^ xtime(a[0] ^ a[1]);
+                a[1] ^= t ^ xtime(a[1] ^ a[2]);
+                a[2] ^= t ^ xtime(a[2] ^ a[3]);
+                a[3] ^= t ^ xtime(a[3] ^ a0);
+            }
+        }
+
+        /* Next round key. */
+        roundKey[0] ^= sbox[roundKey[13]] ^ rcon;
+        roundKey[1] ^= sbox[roundKey[14]];
+        roundKey[2] ^= sbox[roundKey[15]];
+        roundKey[3] ^= sbox[roundKey[12]];
+        for (unsigned i = 4; i < AES_BLOCK_LEN; ++i) {
+            roundKey[i] ^= roundKey[i - 4];
+        }
+        rcon = xtime(rcon);
+
+        for (unsigned i = 0; i < AES_BLOCK_LEN; ++i) {
+            block[i] = state[i] ^ roundKey[i];
+        }
+    }
+}
+
+/**
+ * Build the plaintext of the random address hash function ah: the 24-bit
+ * prand of @p address, padded with zeros, most significant octet first.
+ */
+static void buildHashPlaintext(const BLEProtocol::AddressBytes_t address, uint8_t plaintext[AES_BLOCK_LEN])
+{
+    memset(plaintext, 0, AES_BLOCK_LEN);
+    plaintext[13] = address[5];
+    plaintext[14] = address[4];
+    plaintext[15] = address[3];
+}
+
+/**
+ * Evaluate ah with @p irk on @p plaintext, and compare the result to the hash
+ * of @p address.
+ */
+static bool checkHash(const SecurityManager::Irk_t           irk,
+                      const uint8_t                          plaintext[AES_BLOCK_LEN],
+                      const BLEProtocol::AddressBytes_t      address)
+{
+    /* The IRK is stored least significant octet first. */
+    uint8_t key[AES_BLOCK_LEN];
+    for (unsigned i = 0; i < AES_BLOCK_LEN; ++i) {
+        key[i] = irk[AES_BLOCK_LEN - 1 - i];
+    }
+
+    uint8_t block[AES_BLOCK_LEN];
+    memcpy(block, plaintext, AES_BLOCK_LEN);
+    aes128Encrypt(key, block);
+
+    return (block[13] == address[2]) && (block[14] == address[1]) && (block[15] == address[0]);
+}
+
+PrivateAddressResolver::PrivateAddressResolver(SecurityManager::Identity_t  *identityStorage,
+                                               uint16_t                      identityCapacityIn,
+                                               CacheEntry_t                 *cacheStorage,
+                                               uint16_t                      cacheCapacityIn,
+                                               uint32_t                    (*clockIn)(void)) :
+    identities(identityStorage),
+    identityCapacity((identityCapacityIn < EMPTY_ENTRY) ? identityCapacityIn : (EMPTY_ENTRY - 1)),
+    identityCount(0),
+    cache(cacheStorage),
+    cacheCapacity(cacheCapacityIn),
+    clock(clockIn),
+    cacheHitCount(0),
+    cacheMissCount(0),
+    cipherCount(0)
+{
+    flushCache();
+}
+
+ble_error_t
+PrivateAddressResolver::loadBondTable(const SecurityManager &securityManager)
+{
+    clear();
+
+    SecurityManager::IdentityList_t list;
+    list.identities = identities;
+    list.size       = 0;
+    list.capacity   = identityCapacity;
+    ble_error_t err = securityManager.getIdentitiesFromBondTable(list);
+    if (err != BLE_ERROR_NONE) {
+        return err;
+    }
+
+    identityCount = (list.size < identityCapacity) ? list.size : identityCapacity;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t
+PrivateAddressResolver::addIdentity(const BLEProtocol::Address_t &address, const SecurityManager::Irk_t irk)
+{
+    if (identityCount >= identityCapacity) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    identities[identityCount].address = address;
+    memcpy(identities[identityCount].irk, irk, SecurityManager::IRK_LEN);
+    ++identityCount;
+
+    /* Addresses cached as unresolved may resolve to the new identity. */
+    flushCache();
+    return BLE_ERROR_NONE;
+}
+
+void
+PrivateAddressResolver::clear(void)
+{
+    identityCount = 0;
+    flushCache();
+}
+
+void
+PrivateAddressResolver::flushCache(void)
+{
+    for (uint16_t i = 0; i < cacheCapacity; ++i) {
+        cache[i].identity = EMPTY_ENTRY;
+    }
+}
+
+bool
+PrivateAddressResolver::resolve(const BLEProtocol::AddressBytes_t address, BLEProtocol::Address_t *identityP)
+{
+    uint16_t identity = NO_IDENTITY;
+
+    if (cacheCapacity == 0) {
+        ++cacheMissCount;
+        identity = lookup(address);
+    } else {
+        uint32_t now = clock ? clock() : 0;
+
+        /* The low octets of a private address are random, and so is the hash
+         * of the entries. An address is stored in one of the
+         * BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_WAYS entries following it. */
+        unsigned      start  = (address[0] | (address[1] << 8) | ((unsigned)address[3] << 16)) % cacheCapacity;
+        CacheEntry_t *victim = NULL;
+        CacheEntry_t *found  = NULL;
+        for (unsigned way = 0; (way < BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_WAYS) && (way < cacheCapacity); ++way) {
+            CacheEntry_t &entry = cache[(start + way) % cacheCapacity];
+            if ((entry.identity != EMPTY_ENTRY) && clock &&
+                ((now - entry.storedAt) >= BLE_PRIVATE_ADDRESS_RESOLVER_CACHE_TTL)) {
+                entry.identity = EMPTY_ENTRY;
+            }
+
+            if (entry.identity == EMPTY_ENTRY) {
+                if ((victim == NULL) || (victim->identity != EMPTY_ENTRY)) {
+                    victim = &entry;
+                }
+                continue;
+            }
+            if (memcmp(entry.address, address, BLEProtocol::ADDR_LEN) == 0) {
+                found = &entry;
+                break;
+            }
+            if ((victim == NULL) || ((victim->identity != EMPTY_ENTRY) && ((now - entry.storedAt) > (now - victim->storedAt)))) {
+                victim = &entry;
+            }
+        }
+
+        if (found != NULL) {
+            ++cacheHitCount;
+            identity = found->identity;
+        } else {
+            ++cacheMissCount;
+            identity = lookup(address);
+
+            memcpy(victim->address, address, BLEProtocol::ADDR_LEN);
+            victim->identity = identity;
+            victim->storedAt = now;
+        }
+    }
+
+    if (identity == NO_IDENTITY) {
+        return false;
+    }
+
+    if (identityP != NULL) {
+        *identityP = identities[identity].address;
+    }
+    return true;
+}
+
+bool
+PrivateAddressResolver::matchesIrk(const SecurityManager::Irk_t irk, const BLEProtocol::AddressBytes_t address)
+{
+    if (!isResolvable(address)) {
+        return false;
+    }
+
+    uint8_t plaintext[AES_BLOCK_LEN];
+    buildHashPlaintext(address, plaintext);
+    return checkHash(irk, plaintext, address);
+}
+
+uint16_t
+PrivateAddressResolver::lookup(const BLEProtocol::AddressBytes_t address)
+{
+    /* Reports do not carry the type of the address, and a public address
+     * may have the top bits of a resolvable private address: compare the
+     * identity addresses first in every case. */
+    for (uint16_t i = 0; i < identityCount; ++i) {
+        if (memcmp(identities[i].address.address, address, BLEProtocol::ADDR_LEN) == 0) {
+            return i;
+        }
+    }
+    if (!isResolvable(address)) {
+        return NO_IDENTITY;
+    }
+
+    /* The plaintext depends on the address only: build it once for all the
+     * IRKs. */
+    uint8_t plaintext[AES_BLOCK_LEN];
+    buildHashPlaintext(address, plaintext);
+    for (uint16_t i = 0; i < identityCount; ++i) {
+        ++cipherCount;
+        if (checkHash(identities[i].irk, plaintext, address)) {
+            return i;
+        }
+    }
+
+    return NO_IDENTITY;
+}
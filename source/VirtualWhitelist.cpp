@@ -0,0 +1,234 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "ble/VirtualWhitelist.h"
+#include "ble/Gap.h"
+
+VirtualWhitelist::VirtualWhitelist(Entry_t *storage, uint16_t capacityIn) :
+    entries(storage),
+    maxCount(capacityIn),
+    count(0),
+    activityStamp(0),
+    hardwareEntries(),
+    hardwareCount(0),
+    hardwareValid(false),
+    advertisementRejectCount(0),
+    connectionRejectCount(0),
+    hardwareUpdateCount(0)
+{
+    /* empty */
+}
+
+ble_error_t
+VirtualWhitelist::add(const BLEProtocol::Address_t &address)
+{
+    uint16_t index = lowerBound(address.address);
+    if ((index < count) && (memcmp(entries[index].address, address.address, BLEProtocol::ADDR_LEN) == 0)) {
+        entries[index].type = address.type;
+        return BLE_ERROR_NONE;
+    }
+
+    if (count >= maxCount) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    memmove(&entries[index + 1], &entries[index], (count - index) * sizeof(Entry_t));
+    memcpy(entries[index].address, address.address, BLEProtocol::ADDR_LEN);
+    entries[index].type       = address.type;
+    entries[index].lastActive = 0;
+    ++count;
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t
+VirtualWhitelist::remove(const BLEProtocol::AddressBytes_t address)
+{
+    uint16_t index = lowerBound(address);
+    if ((index >= count) || (memcmp(entries[index].address, address, BLEProtocol::ADDR_LEN) != 0)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    --count;
+    memmove(&entries[index], &entries[index + 1], (count - index) * sizeof(Entry_t));
+
+    return BLE_ERROR_NONE;
+}
+
+void
+VirtualWhitelist::clear(void)
+{
+    count = 0;
+}
+
+bool
+VirtualWhitelist::acceptAdvertisement(const BLEProtocol::AddressBytes_t address)
+{
+    if (!markActive(address)) {
+        ++advertisementRejectCount;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+VirtualWhitelist::acceptConnection(const BLEProtocol::AddressBytes_t address)
+{
+    if (!markActive(address)) {
+        ++connectionRejectCount;
+        return false;
+    }
+
+    return true;
+}
+
+ble_error_t
+VirtualWhitelist::syncHardwareWhitelist(Gap &gap)
+{
+    unsigned hardwareSize = gap.getMaxWhitelistSize();
+    if (hardwareSize > BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE) {
+        hardwareSize = BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE;
+    }
+    if (hardwareSize == 0) {
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+    if (gap.claimWhitelist(this) != BLE_ERROR_NONE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    /* Select the most recently active entries, most recent first; on ties
+     * the entries first in the list are kept. */
+    uint16_t selected[BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE];
+    unsigned selectedCount = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (entries[i].type == BLEProtocol::AddressType::RANDOM_PRIVATE_NON_RESOLVABLE) {
+            continue;
+        }
+
+        unsigned position = selectedCount;
+        while ((position > 0) && (entries[selected[position - 1]].lastActive < entries[i].lastActive)) {
+            --position;
+        }
+        if (position >= hardwareSize) {
+            continue;
+        }
+
+        unsigned last = (selectedCount < hardwareSize) ? selectedCount++ : (hardwareSize - 1);
+        for (unsigned j = last; j > position; --j) {
+            selected[j] = selected[j - 1];
+        }
+        selected[position] = i;
+    }
+
+    /* Nothing to do if the controller already holds the same set. */
+    bool changed = !hardwareValid || (selectedCount != hardwareCount);
+    for (unsigned i = 0; !changed && (i < selectedCount); ++i) {
+        const Entry_t &entry = entries[selected[i]];
+        bool found = false;
+        for (unsigned j = 0; !found && (j < hardwareCount); ++j) {
+            found = (hardwareEntries[j].type == entry.type) &&
+                    (memcmp(hardwareEntries[j].address, entry.address, BLEProtocol::ADDR_LEN) == 0);
+        }
+        changed = !found;
+    }
+    if (!changed) {
+        return BLE_ERROR_NONE;
+    }
+
+    BLEProtocol::Address_t addresses[BLE_VIRTUAL_WHITELIST_MAX_HARDWARE_SIZE];
+    for (unsigned i = 0; i < selectedCount; ++i) {
+        const Entry_t &entry = entries[selected[i]];
+        addresses[i] = BLEProtocol::Address_t(static_cast<BLEProtocol::AddressType_t>(entry.type), entry.address);
+    }
+
+    Gap::Whitelist_t whitelist;
+    whitelist.addresses = addresses;
+    whitelist.size      = selectedCount;
+    whitelist.capacity  = selectedCount;
+    ble_error_t err = gap.setWhitelist(whitelist);
+    if (err != BLE_ERROR_NONE) {
+        /* The content of the whitelist of the controller is unknown. */
+        hardwareValid = false;
+        return err;
+    }
+
+    for (unsigned i = 0; i < selectedCount; ++i) {
+        hardwareEntries[i] = addresses[i];
+    }
+    hardwareCount = selectedCount;
+    hardwareValid = true;
+    ++hardwareUpdateCount;
+
+    return BLE_ERROR_NONE;
+}
+
+void
+VirtualWhitelist::releaseHardwareWhitelist(Gap &gap)
+{
+    gap.releaseWhitelist(this);
+    hardwareValid = false;
+}
+
+uint16_t
+VirtualWhitelist::lowerBound(const BLEProtocol::AddressBytes_t address) const
+{
+    uint16_t low  = 0;
+    uint16_t high = count;
+    while (low < high) {
+        uint16_t middle = low + (high - low) / 2;
+        if (memcmp(entries[middle].address, address, BLEProtocol::ADDR_LEN) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+const VirtualWhitelist::Entry_t *
+VirtualWhitelist::find(const BLEProtocol::AddressBytes_t address) const
+{
+    uint16_t index = lowerBound(address);
+    if ((index < count) && (memcmp(entries[index].address, address, BLEProtocol::ADDR_LEN) == 0)) {
+        return &entries[index];
+    }
+
+    return NULL;
+}
+
+bool
+VirtualWhitelist::markActive(const BLEProtocol::AddressBytes_t address)
+{
+    Entry_t *entry = const_cast<Entry_t *>(find(address));
+    if (entry == NULL) {
+        return false;
+    }
+
+    if (++activityStamp == 0) {
+        /* Halve every stamp on wrap-around, which keeps their order. */
+        for (uint16_t i = 0; i < count; ++i) {
+            entries[i].lastActive >>= 1;
+        }
+        activityStamp = 0x80000000UL;
+    }
+    entry->lastActive = activityStamp;
+
+    return true;
+}
@@ -0,0 +1,97 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+SimulatedBLEInstance::SimulatedBLEInstance(SimulatedMedium &mediumIn) :
+    medium(mediumIn),
+    index(mediumIn.registerDevice(this)),
+    initialized(false),
+    instanceID(BLE::DEFAULT_INSTANCE),
+    gap(mediumIn, *this),
+    gattServer(mediumIn, *this),
+    gattClient(mediumIn, *this),
+    securityManager(mediumIn, *this) {
+    /* empty */
+}
+
+SimulatedBLEInstance::~SimulatedBLEInstance(void)
+{
+    /* empty */
+}
+
+ble_error_t SimulatedBLEInstance::init(BLE::InstanceID_t instanceIDIn,
+                                       FunctionPointerWithContext<BLE::InitializationCompleteCallbackContext *> callback)
+{
+    if (index < 0) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    instanceID  = instanceIDIn;
+    initialized = true;
+
+    BLE::InitializationCompleteCallbackContext context = {
+        BLE::Instance(instanceID),
+        BLE_ERROR_NONE
+    };
+    callback.call(&context);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedBLEInstance::shutdown(void)
+{
+    if (!initialized) {
+        return BLE_ERROR_INITIALIZATION_INCOMPLETE;
+    }
+
+    /* The peers see the links time out. */
+    medium.dropLinks(this);
+
+    if ((gap.reset() != BLE_ERROR_NONE) ||
+        (gattServer.reset() != BLE_ERROR_NONE) ||
+        (gattClient.reset() != BLE_ERROR_NONE) ||
+        (securityManager.reset() != BLE_ERROR_NONE)) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    initialized = false;
+    return BLE_ERROR_NONE;
+}
+
+const char *SimulatedBLEInstance::getVersion(void)
+{
+    return "simulator";
+}
+
+void SimulatedBLEInstance::waitForEvent(void)
+{
+    medium.step();
+}
+
+void SimulatedBLEInstance::processEvents(void)
+{
+    /* Events are handled as the medium runs. */
+}
+
+BLEInstanceBase *createBLEInstance(void)
+{
+    return createSimulatedBLEInstance<0>();
+}
+
+#endif /* #ifdef BLE_SIMULATOR */
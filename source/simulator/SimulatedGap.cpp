@@ -0,0 +1,518 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include <string.h>
+#include "ble/simulator/SimulatedGap.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+/* Maximum random delay added to each advertising interval, in microseconds. */
+static const SimulatedMedium::Time_t ADV_DELAY_MAX = 10 * SimulatedMedium::ONE_MILLISECOND;
+
+/* Bounds of the connection interval, in units of 1.25ms. */
+static const uint16_t CONNECTION_INTERVAL_MIN = 6;
+static const uint16_t CONNECTION_INTERVAL_MAX = 3200;
+
+static const int8_t permittedTxPowerValues[] = { -40, -20, -16, -12, -8, -4, 0, 4 };
+
+SimulatedGap::SimulatedGap(SimulatedMedium &mediumIn, SimulatedBLEInstance &deviceIn) :
+    Gap(),
+    medium(mediumIn),
+    device(deviceIn),
+    addressType(BLEProtocol::AddressType::RANDOM_STATIC),
+    advertisingParams(),
+    advertisingData(),
+    scanResponseData(),
+    scanning(false),
+    activeScanning(false),
+    scanStart(0),
+    scanInterval(0),
+    scanWindow(0),
+    initiating(false),
+    preferredTxOctets(DATA_LENGTH_DEFAULT),
+    preferredTxPhys(PHY_1M | PHY_2M),
+    preferredRxPhys(PHY_1M | PHY_2M),
+    deviceNameLength(0),
+    appearance(GapAdvertisingData::UNKNOWN),
+    txPower(0) {
+    /* Random static address derived from the index of the device. */
+    int index = device.getIndex();
+    address[0] = (uint8_t)(index + 1);
+    address[1] = (uint8_t)((index + 1) >> 8);
+    address[2] = 0x00;
+    address[3] = 0x00;
+    address[4] = 0x00;
+    address[5] = 0xC0;
+
+    memset(initiationPeerAddress, 0, sizeof(initiationPeerAddress));
+
+    preferredConnectionParams.minConnectionInterval        = MSEC_TO_GAP_DURATION_UNITS(30);
+    preferredConnectionParams.maxConnectionInterval        = MSEC_TO_GAP_DURATION_UNITS(50);
+    preferredConnectionParams.slaveLatency                 = 0;
+    preferredConnectionParams.connectionSupervisionTimeout = 400; /* 4s in units of 10ms. */
+    initiationParams = preferredConnectionParams;
+
+    advertisingTimer.handler.attach(this, &SimulatedGap::onAdvertisingTimer);
+    advertisingTimeoutTimer.handler.attach(this, &SimulatedGap::onAdvertisingTimeout);
+    scanTimeoutTimer.handler.attach(this, &SimulatedGap::onScanTimeout);
+    connectionTimeoutTimer.handler.attach(this, &SimulatedGap::onConnectionTimeout);
+}
+
+ble_error_t SimulatedGap::setAddress(BLEProtocol::AddressType_t type, const BLEProtocol::AddressBytes_t addressIn)
+{
+    addressType = type;
+    memcpy(address, addressIn, sizeof(address));
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::getAddress(BLEProtocol::AddressType_t *typeP, BLEProtocol::AddressBytes_t addressOut)
+{
+    if (typeP != NULL) {
+        *typeP = addressType;
+    }
+    if (addressOut != NULL) {
+        memcpy(addressOut, address, sizeof(address));
+    }
+    return BLE_ERROR_NONE;
+}
+
+uint16_t SimulatedGap::getMinAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(GapAdvertisingParams::GAP_ADV_PARAMS_INTERVAL_MIN);
+}
+
+uint16_t SimulatedGap::getMinNonConnectableAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(GapAdvertisingParams::GAP_ADV_PARAMS_INTERVAL_MIN_NONCON);
+}
+
+uint16_t SimulatedGap::getMaxAdvertisingInterval(void) const
+{
+    return GapAdvertisingParams::ADVERTISEMENT_DURATION_UNITS_TO_MS(GapAdvertisingParams::GAP_ADV_PARAMS_INTERVAL_MAX);
+}
+
+ble_error_t SimulatedGap::setAdvertisingData(const GapAdvertisingData &advData, const GapAdvertisingData &scanResponse)
+{
+    advertisingData  = advData;
+    scanResponseData = scanResponse;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::startAdvertising(const GapAdvertisingParams &params)
+{
+    if (params.getAdvertisingType() != GapAdvertisingParams::ADV_NON_CONNECTABLE_UNDIRECTED) {
+        /* Connectable or scannable advertising requires an interval of at
+         * least 20ms, non connectable advertising of at least 100ms. */
+        if (params.getIntervalInADVUnits() < GapAdvertisingParams::GAP_ADV_PARAMS_INTERVAL_MIN) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+    } else if (params.getIntervalInADVUnits() < GapAdvertisingParams::GAP_ADV_PARAMS_INTERVAL_MIN_NONCON) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    advertisingParams = params;
+    medium.arm(advertisingTimer, medium.random(ADV_DELAY_MAX + 1));
+    if (params.getTimeout()) {
+        medium.arm(advertisingTimeoutTimer, params.getTimeout() * SimulatedMedium::ONE_SECOND);
+    } else {
+        medium.disarm(advertisingTimeoutTimer);
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::stopAdvertising(void)
+{
+    medium.disarm(advertisingTimer);
+    medium.disarm(advertisingTimeoutTimer);
+    state.advertising = 0;
+
+    return BLE_ERROR_NONE;
+}
+
+void SimulatedGap::onAdvertisingTimer(SimulatedMedium::Timer *)
+{
+    medium.broadcastAdvertisingPacket(device,
+                                      advertisingParams.getAdvertisingType(),
+                                      advertisingData.getPayload(),
+                                      advertisingData.getPayloadLen(),
+                                      scanResponseData.getPayload(),
+                                      scanResponseData.getPayloadLen(),
+                                      txPower);
+
+    /* Advertising stops when a connection is established. */
+    if (state.advertising) {
+        SimulatedMedium::Time_t interval =
+            (SimulatedMedium::Time_t)advertisingParams.getIntervalInADVUnits() * GapScanningParams::UNIT_0_625_MS;
+        medium.arm(advertisingTimer, interval + medium.random(ADV_DELAY_MAX + 1));
+    }
+}
+
+void SimulatedGap::onAdvertisingTimeout(SimulatedMedium::Timer *)
+{
+    medium.disarm(advertisingTimer);
+    processTimeoutEvent(TIMEOUT_SRC_ADVERTISING);
+}
+
+ble_error_t SimulatedGap::startRadioScan(const GapScanningParams &scanningParams)
+{
+    scanning       = true;
+    activeScanning = scanningParams.getActiveScanning();
+    scanStart      = medium.getTime();
+    scanInterval   = (SimulatedMedium::Time_t)scanningParams.getInterval() * GapScanningParams::UNIT_0_625_MS;
+    scanWindow     = (SimulatedMedium::Time_t)scanningParams.getWindow() * GapScanningParams::UNIT_0_625_MS;
+
+    if (scanningParams.getTimeout()) {
+        medium.arm(scanTimeoutTimer, scanningParams.getTimeout() * SimulatedMedium::ONE_SECOND);
+    } else {
+        medium.disarm(scanTimeoutTimer);
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::stopScan(void)
+{
+    scanning = false;
+    medium.disarm(scanTimeoutTimer);
+
+    return BLE_ERROR_NONE;
+}
+
+void SimulatedGap::onScanTimeout(SimulatedMedium::Timer *)
+{
+    scanning = false;
+    processTimeoutEvent(TIMEOUT_SRC_SCAN);
+}
+
+bool SimulatedGap::isScanWindowOpen(void) const
+{
+    if (!scanning || (scanInterval == 0)) {
+        return false;
+    }
+    return ((medium.getTime() - scanStart) % scanInterval) < scanWindow;
+}
+
+unsigned SimulatedGap::receiveAdvertisingPacket(SimulatedBLEInstance                    &advertiser,
+                                                GapAdvertisingParams::AdvertisingType_t  type,
+                                                const uint8_t                           *advData,
+                                                uint8_t                                  advDataLen,
+                                                const uint8_t                           *scanResponse,
+                                                uint8_t                                  scanResponseLen,
+                                                int8_t                                   rssi)
+{
+    if (!isScanWindowOpen()) {
+        return 0;
+    }
+
+    const uint8_t *peerAddr = advertiser.getSimulatedGap().getOwnAddress();
+    processAdvertisementReport(peerAddr, rssi, false, type, advDataLen, advData);
+
+    /* An active scanner gets the scan response of scannable advertisers. */
+    bool scannable = (type == GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED) ||
+                     (type == GapAdvertisingParams::ADV_SCANNABLE_UNDIRECTED);
+    if (scanning && activeScanning && scannable) {
+        processAdvertisementReport(peerAddr, rssi, true, type, scanResponseLen, scanResponse);
+        return 2;
+    }
+
+    return 1;
+}
+
+ble_error_t SimulatedGap::connect(const BLEProtocol::AddressBytes_t  peerAddr,
+                                  BLEProtocol::AddressType_t         peerAddrType,
+                                  const ConnectionParams_t          *connectionParams,
+                                  const GapScanningParams           *scanParams)
+{
+    (void)peerAddrType;
+
+    if (initiating) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    const ConnectionParams_t &params = connectionParams ? *connectionParams : preferredConnectionParams;
+    if ((params.minConnectionInterval < CONNECTION_INTERVAL_MIN) ||
+        (params.minConnectionInterval > CONNECTION_INTERVAL_MAX) ||
+        (params.maxConnectionInterval < params.minConnectionInterval)) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    memcpy(initiationPeerAddress, peerAddr, sizeof(initiationPeerAddress));
+    initiationParams = params;
+    initiating       = true;
+
+    if (scanParams && scanParams->getTimeout()) {
+        medium.arm(connectionTimeoutTimer, scanParams->getTimeout() * SimulatedMedium::ONE_SECOND);
+    } else {
+        medium.disarm(connectionTimeoutTimer);
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::cancelConnect(void)
+{
+    if (!initiating) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    initiating = false;
+    medium.disarm(connectionTimeoutTimer);
+    return BLE_ERROR_NONE;
+}
+
+bool SimulatedGap::isInitiatingTo(SimulatedBLEInstance &advertiser) const
+{
+    return initiating &&
+           (memcmp(initiationPeerAddress, advertiser.getSimulatedGap().getOwnAddress(), sizeof(initiationPeerAddress)) == 0);
+}
+
+void SimulatedGap::onConnectionTimeout(SimulatedMedium::Timer *)
+{
+    initiating = false;
+    processTimeoutEvent(TIMEOUT_SRC_CONN);
+}
+
+void SimulatedGap::onLinkEstablished(const SimulatedMedium::Link &link, Role_t role)
+{
+    if (role == CENTRAL) {
+        initiating = false;
+        medium.disarm(connectionTimeoutTimer);
+    } else {
+        medium.disarm(advertisingTimer);
+        medium.disarm(advertisingTimeoutTimer);
+    }
+
+    SimulatedGap &peerGap = SimulatedMedium::getPeer(link, &device)->getSimulatedGap();
+    processConnectionEvent(link.handle,
+                           role,
+                           peerGap.getOwnAddressType(),
+                           peerGap.getOwnAddress(),
+                           addressType,
+                           address,
+                           &link.params);
+}
+
+void SimulatedGap::onLinkParamsUpdated(const SimulatedMedium::Link &link)
+{
+    processConnectionParamsUpdateEvent(link.handle, BLE_ERROR_NONE, &link.params);
+}
+
+void SimulatedGap::onLinkDataLengthUpdated(const SimulatedMedium::Link &link)
+{
+    processDataLengthUpdateEvent(link.handle, link.maxTxOctets, link.maxTxOctets);
+}
+
+void SimulatedGap::onLinkPhyUpdated(const SimulatedMedium::Link &link)
+{
+    processPhyUpdateEvent(link.handle, BLE_ERROR_NONE, static_cast<Phy_t>(link.phy), static_cast<Phy_t>(link.phy));
+}
+
+void SimulatedGap::onLinkTerminated(Handle_t handle, DisconnectionReason_t reason)
+{
+    processDisconnectionEvent(handle, reason);
+}
+
+ble_error_t SimulatedGap::disconnect(Handle_t connectionHandle, DisconnectionReason_t reason)
+{
+    SimulatedMedium::Link *link = medium.getLink(connectionHandle);
+    if ((link == NULL) || ((link->central != &device) && (link->peripheral != &device))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    medium.terminate(*link, &device, reason);
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::disconnect(DisconnectionReason_t reason)
+{
+    for (Handle_t handle = 0; handle < BLE_SIMULATOR_MAX_LINKS; ++handle) {
+        if (disconnect(handle, reason) == BLE_ERROR_NONE) {
+            return BLE_ERROR_NONE;
+        }
+    }
+
+    return BLE_ERROR_INVALID_STATE;
+}
+
+ble_error_t SimulatedGap::getPreferredConnectionParams(ConnectionParams_t *params)
+{
+    *params = preferredConnectionParams;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setPreferredConnectionParams(const ConnectionParams_t *params)
+{
+    preferredConnectionParams = *params;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::updateConnectionParams(Handle_t handle, const ConnectionParams_t *params)
+{
+    SimulatedMedium::Link *link = medium.getLink(handle);
+    if ((link == NULL) || ((link->central != &device) && (link->peripheral != &device))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if ((params == NULL) ||
+        (params->minConnectionInterval < CONNECTION_INTERVAL_MIN) ||
+        (params->minConnectionInterval > CONNECTION_INTERVAL_MAX)) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    /* The new interval applies from the next anchor point on. */
+    link->params = *params;
+
+    SimulatedMedium::getPeer(*link, &device)->getSimulatedGap().onLinkParamsUpdated(*link);
+    onLinkParamsUpdated(*link);
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setPreferredDataLength(uint16_t maxTxOctets)
+{
+    if ((maxTxOctets < DATA_LENGTH_DEFAULT) || (maxTxOctets > DATA_LENGTH_MAX)) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    preferredTxOctets = maxTxOctets;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::updateDataLength(Handle_t handle, uint16_t maxTxOctets)
+{
+    SimulatedMedium::Link *link = medium.getLink(handle);
+    if ((link == NULL) || ((link->central != &device) && (link->peripheral != &device))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if ((maxTxOctets < DATA_LENGTH_DEFAULT) || (maxTxOctets > DATA_LENGTH_MAX)) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    /* Simulated controllers receive up to DATA_LENGTH_MAX octets; the
+     * requested size applies to both directions. */
+    link->dataLengthPending = true;
+    link->pendingTxOctets   = maxTxOctets;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setPreferredPhys(uint8_t txPhys, uint8_t rxPhys)
+{
+    static const uint8_t ALL_PHYS = PHY_1M | PHY_2M | PHY_CODED;
+    if (!txPhys || !rxPhys || (txPhys & ~ALL_PHYS) || (rxPhys & ~ALL_PHYS)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    preferredTxPhys = txPhys;
+    preferredRxPhys = rxPhys;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::updatePhy(Handle_t handle, uint8_t txPhys, uint8_t rxPhys)
+{
+    static const uint8_t ALL_PHYS = PHY_1M | PHY_2M | PHY_CODED;
+    SimulatedMedium::Link *link = medium.getLink(handle);
+    if ((link == NULL) || ((link->central != &device) && (link->peripheral != &device))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (!txPhys || !rxPhys || (txPhys & ~ALL_PHYS) || (rxPhys & ~ALL_PHYS)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (link->phyPending) {
+        return BLE_STACK_BUSY;
+    }
+
+    /* The link keeps its PHY if the peer accepts none of the requested ones. */
+    uint8_t phy = SimulatedMedium::selectPhy(txPhys & rxPhys & SimulatedMedium::getPeer(*link, &device)->getSimulatedGap().getPreferredPhys());
+    link->phyPending = true;
+    link->pendingPhy = phy ? phy : link->phy;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setDeviceName(const uint8_t *name)
+{
+    size_t length = strlen(reinterpret_cast<const char *>(name));
+    if (length > sizeof(deviceName)) {
+        return BLE_ERROR_BUFFER_OVERFLOW;
+    }
+
+    memcpy(deviceName, name, length);
+    deviceNameLength = length;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::getDeviceName(uint8_t *name, unsigned *lengthP)
+{
+    if (name == NULL) {
+        *lengthP = deviceNameLength;
+        return BLE_ERROR_NONE;
+    }
+    if (*lengthP < deviceNameLength) {
+        return BLE_ERROR_BUFFER_OVERFLOW;
+    }
+
+    memcpy(name, deviceName, deviceNameLength);
+    *lengthP = deviceNameLength;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setAppearance(GapAdvertisingData::Appearance appearanceIn)
+{
+    appearance = appearanceIn;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::getAppearance(GapAdvertisingData::Appearance *appearanceP)
+{
+    *appearanceP = appearance;
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGap::setTxPower(int8_t txPowerIn)
+{
+    for (unsigned i = 0; i < sizeof(permittedTxPowerValues) / sizeof(permittedTxPowerValues[0]); ++i) {
+        if (permittedTxPowerValues[i] == txPowerIn) {
+            txPower = txPowerIn;
+            return BLE_ERROR_NONE;
+        }
+    }
+
+    return BLE_ERROR_PARAM_OUT_OF_RANGE;
+}
+
+void SimulatedGap::getPermittedTxPowerValues(const int8_t **valueArrayPP, size_t *countP)
+{
+    *valueArrayPP = permittedTxPowerValues;
+    *countP       = sizeof(permittedTxPowerValues) / sizeof(permittedTxPowerValues[0]);
+}
+
+ble_error_t SimulatedGap::reset(void)
+{
+    /* Clear all state that is from the parent, including private members */
+    if (Gap::reset() != BLE_ERROR_NONE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    medium.disarm(advertisingTimer);
+    medium.disarm(advertisingTimeoutTimer);
+    medium.disarm(scanTimeoutTimer);
+    medium.disarm(connectionTimeoutTimer);
+    scanning   = false;
+    initiating = false;
+
+    return BLE_ERROR_NONE;
+}
+
+#endif /* #ifdef BLE_SIMULATOR */
@@ -0,0 +1,365 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include <string.h>
+#include "ble/simulator/SimulatedGattClient.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+void SimulatedDiscoveredCharacteristic::setup(GattClient              *gattcIn,
+                                              Gap::Handle_t            connectionHandleIn,
+                                              const UUID              &uuidIn,
+                                              uint8_t                  propertiesIn,
+                                              GattAttribute::Handle_t  declHandleIn,
+                                              GattAttribute::Handle_t  valueHandleIn,
+                                              GattAttribute::Handle_t  lastHandleIn)
+{
+    gattc       = gattcIn;
+    connHandle  = connectionHandleIn;
+    uuid        = uuidIn;
+    declHandle  = declHandleIn;
+    valueHandle = valueHandleIn;
+    lastHandle  = lastHandleIn;
+
+    props._broadcast       = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_BROADCAST) ? 1 : 0;
+    props._read            = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ) ? 1 : 0;
+    props._writeWoResp     = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE) ? 1 : 0;
+    props._write           = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE) ? 1 : 0;
+    props._notify          = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY) ? 1 : 0;
+    props._indicate        = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE) ? 1 : 0;
+    props._authSignedWrite = (propertiesIn & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_AUTHENTICATED_SIGNED_WRITES) ? 1 : 0;
+}
+
+SimulatedGattClient::SimulatedGattClient(SimulatedMedium &mediumIn, SimulatedBLEInstance &deviceIn) :
+    GattClient(),
+    medium(mediumIn),
+    device(deviceIn),
+    discoveryActive(false),
+    discoveryConnectionHandle(0),
+    discoveryNextHandle(GattAttribute::INVALID_HANDLE),
+    serviceCallback(),
+    characteristicCallback(),
+    matchingServiceUUID(UUID::ShortUUIDBytes_t(BLE_UUID_UNKNOWN)),
+    matchingCharacteristicUUID(UUID::ShortUUIDBytes_t(BLE_UUID_UNKNOWN)),
+    terminationCallback() {
+    /* empty */
+}
+
+ble_error_t SimulatedGattClient::launchServiceDiscovery(Gap::Handle_t                               connectionHandle,
+                                                        ServiceDiscovery::ServiceCallback_t         sc,
+                                                        ServiceDiscovery::CharacteristicCallback_t  cc,
+                                                        const UUID                                 &matchingServiceUUIDIn,
+                                                        const UUID                                 &matchingCharacteristicUUIDIn)
+{
+    if (discoveryActive) {
+        return BLE_STACK_BUSY;
+    }
+    if (medium.getLink(connectionHandle) == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    discoveryActive            = true;
+    discoveryConnectionHandle  = connectionHandle;
+    discoveryNextHandle        = 1;
+    serviceCallback            = sc;
+    characteristicCallback     = cc;
+    matchingServiceUUID        = matchingServiceUUIDIn;
+    matchingCharacteristicUUID = matchingCharacteristicUUIDIn;
+
+    return BLE_ERROR_NONE;
+}
+
+void SimulatedGattClient::terminateServiceDiscovery(void)
+{
+    if (discoveryActive) {
+        endServiceDiscovery();
+    }
+}
+
+void SimulatedGattClient::endServiceDiscovery(void)
+{
+    discoveryActive = false;
+    if (terminationCallback) {
+        terminationCallback.call(discoveryConnectionHandle);
+    }
+}
+
+ble_error_t SimulatedGattClient::read(Gap::Handle_t connHandle, GattAttribute::Handle_t attributeHandle, uint16_t offset) const
+{
+    SimulatedMedium::Link *link = medium.getLink(connHandle);
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    /* ATT allows a single outstanding request per direction. */
+    unsigned side = SimulatedMedium::getSide(*link, &device);
+    if (link->requestPending[side]) {
+        return BLE_STACK_BUSY;
+    }
+
+    SimulatedMedium::Pdu pdu;
+    pdu.type            = SimulatedMedium::Pdu::ATT_READ_REQ;
+    pdu.attributeHandle = attributeHandle;
+    pdu.offset          = offset;
+    pdu.errorCode       = 0;
+    pdu.length          = 0;
+    if (!medium.send(*link, &device, pdu)) {
+        return BLE_ERROR_NO_MEM;
+    }
+    link->requestPending[side] = true;
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattClient::write(GattClient::WriteOp_t    cmd,
+                                       Gap::Handle_t            connHandle,
+                                       GattAttribute::Handle_t  attributeHandle,
+                                       size_t                   length,
+                                       const uint8_t           *value) const
+{
+    SimulatedMedium::Link *link = medium.getLink(connHandle);
+    if ((link == NULL) || (length > (size_t)(link->attMtu - 3))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    unsigned side        = SimulatedMedium::getSide(*link, &device);
+    bool     withResponse = (cmd == GattClient::GATT_OP_WRITE_REQ);
+    if (withResponse && link->requestPending[side]) {
+        return BLE_STACK_BUSY;
+    }
+
+    SimulatedMedium::Pdu pdu;
+    pdu.type            = withResponse ? SimulatedMedium::Pdu::ATT_WRITE_REQ : SimulatedMedium::Pdu::ATT_WRITE_CMD;
+    pdu.attributeHandle = attributeHandle;
+    pdu.offset          = 0;
+    pdu.errorCode       = 0;
+    pdu.length          = length;
+    if (length) {
+        memcpy(pdu.data, value, length);
+    }
+    if (!medium.send(*link, &device, pdu)) {
+        return BLE_ERROR_NO_MEM;
+    }
+    if (withResponse) {
+        link->requestPending[side] = true;
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattClient::negotiateAttMtu(Gap::Handle_t connHandle)
+{
+    SimulatedMedium::Link *link = medium.getLink(connHandle);
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (link->mtuExchanged) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    unsigned side = SimulatedMedium::getSide(*link, &device);
+    if (link->requestPending[side]) {
+        return BLE_STACK_BUSY;
+    }
+
+    SimulatedMedium::Pdu pdu;
+    pdu.type            = SimulatedMedium::Pdu::ATT_EXCHANGE_MTU_REQ;
+    pdu.attributeHandle = GattAttribute::INVALID_HANDLE;
+    pdu.offset          = 0;
+    pdu.errorCode       = 0;
+    pdu.mtu             = BLE_SIMULATOR_MAX_ATT_MTU;
+    pdu.length          = 0;
+    if (!medium.send(*link, &device, pdu)) {
+        return BLE_ERROR_NO_MEM;
+    }
+    link->requestPending[side] = true;
+    link->mtuExchanged         = true;
+
+    return BLE_ERROR_NONE;
+}
+
+uint16_t SimulatedGattClient::getEffectiveMtu(Gap::Handle_t connHandle) const
+{
+    const SimulatedMedium::Link *link = medium.getLink(connHandle);
+    return (link != NULL) ? link->attMtu : BLE_GATT_MTU_SIZE_DEFAULT;
+}
+
+void SimulatedGattClient::onPduReceived(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu)
+{
+    switch (pdu.type) {
+        case SimulatedMedium::Pdu::ATT_READ_RSP: {
+            GattReadCallbackParams params;
+            params.connHandle = link.handle;
+            params.handle     = pdu.attributeHandle;
+            params.offset     = pdu.offset;
+            params.len        = pdu.length;
+            params.data       = pdu.data;
+            processReadResponse(&params);
+            break;
+        }
+
+        case SimulatedMedium::Pdu::ATT_WRITE_RSP: {
+            GattWriteCallbackParams params;
+            params.connHandle = link.handle;
+            params.handle     = pdu.attributeHandle;
+            params.writeOp    = GattWriteCallbackParams::OP_WRITE_REQ;
+            params.offset     = 0;
+            params.len        = 0;
+            params.data       = NULL;
+            processWriteResponse(&params);
+            break;
+        }
+
+        case SimulatedMedium::Pdu::ATT_HANDLE_VALUE_IND: {
+            /* The confirmation carries the handle of the indicated value
+             * so that the server can report it. */
+            SimulatedMedium::Pdu confirmation;
+            confirmation.type            = SimulatedMedium::Pdu::ATT_HANDLE_VALUE_CFM;
+            confirmation.attributeHandle = pdu.attributeHandle;
+            confirmation.offset          = 0;
+            confirmation.errorCode       = 0;
+            confirmation.length          = 0;
+            medium.send(link, &device, confirmation);
+        }
+        /* Fall through. */
+        case SimulatedMedium::Pdu::ATT_HANDLE_VALUE_NTF: {
+            GattHVXCallbackParams params;
+            params.connHandle = link.handle;
+            params.handle     = pdu.attributeHandle;
+            params.type       = (pdu.type == SimulatedMedium::Pdu::ATT_HANDLE_VALUE_IND) ? BLE_HVX_INDICATION : BLE_HVX_NOTIFICATION;
+            params.len        = pdu.length;
+            params.data       = pdu.data;
+            processHVXEvent(&params);
+            break;
+        }
+
+        case SimulatedMedium::Pdu::ATT_EXCHANGE_MTU_RSP: {
+            /* The server switched to the new MTU when it responded. */
+            GattAttMtuChangeCallbackParams params;
+            params.connHandle = link.handle;
+            params.attMtu     = link.attMtu;
+            processAttMtuChangeEvent(&params);
+            break;
+        }
+
+        default:
+            /* Error responses are dropped: the read and write callbacks
+             * have no way to report them. */
+            break;
+    }
+}
+
+void SimulatedGattClient::onConnectionEvent(SimulatedMedium::Link &link)
+{
+    if (!discoveryActive || (link.handle != discoveryConnectionHandle)) {
+        return;
+    }
+
+    /* The table of the peer is walked directly; the procedure reports one
+     * service per connection event. */
+    const SimulatedGattServer &server = SimulatedMedium::getPeer(link, &device)->getSimulatedGattServer();
+    const UUID                 unknown((UUID::ShortUUIDBytes_t)BLE_UUID_UNKNOWN);
+    uint16_t                   attributeCount = server.getAttributeCount();
+
+    GattAttribute::Handle_t start = discoveryNextHandle;
+    while ((start <= attributeCount) && (server.getAttribute(start)->kind != SimulatedGattServer::SERVICE_DECLARATION)) {
+        ++start;
+    }
+    if (start > attributeCount) {
+        endServiceDiscovery();
+        return;
+    }
+
+    GattAttribute::Handle_t end = start + 1;
+    while ((end <= attributeCount) && (server.getAttribute(end)->kind != SimulatedGattServer::SERVICE_DECLARATION)) {
+        ++end;
+    }
+    --end;
+    discoveryNextHandle = end + 1;
+
+    const GattService *service = server.getAttribute(start)->service;
+    if ((matchingServiceUUID != unknown) && (matchingServiceUUID != service->getUUID())) {
+        return;
+    }
+
+    DiscoveredService discoveredService;
+    discoveredService.setup(service->getUUID(), start, end);
+    if (serviceCallback) {
+        serviceCallback.call(&discoveredService);
+    }
+
+    if (!characteristicCallback) {
+        return;
+    }
+    for (GattAttribute::Handle_t declHandle = start + 1; declHandle <= end; ++declHandle) {
+        const SimulatedGattServer::Attribute *declaration = server.getAttribute(declHandle);
+        if (declaration->kind != SimulatedGattServer::CHARACTERISTIC_DECLARATION) {
+            continue;
+        }
+
+        GattAttribute::Handle_t lastHandle = declHandle + 1;
+        while ((lastHandle < end) &&
+               (server.getAttribute(lastHandle + 1)->kind != SimulatedGattServer::CHARACTERISTIC_DECLARATION)) {
+            ++lastHandle;
+        }
+
+        GattCharacteristic *characteristic = declaration->characteristic;
+        const UUID         &uuid           = characteristic->getValueAttribute().getUUID();
+        if ((matchingCharacteristicUUID != unknown) && (matchingCharacteristicUUID != uuid)) {
+            continue;
+        }
+
+        SimulatedDiscoveredCharacteristic discoveredCharacteristic;
+        discoveredCharacteristic.setup(this,
+                                       link.handle,
+                                       uuid,
+                                       characteristic->getProperties(),
+                                       declHandle,
+                                       declHandle + 1,
+                                       lastHandle);
+        characteristicCallback.call(&discoveredCharacteristic);
+
+        if (!discoveryActive) {
+            /* Terminated from the callback. */
+            return;
+        }
+    }
+}
+
+void SimulatedGattClient::onLinkTerminated(Gap::Handle_t handle)
+{
+    if (discoveryActive && (discoveryConnectionHandle == handle)) {
+        endServiceDiscovery();
+    }
+}
+
+ble_error_t SimulatedGattClient::reset(void)
+{
+    /* Clear all state that is from the parent, including private members */
+    if (GattClient::reset() != BLE_ERROR_NONE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    discoveryActive = false;
+    serviceCallback = ServiceDiscovery::ServiceCallback_t();
+    characteristicCallback = ServiceDiscovery::CharacteristicCallback_t();
+    terminationCallback = ServiceDiscovery::TerminationCallback_t();
+
+    return BLE_ERROR_NONE;
+}
+
+#endif /* #ifdef BLE_SIMULATOR */
@@ -0,0 +1,568 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include <string.h>
+#include "ble/simulator/SimulatedGattServer.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+/* ATT error codes. */
+static const uint16_t ATT_ERROR_INVALID_HANDLE         = 0x01;
+static const uint16_t ATT_ERROR_READ_NOT_PERMITTED     = 0x02;
+static const uint16_t ATT_ERROR_WRITE_NOT_PERMITTED    = 0x03;
+static const uint16_t ATT_ERROR_INVALID_OFFSET         = 0x07;
+static const uint16_t ATT_ERROR_INVALID_ATT_VAL_LENGTH = 0x0D;
+
+/* Values of a client characteristic configuration descriptor. */
+static const uint16_t CCCD_NOTIFICATION = 0x0001;
+static const uint16_t CCCD_INDICATION   = 0x0002;
+
+static uint16_t getStorageLength(GattAttribute &attribute)
+{
+    return (attribute.getMaxLength() > attribute.getLength()) ? attribute.getMaxLength() : attribute.getLength();
+}
+
+SimulatedGattServer::SimulatedGattServer(SimulatedMedium &mediumIn, SimulatedBLEInstance &deviceIn) :
+    GattServer(),
+    medium(mediumIn),
+    device(deviceIn),
+    attributeCount(0),
+    storageUsed(0) {
+    /* empty */
+}
+
+SimulatedGattServer::Attribute *SimulatedGattServer::addAttribute(uint8_t              kind,
+                                                                  GattService         &service,
+                                                                  GattCharacteristic  *characteristic,
+                                                                  GattAttribute       *attribute)
+{
+    Attribute &entry = attributes[attributeCount++];
+
+    entry.kind           = kind;
+    entry.service        = &service;
+    entry.characteristic = characteristic;
+    entry.attribute      = attribute;
+    entry.valueOffset    = storageUsed;
+    entry.length         = 0;
+    entry.maxLength      = 0;
+    entry.notifyMask     = 0;
+    entry.indicateMask   = 0;
+    entry.cccdHandle     = GattAttribute::INVALID_HANDLE;
+
+    if ((kind == CHARACTERISTIC_VALUE) || (kind == DESCRIPTOR)) {
+        entry.maxLength = getStorageLength(*attribute);
+        entry.length    = attribute->getLength();
+        if (entry.length && (attribute->getValuePtr() != NULL)) {
+            memcpy(&storage[entry.valueOffset], attribute->getValuePtr(), entry.length);
+        }
+        storageUsed += entry.maxLength;
+    } else if (kind == CCCD) {
+        entry.maxLength = sizeof(uint16_t);
+        entry.length    = sizeof(uint16_t);
+    }
+
+    if (attribute != NULL) {
+        attribute->setHandle(attributeCount);
+    }
+    return &entry;
+}
+
+ble_error_t SimulatedGattServer::addService(GattService &service)
+{
+    /* Check that the whole service fits before adding anything. */
+    unsigned attributesNeeded = 1;
+    unsigned storageNeeded    = 0;
+    for (uint8_t i = 0; i < service.getCharacteristicCount(); ++i) {
+        GattCharacteristic *characteristic = service.getCharacteristic(i);
+
+        attributesNeeded += 2;
+        storageNeeded    += getStorageLength(characteristic->getValueAttribute());
+        if (characteristic->getProperties() &
+            (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE)) {
+            ++attributesNeeded;
+        }
+        for (uint8_t j = 0; j < characteristic->getDescriptorCount(); ++j) {
+            ++attributesNeeded;
+            storageNeeded += getStorageLength(*characteristic->getDescriptor(j));
+        }
+    }
+    if (((attributeCount + attributesNeeded) > BLE_SIMULATOR_MAX_ATTRIBUTES) ||
+        ((storageUsed + storageNeeded) > BLE_SIMULATOR_ATTRIBUTE_STORAGE_SIZE)) {
+        return BLE_ERROR_NO_MEM;
+    }
+
+    addAttribute(SERVICE_DECLARATION, service, NULL, NULL);
+    service.setHandle(attributeCount);
+
+    for (uint8_t i = 0; i < service.getCharacteristicCount(); ++i) {
+        GattCharacteristic *characteristic = service.getCharacteristic(i);
+        bool updatable = (characteristic->getProperties() &
+                          (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE)) != 0;
+
+        addAttribute(CHARACTERISTIC_DECLARATION, service, characteristic, NULL);
+        Attribute *value = addAttribute(CHARACTERISTIC_VALUE, service, characteristic, &characteristic->getValueAttribute());
+
+        /* A CCCD supplied by the application takes the place of the one
+         * added by the server. */
+        bool hasCCCD = false;
+        for (uint8_t j = 0; j < characteristic->getDescriptorCount(); ++j) {
+            if (characteristic->getDescriptor(j)->getUUID() == UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)) {
+                hasCCCD = true;
+            }
+        }
+        if (updatable && !hasCCCD) {
+            addAttribute(CCCD, service, characteristic, NULL);
+            value->cccdHandle = attributeCount;
+        }
+
+        for (uint8_t j = 0; j < characteristic->getDescriptorCount(); ++j) {
+            GattAttribute *descriptor = characteristic->getDescriptor(j);
+            if (updatable && (descriptor->getUUID() == UUID(BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG))) {
+                addAttribute(CCCD, service, characteristic, descriptor);
+                value->cccdHandle = attributeCount;
+            } else {
+                addAttribute(DESCRIPTOR, service, characteristic, descriptor);
+            }
+        }
+    }
+
+    serviceCount++;
+    characteristicCount += service.getCharacteristicCount();
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattServer::read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP)
+{
+    const Attribute *entry = getAttribute(attributeHandle);
+    if ((entry == NULL) || ((entry->kind != CHARACTERISTIC_VALUE) && (entry->kind != DESCRIPTOR))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    uint16_t length = (*lengthP < entry->length) ? *lengthP : entry->length;
+    if (buffer != NULL) {
+        memcpy(buffer, &storage[entry->valueOffset], length);
+    }
+    *lengthP = entry->length;
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattServer::read(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP)
+{
+    const Attribute *entry = getAttribute(attributeHandle);
+    if ((entry == NULL) || (entry->kind != CCCD)) {
+        return read(attributeHandle, buffer, lengthP);
+    }
+
+    /* Only CCCDs hold a value per connection. */
+    if (connectionHandle >= BLE_SIMULATOR_MAX_LINKS) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    uint16_t value = 0;
+    if (entry->notifyMask & (1 << connectionHandle)) {
+        value |= CCCD_NOTIFICATION;
+    }
+    if (entry->indicateMask & (1 << connectionHandle)) {
+        value |= CCCD_INDICATION;
+    }
+    if (*lengthP >= sizeof(value)) {
+        buffer[0] = (uint8_t)value;
+        buffer[1] = (uint8_t)(value >> 8);
+    }
+    *lengthP = sizeof(value);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattServer::write(GattAttribute::Handle_t attributeHandle, const uint8_t buffer[], uint16_t len, bool localOnly)
+{
+    Attribute *entry = getAttribute(attributeHandle);
+    if ((entry == NULL) || ((entry->kind != CHARACTERISTIC_VALUE) && (entry->kind != DESCRIPTOR))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (!updateValue(*entry, 0, buffer, len)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (localOnly || (entry->cccdHandle == GattAttribute::INVALID_HANDLE)) {
+        return BLE_ERROR_NONE;
+    }
+
+    /* Update every client which subscribed. */
+    const Attribute *cccd = getAttribute(entry->cccdHandle);
+    ble_error_t      rc   = BLE_ERROR_NONE;
+    for (Gap::Handle_t handle = 0; handle < BLE_SIMULATOR_MAX_LINKS; ++handle) {
+        bool notify   = (cccd->notifyMask & (1 << handle)) != 0;
+        bool indicate = (cccd->indicateMask & (1 << handle)) != 0;
+        SimulatedMedium::Link *link = medium.getLink(handle);
+        if ((link != NULL) && (notify || indicate)) {
+            ble_error_t error = sendUpdate(*link, *entry, !notify);
+            if (error != BLE_ERROR_NONE) {
+                rc = error;
+            }
+        }
+    }
+
+    return rc;
+}
+
+ble_error_t SimulatedGattServer::write(Gap::Handle_t connectionHandle, GattAttribute::Handle_t attributeHandle, const uint8_t buffer[], uint16_t len, bool localOnly)
+{
+    Attribute *entry = getAttribute(attributeHandle);
+    if ((entry == NULL) || ((entry->kind != CHARACTERISTIC_VALUE) && (entry->kind != DESCRIPTOR))) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (!updateValue(*entry, 0, buffer, len)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (localOnly || (entry->cccdHandle == GattAttribute::INVALID_HANDLE)) {
+        return BLE_ERROR_NONE;
+    }
+
+    SimulatedMedium::Link *link = medium.getLink(connectionHandle);
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    const Attribute *cccd = getAttribute(entry->cccdHandle);
+    bool notify   = (cccd->notifyMask & (1 << connectionHandle)) != 0;
+    bool indicate = (cccd->indicateMask & (1 << connectionHandle)) != 0;
+    if (!notify && !indicate) {
+        return BLE_ERROR_NONE;
+    }
+
+    return sendUpdate(*link, *entry, !notify);
+}
+
+ble_error_t SimulatedGattServer::areUpdatesEnabled(const GattCharacteristic &characteristic, bool *enabledP)
+{
+    const Attribute *entry = getAttribute(characteristic.getValueHandle());
+    if ((entry == NULL) || (entry->characteristic != &characteristic)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    *enabledP = false;
+    if (entry->cccdHandle != GattAttribute::INVALID_HANDLE) {
+        const Attribute *cccd = getAttribute(entry->cccdHandle);
+        *enabledP = (cccd->notifyMask | cccd->indicateMask) != 0;
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedGattServer::areUpdatesEnabled(Gap::Handle_t connectionHandle, const GattCharacteristic &characteristic, bool *enabledP)
+{
+    const Attribute *entry = getAttribute(characteristic.getValueHandle());
+    if ((entry == NULL) || (entry->characteristic != &characteristic) || (connectionHandle >= BLE_SIMULATOR_MAX_LINKS)) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    *enabledP = false;
+    if (entry->cccdHandle != GattAttribute::INVALID_HANDLE) {
+        const Attribute *cccd = getAttribute(entry->cccdHandle);
+        *enabledP = ((cccd->notifyMask | cccd->indicateMask) & (1 << connectionHandle)) != 0;
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+uint16_t SimulatedGattServer::getEffectiveMtu(Gap::Handle_t connectionHandle) const
+{
+    const SimulatedMedium::Link *link = medium.getLink(connectionHandle);
+    return (link != NULL) ? link->attMtu : BLE_GATT_MTU_SIZE_DEFAULT;
+}
+
+bool SimulatedGattServer::updateValue(Attribute &entry, uint16_t offset, const uint8_t *value, uint16_t length)
+{
+    if ((offset + length) > entry.maxLength) {
+        return false;
+    }
+
+    if (length) {
+        memcpy(&storage[entry.valueOffset + offset], value, length);
+    }
+    entry.length = offset + length;
+    return true;
+}
+
+ble_error_t SimulatedGattServer::sendUpdate(SimulatedMedium::Link &link, const Attribute &value, bool indicate)
+{
+    unsigned side = SimulatedMedium::getSide(link, &device);
+    if (indicate && link.indicationPending[side]) {
+        /* Indications wait for the confirmation of the previous one. */
+        return BLE_STACK_BUSY;
+    }
+
+    SimulatedMedium::Pdu pdu;
+    pdu.type            = indicate ? SimulatedMedium::Pdu::ATT_HANDLE_VALUE_IND : SimulatedMedium::Pdu::ATT_HANDLE_VALUE_NTF;
+    pdu.attributeHandle = (&value - attributes) + 1;
+    pdu.offset          = 0;
+    pdu.errorCode       = 0;
+    pdu.length          = value.length;
+    if (pdu.length > (link.attMtu - 3)) {
+        /* Updates carry at most ATT_MTU - 3 bytes of the value. */
+        pdu.length = link.attMtu - 3;
+    }
+    memcpy(pdu.data, &storage[value.valueOffset], pdu.length);
+
+    if (!medium.send(link, &device, pdu)) {
+        return BLE_ERROR_NO_MEM;
+    }
+    if (indicate) {
+        link.indicationPending[side] = true;
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+void SimulatedGattServer::sendError(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &request, uint16_t errorCode)
+{
+    SimulatedMedium::Pdu response;
+    response.type            = SimulatedMedium::Pdu::ATT_ERROR_RSP;
+    response.attributeHandle = request.attributeHandle;
+    response.offset          = 0;
+    response.errorCode       = errorCode;
+    response.length          = 0;
+    medium.send(link, &device, response);
+}
+
+void SimulatedGattServer::onPduReceived(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu)
+{
+    Attribute *entry = getAttribute(pdu.attributeHandle);
+
+    switch (pdu.type) {
+        case SimulatedMedium::Pdu::ATT_READ_REQ: {
+            if (entry == NULL) {
+                sendError(link, pdu, ATT_ERROR_INVALID_HANDLE);
+                return;
+            }
+            if ((entry->kind == SERVICE_DECLARATION) || (entry->kind == CHARACTERISTIC_DECLARATION) ||
+                ((entry->kind == CHARACTERISTIC_VALUE) &&
+                 !(entry->characteristic->getProperties() & GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ))) {
+                sendError(link, pdu, ATT_ERROR_READ_NOT_PERMITTED);
+                return;
+            }
+            if (pdu.offset > entry->length) {
+                sendError(link, pdu, ATT_ERROR_INVALID_OFFSET);
+                return;
+            }
+
+            if ((entry->kind == CHARACTERISTIC_VALUE) && entry->characteristic->isReadAuthorizationEnabled()) {
+                GattReadAuthCallbackParams authParams = {
+                    link.handle,
+                    pdu.attributeHandle,
+                    pdu.offset,
+                    0,
+                    NULL,
+                    AUTH_CALLBACK_REPLY_SUCCESS
+                };
+                GattAuthCallbackReply_t reply = entry->characteristic->authorizeRead(&authParams);
+                if (reply != AUTH_CALLBACK_REPLY_SUCCESS) {
+                    sendError(link, pdu, reply & 0xFF);
+                    return;
+                }
+                if (authParams.data != NULL) {
+                    updateValue(*entry, authParams.offset, authParams.data, authParams.len);
+                }
+            }
+
+            SimulatedMedium::Pdu response;
+            response.type            = SimulatedMedium::Pdu::ATT_READ_RSP;
+            response.attributeHandle = pdu.attributeHandle;
+            response.offset          = pdu.offset;
+            response.errorCode       = 0;
+            if (entry->kind == CCCD) {
+                uint16_t length = sizeof(response.data);
+                read(link.handle, pdu.attributeHandle, response.data, &length);
+                response.length = length;
+            } else {
+                response.length = entry->length - pdu.offset;
+                memcpy(response.data, &storage[entry->valueOffset + pdu.offset], response.length);
+            }
+            if (response.length > (link.attMtu - 1)) {
+                response.length = link.attMtu - 1;
+            }
+            medium.send(link, &device, response);
+
+            GattReadCallbackParams params;
+            params.connHandle = link.handle;
+            params.handle     = pdu.attributeHandle;
+            params.offset     = pdu.offset;
+            params.len        = response.length;
+            params.data       = response.data;
+            handleDataReadEvent(&params);
+            break;
+        }
+
+        case SimulatedMedium::Pdu::ATT_WRITE_REQ:
+        case SimulatedMedium::Pdu::ATT_WRITE_CMD: {
+            bool withResponse = (pdu.type == SimulatedMedium::Pdu::ATT_WRITE_REQ);
+            if (entry == NULL) {
+                if (withResponse) {
+                    sendError(link, pdu, ATT_ERROR_INVALID_HANDLE);
+                }
+                return;
+            }
+
+            uint8_t requiredProperty = withResponse ? GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE :
+                                                      GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE;
+            if ((entry->kind == SERVICE_DECLARATION) || (entry->kind == CHARACTERISTIC_DECLARATION) ||
+                ((entry->kind == CHARACTERISTIC_VALUE) && !(entry->characteristic->getProperties() & requiredProperty))) {
+                if (withResponse) {
+                    sendError(link, pdu, ATT_ERROR_WRITE_NOT_PERMITTED);
+                }
+                return;
+            }
+            if ((pdu.offset + pdu.length) > entry->maxLength) {
+                if (withResponse) {
+                    sendError(link, pdu, ATT_ERROR_INVALID_ATT_VAL_LENGTH);
+                }
+                return;
+            }
+
+            if (entry->kind == CCCD) {
+                uint16_t value = pdu.data[0] | (pdu.data[1] << 8);
+                uint16_t bit   = 1 << link.handle;
+                bool     wasEnabled = ((entry->notifyMask | entry->indicateMask) & bit) != 0;
+
+                entry->notifyMask   = (value & CCCD_NOTIFICATION) ? (entry->notifyMask | bit) : (entry->notifyMask & ~bit);
+                entry->indicateMask = (value & CCCD_INDICATION) ? (entry->indicateMask | bit) : (entry->indicateMask & ~bit);
+                if (withResponse) {
+                    SimulatedMedium::Pdu response;
+                    response.type            = SimulatedMedium::Pdu::ATT_WRITE_RSP;
+                    response.attributeHandle = pdu.attributeHandle;
+                    response.offset          = 0;
+                    response.errorCode       = 0;
+                    response.length          = 0;
+                    medium.send(link, &device, response);
+                }
+
+                bool isEnabled = ((entry->notifyMask | entry->indicateMask) & bit) != 0;
+                if (isEnabled != wasEnabled) {
+                    handleEvent(isEnabled ? GattServerEvents::GATT_EVENT_UPDATES_ENABLED : GattServerEvents::GATT_EVENT_UPDATES_DISABLED,
+                                entry->characteristic->getValueHandle());
+                }
+                return;
+            }
+
+            if ((entry->kind == CHARACTERISTIC_VALUE) && entry->characteristic->isWriteAuthorizationEnabled()) {
+                GattWriteAuthCallbackParams authParams = {
+                    link.handle,
+                    pdu.attributeHandle,
+                    pdu.offset,
+                    pdu.length,
+                    pdu.data,
+                    AUTH_CALLBACK_REPLY_SUCCESS
+                };
+                GattAuthCallbackReply_t reply = entry->characteristic->authorizeWrite(&authParams);
+                if (reply != AUTH_CALLBACK_REPLY_SUCCESS) {
+                    if (withResponse) {
+                        sendError(link, pdu, reply & 0xFF);
+                    }
+                    return;
+                }
+            }
+
+            updateValue(*entry, pdu.offset, pdu.data, pdu.length);
+            if (withResponse) {
+                SimulatedMedium::Pdu response;
+                response.type            = SimulatedMedium::Pdu::ATT_WRITE_RSP;
+                response.attributeHandle = pdu.attributeHandle;
+                response.offset          = 0;
+                response.errorCode       = 0;
+                response.length          = 0;
+                medium.send(link, &device, response);
+            }
+
+            GattWriteCallbackParams params;
+            params.connHandle = link.handle;
+            params.handle     = pdu.attributeHandle;
+            params.writeOp    = withResponse ? GattWriteCallbackParams::OP_WRITE_REQ : GattWriteCallbackParams::OP_WRITE_CMD;
+            params.offset     = pdu.offset;
+            params.len        = pdu.length;
+            params.data       = pdu.data;
+            handleDataWrittenEvent(&params);
+            break;
+        }
+
+        case SimulatedMedium::Pdu::ATT_HANDLE_VALUE_CFM:
+            link.indicationPending[SimulatedMedium::getSide(link, &device)] = false;
+            handleEvent(GattServerEvents::GATT_EVENT_CONFIRMATION_RECEIVED, pdu.attributeHandle);
+            break;
+
+        case SimulatedMedium::Pdu::ATT_EXCHANGE_MTU_REQ: {
+            /* Both sides use the smaller of the two Rx MTUs, and never less
+             * than the default. */
+            uint16_t mtu = (pdu.mtu < BLE_SIMULATOR_MAX_ATT_MTU) ? pdu.mtu : BLE_SIMULATOR_MAX_ATT_MTU;
+            if (mtu < BLE_GATT_MTU_SIZE_DEFAULT) {
+                mtu = BLE_GATT_MTU_SIZE_DEFAULT;
+            }
+
+            SimulatedMedium::Pdu response;
+            response.type            = SimulatedMedium::Pdu::ATT_EXCHANGE_MTU_RSP;
+            response.attributeHandle = GattAttribute::INVALID_HANDLE;
+            response.offset          = 0;
+            response.errorCode       = 0;
+            response.mtu             = BLE_SIMULATOR_MAX_ATT_MTU;
+            response.length          = 0;
+            medium.send(link, &device, response);
+            link.attMtu = mtu;
+
+            GattAttMtuChangeCallbackParams params;
+            params.connHandle = link.handle;
+            params.attMtu     = mtu;
+            handleAttMtuChangeEvent(&params);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void SimulatedGattServer::onPduDelivered(SimulatedMedium::Link &link, const SimulatedMedium::Pdu &pdu)
+{
+    (void)link;
+
+    if (pdu.type == SimulatedMedium::Pdu::ATT_HANDLE_VALUE_NTF) {
+        handleDataSentEvent(1);
+    }
+}
+
+void SimulatedGattServer::onLinkTerminated(Gap::Handle_t handle)
+{
+    uint16_t bit = 1 << handle;
+    for (uint16_t i = 0; i < attributeCount; ++i) {
+        attributes[i].notifyMask   &= ~bit;
+        attributes[i].indicateMask &= ~bit;
+    }
+}
+
+ble_error_t SimulatedGattServer::reset(void)
+{
+    /* Clear all state that is from the parent, including private members */
+    if (GattServer::reset() != BLE_ERROR_NONE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    attributeCount = 0;
+    storageUsed    = 0;
+
+    return BLE_ERROR_NONE;
+}
+
+#endif /* #ifdef BLE_SIMULATOR */
@@ -0,0 +1,497 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include <string.h>
+#include "ble/simulator/SimulatedMedium.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+/* Size of the L2CAP header preceding each ATT PDU. */
+static const uint16_t L2CAP_HEADER_LENGTH = 4;
+
+SimulatedMedium::SimulatedMedium() :
+    now(0),
+    timers(NULL),
+    deviceCount(0),
+    pathLoss(BLE_SIMULATOR_DEFAULT_PATH_LOSS),
+    rssiJitter(0),
+    randomState(1) {
+    memset(devices, 0, sizeof(devices));
+    memset(&statistics, 0, sizeof(statistics));
+    for (unsigned i = 0; i < BLE_SIMULATOR_MAX_LINKS; ++i) {
+        links[i].inUse  = false;
+        links[i].handle = i;
+        links[i].eventTimer.handler.attach(this, &SimulatedMedium::onConnectionEvent);
+    }
+}
+
+SimulatedMedium &SimulatedMedium::getDefault(void)
+{
+    static SimulatedMedium medium;
+    return medium;
+}
+
+bool SimulatedMedium::step(void)
+{
+    Timer *timer = timers;
+    if (timer == NULL) {
+        return false;
+    }
+
+    timers       = timer->next;
+    timer->next  = NULL;
+    timer->armed = false;
+    if (timer->deadline > now) {
+        now = timer->deadline;
+    }
+
+    ++statistics.timersRun;
+    timer->handler.call(timer);
+    return true;
+}
+
+void SimulatedMedium::runUntil(Time_t deadline)
+{
+    while ((timers != NULL) && (timers->deadline <= deadline)) {
+        step();
+    }
+    if (deadline > now) {
+        now = deadline;
+    }
+}
+
+void SimulatedMedium::armAt(Timer &timer, Time_t deadline)
+{
+    disarm(timer);
+
+    timer.deadline = deadline;
+    timer.armed    = true;
+
+    /* Timers expiring at the same time run in the order they were armed. */
+    Timer **position = &timers;
+    while ((*position != NULL) && ((*position)->deadline <= deadline)) {
+        position = &(*position)->next;
+    }
+    timer.next = *position;
+    *position  = &timer;
+}
+
+void SimulatedMedium::disarm(Timer &timer)
+{
+    if (!timer.armed) {
+        return;
+    }
+
+    for (Timer **position = &timers; *position != NULL; position = &(*position)->next) {
+        if (*position == &timer) {
+            *position = timer.next;
+            break;
+        }
+    }
+    timer.next  = NULL;
+    timer.armed = false;
+}
+
+uint32_t SimulatedMedium::random(uint32_t range)
+{
+    /* xorshift32 */
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return range ? (randomState % range) : 0;
+}
+
+int SimulatedMedium::registerDevice(SimulatedBLEInstance *device)
+{
+    if (deviceCount >= BLE_SIMULATOR_MAX_DEVICES) {
+        return -1;
+    }
+
+    devices[deviceCount] = device;
+    return deviceCount++;
+}
+
+void SimulatedMedium::broadcastAdvertisingPacket(SimulatedBLEInstance                    &advertiser,
+                                                 GapAdvertisingParams::AdvertisingType_t  type,
+                                                 const uint8_t                           *advertisingData,
+                                                 uint8_t                                  advertisingDataLen,
+                                                 const uint8_t                           *scanResponse,
+                                                 uint8_t                                  scanResponseLen,
+                                                 int8_t                                   txPower)
+{
+    ++statistics.advertisingPackets;
+
+    bool connectable = (type == GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED) ||
+                       (type == GapAdvertisingParams::ADV_CONNECTABLE_DIRECTED);
+    SimulatedBLEInstance *initiator = NULL;
+
+    for (unsigned i = 0; i < deviceCount; ++i) {
+        SimulatedBLEInstance *device = devices[i];
+        if ((device == &advertiser) || !device->hasInitialized()) {
+            continue;
+        }
+
+        SimulatedGap &gap = device->getSimulatedGap();
+        if (connectable && (initiator == NULL) && gap.isInitiatingTo(advertiser)) {
+            initiator = device;
+        }
+
+        int rssi = txPower - pathLoss;
+        if (rssiJitter) {
+            rssi += (int)random(2 * rssiJitter + 1) - rssiJitter;
+        }
+        if (rssi < -127) {
+            rssi = -127;
+        } else if (rssi > 20) {
+            rssi = 20;
+        }
+
+        statistics.advertisingReports += gap.receiveAdvertisingPacket(advertiser, type, advertisingData, advertisingDataLen,
+                                                                      scanResponse, scanResponseLen, (int8_t)rssi);
+    }
+
+    if (initiator != NULL) {
+        establishLink(*initiator, advertiser);
+    }
+}
+
+SimulatedMedium::Link *SimulatedMedium::getLink(Gap::Handle_t handle)
+{
+    if ((handle >= BLE_SIMULATOR_MAX_LINKS) || !links[handle].inUse) {
+        return NULL;
+    }
+    return &links[handle];
+}
+
+bool SimulatedMedium::send(Link &link, const SimulatedBLEInstance *sender, const Pdu &pdu)
+{
+    Link::Queue &queue = link.queues[getSide(link, sender)];
+    if (queue.count >= BLE_SIMULATOR_LINK_QUEUE_SIZE) {
+        return false;
+    }
+
+    queue.pdus[(queue.head + queue.count) % BLE_SIMULATOR_LINK_QUEUE_SIZE] = pdu;
+    if (queue.count++ == 0) {
+        queue.fragmentsSent = 0;
+    }
+    return true;
+}
+
+unsigned SimulatedMedium::getFreeQueueSlots(const Link &link, const SimulatedBLEInstance *sender) const
+{
+    return BLE_SIMULATOR_LINK_QUEUE_SIZE - link.queues[getSide(link, sender)].count;
+}
+
+void SimulatedMedium::terminate(Link &link, const SimulatedBLEInstance *device, Gap::DisconnectionReason_t reason)
+{
+    if (link.terminating) {
+        return;
+    }
+
+    link.terminating       = true;
+    link.terminatingSide   = getSide(link, device);
+    link.terminationReason = reason;
+}
+
+void SimulatedMedium::dropLinks(const SimulatedBLEInstance *device)
+{
+    for (unsigned i = 0; i < BLE_SIMULATOR_MAX_LINKS; ++i) {
+        Link &link = links[i];
+        if (!link.inUse || ((link.central != device) && (link.peripheral != device))) {
+            continue;
+        }
+
+        SimulatedBLEInstance *peer = getPeer(link, device);
+        link.inUse = false;
+        disarm(link.eventTimer);
+
+        peer->getSimulatedGattServer().onLinkTerminated(link.handle);
+        peer->getSimulatedGattClient().onLinkTerminated(link.handle);
+        peer->getSimulatedGap().onLinkTerminated(link.handle, Gap::CONNECTION_TIMEOUT);
+    }
+}
+
+void SimulatedMedium::establishLink(SimulatedBLEInstance &central, SimulatedBLEInstance &peripheral)
+{
+    Link *link = NULL;
+    for (unsigned i = 0; i < BLE_SIMULATOR_MAX_LINKS; ++i) {
+        if (!links[i].inUse) {
+            link = &links[i];
+            break;
+        }
+    }
+    if (link == NULL) {
+        /* The initiator keeps waiting for the next advertising packet. */
+        return;
+    }
+
+    link->inUse              = true;
+    link->central            = &central;
+    link->peripheral         = &peripheral;
+    link->params             = central.getSimulatedGap().getInitiationParams();
+    link->exchangesInEvent   = 0;
+    link->terminating        = false;
+    link->terminatingSide    = Link::FROM_CENTRAL;
+    link->terminationReason  = 0;
+    link->encrypted          = false;
+    link->encryptionPending  = false;
+    link->securityMode       = SecurityManager::SECURITY_MODE_ENCRYPTION_OPEN_LINK;
+    link->attMtu             = BLE_GATT_MTU_SIZE_DEFAULT;
+    link->mtuExchanged       = false;
+    link->maxTxOctets        = Gap::DATA_LENGTH_DEFAULT;
+    link->phy                = Gap::PHY_1M;
+    link->eventCount         = 0;
+    for (unsigned side = 0; side < 2; ++side) {
+        link->requestPending[side]         = false;
+        link->indicationPending[side]      = false;
+        link->queues[side].head            = 0;
+        link->queues[side].count           = 0;
+        link->queues[side].fragmentsSent   = 0;
+    }
+
+    /* The controllers start the updates suggested by their hosts at the
+     * first connection event. Connections stay on the 1M PHY unless one of
+     * the devices doesn't accept it. */
+    SimulatedGap &centralGap    = central.getSimulatedGap();
+    SimulatedGap &peripheralGap = peripheral.getSimulatedGap();
+    uint16_t      suggestedTxOctets = centralGap.getPreferredDataLength();
+    if (peripheralGap.getPreferredDataLength() > suggestedTxOctets) {
+        suggestedTxOctets = peripheralGap.getPreferredDataLength();
+    }
+    link->dataLengthPending = (suggestedTxOctets > Gap::DATA_LENGTH_DEFAULT);
+    link->pendingTxOctets   = suggestedTxOctets;
+    link->pendingPhy        = selectPhy(centralGap.getPreferredPhys() & peripheralGap.getPreferredPhys());
+    link->phyPending        = (link->pendingPhy != 0) && (link->pendingPhy != Gap::PHY_1M) &&
+                              !(centralGap.getPreferredPhys() & peripheralGap.getPreferredPhys() & Gap::PHY_1M);
+
+    /* The first connection event follows the connection request after the
+     * transmit window delay. */
+    link->anchor = now + 2 * Gap::UNIT_1_25_MS;
+    armAt(link->eventTimer, link->anchor);
+
+    peripheral.getSimulatedGap().onLinkEstablished(*link, Gap::PERIPHERAL);
+    central.getSimulatedGap().onLinkEstablished(*link, Gap::CENTRAL);
+}
+
+void SimulatedMedium::closeLink(Link &link, unsigned initiatingSide, uint8_t reason)
+{
+    SimulatedBLEInstance *devicesOfLink[2] = { link.central, link.peripheral };
+
+    link.inUse = false;
+    disarm(link.eventTimer);
+
+    for (unsigned side = 0; side < 2; ++side) {
+        SimulatedBLEInstance *device = devicesOfLink[side];
+        device->getSimulatedGattServer().onLinkTerminated(link.handle);
+        device->getSimulatedGattClient().onLinkTerminated(link.handle);
+    }
+    for (unsigned side = 0; side < 2; ++side) {
+        Gap::DisconnectionReason_t sideReason = (side == initiatingSide) ?
+            Gap::LOCAL_HOST_TERMINATED_CONNECTION : static_cast<Gap::DisconnectionReason_t>(reason);
+        devicesOfLink[side]->getSimulatedGap().onLinkTerminated(link.handle, sideReason);
+    }
+}
+
+void SimulatedMedium::onConnectionEvent(Timer *timer)
+{
+    Link *link = NULL;
+    for (unsigned i = 0; i < BLE_SIMULATOR_MAX_LINKS; ++i) {
+        if (&links[i].eventTimer == timer) {
+            link = &links[i];
+            break;
+        }
+    }
+    if ((link == NULL) || !link->inUse) {
+        return;
+    }
+
+    SimulatedBLEInstance *central    = link->central;
+    SimulatedBLEInstance *peripheral = link->peripheral;
+
+    if (link->exchangesInEvent == 0) {
+        /* Start of a connection event. */
+        ++link->eventCount;
+        ++statistics.connectionEvents;
+
+        if (link->terminating) {
+            closeLink(*link, link->terminatingSide, link->terminationReason);
+            return;
+        }
+
+        if (link->encryptionPending) {
+            link->encryptionPending = false;
+            link->encrypted         = true;
+            central->getSimulatedSecurityManager().onLinkSecured(*link);
+            peripheral->getSimulatedSecurityManager().onLinkSecured(*link);
+        }
+
+        /* Link layer control procedures complete within one event. */
+        if (link->dataLengthPending) {
+            link->dataLengthPending = false;
+            link->maxTxOctets       = link->pendingTxOctets;
+            central->getSimulatedGap().onLinkDataLengthUpdated(*link);
+            peripheral->getSimulatedGap().onLinkDataLengthUpdated(*link);
+        }
+        if (link->phyPending) {
+            link->phyPending = false;
+            link->phy        = link->pendingPhy;
+            central->getSimulatedGap().onLinkPhyUpdated(*link);
+            peripheral->getSimulatedGap().onLinkPhyUpdated(*link);
+        }
+
+        central->getSimulatedGattClient().onConnectionEvent(*link);
+        peripheral->getSimulatedGattClient().onConnectionEvent(*link);
+        if (!link->inUse || (link->central != central)) {
+            return;
+        }
+    }
+
+    Time_t duration = exchange(*link);
+    if (!link->inUse || (link->central != central)) {
+        /* The link was dropped by one of the devices. */
+        return;
+    }
+    ++link->exchangesInEvent;
+
+    /* The event goes on while there is data to send and time left before
+     * the next anchor point. */
+    Time_t interval = (Time_t)link->params.minConnectionInterval * Gap::UNIT_1_25_MS;
+    Time_t nextExchangeEnd = (now - link->anchor) + 2 * duration;
+    bool moreData = (link->queues[Link::FROM_CENTRAL].count != 0) ||
+                    (link->queues[Link::FROM_PERIPHERAL].count != 0);
+    if (moreData &&
+        !link->terminating &&
+        (link->exchangesInEvent < BLE_SIMULATOR_MAX_PACKETS_PER_EVENT) &&
+        (nextExchangeEnd <= interval)) {
+        arm(link->eventTimer, duration);
+        return;
+    }
+
+    link->exchangesInEvent = 0;
+    link->anchor += interval;
+    if (link->anchor <= now) {
+        link->anchor = now + interval;
+    }
+    armAt(link->eventTimer, link->anchor);
+}
+
+SimulatedMedium::Time_t SimulatedMedium::exchange(Link &link)
+{
+    Pdu      received[2];
+    bool     complete[2] = { false, false };
+    Time_t   duration    = 0;
+
+    /* The central transmits, then the peripheral answers; an empty packet
+     * is sent by a side which has nothing to send. */
+    for (unsigned side = 0; side < 2; ++side) {
+        Link::Queue &queue  = link.queues[side];
+        uint16_t     octets = 0;
+
+        if (queue.count) {
+            const Pdu &pdu       = queue.pdus[queue.head];
+            uint16_t   length    = getLinkLayerLength(pdu);
+            uint16_t   sent      = queue.fragmentsSent * link.maxTxOctets;
+            uint16_t   remaining = length - sent;
+
+            octets = (remaining > link.maxTxOctets) ? link.maxTxOctets : remaining;
+            ++queue.fragmentsSent;
+            if (sent + octets >= length) {
+                received[side] = pdu;
+                complete[side] = true;
+                queue.head = (queue.head + 1) % BLE_SIMULATOR_LINK_QUEUE_SIZE;
+                --queue.count;
+                queue.fragmentsSent = 0;
+            }
+        }
+
+        duration += getAirTime(link, octets) + T_IFS;
+    }
+
+    SimulatedBLEInstance *central = link.central;
+    for (unsigned side = 0; side < 2; ++side) {
+        if (complete[side]) {
+            deliver(link, side, received[side]);
+            if (!link.inUse || (link.central != central)) {
+                break;
+            }
+        }
+    }
+
+    return duration;
+}
+
+void SimulatedMedium::deliver(Link &link, unsigned side, const Pdu &pdu)
+{
+    SimulatedBLEInstance *sender   = (side == Link::FROM_CENTRAL) ? link.central : link.peripheral;
+    SimulatedBLEInstance *receiver = getPeer(link, sender);
+
+    ++statistics.pdusDelivered;
+    statistics.pduBytesDelivered += getLinkLayerLength(pdu);
+
+    switch (pdu.type) {
+        case Pdu::ATT_ERROR_RSP:
+        case Pdu::ATT_READ_RSP:
+        case Pdu::ATT_WRITE_RSP:
+        case Pdu::ATT_EXCHANGE_MTU_RSP:
+            link.requestPending[1 - side] = false;
+            receiver->getSimulatedGattClient().onPduReceived(link, pdu);
+            break;
+        case Pdu::ATT_HANDLE_VALUE_NTF:
+            receiver->getSimulatedGattClient().onPduReceived(link, pdu);
+            if (link.inUse) {
+                sender->getSimulatedGattServer().onPduDelivered(link, pdu);
+            }
+            break;
+        case Pdu::ATT_HANDLE_VALUE_IND:
+            receiver->getSimulatedGattClient().onPduReceived(link, pdu);
+            break;
+        default:
+            receiver->getSimulatedGattServer().onPduReceived(link, pdu);
+            break;
+    }
+}
+
+uint16_t SimulatedMedium::getLinkLayerLength(const Pdu &pdu)
+{
+    uint16_t attLength;
+    switch (pdu.type) {
+        case Pdu::ATT_ERROR_RSP:
+            attLength = 5;
+            break;
+        case Pdu::ATT_READ_REQ:
+            attLength = pdu.offset ? 5 : 3;
+            break;
+        case Pdu::ATT_WRITE_RSP:
+        case Pdu::ATT_HANDLE_VALUE_CFM:
+            attLength = 1;
+            break;
+        case Pdu::ATT_EXCHANGE_MTU_REQ:
+        case Pdu::ATT_EXCHANGE_MTU_RSP:
+            attLength = 3;
+            break;
+        case Pdu::ATT_READ_RSP:
+            attLength = 1 + pdu.length;
+            break;
+        default:
+            /* Opcode and attribute handle followed by the value. */
+            attLength = 3 + pdu.length;
+            break;
+    }
+    return L2CAP_HEADER_LENGTH + attLength;
+}
+
+#endif /* #ifdef BLE_SIMULATOR */
@@ -0,0 +1,111 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef BLE_SIMULATOR
+
+#include "ble/simulator/SimulatedSecurityManager.h"
+#include "ble/simulator/SimulatedBLEInstance.h"
+
+SimulatedSecurityManager::SimulatedSecurityManager(SimulatedMedium &mediumIn, SimulatedBLEInstance &deviceIn) :
+    SecurityManager(),
+    medium(mediumIn),
+    device(deviceIn),
+    initialized(false),
+    bondingEnabled(false),
+    mitmRequired(false),
+    ioCapabilities(IO_CAPS_NONE) {
+    /* empty */
+}
+
+ble_error_t SimulatedSecurityManager::init(bool                     enableBonding,
+                                           bool                     requireMITM,
+                                           SecurityIOCapabilities_t iocaps,
+                                           const Passkey_t          passkey)
+{
+    (void)passkey;
+
+    initialized    = true;
+    bondingEnabled = enableBonding;
+    mitmRequired   = requireMITM;
+    ioCapabilities = iocaps;
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedSecurityManager::getLinkSecurity(Gap::Handle_t connectionHandle, LinkSecurityStatus_t *securityStatusP)
+{
+    const SimulatedMedium::Link *link = medium.getLink(connectionHandle);
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    if (link->encrypted) {
+        *securityStatusP = ENCRYPTED;
+    } else if (link->encryptionPending) {
+        *securityStatusP = ENCRYPTION_IN_PROGRESS;
+    } else {
+        *securityStatusP = NOT_ENCRYPTED;
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedSecurityManager::setLinkSecurity(Gap::Handle_t connectionHandle, SecurityMode_t securityMode)
+{
+    if (!initialized) {
+        return BLE_ERROR_INITIALIZATION_INCOMPLETE;
+    }
+
+    SimulatedMedium::Link *link = medium.getLink(connectionHandle);
+    if (link == NULL) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+    if (link->encryptionPending) {
+        return BLE_STACK_BUSY;
+    }
+
+    link->encryptionPending = true;
+    link->securityMode      = securityMode;
+    processSecuritySetupInitiatedEvent(connectionHandle, bondingEnabled, mitmRequired, ioCapabilities);
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t SimulatedSecurityManager::purgeAllBondingState(void)
+{
+    /* No bond is ever stored. */
+    return BLE_ERROR_NONE;
+}
+
+void SimulatedSecurityManager::onLinkSecured(const SimulatedMedium::Link &link)
+{
+    processSecuritySetupCompletedEvent(link.handle, SEC_STATUS_SUCCESS);
+    processLinkSecuredEvent(link.handle, static_cast<SecurityMode_t>(link.securityMode));
+}
+
+ble_error_t SimulatedSecurityManager::reset(void)
+{
+    /* Clear all state that is from the parent, including private members */
+    if (SecurityManager::reset() != BLE_ERROR_NONE) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+
+    initialized = false;
+
+    return BLE_ERROR_NONE;
+}
+
+#endif /* #ifdef BLE_SIMULATOR */